@@ -35,6 +35,12 @@ static bool isNeo = false;
 static bool playBGM = false;
 static bool isTrophyPopupDisabled = false;
 static int BGMvolume = 50;
+static std::string audioBackend = "sdl";
+static std::string videoDecoderThreading = "auto";
+static int videoDecoderThreads = 0; // 0 lets the decoder pick based on core count
+static int avPlayerPrefetchMs = 500;
+static int zlibWorkerThreads = 0; // 0 sizes the inflate pool from the core count
+static int pngDecodeCacheSize = 32; // MiB, 0 disables the cache
 static bool enableDiscordRPC = false;
 static u32 screenWidth = 1280;
 static u32 screenHeight = 720;
@@ -55,9 +61,15 @@ static bool isAutoUpdate = false;
 static bool isAlwaysShowChangelog = false;
 static bool isNullGpu = false;
 static bool shouldCopyGPUBuffers = false;
+static bool readbacksEnabled = false;
+static bool threadedSubmitEnabled = false;
 static bool shouldDumpShaders = false;
 static bool shouldPatchShaders = true;
 static u32 vblankDivider = 1;
+static std::string framePacingMode = "vblank";
+static u32 frameQueueDepthLimit = 1;
+static bool isHeadless = false;
+static std::string frameTimingsPath = "";
 static bool vkValidation = false;
 static bool vkValidationSync = false;
 static bool vkValidationGpu = false;
@@ -264,6 +276,30 @@ bool alwaysShowChangelog() {
     return isAlwaysShowChangelog;
 }
 
+std::string getAudioBackend() {
+    return audioBackend;
+}
+
+std::string getVideoDecoderThreading() {
+    return videoDecoderThreading;
+}
+
+int getVideoDecoderThreads() {
+    return videoDecoderThreads;
+}
+
+int getAvPlayerPrefetchMs() {
+    return avPlayerPrefetchMs;
+}
+
+int getZlibWorkerThreads() {
+    return zlibWorkerThreads;
+}
+
+int getPngDecodeCacheSize() {
+    return pngDecodeCacheSize;
+}
+
 bool nullGpu() {
     return isNullGpu;
 }
@@ -272,6 +308,14 @@ bool copyGPUCmdBuffers() {
     return shouldCopyGPUBuffers;
 }
 
+bool readbacks() {
+    return readbacksEnabled;
+}
+
+bool threadedSubmit() {
+    return threadedSubmitEnabled;
+}
+
 bool dumpShaders() {
     return shouldDumpShaders;
 }
@@ -292,6 +336,22 @@ u32 vblankDiv() {
     return vblankDivider;
 }
 
+std::string framePacing() {
+    return framePacingMode;
+}
+
+u32 frameQueueDepth() {
+    return frameQueueDepthLimit;
+}
+
+bool headless() {
+    return isHeadless;
+}
+
+std::string getFrameTimingsPath() {
+    return frameTimingsPath;
+}
+
 bool vkValidationEnabled() {
     return vkValidation;
 }
@@ -384,6 +444,14 @@ void setCopyGPUCmdBuffers(bool enable) {
     shouldCopyGPUBuffers = enable;
 }
 
+void setReadbacks(bool enable) {
+    readbacksEnabled = enable;
+}
+
+void setThreadedSubmit(bool enable) {
+    threadedSubmitEnabled = enable;
+}
+
 void setDumpShaders(bool enable) {
     shouldDumpShaders = enable;
 }
@@ -404,6 +472,22 @@ void setVblankDiv(u32 value) {
     vblankDivider = value;
 }
 
+void setFramePacing(const std::string& mode) {
+    framePacingMode = mode;
+}
+
+void setFrameQueueDepth(u32 depth) {
+    frameQueueDepthLimit = depth;
+}
+
+void setHeadless(bool enable) {
+    isHeadless = enable;
+}
+
+void setFrameTimingsPath(const std::string& path) {
+    frameTimingsPath = path;
+}
+
 void setIsFullscreen(bool enable) {
     isFullscreen = enable;
 }
@@ -707,6 +791,13 @@ void load(const std::filesystem::path& path) {
         playBGM = toml::find_or<bool>(general, "playBGM", false);
         isTrophyPopupDisabled = toml::find_or<bool>(general, "isTrophyPopupDisabled", false);
         BGMvolume = toml::find_or<int>(general, "BGMvolume", 50);
+        audioBackend = toml::find_or<std::string>(general, "audioBackend", "sdl");
+        videoDecoderThreading =
+            toml::find_or<std::string>(general, "videoDecoderThreading", "auto");
+        videoDecoderThreads = toml::find_or<int>(general, "videoDecoderThreads", 0);
+        avPlayerPrefetchMs = toml::find_or<int>(general, "avPlayerPrefetchMs", 500);
+        zlibWorkerThreads = toml::find_or<int>(general, "zlibWorkerThreads", 0);
+        pngDecodeCacheSize = toml::find_or<int>(general, "pngDecodeCacheSize", 32);
         enableDiscordRPC = toml::find_or<bool>(general, "enableDiscordRPC", true);
         logFilter = toml::find_or<std::string>(general, "logFilter", "");
         logType = toml::find_or<std::string>(general, "logType", "sync");
@@ -745,9 +836,15 @@ void load(const std::filesystem::path& path) {
         screenHeight = toml::find_or<int>(gpu, "screenHeight", screenHeight);
         isNullGpu = toml::find_or<bool>(gpu, "nullGpu", false);
         shouldCopyGPUBuffers = toml::find_or<bool>(gpu, "copyGPUBuffers", false);
+        readbacksEnabled = toml::find_or<bool>(gpu, "readbacks", false);
+        threadedSubmitEnabled = toml::find_or<bool>(gpu, "threadedSubmit", false);
         shouldDumpShaders = toml::find_or<bool>(gpu, "dumpShaders", false);
         shouldPatchShaders = toml::find_or<bool>(gpu, "patchShaders", true);
         vblankDivider = toml::find_or<int>(gpu, "vblankDivider", 1);
+        framePacingMode = toml::find_or<std::string>(gpu, "framePacing", "vblank");
+        frameQueueDepthLimit = toml::find_or<int>(gpu, "frameQueueDepth", 1);
+        isHeadless = toml::find_or<bool>(gpu, "headless", false);
+        frameTimingsPath = toml::find_or<std::string>(gpu, "frameTimingsPath", "");
         isFullscreen = toml::find_or<bool>(gpu, "Fullscreen", false);
         fullscreenMode = toml::find_or<std::string>(gpu, "FullscreenMode", "Windowed");
         isHDRAllowed = toml::find_or<bool>(gpu, "allowHDR", false);
@@ -858,6 +955,12 @@ void save(const std::filesystem::path& path) {
     data["General"]["isTrophyPopupDisabled"] = isTrophyPopupDisabled;
     data["General"]["playBGM"] = playBGM;
     data["General"]["BGMvolume"] = BGMvolume;
+    data["General"]["audioBackend"] = audioBackend;
+    data["General"]["videoDecoderThreading"] = videoDecoderThreading;
+    data["General"]["videoDecoderThreads"] = videoDecoderThreads;
+    data["General"]["avPlayerPrefetchMs"] = avPlayerPrefetchMs;
+    data["General"]["zlibWorkerThreads"] = zlibWorkerThreads;
+    data["General"]["pngDecodeCacheSize"] = pngDecodeCacheSize;
     data["General"]["enableDiscordRPC"] = enableDiscordRPC;
     data["General"]["logFilter"] = logFilter;
     data["General"]["logType"] = logType;
@@ -881,9 +984,15 @@ void save(const std::filesystem::path& path) {
     data["GPU"]["screenHeight"] = screenHeight;
     data["GPU"]["nullGpu"] = isNullGpu;
     data["GPU"]["copyGPUBuffers"] = shouldCopyGPUBuffers;
+    data["GPU"]["readbacks"] = readbacksEnabled;
+    data["GPU"]["threadedSubmit"] = threadedSubmitEnabled;
     data["GPU"]["dumpShaders"] = shouldDumpShaders;
     data["GPU"]["patchShaders"] = shouldPatchShaders;
     data["GPU"]["vblankDivider"] = vblankDivider;
+    data["GPU"]["framePacing"] = framePacingMode;
+    data["GPU"]["frameQueueDepth"] = frameQueueDepthLimit;
+    data["GPU"]["headless"] = isHeadless;
+    data["GPU"]["frameTimingsPath"] = frameTimingsPath;
     data["GPU"]["Fullscreen"] = isFullscreen;
     data["GPU"]["FullscreenMode"] = fullscreenMode;
     data["GPU"]["allowHDR"] = isHDRAllowed;
@@ -972,6 +1081,12 @@ void setDefaultValues() {
     isTrophyPopupDisabled = false;
     playBGM = false;
     BGMvolume = 50;
+    audioBackend = "sdl";
+    videoDecoderThreading = "auto";
+    videoDecoderThreads = 0;
+    avPlayerPrefetchMs = 500;
+    zlibWorkerThreads = 0;
+    pngDecodeCacheSize = 32;
     enableDiscordRPC = true;
     screenWidth = 1280;
     screenHeight = 720;
@@ -995,8 +1110,14 @@ void setDefaultValues() {
     isAutoUpdate = false;
     isAlwaysShowChangelog = false;
     isNullGpu = false;
+    readbacksEnabled = false;
+    threadedSubmitEnabled = false;
     shouldDumpShaders = false;
     vblankDivider = 1;
+    framePacingMode = "vblank";
+    frameQueueDepthLimit = 1;
+    isHeadless = false;
+    frameTimingsPath = "";
     vkValidation = false;
     vkValidationSync = false;
     vkValidationGpu = false;
@@ -25,6 +25,12 @@ std::string getFullscreenMode();
 bool isNeoModeConsole();
 bool getPlayBGM();
 int getBGMvolume();
+std::string getAudioBackend();
+std::string getVideoDecoderThreading();
+int getVideoDecoderThreads();
+int getAvPlayerPrefetchMs();
+int getZlibWorkerThreads();
+int getPngDecodeCacheSize();
 bool getisTrophyPopupDisabled();
 bool getEnableDiscordRPC();
 bool getSeparateUpdateEnabled();
@@ -64,11 +70,17 @@ bool autoUpdate();
 bool alwaysShowChangelog();
 bool nullGpu();
 bool copyGPUCmdBuffers();
+bool readbacks();
+bool threadedSubmit();
 bool dumpShaders();
 bool patchShaders();
 bool isRdocEnabled();
 bool fpsColor();
 u32 vblankDiv();
+std::string framePacing();
+u32 frameQueueDepth();
+bool headless();
+std::string getFrameTimingsPath();
 
 void setDebugDump(bool enable);
 void setCollectShaderForDebug(bool enable);
@@ -78,8 +90,14 @@ void setAlwaysShowChangelog(bool enable);
 void setNullGpu(bool enable);
 void setAllowHDR(bool enable);
 void setCopyGPUCmdBuffers(bool enable);
+void setReadbacks(bool enable);
+void setThreadedSubmit(bool enable);
 void setDumpShaders(bool enable);
 void setVblankDiv(u32 value);
+void setFramePacing(const std::string& mode);
+void setFrameQueueDepth(u32 depth);
+void setHeadless(bool enable);
+void setFrameTimingsPath(const std::string& path);
 void setGpuId(s32 selectedGpuId);
 void setScreenWidth(u32 width);
 void setScreenHeight(u32 height);
@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+namespace Common {
+
+/// Lock-free single producer, single consumer ring buffer of trivially copyable elements.
+template <typename T, std::size_t Capacity>
+class RingBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+public:
+    /// Pushes as many elements as fit, returning the number of elements pushed.
+    std::size_t Push(std::span<const T> data) {
+        const std::size_t write_index = m_write_index.load(std::memory_order::relaxed);
+        const std::size_t read_index = m_read_index.load(std::memory_order::acquire);
+        const std::size_t count = std::min(data.size(), Capacity - (write_index - read_index));
+
+        const std::size_t pos = write_index % Capacity;
+        const std::size_t first = std::min(count, Capacity - pos);
+        std::memcpy(&m_data[pos], data.data(), first * sizeof(T));
+        std::memcpy(&m_data[0], data.data() + first, (count - first) * sizeof(T));
+
+        m_write_index.store(write_index + count, std::memory_order::release);
+        return count;
+    }
+
+    /// Pops up to output.size() elements, returning the number of elements popped.
+    std::size_t Pop(std::span<T> output) {
+        const std::size_t read_index = m_read_index.load(std::memory_order::relaxed);
+        const std::size_t write_index = m_write_index.load(std::memory_order::acquire);
+        const std::size_t count = std::min(output.size(), write_index - read_index);
+
+        const std::size_t pos = read_index % Capacity;
+        const std::size_t first = std::min(count, Capacity - pos);
+        std::memcpy(output.data(), &m_data[pos], first * sizeof(T));
+        std::memcpy(output.data() + first, &m_data[0], (count - first) * sizeof(T));
+
+        m_read_index.store(read_index + count, std::memory_order::release);
+        return count;
+    }
+
+    /// Discards up to count elements from the consumer side.
+    std::size_t Discard(std::size_t count) {
+        const std::size_t read_index = m_read_index.load(std::memory_order::relaxed);
+        const std::size_t write_index = m_write_index.load(std::memory_order::acquire);
+        count = std::min(count, write_index - read_index);
+        m_read_index.store(read_index + count, std::memory_order::release);
+        return count;
+    }
+
+    [[nodiscard]] std::size_t Size() const {
+        return m_write_index.load(std::memory_order::acquire) -
+               m_read_index.load(std::memory_order::acquire);
+    }
+
+    [[nodiscard]] static constexpr std::size_t GetCapacity() {
+        return Capacity;
+    }
+
+private:
+    alignas(128) std::atomic_size_t m_read_index{0};
+    alignas(128) std::atomic_size_t m_write_index{0};
+    std::array<T, Capacity> m_data;
+};
+
+} // namespace Common
@@ -38,6 +38,11 @@ public:
 
     void End();
 
+    /// Accounts for time spent waiting outside of Start, which then sleeps that much less.
+    void Consume(std::chrono::nanoseconds time) {
+        total_wait -= time;
+    }
+
     std::chrono::nanoseconds GetTotalWait() const {
         return total_wait;
     }
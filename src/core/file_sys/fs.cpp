@@ -23,7 +23,19 @@ void MntPoints::Mount(const std::filesystem::path& host_folder, const std::strin
                       bool read_only) {
     std::scoped_lock lock{m_mutex};
     const auto guest_folder_sanitized = RemoveTrailingSlashes(guest_folder);
-    m_mnt_pairs.emplace_back(host_folder, guest_folder_sanitized, read_only);
+
+    // Only the application mounts are overlaid by an update folder. Check its presence once here
+    // rather than probing the host filesystem on every lookup.
+    std::filesystem::path patch_folder;
+    if (guest_folder_sanitized == "/app0" || guest_folder_sanitized == "/hostapp") {
+        patch_folder = host_folder;
+        patch_folder += "-UPDATE";
+        if (!std::filesystem::is_directory(patch_folder)) {
+            patch_folder.clear();
+        }
+    }
+    m_mnt_pairs.emplace_back(host_folder, guest_folder_sanitized, read_only, patch_folder);
+    ClearCaches();
 }
 
 void MntPoints::Unmount(const std::filesystem::path& host_folder, const std::string& guest_folder) {
@@ -33,21 +45,103 @@ void MntPoints::Unmount(const std::filesystem::path& host_folder, const std::str
         return pair.mount == guest_folder_sanitized;
     });
     m_mnt_pairs.erase(it, m_mnt_pairs.end());
+    ClearCaches();
 }
 
 void MntPoints::UnmountAll() {
     std::scoped_lock lock{m_mutex};
     m_mnt_pairs.clear();
+    ClearCaches();
+}
+
+void MntPoints::ClearCaches() {
+    dir_index.clear();
+    resolved_cache.clear();
+}
+
+void MntPoints::InvalidateHostPath(const std::filesystem::path& host_path) {
+    std::scoped_lock lock{m_mutex};
+    dir_index.erase(host_path);
+    dir_index.erase(host_path.parent_path());
+    // Resolved paths below a renamed or removed folder are stale as well, and a new entry may
+    // shadow a base file with an update one. Mutations are rare compared to lookups.
+    resolved_cache.clear();
+}
+
+const MntPoints::DirectoryIndex* MntPoints::GetDirectoryIndex(const std::filesystem::path& host_dir,
+                                                              bool rebuild) {
+    if (!rebuild) {
+        if (const auto it = dir_index.find(host_dir); it != dir_index.end()) {
+            return &it->second;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::directory_iterator dir_it{host_dir, ec};
+    if (ec) {
+        dir_index.erase(host_dir);
+        return nullptr;
+    }
+    DirectoryIndex index;
+    for (const auto& entry : dir_it) {
+        auto name = entry.path().filename().string();
+        index.try_emplace(Common::ToLower(name), std::move(name));
+    }
+    return &(dir_index[host_dir] = std::move(index));
+}
+
+std::optional<std::filesystem::path> MntPoints::ResolvePath(const std::filesystem::path& root,
+                                                            std::string_view rel_path) {
+    // Walk the relative path one component at a time, matching each against the lowercase
+    // index of its parent folder. Once the indices are warm no host filesystem access is made.
+    std::filesystem::path current_path = root;
+    while (!rel_path.empty()) {
+        const auto sep = rel_path.find('/');
+        const auto part = rel_path.substr(0, sep);
+        rel_path = sep == std::string_view::npos ? std::string_view{} : rel_path.substr(sep + 1);
+        if (part.empty()) {
+            continue;
+        }
+        if (part == "." || part == "..") {
+            current_path /= part;
+            continue;
+        }
+        const auto part_low = Common::ToLower(part);
+        const auto* index = GetDirectoryIndex(current_path, false);
+        if (!index) {
+            return std::nullopt;
+        }
+        auto it = index->find(part_low);
+        if (it == index->end()) {
+            // The folder may have changed behind our back (e.g by save data or host tools),
+            // so rescan it once before giving up.
+            index = GetDirectoryIndex(current_path, true);
+            if (!index) {
+                return std::nullopt;
+            }
+            it = index->find(part_low);
+            if (it == index->end()) {
+                return std::nullopt;
+            }
+        }
+        // Multiple entries may only differ in case, prefer the exact one if it exists.
+        if (it->second != part && std::filesystem::exists(current_path / part)) {
+            current_path /= part;
+        } else {
+            current_path /= it->second;
+        }
+    }
+    return current_path;
 }
 
 std::filesystem::path MntPoints::GetHostPath(std::string_view path, bool* is_read_only,
                                              bool force_base_path) {
     // Evil games like Turok2 pass double slashes e.g /app0//game.kpf
-    std::string corrected_path(path);
-    size_t pos = corrected_path.find("//");
-    while (pos != std::string::npos) {
-        corrected_path.replace(pos, 2, "/");
-        pos = corrected_path.find("//", pos + 1);
+    std::string corrected_path;
+    corrected_path.reserve(path.size());
+    for (const char c : path) {
+        if (c != '/' || !corrected_path.ends_with('/')) {
+            corrected_path.push_back(c);
+        }
     }
 
     const MntPair* mount = GetMount(corrected_path);
@@ -67,83 +161,53 @@ std::filesystem::path MntPoints::GetHostPath(std::string_view path, bool* is_rea
 
     // Remove device (e.g /app0) from path to retrieve relative path.
     const auto rel_path = std::string_view{corrected_path}.substr(mount->mount.size() + 1);
-    std::filesystem::path host_path = mount->host_path / rel_path;
-    std::filesystem::path patch_path = mount->host_path;
-    patch_path += "-UPDATE";
-    patch_path /= rel_path;
+    const std::filesystem::path host_path = mount->host_path / rel_path;
+    const bool use_patch = !force_base_path && !mount->patch_path.empty();
 
-    if ((corrected_path.starts_with("/app0") || corrected_path.starts_with("/hostapp")) &&
-        !force_base_path && std::filesystem::exists(patch_path)) {
-        return patch_path;
+    std::scoped_lock lk{m_mutex};
+    // Base and patch lookups of the same guest path may resolve differently.
+    std::string cache_key = corrected_path;
+    cache_key.push_back(use_patch ? 'p' : 'b');
+    if (const auto it = resolved_cache.find(cache_key); it != resolved_cache.end()) {
+        return it->second;
     }
 
-    if (!NeedsCaseInsensitiveSearch) {
-        return host_path;
-    }
-
-    const auto search = [&](const auto host_path) {
-        // If the path does not exist attempt to verify this.
-        // Retrieve parent path until we find one that exists.
-        std::scoped_lock lk{m_mutex};
-        path_parts.clear();
-        auto current_path = host_path;
-        while (!std::filesystem::exists(current_path)) {
-            // We have probably cached this if it's a folder.
-            if (auto it = path_cache.find(current_path); it != path_cache.end()) {
-                current_path = it->second;
-                break;
+    const auto resolve =
+        [&](const std::filesystem::path& root) -> std::optional<std::filesystem::path> {
+        if (!NeedsCaseInsensitiveSearch) {
+            auto candidate = root / rel_path;
+            if (!std::filesystem::exists(candidate)) {
+                return std::nullopt;
             }
-            path_parts.emplace_back(current_path.filename());
-            current_path = current_path.parent_path();
+            return candidate;
         }
-        // We have found an anchor. Traverse parts we recoded and see if they
-        // exist in filesystem but in different case.
-        auto guest_path = current_path;
-        while (!path_parts.empty()) {
-            const auto part = path_parts.back();
-            const auto add_match = [&](const auto& host_part) {
-                current_path /= host_part;
-                guest_path /= part;
-                path_cache[guest_path] = current_path;
-                path_parts.pop_back();
-            };
-            // Can happen when the mismatch is in upper folder.
-            if (std::filesystem::exists(current_path / part)) {
-                add_match(part);
-                continue;
-            }
-            const auto part_low = Common::ToLower(part.string());
-            bool found_match = false;
-            for (const auto& path : std::filesystem::directory_iterator(current_path)) {
-                const auto candidate = path.path().filename();
-                const auto filename = Common::ToLower(candidate.string());
-                // Check if a filename matches in case insensitive manner.
-                if (filename != part_low) {
-                    continue;
-                }
-                // We found a match, record the actual path in the cache.
-                add_match(candidate);
-                found_match = true;
-                break;
-            }
-            if (!found_match) {
-                return std::optional<std::filesystem::path>({});
-            }
+        return ResolvePath(root, rel_path);
+    };
+
+    const auto cache = [&](const std::filesystem::path& resolved) -> std::filesystem::path {
+        if (resolved_cache.size() >= MaxResolvedPaths) {
+            resolved_cache.clear();
         }
-        return std::optional<std::filesystem::path>(current_path);
+        return resolved_cache[cache_key] = resolved;
     };
 
-    if (!force_base_path) {
-        if (const auto path = search(patch_path)) {
-            return *path;
+    if (use_patch) {
+        if (const auto patch_path = resolve(mount->patch_path)) {
+            return cache(*patch_path);
         }
     }
-    if (const auto path = search(host_path)) {
-        return *path;
+
+    if (!NeedsCaseInsensitiveSearch) {
+        return host_path;
+    }
+
+    if (const auto resolved_path = ResolvePath(mount->host_path, rel_path)) {
+        return cache(*resolved_path);
     }
 
     // Opening the guest path will surely fail but at least gives
-    // a better error message than the empty path.
+    // a better error message than the empty path. Misses are not cached, the file may be
+    // created behind the guest file system and is found by the rescan then.
     return host_path;
 }
 
@@ -5,6 +5,7 @@
 
 #include <atomic>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 #include <tsl/robin_map.h>
@@ -20,11 +21,15 @@ class MntPoints {
 #else
     static constexpr bool NeedsCaseInsensitiveSearch = true;
 #endif
+    /// Resolved guest paths kept before the cache is dropped and refilled.
+    static constexpr size_t MaxResolvedPaths = 8192;
+
 public:
     struct MntPair {
         std::filesystem::path host_path;
         std::string mount; // e.g /app0
         bool read_only;
+        std::filesystem::path patch_path; // e.g CUSA00001-UPDATE, empty if there is no update
     };
 
     explicit MntPoints() = default;
@@ -42,6 +47,9 @@ public:
     void IterateDirectory(std::string_view guest_directory,
                           const IterateDirectoryCallback& callback);
 
+    /// Drops cached lookups affected by a create, rename or removal of the given host path.
+    void InvalidateHostPath(const std::filesystem::path& host_path);
+
     const MntPair* GetMountFromHostPath(const std::string& host_path) {
         std::scoped_lock lock{m_mutex};
         const auto it = std::ranges::find_if(m_mnt_pairs, [&](const MntPair& mount) {
@@ -60,10 +68,19 @@ public:
         return it == m_mnt_pairs.end() ? nullptr : &*it;
     }
 
+private:
+    /// Maps lowercase entry names of a host directory to their actual name.
+    using DirectoryIndex = tsl::robin_map<std::string, std::string>;
+
+    const DirectoryIndex* GetDirectoryIndex(const std::filesystem::path& host_dir, bool rebuild);
+    std::optional<std::filesystem::path> ResolvePath(const std::filesystem::path& root,
+                                                     std::string_view rel_path);
+    void ClearCaches();
+
 private:
     std::vector<MntPair> m_mnt_pairs;
-    std::vector<std::filesystem::path> path_parts;
-    tsl::robin_map<std::filesystem::path, std::filesystem::path> path_cache;
+    tsl::robin_map<std::filesystem::path, DirectoryIndex> dir_index;
+    tsl::robin_map<std::string, std::filesystem::path> resolved_cache;
     std::mutex m_mutex;
 };
 
@@ -13,6 +13,8 @@
 #include "core/libraries/ajm/ajm_mp3.h"
 #include "core/libraries/error_codes.h"
 
+#include <algorithm>
+#include <chrono>
 #include <span>
 #include <utility>
 
@@ -21,7 +23,13 @@ namespace Libraries::Ajm {
 static constexpr u32 ORBIS_AJM_WAIT_INFINITE = -1;
 
 AjmContext::AjmContext() {
-    worker_thread = std::jthread([this](std::stop_token stop) { this->WorkerThread(stop); });
+    // Batches of different instances are independent, so decode them on a few host cores.
+    const u32 num_workers = std::clamp(std::thread::hardware_concurrency() / 4, 1U, 4U);
+    worker_threads.reserve(num_workers);
+    for (u32 i = 0; i < num_workers; ++i) {
+        worker_threads.emplace_back(
+            [this, i](std::stop_token stop) { this->WorkerThread(stop, i); });
+    }
 }
 
 bool AjmContext::IsRegistered(AjmCodecType type) const {
@@ -54,14 +62,50 @@ s32 AjmContext::ModuleRegister(AjmCodecType type) {
     return ORBIS_OK;
 }
 
-void AjmContext::WorkerThread(std::stop_token stop) {
-    Common::SetCurrentThreadName("shadPS4:AjmWorker");
+bool AjmContext::TryPopRunnableBatch(PendingBatch& out_batch) {
+    // Instances referenced by a running batch or by an earlier pending batch are blocked, so that
+    // the jobs of each instance still execute in submission order.
+    tsl::robin_set<u32> blocked = busy_instances;
+    auto best = pending_batches.end();
+    for (auto it = pending_batches.begin(); it != pending_batches.end(); ++it) {
+        const bool runnable = std::ranges::none_of(
+            it->instance_ids, [&](u32 instance_id) { return blocked.contains(instance_id); });
+        // Lower values have higher priority, ties are resolved in submission order.
+        if (runnable && (best == pending_batches.end() || it->priority < best->priority)) {
+            best = it;
+        }
+        blocked.insert(it->instance_ids.begin(), it->instance_ids.end());
+    }
+    if (best == pending_batches.end()) {
+        return false;
+    }
+    busy_instances.insert(best->instance_ids.begin(), best->instance_ids.end());
+    out_batch = std::move(*best);
+    pending_batches.erase(best);
+    return true;
+}
+
+void AjmContext::WorkerThread(std::stop_token stop, u32 index) {
+    const auto thread_name = fmt::format("shadPS4:AjmWorker{}", index);
+    Common::SetCurrentThreadName(thread_name.c_str());
     while (!stop.stop_requested()) {
-        auto batch = batch_queue.PopWait(stop);
-        if (batch != nullptr) {
-            ProcessBatch(batch->id, batch->jobs);
-            batch->finished.release();
+        PendingBatch pending{};
+        {
+            std::unique_lock lock{queue_mutex};
+            if (!queue_cv.wait(lock, stop, [&] { return TryPopRunnableBatch(pending); })) {
+                break;
+            }
         }
+        ProcessBatch(pending.batch->id, pending.batch->jobs);
+        {
+            std::scoped_lock lock{queue_mutex};
+            for (const u32 instance_id : pending.instance_ids) {
+                busy_instances.erase(instance_id);
+            }
+        }
+        // Batches blocked on the instances we just released may now be runnable.
+        queue_cv.notify_all();
+        pending.batch->finished.release();
     }
 }
 
@@ -82,7 +126,11 @@ void AjmContext::ProcessBatch(u32 id, std::span<AjmJob> jobs) {
                 instance = *p_instance;
             }
 
+            const auto start = std::chrono::steady_clock::now();
             instance->ExecuteJob(job);
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            instance->AddDecodeTime(elapsed);
+            AjmInstanceStatistics::Getinstance().RecordJob(instance->GetCodecType(), elapsed);
         }
     }
 }
@@ -142,7 +190,19 @@ int AjmContext::BatchStartBuffer(u8* p_batch, u32 batch_size, const int priority
     batch_info->id = *out_batch_id;
 
     if (!batch_info->jobs.empty()) {
-        batch_queue.EmplaceWait(batch_info);
+        PendingBatch pending{batch_info, {}, priority};
+        for (const auto& job : batch_info->jobs) {
+            if (job.instance_id != AJM_INSTANCE_STATISTICS &&
+                std::ranges::find(pending.instance_ids, job.instance_id) ==
+                    pending.instance_ids.end()) {
+                pending.instance_ids.push_back(job.instance_id);
+            }
+        }
+        {
+            std::scoped_lock lock{queue_mutex};
+            pending_batches.emplace_back(std::move(pending));
+        }
+        queue_cv.notify_one();
     } else {
         // Empty batches are not submitted to the processor and are marked as finished
         batch_info->finished.release();
@@ -177,6 +237,12 @@ s32 AjmContext::InstanceCreate(AjmCodecType codec_type, AjmInstanceFlags flags,
 
 s32 AjmContext::InstanceDestroy(u32 instance) {
     std::unique_lock lock(instances_mutex);
+    if (const auto* p_instance = instances.Get(instance); p_instance != nullptr) {
+        LOG_DEBUG(Lib_Ajm, "instance = {} total decode time = {} us", instance,
+                  std::chrono::duration_cast<std::chrono::microseconds>(
+                      (*p_instance)->GetDecodeTime())
+                      .count());
+    }
     if (!instances.Destroy(instance)) {
         return ORBIS_AJM_ERROR_INVALID_INSTANCE;
     }
@@ -3,19 +3,24 @@
 
 #pragma once
 
-#include "common/bounded_threadsafe_queue.h"
 #include "common/slot_array.h"
 #include "common/types.h"
 #include "core/libraries/ajm/ajm.h"
 #include "core/libraries/ajm/ajm_batch.h"
 #include "core/libraries/ajm/ajm_instance.h"
 
+#include <boost/container/small_vector.hpp>
+#include <tsl/robin_set.h>
+
 #include <array>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <span>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace Libraries::Ajm {
 
@@ -32,16 +37,26 @@ public:
     s32 BatchStartBuffer(u8* p_batch, u32 batch_size, const int priority,
                          AjmBatchError* p_batch_error, u32* p_batch_id);
 
-    void WorkerThread(std::stop_token stop);
+    void WorkerThread(std::stop_token stop, u32 index);
     void ProcessBatch(u32 id, std::span<AjmJob> jobs);
 
 private:
+    struct PendingBatch {
+        std::shared_ptr<AjmBatch> batch;
+        boost::container::small_vector<u32, 8> instance_ids;
+        int priority{};
+    };
+
     static constexpr u32 MaxInstances = 0x2fff;
     static constexpr u32 MaxBatches = 0x0400;
     static constexpr u32 NumAjmCodecs = std::to_underlying(AjmCodecType::Max);
 
     [[nodiscard]] bool IsRegistered(AjmCodecType type) const;
 
+    /// Pops the highest priority batch that does not touch an instance still in use by a running
+    /// or earlier submitted batch. Must be called with queue_mutex held.
+    bool TryPopRunnableBatch(PendingBatch& out_batch);
+
     std::array<bool, NumAjmCodecs> registered_codecs{};
 
     std::shared_mutex instances_mutex;
@@ -50,8 +65,12 @@ private:
     std::shared_mutex batches_mutex;
     Common::SlotArray<u32, std::shared_ptr<AjmBatch>, MaxBatches, 1> batches;
 
-    std::jthread worker_thread{};
-    Common::MPSCQueue<std::shared_ptr<AjmBatch>> batch_queue;
+    std::mutex queue_mutex;
+    std::condition_variable_any queue_cv;
+    std::vector<PendingBatch> pending_batches; ///< In submission order.
+    tsl::robin_set<u32> busy_instances;
+
+    std::vector<std::jthread> worker_threads;
 };
 
 } // namespace Libraries::Ajm
@@ -35,7 +35,8 @@ u8 GetPCMSize(AjmFormatEncoding format) {
     }
 }
 
-AjmInstance::AjmInstance(AjmCodecType codec_type, AjmInstanceFlags flags) : m_flags(flags) {
+AjmInstance::AjmInstance(AjmCodecType codec_type, AjmInstanceFlags flags)
+    : m_codec_type(codec_type), m_flags(flags) {
     switch (codec_type) {
     case AjmCodecType::At9Dec: {
         m_codec = std::make_unique<AjmAt9Decoder>(AjmFormatEncoding(flags.format),
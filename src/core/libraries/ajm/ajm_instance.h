@@ -8,6 +8,8 @@
 #include "core/libraries/ajm/ajm.h"
 #include "core/libraries/ajm/ajm_batch.h"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <tuple>
@@ -86,10 +88,24 @@ public:
 
     void ExecuteJob(AjmJob& job);
 
+    AjmCodecType GetCodecType() const {
+        return m_codec_type;
+    }
+
+    /// Total host time spent executing jobs of this instance.
+    std::chrono::nanoseconds GetDecodeTime() const {
+        return std::chrono::nanoseconds{m_decode_time_ns.load(std::memory_order_relaxed)};
+    }
+
+    void AddDecodeTime(std::chrono::nanoseconds time) {
+        m_decode_time_ns.fetch_add(time.count(), std::memory_order_relaxed);
+    }
+
 private:
     bool HasEnoughSpace(const SparseOutputBuffer& output) const;
     std::optional<u32> GetNumRemainingSamples() const;
 
+    AjmCodecType m_codec_type{};
     AjmInstanceFlags m_flags{};
     AjmSidebandFormat m_format{};
     AjmInstanceGapless m_gapless{};
@@ -97,6 +113,7 @@ private:
     u32 m_total_samples{};
     std::unique_ptr<AjmCodec> m_codec;
     bool is_initialized = false;
+    std::atomic<s64> m_decode_time_ns{};
 };
 
 } // namespace Libraries::Ajm
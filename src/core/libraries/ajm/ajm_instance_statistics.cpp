@@ -4,20 +4,56 @@
 #include "core/libraries/ajm/ajm.h"
 #include "core/libraries/ajm/ajm_instance_statistics.h"
 
+#include <algorithm>
+#include <numeric>
+
 namespace Libraries::Ajm {
 
+void AjmInstanceStatistics::RecordJob(AjmCodecType codec_type, std::chrono::nanoseconds time) {
+    std::scoped_lock lock{m_mutex};
+    m_codec_time[std::to_underlying(codec_type)] += time;
+}
+
 void AjmInstanceStatistics::ExecuteJob(AjmJob& job) {
+    // Report the decode time accumulated since the previous statistics query, relative to the
+    // wall time that has passed in between.
+    std::array<std::chrono::nanoseconds, NumAjmCodecs> codec_time;
+    std::chrono::nanoseconds elapsed;
+    {
+        std::scoped_lock lock{m_mutex};
+        const auto now = std::chrono::steady_clock::now();
+        elapsed = now - m_last_query;
+        m_last_query = now;
+        codec_time = std::exchange(m_codec_time, {});
+    }
+    const auto busy_time =
+        std::accumulate(codec_time.begin(), codec_time.end(), std::chrono::nanoseconds{});
+    const float usage =
+        elapsed.count() > 0
+            ? std::min(static_cast<float>(busy_time.count()) / elapsed.count(), 1.0f)
+            : 0.0f;
+
     if (job.output.p_engine) {
-        job.output.p_engine->usage_batch = 0.01;
-        const auto ic = job.input.statistics_engine_parameters->interval_count;
+        job.output.p_engine->usage_batch = usage;
+        const auto ic = std::min(job.input.statistics_engine_parameters->interval_count, 3U);
         for (u32 idx = 0; idx < ic; ++idx) {
-            job.output.p_engine->usage_interval[idx] = 0.01;
+            job.output.p_engine->usage_interval[idx] = usage;
         }
     }
     if (job.output.p_engine_per_codec) {
-        job.output.p_engine_per_codec->codec_count = 1;
-        job.output.p_engine_per_codec->codec_id[0] = static_cast<u8>(AjmCodecType::At9Dec);
-        job.output.p_engine_per_codec->codec_percentage[0] = 0.01;
+        // Report the three busiest codecs.
+        std::array<u32, NumAjmCodecs> codecs;
+        std::iota(codecs.begin(), codecs.end(), 0);
+        std::ranges::partial_sort(codecs, codecs.begin() + 3, std::ranges::greater{},
+                                  [&](u32 codec) { return codec_time[codec]; });
+        auto* per_codec = job.output.p_engine_per_codec;
+        per_codec->codec_count = 0;
+        for (u32 i = 0; i < 3 && codec_time[codecs[i]].count() > 0; ++i) {
+            per_codec->codec_id[i] = static_cast<u8>(codecs[i]);
+            per_codec->codec_percentage[i] =
+                static_cast<float>(codec_time[codecs[i]].count()) / busy_time.count();
+            ++per_codec->codec_count;
+        }
     }
     if (job.output.p_memory) {
         job.output.p_memory->instance_free = 0x400000;
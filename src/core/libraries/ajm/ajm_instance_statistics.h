@@ -5,13 +5,28 @@
 
 #include "core/libraries/ajm/ajm_batch.h"
 
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <utility>
+
 namespace Libraries::Ajm {
 
 class AjmInstanceStatistics {
 public:
     void ExecuteJob(AjmJob& job);
 
+    /// Accounts host time spent decoding a job of the given codec.
+    void RecordJob(AjmCodecType codec_type, std::chrono::nanoseconds time);
+
     static AjmInstanceStatistics& Getinstance();
+
+private:
+    static constexpr u32 NumAjmCodecs = std::to_underlying(AjmCodecType::Max);
+
+    std::mutex m_mutex;
+    std::array<std::chrono::nanoseconds, NumAjmCodecs> m_codec_time{};
+    std::chrono::steady_clock::time_point m_last_query{std::chrono::steady_clock::now()};
 };
 
 } // namespace Libraries::Ajm
@@ -0,0 +1,253 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/arch.h"
+#include "common/logging/log.h"
+#include "common/path_util.h"
+#include "common/ring_buffer.h"
+#include "common/thread.h"
+#include "core/libraries/audio/audioout.h"
+#include "core/libraries/audio/audioout_backend.h"
+
+#ifdef ARCH_X86_64
+#include <xmmintrin.h>
+#endif
+
+namespace Libraries::AudioOut {
+
+namespace {
+
+constexpr u32 MixerSampleRate = 48000;
+constexpr u32 MixerPeriodFrames = 256;
+
+/// Ports are mixed in a fixed 7.1 layout: FL, FR, FC, LFE, BL, BR, SL, SR.
+constexpr u32 MixChannels = 8;
+constexpr u32 ChFL = 0, ChFR = 1, ChFC = 2, ChBL = 4, ChBR = 5, ChSL = 6, ChSR = 7;
+
+/// Multiply-accumulates 8 channel frames from src into dst with per-channel gains.
+void MixFrames(float* dst, const float* src, const std::array<float, MixChannels>& gains,
+               u32 num_frames) {
+#ifdef ARCH_X86_64
+    const __m128 gain_lo = _mm_loadu_ps(&gains[0]);
+    const __m128 gain_hi = _mm_loadu_ps(&gains[4]);
+    for (u32 i = 0; i < num_frames * MixChannels; i += MixChannels) {
+        const __m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), gain_lo);
+        const __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4), gain_hi);
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), lo));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), hi));
+    }
+#else
+    for (u32 i = 0; i < num_frames * MixChannels; i += MixChannels) {
+        for (u32 ch = 0; ch < MixChannels; ++ch) {
+            dst[i + ch] += src[i + ch] * gains[ch];
+        }
+    }
+#endif
+}
+
+/// Converts the 7.1 mix into the sink layout, clamping samples to the valid range.
+void Downmix(std::span<float> out, std::span<const float> mix, u32 out_channels) {
+    const u32 num_frames = static_cast<u32>(mix.size() / MixChannels);
+    if (out_channels == MixChannels) {
+        std::ranges::transform(mix, out.begin(),
+                               [](float sample) { return std::clamp(sample, -1.0f, 1.0f); });
+        return;
+    }
+    // ITU-R BS.775 stereo downmix, LFE is dropped.
+    constexpr float Center = 0.7071f;
+    constexpr float Surround = 0.7071f;
+    for (u32 i = 0; i < num_frames; ++i) {
+        const float* in = &mix[i * MixChannels];
+        const float left = in[ChFL] + Center * in[ChFC] + Surround * (in[ChBL] + in[ChSL]);
+        const float right = in[ChFR] + Center * in[ChFC] + Surround * (in[ChBR] + in[ChSR]);
+        out[i * 2 + 0] = std::clamp(left, -1.0f, 1.0f);
+        out[i * 2 + 1] = std::clamp(right, -1.0f, 1.0f);
+    }
+}
+
+} // Anonymous namespace
+
+class MixerPortBackend;
+
+class AudioMixer {
+public:
+    explicit AudioMixer(std::unique_ptr<AudioSink> sink_) : sink{std::move(sink_)} {
+        mix_buffer.resize(MixerPeriodFrames * MixChannels);
+        port_buffer.resize(MixerPeriodFrames * MixChannels);
+        output_buffer.resize(MixerPeriodFrames * sink->NumChannels());
+        mixer_thread = std::jthread([this](std::stop_token stop) { MixerThread(stop); });
+    }
+
+    void AddPort(MixerPortBackend* port) {
+        std::scoped_lock lock{ports_mutex};
+        ports.push_back(port);
+    }
+
+    void RemovePort(MixerPortBackend* port) {
+        std::scoped_lock lock{ports_mutex};
+        std::erase(ports, port);
+    }
+
+private:
+    void MixerThread(std::stop_token stop);
+
+    std::unique_ptr<AudioSink> sink;
+    std::mutex ports_mutex;
+    std::vector<MixerPortBackend*> ports;
+    std::vector<float> mix_buffer;
+    std::vector<float> port_buffer;
+    std::vector<float> output_buffer;
+    std::jthread mixer_thread;
+};
+
+class MixerPortBackend final : public PortBackend {
+public:
+    explicit MixerPortBackend(AudioMixer& mixer_, const PortOut& port)
+        : mixer{mixer_}, format_info{port.format_info}, buffer_frames{port.buffer_frames},
+          convert_buffer(port.buffer_frames * MixChannels) {
+        for (auto& gain : gains) {
+            gain = 1.0f;
+        }
+        mixer.AddPort(this);
+    }
+
+    ~MixerPortBackend() override {
+        mixer.RemovePort(this);
+        LOG_DEBUG(Lib_AudioOut, "Closing mixer port, {} underruns", num_underruns);
+    }
+
+    void Output(void* ptr) override {
+        // Convert to float in the mixer channel layout here, so the work is spread over the
+        // port threads and the mixer only needs to scale and accumulate.
+        const u32 num_channels = format_info.num_channels;
+        const auto read_sample = [&](u32 index) {
+            if (format_info.is_float) {
+                return static_cast<const float*>(ptr)[index];
+            }
+            return static_cast<const s16*>(ptr)[index] / 32768.0f;
+        };
+        std::ranges::fill(convert_buffer, 0.0f);
+        for (u32 frame = 0; frame < buffer_frames; ++frame) {
+            float* out = &convert_buffer[frame * MixChannels];
+            const u32 base = frame * num_channels;
+            if (num_channels == 1) {
+                out[ChFL] = out[ChFR] = read_sample(base);
+                continue;
+            }
+            for (u32 ch = 0; ch < num_channels; ++ch) {
+                out[ch] = read_sample(base + format_info.channel_layout[ch]);
+            }
+        }
+        if (ring.Push(convert_buffer) != convert_buffer.size()) {
+            LOG_WARNING(Lib_AudioOut, "Mixer port buffer overflow, dropping samples");
+        }
+    }
+
+    void SetVolume(const std::array<int, 8>& ch_volumes) override {
+        const u32 num_channels = format_info.num_channels;
+        if (num_channels == 1) {
+            const float gain = static_cast<float>(ch_volumes[0]) / SCE_AUDIO_OUT_VOLUME_0DB;
+            gains[ChFL].store(gain, std::memory_order_relaxed);
+            gains[ChFR].store(gain, std::memory_order_relaxed);
+            return;
+        }
+        for (u32 ch = 0; ch < num_channels; ++ch) {
+            const auto volume = ch_volumes[format_info.channel_layout[ch]];
+            gains[ch].store(static_cast<float>(volume) / SCE_AUDIO_OUT_VOLUME_0DB,
+                            std::memory_order_relaxed);
+        }
+    }
+
+    /// Called from the mixer thread to accumulate num_frames of this port into mix.
+    void MixInto(std::span<float> mix, std::span<float> scratch, u32 num_frames) {
+        u32 available = static_cast<u32>(ring.Size() / MixChannels);
+        if (!primed) {
+            // Wait until a port buffer plus some slack for timer jitter is queued,
+            // so that the regular port cadence does not cause underruns.
+            if (available < buffer_frames + MixerPeriodFrames * 2) {
+                return;
+            }
+            primed = true;
+        }
+        // Bound latency in case the port runs ahead of the mixer.
+        const u32 max_frames = buffer_frames * 4;
+        if (available > max_frames) {
+            ring.Discard((available - buffer_frames) * MixChannels);
+            available = buffer_frames;
+        }
+        const u32 frames = std::min(available, num_frames);
+        if (frames < num_frames) {
+            ++num_underruns;
+            primed = false;
+        }
+        ring.Pop(scratch.first(frames * MixChannels));
+
+        std::array<float, MixChannels> frame_gains;
+        for (u32 ch = 0; ch < MixChannels; ++ch) {
+            frame_gains[ch] = gains[ch].load(std::memory_order_relaxed);
+        }
+        MixFrames(mix.data(), scratch.data(), frame_gains, frames);
+    }
+
+private:
+    static constexpr size_t RingFrames = 8192;
+
+    AudioMixer& mixer;
+    AudioFormatInfo format_info;
+    u32 buffer_frames;
+    std::vector<float> convert_buffer;
+    std::array<std::atomic<float>, MixChannels> gains{};
+    Common::RingBuffer<float, RingFrames * MixChannels> ring;
+    bool primed{};
+    u64 num_underruns{};
+};
+
+void AudioMixer::MixerThread(std::stop_token stop) {
+    Common::SetCurrentThreadName("shadPS4:AudioMixer");
+    Common::AccurateTimer timer(
+        std::chrono::nanoseconds(1000000000ULL * MixerPeriodFrames / MixerSampleRate));
+    while (!stop.stop_requested()) {
+        timer.Start();
+        std::ranges::fill(mix_buffer, 0.0f);
+        {
+            std::scoped_lock lock{ports_mutex};
+            for (auto* port : ports) {
+                port->MixInto(mix_buffer, port_buffer, MixerPeriodFrames);
+            }
+        }
+        Downmix(output_buffer, mix_buffer, sink->NumChannels());
+        sink->Output(output_buffer);
+        timer.End();
+    }
+}
+
+MixerAudioOut::MixerAudioOut(std::unique_ptr<AudioSink> sink)
+    : mixer{std::make_unique<AudioMixer>(std::move(sink))} {}
+
+MixerAudioOut::~MixerAudioOut() = default;
+
+std::unique_ptr<PortBackend> MixerAudioOut::Open(PortOut& port) {
+    return std::make_unique<MixerPortBackend>(*mixer, port);
+}
+
+std::unique_ptr<AudioSink> CreateAudioSink(std::string_view backend) {
+    if (backend == "null") {
+        return std::make_unique<NullAudioSink>();
+    }
+    if (backend == "wav") {
+        return std::make_unique<WavAudioSink>(
+            Common::FS::GetUserPath(Common::FS::PathType::LogDir) / "audio_out.wav");
+    }
+    if (backend != "sdl") {
+        LOG_WARNING(Lib_AudioOut, "Unknown audio backend {}, falling back to SDL", backend);
+    }
+    return std::make_unique<SDLAudioSink>();
+}
+
+} // namespace Libraries::AudioOut
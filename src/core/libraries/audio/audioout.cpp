@@ -22,6 +22,7 @@ std::mutex port_open_mutex{};
 std::array<PortOut, SCE_AUDIO_OUT_NUM_PORTS> ports_out{};
 
 static std::unique_ptr<AudioOutBackend> audio;
+static bool is_initialized{};
 
 static AudioFormatInfo GetFormatInfo(const OrbisAudioOutParamFormat format) {
     static constexpr std::array<AudioFormatInfo, 8> format_infos = {{
@@ -237,12 +238,19 @@ int PS4_SYSV_ABI sceAudioOutGetSystemState() {
     return ORBIS_OK;
 }
 
+void StartBackend() {
+    if (audio == nullptr) {
+        audio = std::make_unique<MixerAudioOut>(CreateAudioSink(Config::getAudioBackend()));
+    }
+}
+
 int PS4_SYSV_ABI sceAudioOutInit() {
     LOG_TRACE(Lib_AudioOut, "called");
-    if (audio != nullptr) {
+    if (is_initialized) {
         return ORBIS_AUDIO_OUT_ERROR_ALREADY_INIT;
     }
-    audio = std::make_unique<SDLAudioOut>();
+    StartBackend();
+    is_initialized = true;
     return ORBIS_OK;
 }
 
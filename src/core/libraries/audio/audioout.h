@@ -173,5 +173,9 @@ int PS4_SYSV_ABI sceAudioOutSystemControlSet();
 int PS4_SYSV_ABI sceAudioOutSparkControlSetEqCoef();
 int PS4_SYSV_ABI sceAudioOutSetSystemDebugState();
 
+/// Starts the output backend for libraries rendering through AudioOut ports, without
+/// initializing AudioOut on behalf of the guest.
+void StartBackend();
+
 void RegisterlibSceAudioOut(Core::Loader::SymbolsResolver* sym);
 } // namespace Libraries::AudioOut
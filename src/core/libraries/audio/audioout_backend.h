@@ -3,9 +3,21 @@
 
 #pragma once
 
+#include <array>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "common/io_file.h"
+#include "common/types.h"
+
+struct SDL_AudioStream;
+
 namespace Libraries::AudioOut {
 
 struct PortOut;
+class AudioMixer;
 
 class PortBackend {
 public:
@@ -26,9 +38,79 @@ public:
     virtual std::unique_ptr<PortBackend> Open(PortOut& port) = 0;
 };
 
-class SDLAudioOut final : public AudioOutBackend {
+/// Host audio device receiving the final mix as interleaved 48 kHz float frames.
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    /// Number of interleaved channels per frame, either 2 (stereo) or 8 (7.1).
+    [[nodiscard]] virtual u32 NumChannels() const = 0;
+
+    virtual void Output(std::span<const float> samples) = 0;
+};
+
+/// Mixes all ports in process and feeds the result to a single audio sink.
+class MixerAudioOut final : public AudioOutBackend {
 public:
+    explicit MixerAudioOut(std::unique_ptr<AudioSink> sink);
+    ~MixerAudioOut() override;
+
     std::unique_ptr<PortBackend> Open(PortOut& port) override;
+
+private:
+    std::unique_ptr<AudioMixer> mixer;
 };
 
+class SDLAudioSink final : public AudioSink {
+public:
+    SDLAudioSink();
+    ~SDLAudioSink() override;
+
+    [[nodiscard]] u32 NumChannels() const override {
+        return num_channels;
+    }
+
+    void Output(std::span<const float> samples) override;
+
+private:
+    void CalculateQueueThreshold(u32 period_size);
+
+    SDL_AudioStream* stream{};
+    u32 num_channels{2};
+    u32 host_buffer_size{};
+    u32 queue_threshold{};
+};
+
+/// Discards all output, used for headless runs.
+class NullAudioSink final : public AudioSink {
+public:
+    [[nodiscard]] u32 NumChannels() const override {
+        return 2;
+    }
+
+    void Output(std::span<const float> samples) override {}
+};
+
+/// Writes the mix to a 32-bit float stereo WAV file.
+class WavAudioSink final : public AudioSink {
+public:
+    explicit WavAudioSink(const std::filesystem::path& path);
+    ~WavAudioSink() override;
+
+    [[nodiscard]] u32 NumChannels() const override {
+        return 2;
+    }
+
+    void Output(std::span<const float> samples) override;
+
+private:
+    void WriteHeader();
+
+    Common::FS::IOFile file;
+    u64 data_size{};
+};
+
+/// Creates the sink selected by the audio backend setting ("sdl", "null" or "wav").
+std::unique_ptr<AudioSink> CreateAudioSink(std::string_view backend);
+
 } // namespace Libraries::AudioOut
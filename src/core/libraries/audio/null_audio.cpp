@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+
+#include "common/logging/formatter.h"
+#include "common/logging/log.h"
+#include "core/libraries/audio/audioout_backend.h"
+
+namespace Libraries::AudioOut {
+
+namespace {
+
+struct WavHeader {
+    char riff_id[4];
+    u32 riff_size;
+    char wave_id[4];
+    char fmt_id[4];
+    u32 fmt_size;
+    u16 format_tag;
+    u16 channels;
+    u32 sample_rate;
+    u32 byte_rate;
+    u16 block_align;
+    u16 bits_per_sample;
+    char data_id[4];
+    u32 data_size;
+};
+static_assert(sizeof(WavHeader) == 44);
+
+constexpr u16 WaveFormatIeeeFloat = 3;
+
+} // Anonymous namespace
+
+WavAudioSink::WavAudioSink(const std::filesystem::path& path)
+    : file{path, Common::FS::FileAccessMode::Write} {
+    if (!file.IsOpen()) {
+        LOG_ERROR(Lib_AudioOut, "Failed to open WAV output file {}",
+                  fmt::UTF(path.u8string()));
+        return;
+    }
+    LOG_INFO(Lib_AudioOut, "Writing audio output to {}", fmt::UTF(path.u8string()));
+    WriteHeader();
+}
+
+WavAudioSink::~WavAudioSink() {
+    if (!file.IsOpen()) {
+        return;
+    }
+    // Patch the header now that the final data size is known.
+    file.Seek(0);
+    WriteHeader();
+}
+
+void WavAudioSink::Output(std::span<const float> samples) {
+    if (!file.IsOpen()) {
+        return;
+    }
+    data_size += file.WriteRaw<float>(samples.data(), samples.size()) * sizeof(float);
+}
+
+void WavAudioSink::WriteHeader() {
+    const u16 channels = NumChannels();
+    const u32 data_bytes = static_cast<u32>(std::min<u64>(data_size, 0xFFFFFFFFULL - 36));
+    const WavHeader header = {
+        .riff_id = {'R', 'I', 'F', 'F'},
+        .riff_size = data_bytes + 36,
+        .wave_id = {'W', 'A', 'V', 'E'},
+        .fmt_id = {'f', 'm', 't', ' '},
+        .fmt_size = 16,
+        .format_tag = WaveFormatIeeeFloat,
+        .channels = channels,
+        .sample_rate = 48000,
+        .byte_rate = 48000 * channels * sizeof(float),
+        .block_align = static_cast<u16>(channels * sizeof(float)),
+        .bits_per_sample = 32,
+        .data_id = {'d', 'a', 't', 'a'},
+        .data_size = data_bytes,
+    };
+    file.WriteObject(header);
+}
+
+} // namespace Libraries::AudioOut
@@ -1,118 +1,91 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
-#include <thread>
+#include <algorithm>
 #include <SDL3/SDL_audio.h>
 #include <SDL3/SDL_hints.h>
 
 #include "common/logging/log.h"
-#include "core/libraries/audio/audioout.h"
 #include "core/libraries/audio/audioout_backend.h"
 
 namespace Libraries::AudioOut {
 
-class SDLPortBackend : public PortBackend {
-public:
-    explicit SDLPortBackend(const PortOut& port)
-        : frame_size(port.format_info.FrameSize()), guest_buffer_size(port.BufferSize()) {
-        const SDL_AudioSpec fmt = {
-            .format = port.format_info.is_float ? SDL_AUDIO_F32LE : SDL_AUDIO_S16LE,
-            .channels = port.format_info.num_channels,
-            .freq = static_cast<int>(port.sample_rate),
-        };
-        stream =
-            SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &fmt, nullptr, nullptr);
-        if (stream == nullptr) {
-            LOG_ERROR(Lib_AudioOut, "Failed to create SDL audio stream: {}", SDL_GetError());
-            return;
-        }
-        CalculateQueueThreshold();
-        if (!SDL_SetAudioStreamInputChannelMap(stream, port.format_info.channel_layout.data(),
-                                               port.format_info.num_channels)) {
-            LOG_ERROR(Lib_AudioOut, "Failed to configure SDL audio stream channel map: {}",
-                      SDL_GetError());
-            SDL_DestroyAudioStream(stream);
-            stream = nullptr;
-            return;
-        }
-        if (!SDL_ResumeAudioStreamDevice(stream)) {
-            LOG_ERROR(Lib_AudioOut, "Failed to resume SDL audio stream: {}", SDL_GetError());
-            SDL_DestroyAudioStream(stream);
-            stream = nullptr;
-            return;
-        }
+SDLAudioSink::SDLAudioSink() {
+    // Output 7.1 when the device has enough channels, otherwise let the mixer downmix to stereo
+    // and SDL take care of anything else.
+    SDL_AudioSpec device_spec{};
+    if (SDL_GetAudioDeviceFormat(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &device_spec, nullptr) &&
+        device_spec.channels >= 8) {
+        num_channels = 8;
     }
-
-    ~SDLPortBackend() override {
-        if (!stream) {
-            return;
-        }
+    const SDL_AudioSpec fmt = {
+        .format = SDL_AUDIO_F32,
+        .channels = static_cast<int>(num_channels),
+        .freq = 48000,
+    };
+    stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &fmt, nullptr, nullptr);
+    if (stream == nullptr) {
+        LOG_ERROR(Lib_AudioOut, "Failed to create SDL audio stream: {}", SDL_GetError());
+        return;
+    }
+    if (!SDL_ResumeAudioStreamDevice(stream)) {
+        LOG_ERROR(Lib_AudioOut, "Failed to resume SDL audio stream: {}", SDL_GetError());
         SDL_DestroyAudioStream(stream);
         stream = nullptr;
+        return;
     }
+    LOG_INFO(Lib_AudioOut, "Opened SDL audio stream with {} channels", num_channels);
+}
 
-    void Output(void* ptr) override {
-        if (!stream) {
-            return;
-        }
-        // AudioOut library manages timing, but we still need to guard against the SDL
-        // audio queue stalling, which may happen during device changes, for example.
-        // Otherwise, latency may grow over time unbounded.
-        if (const auto queued = SDL_GetAudioStreamQueued(stream); queued >= queue_threshold) {
-            LOG_WARNING(Lib_AudioOut,
-                        "SDL audio queue backed up ({} queued, {} threshold), clearing.", queued,
-                        queue_threshold);
-            SDL_ClearAudioStream(stream);
-            // Recalculate the threshold in case this happened because of a device change.
-            CalculateQueueThreshold();
-        }
-        if (!SDL_PutAudioStreamData(stream, ptr, static_cast<int>(guest_buffer_size))) {
-            LOG_ERROR(Lib_AudioOut, "Failed to output to SDL audio stream: {}", SDL_GetError());
-        }
+SDLAudioSink::~SDLAudioSink() {
+    if (!stream) {
+        return;
     }
+    SDL_DestroyAudioStream(stream);
+    stream = nullptr;
+}
 
-    void SetVolume(const std::array<int, 8>& ch_volumes) override {
-        if (!stream) {
-            return;
-        }
-        // SDL does not have per-channel volumes, for now just take the maximum of the channels.
-        const auto vol = *std::ranges::max_element(ch_volumes);
-        if (!SDL_SetAudioStreamGain(stream, static_cast<float>(vol) / SCE_AUDIO_OUT_VOLUME_0DB)) {
-            LOG_WARNING(Lib_AudioOut, "Failed to change SDL audio stream volume: {}",
-                        SDL_GetError());
-        }
+void SDLAudioSink::Output(std::span<const float> samples) {
+    if (!stream) {
+        return;
     }
-
-private:
-    void CalculateQueueThreshold() {
-        SDL_AudioSpec discard;
-        int sdl_buffer_frames;
-        if (!SDL_GetAudioDeviceFormat(SDL_GetAudioStreamDevice(stream), &discard,
-                                      &sdl_buffer_frames)) {
-            LOG_WARNING(Lib_AudioOut, "Failed to get SDL audio stream buffer size: {}",
-                        SDL_GetError());
-            sdl_buffer_frames = 0;
-        }
-        const auto sdl_buffer_size = sdl_buffer_frames * frame_size;
-        const auto new_threshold = std::max(guest_buffer_size, sdl_buffer_size) * 4;
-        if (host_buffer_size != sdl_buffer_size || queue_threshold != new_threshold) {
-            host_buffer_size = sdl_buffer_size;
-            queue_threshold = new_threshold;
-            LOG_INFO(Lib_AudioOut,
-                     "SDL audio buffers: guest = {} bytes, host = {} bytes, threshold = {} bytes",
-                     guest_buffer_size, host_buffer_size, queue_threshold);
-        }
+    const auto period_size = static_cast<u32>(samples.size_bytes());
+    if (queue_threshold == 0) {
+        CalculateQueueThreshold(period_size);
     }
+    // The mixer manages timing, but we still need to guard against the SDL audio queue
+    // stalling, which may happen during device changes, for example.
+    // Otherwise, latency may grow over time unbounded.
+    if (const auto queued = SDL_GetAudioStreamQueued(stream); queued >= queue_threshold) {
+        LOG_WARNING(Lib_AudioOut, "SDL audio queue backed up ({} queued, {} threshold), clearing.",
+                    queued, queue_threshold);
+        SDL_ClearAudioStream(stream);
+        // Recalculate the threshold in case this happened because of a device change.
+        CalculateQueueThreshold(period_size);
+    }
+    if (!SDL_PutAudioStreamData(stream, samples.data(), static_cast<int>(period_size))) {
+        LOG_ERROR(Lib_AudioOut, "Failed to output to SDL audio stream: {}", SDL_GetError());
+    }
+}
 
-    u32 frame_size;
-    u32 guest_buffer_size;
-    u32 host_buffer_size{};
-    u32 queue_threshold{};
-    SDL_AudioStream* stream{};
-};
-
-std::unique_ptr<PortBackend> SDLAudioOut::Open(PortOut& port) {
-    return std::make_unique<SDLPortBackend>(port);
+void SDLAudioSink::CalculateQueueThreshold(u32 period_size) {
+    SDL_AudioSpec discard;
+    int sdl_buffer_frames;
+    if (!SDL_GetAudioDeviceFormat(SDL_GetAudioStreamDevice(stream), &discard,
+                                  &sdl_buffer_frames)) {
+        LOG_WARNING(Lib_AudioOut, "Failed to get SDL audio stream buffer size: {}",
+                    SDL_GetError());
+        sdl_buffer_frames = 0;
+    }
+    const auto sdl_buffer_size = sdl_buffer_frames * num_channels * sizeof(float);
+    const auto new_threshold = std::max<u32>(period_size, sdl_buffer_size) * 4;
+    if (host_buffer_size != sdl_buffer_size || queue_threshold != new_threshold) {
+        host_buffer_size = sdl_buffer_size;
+        queue_threshold = new_threshold;
+        LOG_INFO(Lib_AudioOut,
+                 "SDL audio buffers: mixer = {} bytes, host = {} bytes, threshold = {} bytes",
+                 period_size, host_buffer_size, queue_threshold);
+    }
 }
 
 } // namespace Libraries::AudioOut
@@ -1,23 +1,39 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <array>
+#include <cmath>
+#include <cstring>
+
 #include "common/logging/log.h"
 #include "core/libraries/audio/audioout.h"
 #include "core/libraries/audio3d/audio3d.h"
 #include "core/libraries/audio3d/audio3d_error.h"
+#include "core/libraries/audio3d/audio3d_impl.h"
 #include "core/libraries/error_codes.h"
 #include "core/libraries/libs.h"
 
 namespace Libraries::Audio3d {
 
+static std::unique_ptr<Audio3d> state;
+
 int PS4_SYSV_ABI sceAudio3dInitialize(s64 iReserved) {
     LOG_INFO(Lib_Audio3d, "iReserved = {}", iReserved);
+    if (state != nullptr) {
+        return ORBIS_AUDIO3D_ERROR_NOT_READY;
+    }
+    // Audio3D renders through AudioOut ports, make sure the output side is up.
+    AudioOut::StartBackend();
+    state = std::make_unique<Audio3d>();
     return ORBIS_OK;
 }
 
 int PS4_SYSV_ABI sceAudio3dTerminate() {
-    // TODO: When not initialized or some ports still open, return ORBIS_AUDIO3D_ERROR_NOT_READY
     LOG_INFO(Lib_Audio3d, "called");
+    if (state == nullptr || state->HasOpenPorts()) {
+        return ORBIS_AUDIO3D_ERROR_NOT_READY;
+    }
+    state.reset();
     return ORBIS_OK;
 }
 
@@ -40,12 +56,32 @@ int PS4_SYSV_ABI sceAudio3dPortOpen(OrbisUserServiceUserId iUserId,
                                     const OrbisAudio3dOpenParameters* pParameters,
                                     OrbisAudio3dPortId* pId) {
     LOG_INFO(Lib_Audio3d, "iUserId = {}", iUserId);
-    return ORBIS_OK;
+    if (state == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_NOT_READY;
+    }
+    if (pParameters == nullptr || pId == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    const auto& params = *pParameters;
+    if (params.granularity == 0 || params.granularity % 256 != 0 || params.granularity > 2048 ||
+        params.rate != OrbisAudio3dRate::Rate48000 || params.queue_depth == 0) {
+        LOG_ERROR(Lib_Audio3d, "Invalid open parameters: granularity = {}, queue_depth = {}",
+                  params.granularity, params.queue_depth);
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    return state->OpenPort(iUserId, params, pId);
 }
 
 int PS4_SYSV_ABI sceAudio3dPortClose(OrbisAudio3dPortId uiPortId) {
     LOG_INFO(Lib_Audio3d, "uiPortId = {}", uiPortId);
-    return ORBIS_OK;
+    if (state == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_NOT_READY;
+    }
+    return state->ClosePort(uiPortId);
+}
+
+static std::shared_ptr<Audio3dPort> GetPort(OrbisAudio3dPortId id) {
+    return state != nullptr ? state->GetPort(id) : nullptr;
 }
 
 int PS4_SYSV_ABI sceAudio3dPortSetAttribute(OrbisAudio3dPortId uiPortId,
@@ -58,50 +94,109 @@ int PS4_SYSV_ABI sceAudio3dPortSetAttribute(OrbisAudio3dPortId uiPortId,
 
 int PS4_SYSV_ABI sceAudio3dPortFlush(OrbisAudio3dPortId uiPortId) {
     LOG_INFO(Lib_Audio3d, "uiPortId = {}", uiPortId);
-    return ORBIS_OK;
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    return port->Push(OrbisAudio3dBlocking::Sync);
 }
 
 int PS4_SYSV_ABI sceAudio3dPortAdvance(OrbisAudio3dPortId uiPortId) {
     LOG_TRACE(Lib_Audio3d, "uiPortId = {}", uiPortId);
-    return ORBIS_OK;
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    if (port->BufferMode() == OrbisAudio3dBufferMode::NoAdvance) {
+        return ORBIS_AUDIO3D_ERROR_NOT_SUPPORTED;
+    }
+    return port->Advance();
 }
 
 int PS4_SYSV_ABI sceAudio3dPortPush(OrbisAudio3dPortId uiPortId, OrbisAudio3dBlocking eBlocking) {
     LOG_TRACE(Lib_Audio3d, "uiPortId = {}", uiPortId);
-    return ORBIS_OK;
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    if (port->BufferMode() != OrbisAudio3dBufferMode::AdvanceAndPush) {
+        return ORBIS_AUDIO3D_ERROR_NOT_SUPPORTED;
+    }
+    return port->Push(eBlocking);
 }
 
 int PS4_SYSV_ABI sceAudio3dPortGetAttributesSupported(OrbisAudio3dPortId uiPortId,
                                                       OrbisAudio3dAttributeId* pCapabilities,
                                                       u32* pNumCapabilities) {
     LOG_INFO(Lib_Audio3d, "uiPortId = {}", uiPortId);
+    static constexpr std::array<OrbisAudio3dAttributeId, 6> Supported = {
+        s_sceAudio3dAttributePcm,         s_sceAudio3dAttributePosition,
+        s_sceAudio3dAttributeSpread,      s_sceAudio3dAttributeGain,
+        s_sceAudio3dAttributePassthrough, s_sceAudio3dAttributeResetState,
+    };
+    if (GetPort(uiPortId) == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    if (pNumCapabilities == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    if (pCapabilities != nullptr) {
+        std::ranges::copy(Supported, pCapabilities);
+    }
+    *pNumCapabilities = static_cast<u32>(Supported.size());
     return ORBIS_OK;
 }
 
 int PS4_SYSV_ABI sceAudio3dPortGetQueueLevel(OrbisAudio3dPortId uiPortId, u32* pQueueLevel,
                                              u32* pQueueAvailable) {
     LOG_TRACE(Lib_Audio3d, "uiPortId = {}", uiPortId);
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    if (pQueueLevel == nullptr && pQueueAvailable == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    port->GetQueueLevel(pQueueLevel, pQueueAvailable);
     return ORBIS_OK;
 }
 
 int PS4_SYSV_ABI sceAudio3dObjectReserve(OrbisAudio3dPortId uiPortId, OrbisAudio3dObjectId* pId) {
     LOG_INFO(Lib_Audio3d, "uiPortId = {}", uiPortId);
-    return ORBIS_OK;
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    if (pId == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    return port->ReserveObject(pId);
 }
 
 int PS4_SYSV_ABI sceAudio3dObjectUnreserve(OrbisAudio3dPortId uiPortId,
                                            OrbisAudio3dObjectId uiObjectId) {
     LOG_INFO(Lib_Audio3d, "uiPortId = {}, uiObjectId = {}", uiPortId, uiObjectId);
-    return ORBIS_OK;
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    return port->UnreserveObject(uiObjectId);
 }
 
 int PS4_SYSV_ABI sceAudio3dObjectSetAttributes(OrbisAudio3dPortId uiPortId,
                                                OrbisAudio3dObjectId uiObjectId,
                                                size_t szNumAttributes,
                                                const OrbisAudio3dAttribute* pAttributeArray) {
-    LOG_INFO(Lib_Audio3d, "uiPortId = {}, uiObjectId = {}, szNumAttributes = {}", uiPortId,
-             uiObjectId, szNumAttributes);
-    return ORBIS_OK;
+    LOG_TRACE(Lib_Audio3d, "uiPortId = {}, uiObjectId = {}, szNumAttributes = {}", uiPortId,
+              uiObjectId, szNumAttributes);
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    if (szNumAttributes != 0 && pAttributeArray == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    return port->SetObjectAttributes(uiObjectId, {pAttributeArray, szNumAttributes});
 }
 
 int PS4_SYSV_ABI sceAudio3dBedWrite(OrbisAudio3dPortId uiPortId, u32 uiNumChannels,
@@ -109,21 +204,27 @@ int PS4_SYSV_ABI sceAudio3dBedWrite(OrbisAudio3dPortId uiPortId, u32 uiNumChanne
                                     u32 uiNumSamples) {
     LOG_TRACE(Lib_Audio3d, "uiPortId = {}, uiNumChannels = {}, uiNumSamples = {}", uiPortId,
               uiNumChannels, uiNumSamples);
-    return ORBIS_OK;
+    const auto port = GetPort(uiPortId);
+    if (port == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    return port->WriteBed(uiNumChannels, eFormat, pBuffer, uiNumSamples);
 }
 
 int PS4_SYSV_ABI sceAudio3dBedWrite2(OrbisAudio3dPortId uiPortId, u32 uiNumChannels,
                                      OrbisAudio3dFormat eFormat, const void* pBuffer,
                                      u32 uiNumSamples, OrbisAudio3dOutputRoute eOutputRoute,
                                      bool bRestricted) {
-    LOG_INFO(Lib_Audio3d, "uiPortId = {}, uiNumChannels = {}, uiNumSamples = {}, bRestricted = {}",
-             uiPortId, uiNumChannels, uiNumSamples, bRestricted);
-    return ORBIS_OK;
+    LOG_TRACE(Lib_Audio3d,
+              "uiPortId = {}, uiNumChannels = {}, uiNumSamples = {}, bRestricted = {}", uiPortId,
+              uiNumChannels, uiNumSamples, bRestricted);
+    // Output routes only matter with a headset attached, everything goes to the main mix.
+    return sceAudio3dBedWrite(uiPortId, uiNumChannels, eFormat, pBuffer, uiNumSamples);
 }
 
 size_t PS4_SYSV_ABI sceAudio3dGetSpeakerArrayMemorySize(u32 uiNumSpeakers, bool bIs3d) {
     LOG_INFO(Lib_Audio3d, "uiNumSpeakers = {}, bIs3d = {}", uiNumSpeakers, bIs3d);
-    return ORBIS_OK;
+    return OrbisAudio3dSpeakerArray::MemorySize(uiNumSpeakers);
 }
 
 int PS4_SYSV_ABI
@@ -133,7 +234,21 @@ sceAudio3dCreateSpeakerArray(OrbisAudio3dSpeakerArrayHandle* pHandle,
         LOG_ERROR(Lib_Audio3d, "invalid SpeakerArray parameters");
         return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
     }
-    LOG_INFO(Lib_Audio3d, "called");
+    const auto& params = *pParameters;
+    LOG_INFO(Lib_Audio3d, "num_speakers = {}, is_3d = {}", params.num_speakers, params.is_3d);
+    if (params.buffer == nullptr || params.speaker_position == nullptr ||
+        params.size < OrbisAudio3dSpeakerArray::MemorySize(params.num_speakers)) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    auto* array = new (params.buffer) OrbisAudio3dSpeakerArray{params.num_speakers, params.is_3d};
+    const auto azimuths = array->Azimuths();
+    for (u32 i = 0; i < params.num_speakers; ++i) {
+        const auto& position = params.speaker_position[i];
+        // Speakers without a horizontal direction (LFE) are left out of panning.
+        azimuths[i] =
+            std::hypot(position.fX, position.fZ) > 0.0f ? GetAzimuth(position) : NAN;
+    }
+    *pHandle = array;
     return ORBIS_OK;
 }
 
@@ -150,11 +265,15 @@ int PS4_SYSV_ABI sceAudio3dGetSpeakerArrayMixCoefficients(OrbisAudio3dSpeakerArr
                                                           OrbisAudio3dPosition pos, float fSpread,
                                                           float* pCoefficients,
                                                           u32 uiNumCoefficients) {
-    LOG_INFO(Lib_Audio3d, "fSpread = {}, uiNumCoefficients = {}", fSpread, uiNumCoefficients);
+    LOG_TRACE(Lib_Audio3d, "fSpread = {}, uiNumCoefficients = {}", fSpread, uiNumCoefficients);
     if (handle == nullptr) {
         LOG_ERROR(Lib_Audio3d, "invalid SpeakerArrayHandle");
         return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
     }
+    if (pCoefficients == nullptr || uiNumCoefficients < handle->num_speakers) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    ComputeSpeakerGains(handle->Azimuths(), pos, fSpread, {pCoefficients, uiNumCoefficients});
     return ORBIS_OK;
 }
 
@@ -163,14 +282,20 @@ int PS4_SYSV_ABI sceAudio3dGetSpeakerArrayMixCoefficients2(OrbisAudio3dSpeakerAr
                                                            float* pCoefficients,
                                                            u32 uiNumCoefficients, bool bHeightAware,
                                                            float fDownmixSpreadRadius) {
-    LOG_INFO(Lib_Audio3d,
-             "fSpread = {}, uiNumCoefficients = {}, bHeightAware = {}, fDownmixSpreadRadius = {}",
-             fSpread, uiNumCoefficients, bHeightAware, fDownmixSpreadRadius);
+    LOG_TRACE(Lib_Audio3d,
+              "fSpread = {}, uiNumCoefficients = {}, bHeightAware = {}, fDownmixSpreadRadius = {}",
+              fSpread, uiNumCoefficients, bHeightAware, fDownmixSpreadRadius);
     if (handle == nullptr) {
         LOG_ERROR(Lib_Audio3d, "invalid SpeakerArrayHandle");
         return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
     }
-    return ORBIS_OK;
+    // Sources inside the downmix radius are spread out more the closer they get to the listener.
+    const float distance = std::hypot(pos.fX, pos.fZ);
+    if (fDownmixSpreadRadius > 0.0f && distance < fDownmixSpreadRadius) {
+        fSpread = std::max(fSpread, 1.0f - distance / fDownmixSpreadRadius);
+    }
+    return sceAudio3dGetSpeakerArrayMixCoefficients(handle, pos, fSpread, pCoefficients,
+                                                    uiNumCoefficients);
 }
 
 s32 PS4_SYSV_ABI sceAudio3dAudioOutOpen(OrbisAudio3dPortId uiPortId, OrbisUserServiceUserId userId,
@@ -178,12 +303,15 @@ s32 PS4_SYSV_ABI sceAudio3dAudioOutOpen(OrbisAudio3dPortId uiPortId, OrbisUserSe
     LOG_INFO(Lib_Audio3d,
              "uiPortId = {}, userId = {}, type = {}, index = {}, len = {}, freq = {}, param = {}",
              uiPortId, userId, type, index, len, freq, param);
-    return ORBIS_OK;
+    AudioOut::OrbisAudioOutParamExtendedInformation param_type{};
+    std::memcpy(&param_type, &param, sizeof(param_type));
+    return AudioOut::sceAudioOutOpen(userId, static_cast<AudioOut::OrbisAudioOutPort>(type),
+                                     index, len, freq, param_type);
 }
 
 s32 PS4_SYSV_ABI sceAudio3dAudioOutClose(s32 handle) {
     LOG_INFO(Lib_Audio3d, "handle = {}", handle);
-    return ORBIS_OK;
+    return AudioOut::sceAudioOutClose(handle);
 }
 
 s32 PS4_SYSV_ABI sceAudio3dAudioOutOutput(s32 handle, const void* ptr) {
@@ -192,7 +320,7 @@ s32 PS4_SYSV_ABI sceAudio3dAudioOutOutput(s32 handle, const void* ptr) {
         LOG_ERROR(Lib_Audio3d, "invalid Output ptr");
         return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
     }
-    return ORBIS_OK;
+    return AudioOut::sceAudioOutOutput(handle, const_cast<void*>(ptr));
 }
 
 s32 PS4_SYSV_ABI sceAudio3dAudioOutOutputs(::Libraries::AudioOut::OrbisAudioOutOutputParam* param,
@@ -202,18 +330,23 @@ s32 PS4_SYSV_ABI sceAudio3dAudioOutOutputs(::Libraries::AudioOut::OrbisAudioOutO
         LOG_ERROR(Lib_Audio3d, "invalid OutputParam ptr");
         return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
     }
-    return ORBIS_OK;
+    return AudioOut::sceAudioOutOutputs(param, num);
 }
 
 int PS4_SYSV_ABI sceAudio3dPortCreate(u32 uiGranularity, OrbisAudio3dRate eRate, s64 iReserved,
                                       OrbisAudio3dPortId* pId) {
     LOG_INFO(Lib_Audio3d, "uiGranularity = {}, iReserved = {}", uiGranularity, iReserved);
-    return ORBIS_OK;
+    OrbisAudio3dOpenParameters params{};
+    sceAudio3dGetDefaultOpenParameters(&params);
+    params.granularity = uiGranularity;
+    params.rate = eRate;
+    return sceAudio3dPortOpen(Libraries::UserService::ORBIS_USER_SERVICE_USER_ID_SYSTEM, &params,
+                              pId);
 }
 
 int PS4_SYSV_ABI sceAudio3dPortDestroy(OrbisAudio3dPortId uiPortId) {
     LOG_INFO(Lib_Audio3d, "uiPortId = {}", uiPortId);
-    return ORBIS_OK;
+    return sceAudio3dPortClose(uiPortId);
 }
 
 // Audio3dPrivate
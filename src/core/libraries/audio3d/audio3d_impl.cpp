@@ -1,13 +1,403 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
 #include "audio3d_error.h"
 #include "audio3d_impl.h"
 
+#include "common/arch.h"
 #include "common/logging/log.h"
+#include "core/libraries/audio/audioout.h"
 #include "core/libraries/error_codes.h"
 #include "core/libraries/kernel/kernel.h"
 
+#ifdef ARCH_X86_64
+#include <xmmintrin.h>
+#endif
+
 using namespace Libraries::Kernel;
 
-namespace Libraries::Audio3d {} // namespace Libraries::Audio3d
+namespace Libraries::Audio3d {
+
+namespace {
+
+constexpr u32 ChFL = 0, ChFR = 1, ChFC = 2, ChLFE = 3, ChBL = 4, ChBR = 5, ChSL = 6, ChSR = 7;
+
+constexpr float Deg(float degrees) {
+    return degrees * std::numbers::pi_v<float> / 180.0f;
+}
+
+/// Azimuths of the mix channels, LFE takes no part in panning.
+const std::array<float, MixChannels> MixAzimuths = {
+    Deg(-30.0f), Deg(30.0f), Deg(0.0f), NAN, Deg(-150.0f), Deg(150.0f), Deg(-90.0f), Deg(90.0f),
+};
+
+constexpr u32 MaxSpeakers = 32;
+
+/// Accumulates a mono source into interleaved 8 channel frames with per-channel gains.
+void MixMono(float* dst, const float* src, const std::array<float, MixChannels>& gains,
+             u32 num_frames) {
+#ifdef ARCH_X86_64
+    const __m128 gain_lo = _mm_loadu_ps(&gains[0]);
+    const __m128 gain_hi = _mm_loadu_ps(&gains[4]);
+    for (u32 i = 0; i < num_frames; ++i) {
+        const __m128 sample = _mm_set1_ps(src[i]);
+        float* out = dst + i * MixChannels;
+        _mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), _mm_mul_ps(sample, gain_lo)));
+        _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), _mm_mul_ps(sample, gain_hi)));
+    }
+#else
+    for (u32 i = 0; i < num_frames; ++i) {
+        for (u32 ch = 0; ch < MixChannels; ++ch) {
+            dst[i * MixChannels + ch] += src[i] * gains[ch];
+        }
+    }
+#endif
+}
+
+float ReadSample(OrbisAudio3dFormat format, const void* buffer, u32 index) {
+    if (format == OrbisAudio3dFormat::Float) {
+        return static_cast<const float*>(buffer)[index];
+    }
+    return static_cast<const s16*>(buffer)[index] / 32768.0f;
+}
+
+} // Anonymous namespace
+
+float GetAzimuth(const OrbisAudio3dPosition& position) {
+    return std::atan2(position.fX, position.fZ);
+}
+
+void ComputeSpeakerGains(std::span<const float> speaker_azimuths,
+                         const OrbisAudio3dPosition& position, float spread,
+                         std::span<float> gains) {
+    std::ranges::fill(gains, 0.0f);
+
+    std::array<u32, MaxSpeakers> order;
+    u32 num_speakers = 0;
+    for (u32 i = 0; i < std::min<size_t>(speaker_azimuths.size(), gains.size()); ++i) {
+        if (!std::isnan(speaker_azimuths[i]) && num_speakers < MaxSpeakers) {
+            order[num_speakers++] = i;
+        }
+    }
+    if (num_speakers == 0) {
+        return;
+    }
+    if (num_speakers == 1) {
+        gains[order[0]] = 1.0f;
+        return;
+    }
+    std::sort(order.begin(), order.begin() + num_speakers,
+              [&](u32 a, u32 b) { return speaker_azimuths[a] < speaker_azimuths[b]; });
+
+    // A source on top of the listener has no direction, spread it evenly.
+    if (std::hypot(position.fX, position.fZ) < 1e-4f) {
+        spread = 1.0f;
+    }
+
+    constexpr float TwoPi = 2.0f * std::numbers::pi_v<float>;
+    const float source = GetAzimuth(position);
+
+    // Find the pair of neighbouring speakers enclosing the source direction.
+    for (u32 k = 0; k < num_speakers; ++k) {
+        const u32 index_a = order[k];
+        const u32 index_b = order[(k + 1) % num_speakers];
+        const float a = speaker_azimuths[index_a];
+        float b = speaker_azimuths[index_b];
+        if (b <= a) {
+            b += TwoPi;
+        }
+        float s = source;
+        while (s < a) {
+            s += TwoPi;
+        }
+        if (s > b) {
+            continue;
+        }
+
+        // Solve p = ga * la + gb * lb for the speaker unit vectors.
+        const float det = std::sin(a) * std::cos(b) - std::cos(a) * std::sin(b);
+        float ga, gb;
+        if (std::abs(det) > 1e-4f) {
+            ga = (std::sin(s) * std::cos(b) - std::cos(s) * std::sin(b)) / det;
+            gb = (std::sin(a) * std::cos(s) - std::cos(a) * std::sin(s)) / det;
+            ga = std::max(ga, 0.0f);
+            gb = std::max(gb, 0.0f);
+        } else {
+            ga = gb = 0.0f;
+        }
+        if (ga + gb <= 0.0f) {
+            // Speakers are opposite or too far apart for VBAP, pan by angle instead.
+            const float t = (s - a) / (b - a) * std::numbers::pi_v<float> * 0.5f;
+            ga = std::cos(t);
+            gb = std::sin(t);
+        }
+        const float norm = 1.0f / std::sqrt(ga * ga + gb * gb);
+        gains[index_a] = ga * norm;
+        gains[index_b] = gb * norm;
+        break;
+    }
+
+    if (spread > 0.0f) {
+        spread = std::min(spread, 1.0f);
+        const float even = spread / num_speakers;
+        for (u32 i = 0; i < num_speakers; ++i) {
+            float& gain = gains[order[i]];
+            gain = std::sqrt((1.0f - spread) * gain * gain + even);
+        }
+    }
+}
+
+Audio3dPort::Audio3dPort(OrbisUserServiceUserId user_id, const OrbisAudio3dOpenParameters& params_)
+    : params{params_}, objects(params_.max_objects) {
+    const u32 frame_size = params.granularity * MixChannels;
+    bed.resize(frame_size);
+    scratch.resize(params.granularity);
+
+    AudioOut::OrbisAudioOutParamExtendedInformation param_type{};
+    param_type.data_format.Assign(AudioOut::OrbisAudioOutParamFormat::Float_8CH);
+    const s32 handle = AudioOut::sceAudioOutOpen(user_id, AudioOut::OrbisAudioOutPort::Main, 0,
+                                                 params.granularity, 48000, param_type);
+    if (handle < 0) {
+        LOG_ERROR(Lib_Audio3d, "Failed to open AudioOut port ({:#x}), output will be dropped",
+                  handle);
+        return;
+    }
+    audio_out_handle = handle;
+}
+
+Audio3dPort::~Audio3dPort() {
+    if (audio_out_handle >= 0) {
+        AudioOut::sceAudioOutClose(audio_out_handle);
+    }
+}
+
+s32 Audio3dPort::ReserveObject(OrbisAudio3dObjectId* out_id) {
+    std::scoped_lock lock{mutex};
+    const auto it = std::ranges::find_if(objects, [](const Object& o) { return !o.reserved; });
+    if (it == objects.end()) {
+        return ORBIS_AUDIO3D_ERROR_OUT_OF_RESOURCES;
+    }
+    *it = Object{};
+    it->reserved = true;
+    *out_id = static_cast<OrbisAudio3dObjectId>(std::distance(objects.begin(), it));
+    return ORBIS_OK;
+}
+
+s32 Audio3dPort::UnreserveObject(OrbisAudio3dObjectId id) {
+    std::scoped_lock lock{mutex};
+    if (id >= objects.size() || !objects[id].reserved) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_OBJECT;
+    }
+    objects[id] = Object{};
+    return ORBIS_OK;
+}
+
+s32 Audio3dPort::SetObjectAttributes(OrbisAudio3dObjectId id,
+                                     std::span<const OrbisAudio3dAttribute> attributes) {
+    std::scoped_lock lock{mutex};
+    if (id >= objects.size() || !objects[id].reserved) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_OBJECT;
+    }
+    auto& object = objects[id];
+    for (const auto& attribute : attributes) {
+        const void* value = attribute.p_value;
+        if (value == nullptr && attribute.attribute_id != s_sceAudio3dAttributeResetState) {
+            return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+        }
+        switch (attribute.attribute_id) {
+        case s_sceAudio3dAttributePcm: {
+            const auto* pcm = static_cast<const OrbisAudio3dPcm*>(value);
+            if (pcm->sample_buffer == nullptr && pcm->num_samples != 0) {
+                return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+            }
+            // Bound latency to the queue depth in case the title submits faster than it advances.
+            const size_t max_pending = params.granularity * std::max(params.queue_depth, 1U);
+            if (object.pcm.size() + pcm->num_samples > max_pending) {
+                object.pcm.clear();
+            }
+            for (u32 i = 0; i < pcm->num_samples; ++i) {
+                object.pcm.push_back(ReadSample(pcm->format, pcm->sample_buffer, i));
+            }
+            break;
+        }
+        case s_sceAudio3dAttributePosition:
+            object.position = *static_cast<const OrbisAudio3dPosition*>(value);
+            object.gains_dirty = true;
+            break;
+        case s_sceAudio3dAttributeSpread:
+            object.spread = *static_cast<const float*>(value);
+            object.gains_dirty = true;
+            break;
+        case s_sceAudio3dAttributeGain:
+            object.gain = *static_cast<const float*>(value);
+            break;
+        case s_sceAudio3dAttributePassthrough:
+            object.passthrough = *static_cast<const OrbisAudio3dPassthrough*>(value);
+            object.gains_dirty = true;
+            break;
+        case s_sceAudio3dAttributeResetState:
+            object = Object{};
+            object.reserved = true;
+            break;
+        default:
+            LOG_DEBUG(Lib_Audio3d, "Ignoring object attribute {:#x}", attribute.attribute_id);
+            break;
+        }
+    }
+    return ORBIS_OK;
+}
+
+s32 Audio3dPort::WriteBed(u32 num_channels, OrbisAudio3dFormat format, const void* buffer,
+                          u32 num_samples) {
+    // Beds use the standard channel order: FL, FR, FC, LFE, SL, SR, BL, BR.
+    static constexpr std::array<u32, MixChannels> BedLayout = {ChFL, ChFR, ChFC, ChLFE,
+                                                               ChSL, ChSR, ChBL, ChBR};
+    if (num_channels != 2 && num_channels != 6 && num_channels != 8) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    if (buffer == nullptr || num_samples != params.granularity) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PARAMETER;
+    }
+    std::scoped_lock lock{mutex};
+    for (u32 i = 0; i < num_samples; ++i) {
+        float* out = &bed[i * MixChannels];
+        for (u32 ch = 0; ch < num_channels; ++ch) {
+            out[BedLayout[ch]] += ReadSample(format, buffer, i * num_channels + ch);
+        }
+    }
+    return ORBIS_OK;
+}
+
+void Audio3dPort::UpdateGains(Object& object) {
+    object.gains_dirty = false;
+    switch (object.passthrough) {
+    case OrbisAudio3dPassthrough::Left:
+        object.gains = {};
+        object.gains[ChFL] = 1.0f;
+        return;
+    case OrbisAudio3dPassthrough::Right:
+        object.gains = {};
+        object.gains[ChFR] = 1.0f;
+        return;
+    default:
+        ComputeSpeakerGains(MixAzimuths, object.position, object.spread, object.gains);
+        return;
+    }
+}
+
+s32 Audio3dPort::Advance() {
+    if (const s32 result = MixFrame(); result != ORBIS_OK) {
+        return result;
+    }
+    if (params.buffer_mode == OrbisAudio3dBufferMode::AdvanceNoPush) {
+        // The title never pushes in this mode, the port submits each grain as it is mixed.
+        return Push(OrbisAudio3dBlocking::Sync);
+    }
+    return ORBIS_OK;
+}
+
+s32 Audio3dPort::MixFrame() {
+    std::scoped_lock lock{mutex};
+    if (queue.size() >= std::max(params.queue_depth, 1U)) {
+        return ORBIS_AUDIO3D_ERROR_NOT_READY;
+    }
+    std::vector<float> frame;
+    if (!free_frames.empty()) {
+        frame = std::move(free_frames.back());
+        free_frames.pop_back();
+    }
+    // The bed accumulation buffer becomes the frame, objects are mixed on top of it.
+    frame.swap(bed);
+    bed.assign(frame.size(), 0.0f);
+
+    const u32 granularity = params.granularity;
+    for (auto& object : objects) {
+        if (!object.reserved || object.pcm.empty()) {
+            continue;
+        }
+        if (object.gains_dirty) {
+            UpdateGains(object);
+        }
+        const u32 num_frames = std::min<u32>(granularity, static_cast<u32>(object.pcm.size()));
+        std::transform(object.pcm.begin(), object.pcm.begin() + num_frames, scratch.begin(),
+                       [&](float sample) { return sample * object.gain; });
+        MixMono(frame.data(), scratch.data(), object.gains, num_frames);
+        object.pcm.erase(object.pcm.begin(), object.pcm.begin() + num_frames);
+    }
+    queue.push_back(std::move(frame));
+    return ORBIS_OK;
+}
+
+s32 Audio3dPort::Push(OrbisAudio3dBlocking blocking) {
+    while (true) {
+        std::vector<float> frame;
+        {
+            std::scoped_lock lock{mutex};
+            if (queue.empty()) {
+                return ORBIS_OK;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        // AudioOut only waits for the previously submitted buffer, so at most one frame is
+        // buffered beyond the queue.
+        if (audio_out_handle >= 0) {
+            AudioOut::sceAudioOutOutput(audio_out_handle, frame.data());
+        }
+        {
+            std::scoped_lock lock{mutex};
+            free_frames.push_back(std::move(frame));
+        }
+        if (blocking == OrbisAudio3dBlocking::Async) {
+            return ORBIS_OK;
+        }
+    }
+}
+
+void Audio3dPort::GetQueueLevel(u32* out_level, u32* out_available) {
+    std::scoped_lock lock{mutex};
+    const u32 level = static_cast<u32>(queue.size());
+    if (out_level) {
+        *out_level = level;
+    }
+    if (out_available) {
+        *out_available = std::max(params.queue_depth, 1U) - std::min(level, params.queue_depth);
+    }
+}
+
+s32 Audio3d::OpenPort(OrbisUserServiceUserId user_id, const OrbisAudio3dOpenParameters& params,
+                      OrbisAudio3dPortId* out_id) {
+    std::scoped_lock lock{mutex};
+    const auto it = std::ranges::find(ports, nullptr);
+    if (it == ports.end()) {
+        return ORBIS_AUDIO3D_ERROR_OUT_OF_RESOURCES;
+    }
+    *it = std::make_shared<Audio3dPort>(user_id, params);
+    *out_id = static_cast<OrbisAudio3dPortId>(std::distance(ports.begin(), it));
+    return ORBIS_OK;
+}
+
+s32 Audio3d::ClosePort(OrbisAudio3dPortId id) {
+    std::scoped_lock lock{mutex};
+    if (id >= ports.size() || ports[id] == nullptr) {
+        return ORBIS_AUDIO3D_ERROR_INVALID_PORT;
+    }
+    ports[id].reset();
+    return ORBIS_OK;
+}
+
+std::shared_ptr<Audio3dPort> Audio3d::GetPort(OrbisAudio3dPortId id) {
+    std::scoped_lock lock{mutex};
+    return id < ports.size() ? ports[id] : nullptr;
+}
+
+bool Audio3d::HasOpenPorts() {
+    std::scoped_lock lock{mutex};
+    return std::ranges::any_of(ports, [](const auto& port) { return port != nullptr; });
+}
+
+} // namespace Libraries::Audio3d
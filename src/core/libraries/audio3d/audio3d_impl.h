@@ -3,14 +3,108 @@
 
 #pragma once
 
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
 #include "audio3d.h"
 
 namespace Libraries::Audio3d {
 
+/// Ports are mixed in the AudioOut 7.1 layout: FL, FR, FC, LFE, BL, BR, SL, SR.
+constexpr u32 MixChannels = 8;
+constexpr u32 MaxPorts = 4;
+
+/// Speaker array as stored in the guest provided buffer, followed by one azimuth per speaker.
+struct OrbisAudio3dSpeakerArray {
+    u32 num_speakers;
+    bool is_3d;
+
+    static size_t MemorySize(u32 num_speakers) {
+        return sizeof(OrbisAudio3dSpeakerArray) + num_speakers * sizeof(float);
+    }
+
+    [[nodiscard]] std::span<float> Azimuths() {
+        return {reinterpret_cast<float*>(this + 1), num_speakers};
+    }
+};
+
+/// Returns the horizontal angle of a position, 0 is straight ahead and positive is to the right.
+float GetAzimuth(const OrbisAudio3dPosition& position);
+
+/// Computes power normalized 2D VBAP gains over the given speakers. Speakers with a NaN azimuth
+/// (LFE) get no signal. Spread blends the panned gains towards an even distribution.
+void ComputeSpeakerGains(std::span<const float> speaker_azimuths,
+                         const OrbisAudio3dPosition& position, float spread,
+                         std::span<float> gains);
+
+class Audio3dPort {
+public:
+    Audio3dPort(OrbisUserServiceUserId user_id, const OrbisAudio3dOpenParameters& params);
+    ~Audio3dPort();
+
+    s32 ReserveObject(OrbisAudio3dObjectId* out_id);
+    s32 UnreserveObject(OrbisAudio3dObjectId id);
+    s32 SetObjectAttributes(OrbisAudio3dObjectId id,
+                            std::span<const OrbisAudio3dAttribute> attributes);
+    s32 WriteBed(u32 num_channels, OrbisAudio3dFormat format, const void* buffer,
+                 u32 num_samples);
+
+    /// Mixes the pending bed and object submissions into the next queued frame. In AdvanceNoPush
+    /// mode the frame is also sent to AudioOut.
+    s32 Advance();
+
+    /// Sends queued frames to AudioOut. Sync pushes drain the queue, async pushes send one frame.
+    s32 Push(OrbisAudio3dBlocking blocking);
+
+    void GetQueueLevel(u32* out_level, u32* out_available);
+
+    [[nodiscard]] OrbisAudio3dBufferMode BufferMode() const {
+        return params.buffer_mode;
+    }
+
+private:
+    struct Object {
+        bool reserved{};
+        std::vector<float> pcm;
+        OrbisAudio3dPosition position{0.0f, 0.0f, 1.0f};
+        float spread{};
+        float gain{1.0f};
+        OrbisAudio3dPassthrough passthrough{OrbisAudio3dPassthrough::None};
+        std::array<float, MixChannels> gains{};
+        bool gains_dirty{true};
+    };
+
+    void UpdateGains(Object& object);
+
+    s32 MixFrame();
+
+    std::mutex mutex;
+    OrbisAudio3dOpenParameters params;
+    s32 audio_out_handle{-1};
+    std::vector<Object> objects;
+    std::vector<float> bed;
+    std::vector<float> scratch;
+    std::deque<std::vector<float>> queue;
+    std::vector<std::vector<float>> free_frames;
+};
+
 class Audio3d {
 public:
+    s32 OpenPort(OrbisUserServiceUserId user_id, const OrbisAudio3dOpenParameters& params,
+                 OrbisAudio3dPortId* out_id);
+    s32 ClosePort(OrbisAudio3dPortId id);
+    std::shared_ptr<Audio3dPort> GetPort(OrbisAudio3dPortId id);
+    [[nodiscard]] bool HasOpenPorts();
+
 private:
     using OrbisAudio3dPluginId = u32;
+
+    std::mutex mutex;
+    std::array<std::shared_ptr<Audio3dPort>, MaxPorts> ports;
 };
 
 } // namespace Libraries::Audio3d
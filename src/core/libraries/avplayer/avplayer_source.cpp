@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include "common/alignment.h"
+#include "common/config.h"
 #include "common/singleton.h"
 #include "common/thread.h"
 #include "core/file_sys/fs.h"
@@ -15,7 +16,6 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavformat/avio.h>
 #include <libswresample/swresample.h>
-#include <libswscale/swscale.h>
 }
 
 #include "common/support/avdec.h"
@@ -33,6 +33,7 @@ bool AvPlayerSource::Init(const SceAvPlayerInitData& init_data, std::string_view
     m_memory_replacement = init_data.memory_replacement,
     m_num_output_video_framebuffers =
         std::min(std::max(2, init_data.num_output_video_framebuffers), 16);
+    m_prefetch_ms = std::max(Config::getAvPlayerPrefetchMs(), 50);
 
     AVFormatContext* context = avformat_alloc_context();
     if (init_data.file_replacement.open != nullptr) {
@@ -186,15 +187,19 @@ bool AvPlayerSource::EnableStream(u32 stream_index) {
             LOG_ERROR(Lib_AvPlayer, "Could not open avcodec for video stream {}.", stream_index);
             return false;
         }
+        const auto frame_rate = av_q2d(stream->avg_frame_rate);
+        m_video_packet_fallback_ms =
+            frame_rate > 0.0 ? std::max<s64>(s64(1000.0 / frame_rate), 1) : 33;
         auto width = u32(m_video_codec_context->width);
         auto height = u32(m_video_codec_context->height);
         if (!m_use_vdec2) {
             width = Common::AlignUp(width, 16);
             height = Common::AlignUp(height, 16);
         }
-        const auto size = (width * height * 3) / 2;
+        m_video_framebuffer_size = (width * height * 3) / 2;
         for (u64 index = 0; index < m_num_output_video_framebuffers; ++index) {
-            m_video_buffers.Push(FrameBuffer(m_memory_replacement, 0x100, size));
+            m_video_buffers.Push(
+                FrameBuffer(m_memory_replacement, 0x100, m_video_framebuffer_size));
         }
         LOG_INFO(Lib_AvPlayer, "Video stream {} enabled", stream_index);
         break;
@@ -212,6 +217,11 @@ bool AvPlayerSource::EnableStream(u32 stream_index) {
             LOG_ERROR(Lib_AvPlayer, "Could not open avcodec for audio stream {}.", stream_index);
             return false;
         }
+        const auto frame_size = s64(stream->codecpar->frame_size);
+        const auto sample_rate = s64(stream->codecpar->sample_rate);
+        m_audio_packet_fallback_ms =
+            (frame_size > 0 && sample_rate > 0) ? std::max<s64>(frame_size * 1000 / sample_rate, 1)
+                                                : 21;
         const auto num_channels = m_audio_codec_context->ch_layout.nb_channels;
         const auto align = num_channels * sizeof(u16);
         const auto size = num_channels * sizeof(u16) * 1024;
@@ -248,6 +258,7 @@ bool AvPlayerSource::Start() {
     m_video_decoder_thread.Run([this](std::stop_token stop) { this->VideoDecoderThread(stop); });
     m_audio_decoder_thread.Run([this](std::stop_token stop) { this->AudioDecoderThread(stop); });
     m_start_time = std::chrono::high_resolution_clock::now();
+    m_stats_time = std::chrono::steady_clock::now();
     return true;
 }
 
@@ -275,8 +286,11 @@ bool AvPlayerSource::Stop() {
 
     m_audio_packets.Clear();
     m_video_packets.Clear();
+    m_audio_packets_ms = 0;
+    m_video_packets_ms = 0;
     m_audio_frames.Clear();
     m_video_frames.Clear();
+    ReportStats(true);
     return true;
 }
 
@@ -303,6 +317,9 @@ bool AvPlayerSource::GetVideoData(SceAvPlayerFrameInfoEx& video_info) {
         return false;
     }
 
+    if (m_video_frames.Size() == 0 && !m_is_eof) {
+        ++m_video_underruns;
+    }
     m_video_frames_cv.Wait([this] { return m_video_frames.Size() != 0 || m_is_eof; });
 
     auto frame = m_video_frames.Pop();
@@ -330,6 +347,7 @@ bool AvPlayerSource::GetVideoData(SceAvPlayerFrameInfoEx& video_info) {
     }
     m_current_video_frame = std::move(frame->buffer);
     video_info = frame->info;
+    ReportStats(false);
     return true;
 }
 
@@ -338,6 +356,9 @@ bool AvPlayerSource::GetAudioData(SceAvPlayerFrameInfo& audio_info) {
         return false;
     }
 
+    if (m_audio_frames.Size() == 0 && !m_is_eof) {
+        ++m_audio_underruns;
+    }
     m_audio_frames_cv.Wait([this] { return m_audio_frames.Size() != 0 || m_is_eof; });
 
     auto frame = m_audio_frames.Pop();
@@ -371,6 +392,7 @@ bool AvPlayerSource::GetAudioData(SceAvPlayerFrameInfo& audio_info) {
     audio_info.details.audio.sample_rate = frame->info.details.audio.sample_rate;
     audio_info.details.audio.size = frame->info.details.audio.size;
     audio_info.details.audio.channel_count = frame->info.details.audio.channel_count;
+    ReportStats(false);
     return true;
 }
 
@@ -411,12 +433,6 @@ void AvPlayerSource::ReleaseSWRContext(SwrContext* context) {
     }
 }
 
-void AvPlayerSource::ReleaseSWSContext(SwsContext* context) {
-    if (context != nullptr) {
-        sws_freeContext(context);
-    }
-}
-
 void AvPlayerSource::ReleaseAVFormatContext(AVFormatContext* context) {
     if (context != nullptr) {
         avformat_close_input(&context);
@@ -434,10 +450,11 @@ void AvPlayerSource::DemuxerThread(std::stop_token stop) {
     LOG_INFO(Lib_AvPlayer, "Demuxer Thread started");
 
     while (!stop.stop_requested()) {
-        if (m_video_packets.Size() > 30 &&
-            (!m_audio_stream_index.has_value() || m_audio_packets.Size() > 8)) {
-            std::this_thread::sleep_for(milliseconds(5));
-            continue;
+        if (IsPrefetchFull()) {
+            // Sleep until a decoder drains one of the queues below the low watermark.
+            if (!m_demuxer_cv.Wait(stop, [this] { return IsPrefetchLow(); })) {
+                break;
+            }
         }
         AVPacketPtr up_packet(av_packet_alloc(), &ReleaseAVPacket);
         const auto res = av_read_frame(m_avformat_context.get(), up_packet.get());
@@ -471,9 +488,11 @@ void AvPlayerSource::DemuxerThread(std::stop_token stop) {
             break;
         }
         if (up_packet->stream_index == m_video_stream_index) {
+            m_video_packets_ms += PacketDurationMs(*up_packet, m_video_packet_fallback_ms);
             m_video_packets.Push(std::move(up_packet));
             m_video_packets_cv.Notify();
         } else if (up_packet->stream_index == m_audio_stream_index) {
+            m_audio_packets_ms += PacketDurationMs(*up_packet, m_audio_packet_fallback_ms);
             m_audio_packets.Push(std::move(up_packet));
             m_audio_packets_cv.Notify();
         }
@@ -493,81 +512,100 @@ void AvPlayerSource::DemuxerThread(std::stop_token stop) {
     LOG_INFO(Lib_AvPlayer, "Demuxer Thread exited normally");
 }
 
-AvPlayerSource::AVFramePtr AvPlayerSource::ConvertVideoFrame(const AVFrame& frame) {
-    auto nv12_frame = AVFramePtr{av_frame_alloc(), &ReleaseAVFrame};
-    nv12_frame->pts = frame.pts;
-    nv12_frame->pkt_dts = frame.pkt_dts < 0 ? 0 : frame.pkt_dts;
-    nv12_frame->format = AV_PIX_FMT_NV12;
-    nv12_frame->width = frame.width;
-    nv12_frame->height = frame.height;
-    nv12_frame->sample_aspect_ratio = frame.sample_aspect_ratio;
-    nv12_frame->crop_top = frame.crop_top;
-    nv12_frame->crop_bottom = frame.crop_bottom;
-    nv12_frame->crop_left = frame.crop_left;
-    nv12_frame->crop_right = frame.crop_right;
-
-    av_frame_get_buffer(nv12_frame.get(), 0);
-
-    if (m_sws_context == nullptr) {
-        m_sws_context =
-            SWSContextPtr(sws_getContext(frame.width, frame.height, AVPixelFormat(frame.format),
-                                         nv12_frame->width, nv12_frame->height, AV_PIX_FMT_NV12,
-                                         SWS_FAST_BILINEAR, nullptr, nullptr, nullptr),
-                          &ReleaseSWSContext);
-    }
-    const auto res = sws_scale(m_sws_context.get(), frame.data, frame.linesize, 0, frame.height,
-                               nv12_frame->data, nv12_frame->linesize);
-    if (res < 0) {
-        LOG_ERROR(Lib_AvPlayer, "Could not convert to NV12: {}", av_err2str(res));
-        return AVFramePtr{nullptr, &ReleaseAVFrame};
+s64 AvPlayerSource::PacketDurationMs(const AVPacket& packet, s64 fallback_ms) const {
+    if (packet.duration <= 0) {
+        return fallback_ms;
     }
-    return nv12_frame;
+    const auto stream = m_avformat_context->streams[packet.stream_index];
+    return std::max<s64>(av_rescale_q(packet.duration, stream->time_base, {1, 1000}), 1);
 }
 
-static void CopyNV12Data(u8* dst, const AVFrame& src, bool use_vdec2) {
-    auto width = u32(src.width);
-    auto height = u32(src.height);
-    if (!use_vdec2) {
-        width = Common::AlignUp(width, 16);
-        height = Common::AlignUp(height, 16);
-    }
+bool AvPlayerSource::IsPrefetchFull() {
+    const bool video_full =
+        !m_video_stream_index.has_value() || m_video_packets_ms >= m_prefetch_ms;
+    const bool audio_full =
+        !m_audio_stream_index.has_value() || m_audio_packets_ms >= m_prefetch_ms;
+    return video_full && audio_full;
+}
 
-    if (src.width == width) {
-        std::memcpy(dst, src.data[0], src.width * src.height);
-        std::memcpy(dst + src.width * height, src.data[1], (src.width * src.height) / 2);
-    } else {
-        const auto luma_dst = dst;
-        for (u32 y = 0; y < src.height; ++y) {
-            std::memcpy(luma_dst + y * width, src.data[0] + y * src.width, src.width);
-        }
-        const auto chroma_dst = dst + width * height;
-        for (u32 y = 0; y < src.height / 2; ++y) {
-            std::memcpy(chroma_dst + y * (width / 2), src.data[0] + y * (src.width / 2),
-                        src.width / 2);
+bool AvPlayerSource::IsPrefetchLow() {
+    const auto low_watermark = m_prefetch_ms / 2;
+    return (m_video_stream_index.has_value() && m_video_packets_ms < low_watermark) ||
+           (m_audio_stream_index.has_value() && m_audio_packets_ms < low_watermark);
+}
+
+std::optional<AvPlayerSource::AVPacketPtr> AvPlayerSource::PopPacket(
+    AvPlayerQueue<AVPacketPtr>& packets, std::atomic<s64>& packets_ms, s64 fallback_ms) {
+    auto packet = packets.Pop();
+    if (packet.has_value()) {
+        packets_ms -= PacketDurationMs(**packet, fallback_ms);
+        if (IsPrefetchLow()) {
+            m_demuxer_cv.Notify();
         }
     }
+    return packet;
 }
 
-Frame AvPlayerSource::PrepareVideoFrame(FrameBuffer buffer, const AVFrame& frame) {
-    ASSERT(frame.format == AV_PIX_FMT_NV12);
+void AvPlayerSource::ReportStats(bool force) {
+    using namespace std::chrono;
+    std::unique_lock lock(m_stats_mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    const auto now = steady_clock::now();
+    const auto elapsed = duration_cast<milliseconds>(now - m_stats_time).count();
+    if (!force && elapsed < 1000) {
+        return;
+    }
+    m_stats_time = now;
+
+    // Wakeups are reported per second over the elapsed window.
+    const auto per_second = [elapsed = std::max<s64>(elapsed, 1)](u64 wakeups) {
+        return wakeups * 1000 / elapsed;
+    };
+    const auto demuxer_wakeups = per_second(m_demuxer_cv.TakeWakeups());
+    const auto video_wakeups =
+        per_second(m_video_packets_cv.TakeWakeups() + m_video_buffers_cv.TakeWakeups());
+    const auto audio_wakeups =
+        per_second(m_audio_packets_cv.TakeWakeups() + m_audio_buffers_cv.TakeWakeups());
+    LOG_DEBUG(Lib_AvPlayer,
+              "Queues: video {} packets ({} ms) {} frames, audio {} packets ({} ms) {} frames",
+              m_video_packets.Size(), m_video_packets_ms.load(), m_video_frames.Size(),
+              m_audio_packets.Size(), m_audio_packets_ms.load(), m_audio_frames.Size());
+    LOG_DEBUG(Lib_AvPlayer,
+              "Underruns: video {}, audio {}. Wakeups/s: demuxer {}, video {}, audio {}",
+              m_video_underruns.load(), m_audio_underruns.load(), demuxer_wakeups, video_wakeups,
+              audio_wakeups);
+}
+
+std::optional<Frame> AvPlayerSource::PrepareVideoFrame(FrameBuffer buffer, const AVFrame& frame) {
+    auto width = u32(frame.width);
+    auto height = u32(frame.height);
+    if (!m_use_vdec2) {
+        width = Common::AlignUp(width, 16);
+        height = Common::AlignUp(height, 16);
+    }
 
+    // Decoded pictures are written straight into the guest frame buffer.
     auto p_buffer = buffer.GetBuffer();
-    CopyNV12Data(p_buffer, frame, m_use_vdec2);
+    const Videodec::Nv12Surface surface = {
+        .data = p_buffer,
+        .pitch = width,
+        .height = height,
+        .size = m_video_framebuffer_size,
+    };
+    if (!m_nv12_writer.Write(frame, surface)) {
+        m_video_buffers.Push(std::move(buffer));
+        return std::nullopt;
+    }
 
-    const auto pkt_dts = u64(frame.pkt_dts) * 1000;
+    const auto pkt_dts = u64(frame.pkt_dts < 0 ? 0 : frame.pkt_dts) * 1000;
     const auto stream = m_avformat_context->streams[m_video_stream_index.value()];
     const auto time_base = stream->time_base;
     const auto den = time_base.den;
     const auto num = time_base.num;
     const auto timestamp = (num != 0 && den > 1) ? (pkt_dts * num) / den : pkt_dts;
 
-    auto width = u32(frame.width);
-    auto height = u32(frame.height);
-    if (!m_use_vdec2) {
-        width = Common::AlignUp(width, 16);
-        height = Common::AlignUp(height, 16);
-    }
-
     return Frame{
         .buffer = std::move(buffer),
         .info =
@@ -586,7 +624,7 @@ Frame AvPlayerSource::PrepareVideoFrame(FrameBuffer buffer, const AVFrame& frame
                                 .crop_top_offset = u32(frame.crop_top),
                                 .crop_bottom_offset =
                                     u32(frame.crop_bottom + (height - frame.height)),
-                                .pitch = u32(frame.linesize[0]),
+                                .pitch = width,
                                 .luma_bit_depth = 8,
                                 .chroma_bit_depth = 8,
                             },
@@ -600,12 +638,15 @@ void AvPlayerSource::VideoDecoderThread(std::stop_token stop) {
     Common::SetCurrentThreadName("shadPS4:AvVideoDecoder");
 
     LOG_INFO(Lib_AvPlayer, "Video Decoder Thread started");
+    // A single frame is reused for every decoded picture.
+    const auto up_frame = AVFramePtr(av_frame_alloc(), &ReleaseAVFrame);
     while ((!m_is_eof || m_video_packets.Size() != 0) && !stop.stop_requested()) {
         if (!m_video_packets_cv.Wait(stop,
                                      [this] { return m_video_packets.Size() != 0 || m_is_eof; })) {
             continue;
         }
-        const auto packet = m_video_packets.Pop();
+        const auto packet =
+            PopPacket(m_video_packets, m_video_packets_ms, m_video_packet_fallback_ms);
         if (!packet.has_value()) {
             continue;
         }
@@ -624,7 +665,6 @@ void AvPlayerSource::VideoDecoderThread(std::stop_token stop) {
             if (m_video_buffers.Size() == 0) {
                 continue;
             }
-            auto up_frame = AVFramePtr(av_frame_alloc(), &ReleaseAVFrame);
             res = avcodec_receive_frame(m_video_codec_context.get(), up_frame.get());
             if (res < 0) {
                 if (res == AVERROR_EOF) {
@@ -643,12 +683,13 @@ void AvPlayerSource::VideoDecoderThread(std::stop_token stop) {
                     // Video buffers queue was cleared. This means that player was stopped.
                     break;
                 }
-                if (up_frame->format != AV_PIX_FMT_NV12) {
-                    const auto nv12_frame = ConvertVideoFrame(*up_frame);
-                    m_video_frames.Push(PrepareVideoFrame(std::move(buffer.value()), *nv12_frame));
-                } else {
-                    m_video_frames.Push(PrepareVideoFrame(std::move(buffer.value()), *up_frame));
+                auto frame = PrepareVideoFrame(std::move(buffer.value()), *up_frame);
+                av_frame_unref(up_frame.get());
+                if (!frame.has_value()) {
+                    m_state.OnError();
+                    return;
                 }
+                m_video_frames.Push(std::move(frame.value()));
                 m_video_frames_cv.Notify();
             }
         }
@@ -727,7 +768,8 @@ void AvPlayerSource::AudioDecoderThread(std::stop_token stop) {
                                      [this] { return m_audio_packets.Size() != 0 || m_is_eof; })) {
             continue;
         }
-        const auto packet = m_audio_packets.Pop();
+        const auto packet =
+            PopPacket(m_audio_packets, m_audio_packets_ms, m_audio_packet_fallback_ms);
         if (!packet.has_value()) {
             continue;
         }
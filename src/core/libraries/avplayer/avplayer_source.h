@@ -9,12 +9,14 @@
 #include <mutex>
 #include <optional>
 #include <string_view>
+#include <utility>
 
 #include "common/assert.h"
 #include "core/libraries/avplayer/avplayer.h"
 #include "core/libraries/avplayer/avplayer_common.h"
 #include "core/libraries/avplayer/avplayer_data_streamer.h"
 #include "core/libraries/kernel/threads.h"
+#include "core/libraries/videodec/nv12_writer.h"
 
 struct AVCodecContext;
 struct AVFormatContext;
@@ -22,7 +24,6 @@ struct AVFrame;
 struct AVIOContext;
 struct AVPacket;
 struct SwrContext;
-struct SwsContext;
 
 namespace Libraries::AvPlayer {
 
@@ -91,19 +92,19 @@ public:
     template <class Pred>
     void Wait(Pred pred) {
         std::unique_lock lock(m_mutex);
-        m_cv.wait(lock, std::move(pred));
+        m_cv.wait(lock, CountWakeups(std::move(pred)));
     }
 
     template <class Pred>
     bool Wait(std::stop_token stop, Pred pred) {
         std::unique_lock lock(m_mutex);
-        return m_cv.wait(lock, std::move(stop), std::move(pred));
+        return m_cv.wait(lock, std::move(stop), CountWakeups(std::move(pred)));
     }
 
     template <class Pred, class Rep, class Period>
     bool WaitFor(std::chrono::duration<Rep, Period> timeout, Pred pred) {
         std::unique_lock lock(m_mutex);
-        return m_cv.wait_for(lock, timeout, std::move(pred));
+        return m_cv.wait_for(lock, timeout, CountWakeups(std::move(pred)));
     }
 
     void Notify() {
@@ -111,9 +112,27 @@ public:
         m_cv.notify_all();
     }
 
+    /// Returns the number of times waiters were woken up since the last call.
+    u64 TakeWakeups() {
+        std::unique_lock lock(m_mutex);
+        return std::exchange(m_wakeups, 0);
+    }
+
 private:
+    template <class Pred>
+    auto CountWakeups(Pred pred) {
+        // The first evaluation happens before blocking, every later one follows a wakeup.
+        return [this, pred = std::move(pred), first = true]() mutable {
+            if (!std::exchange(first, false)) {
+                ++m_wakeups;
+            }
+            return pred();
+        };
+    }
+
     std::mutex m_mutex{};
     std::condition_variable_any m_cv{};
+    u64 m_wakeups{};
 };
 
 class AvPlayerSource {
@@ -141,14 +160,12 @@ private:
     static void ReleaseAVFrame(AVFrame* frame);
     static void ReleaseAVCodecContext(AVCodecContext* context);
     static void ReleaseSWRContext(SwrContext* context);
-    static void ReleaseSWSContext(SwsContext* context);
     static void ReleaseAVFormatContext(AVFormatContext* context);
 
     using AVPacketPtr = std::unique_ptr<AVPacket, decltype(&ReleaseAVPacket)>;
     using AVFramePtr = std::unique_ptr<AVFrame, decltype(&ReleaseAVFrame)>;
     using AVCodecContextPtr = std::unique_ptr<AVCodecContext, decltype(&ReleaseAVCodecContext)>;
     using SWRContextPtr = std::unique_ptr<SwrContext, decltype(&ReleaseSWRContext)>;
-    using SWSContextPtr = std::unique_ptr<SwsContext, decltype(&ReleaseSWSContext)>;
     using AVFormatContextPtr = std::unique_ptr<AVFormatContext, decltype(&ReleaseAVFormatContext)>;
 
     void DemuxerThread(std::stop_token stop);
@@ -157,17 +174,24 @@ private:
 
     bool HasRunningThreads() const;
 
+    s64 PacketDurationMs(const AVPacket& packet, s64 fallback_ms) const;
+    bool IsPrefetchFull();
+    bool IsPrefetchLow();
+    std::optional<AVPacketPtr> PopPacket(AvPlayerQueue<AVPacketPtr>& packets,
+                                         std::atomic<s64>& packets_ms, s64 fallback_ms);
+    void ReportStats(bool force);
+
     AVFramePtr ConvertAudioFrame(const AVFrame& frame);
-    AVFramePtr ConvertVideoFrame(const AVFrame& frame);
 
     Frame PrepareAudioFrame(FrameBuffer buffer, const AVFrame& frame);
-    Frame PrepareVideoFrame(FrameBuffer buffer, const AVFrame& frame);
+    std::optional<Frame> PrepareVideoFrame(FrameBuffer buffer, const AVFrame& frame);
 
     AvPlayerStateCallback& m_state;
     bool m_use_vdec2 = false;
 
     SceAvPlayerMemAllocator m_memory_replacement{};
     u32 m_num_output_video_framebuffers{};
+    u32 m_video_framebuffer_size{};
 
     std::atomic_bool m_is_looping = false;
     std::atomic_bool m_is_eof = false;
@@ -180,6 +204,14 @@ private:
     AvPlayerQueue<AVPacketPtr> m_audio_packets;
     AvPlayerQueue<AVPacketPtr> m_video_packets;
 
+    // Media time covered by the queued packets. The demuxer fills the queues up to the prefetch
+    // depth and sleeps until a decoder drains one of them below half of it.
+    std::atomic<s64> m_audio_packets_ms{};
+    std::atomic<s64> m_video_packets_ms{};
+    s64 m_prefetch_ms{};
+    s64 m_audio_packet_fallback_ms{};
+    s64 m_video_packet_fallback_ms{};
+
     AvPlayerQueue<Frame> m_audio_frames;
     AvPlayerQueue<Frame> m_video_frames;
 
@@ -197,8 +229,14 @@ private:
     EventCV m_video_frames_cv{};
     EventCV m_video_buffers_cv{};
 
+    EventCV m_demuxer_cv{};
     EventCV m_stop_cv{};
 
+    std::atomic<u64> m_audio_underruns{};
+    std::atomic<u64> m_video_underruns{};
+    std::mutex m_stats_mutex{};
+    std::chrono::steady_clock::time_point m_stats_time{};
+
     std::mutex m_state_mutex{};
     Kernel::Thread m_demuxer_thread{};
     Kernel::Thread m_video_decoder_thread{};
@@ -208,7 +246,7 @@ private:
     AVCodecContextPtr m_video_codec_context{nullptr, &ReleaseAVCodecContext};
     AVCodecContextPtr m_audio_codec_context{nullptr, &ReleaseAVCodecContext};
     SWRContextPtr m_swr_context{nullptr, &ReleaseSWRContext};
-    SWSContextPtr m_sws_context{nullptr, &ReleaseSWSContext};
+    Videodec::Nv12Writer m_nv12_writer{};
 
     std::chrono::high_resolution_clock::time_point m_start_time{};
 };
@@ -0,0 +1,731 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "common/arch.h"
+#include "core/libraries/jpeg/jpeg_encoder.h"
+
+#ifdef ARCH_X86_64
+#include <emmintrin.h>
+#endif
+
+namespace Libraries::JpegEnc {
+
+namespace {
+
+// Natural order index of every zigzag position.
+constexpr std::array<u8, 64> ZigZag = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Annex K quantization tables in natural order.
+constexpr std::array<u8, 64> LumaQuant = {
+    16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+    14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+    18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99,
+};
+
+constexpr std::array<u8, 64> ChromaQuant = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99, 24, 26, 56, 99, 99, 99,
+    99, 99, 47, 66, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+};
+
+// Annex K Huffman tables: code counts per length followed by the symbols.
+constexpr std::array<u8, 16> DcLumaBits = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+constexpr std::array<u8, 16> DcChromaBits = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+constexpr std::array<u8, 12> DcValues = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+constexpr std::array<u8, 16> AcLumaBits = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+constexpr std::array<u8, 162> AcLumaValues = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61,
+    0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52,
+    0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25,
+    0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45,
+    0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64,
+    0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99,
+    0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+    0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3,
+    0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8,
+    0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+constexpr std::array<u8, 16> AcChromaBits = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+constexpr std::array<u8, 162> AcChromaValues = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61,
+    0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33,
+    0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18,
+    0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44,
+    0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63,
+    0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97,
+    0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+    0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca,
+    0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7,
+    0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa,
+};
+
+// Output scale of each AAN DCT coefficient, folded into the quantization divisors.
+constexpr std::array<float, 8> AanScale = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f,
+};
+
+struct HuffmanTable {
+    std::span<const u8> bits;
+    std::span<const u8> values;
+    std::array<u16, 256> codes{};
+    std::array<u8, 256> sizes{};
+
+    HuffmanTable(std::span<const u8> bits, std::span<const u8> values)
+        : bits{bits}, values{values} {
+        // Canonical code assignment, Annex C.
+        u32 code = 0;
+        u32 index = 0;
+        for (u32 length = 1; length <= 16; ++length) {
+            for (u32 i = 0; i < bits[length - 1]; ++i) {
+                codes[values[index]] = static_cast<u16>(code++);
+                sizes[values[index]] = static_cast<u8>(length);
+                ++index;
+            }
+            code <<= 1;
+        }
+    }
+};
+
+struct QuantTable {
+    std::array<u8, 64> values;     ///< Natural order.
+    std::array<float, 64> inverse; ///< Reciprocal divisors including the AAN output scale.
+
+    QuantTable(const std::array<u8, 64>& base, u32 quality) {
+        // IJG quality scaling.
+        const u32 scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        for (u32 i = 0; i < 64; ++i) {
+            values[i] = static_cast<u8>(std::clamp<u32>((base[i] * scale + 50) / 100, 1, 255));
+            inverse[i] = 1.0f / (values[i] * AanScale[i / 8] * AanScale[i % 8] * 8.0f);
+        }
+    }
+};
+
+class BitWriter {
+public:
+    explicit BitWriter(std::span<u8> output) : output{output} {}
+
+    void Byte(u8 value) {
+        if (position < output.size()) {
+            output[position] = value;
+        } else {
+            overflow = true;
+        }
+        ++position;
+    }
+
+    void Word(u16 value) {
+        Byte(static_cast<u8>(value >> 8));
+        Byte(static_cast<u8>(value));
+    }
+
+    void Marker(u8 marker) {
+        Byte(0xFF);
+        Byte(marker);
+    }
+
+    void Bits(u32 code, u32 size) {
+        bit_buffer = (bit_buffer << size) | (code & ((1U << size) - 1));
+        bit_count += size;
+        while (bit_count >= 8) {
+            bit_count -= 8;
+            const u8 value = static_cast<u8>(bit_buffer >> bit_count);
+            Byte(value);
+            if (value == 0xFF) {
+                Byte(0); // Byte stuffing
+            }
+        }
+        bit_buffer &= (1U << bit_count) - 1;
+    }
+
+    /// Pads the entropy coded segment to a byte boundary with one bits.
+    void FlushBits() {
+        if (bit_count > 0) {
+            Bits(0x7F, 8 - bit_count);
+        }
+    }
+
+    [[nodiscard]] bool Overflow() const {
+        return overflow;
+    }
+
+    [[nodiscard]] u64 Size() const {
+        return position;
+    }
+
+private:
+    std::span<u8> output;
+    u64 position{};
+    u32 bit_buffer{};
+    u32 bit_count{};
+    bool overflow{};
+};
+
+struct Plane {
+    const u8* data;
+    u32 pitch;
+    u32 width;
+    u32 height;
+};
+
+// Colour conversion, JFIF full range BT.601.
+
+inline u8 ToU8(float value) {
+    return static_cast<u8>(std::clamp(std::lround(value), 0l, 255l));
+}
+
+inline float LumaOf(float r, float g, float b) {
+    return 0.299f * r + 0.587f * g + 0.114f * b;
+}
+
+inline float CbOf(float r, float g, float b) {
+    return -0.168736f * r - 0.331264f * g + 0.5f * b + 128.0f;
+}
+
+inline float CrOf(float r, float g, float b) {
+    return 0.5f * r - 0.418688f * g - 0.081312f * b + 128.0f;
+}
+
+void LoadRgb(const u8* pixel, bool bgr, float& r, float& g, float& b) {
+    r = pixel[bgr ? 2 : 0];
+    g = pixel[1];
+    b = pixel[bgr ? 0 : 2];
+}
+
+void ConvertLumaRowScalar(const u8* src, bool bgr, u8* dst, u32 begin, u32 end) {
+    for (u32 x = begin; x < end; ++x) {
+        float r, g, b;
+        LoadRgb(src + x * 4, bgr, r, g, b);
+        dst[x] = ToU8(LumaOf(r, g, b));
+    }
+}
+
+void ConvertChromaRowScalar(const u8* row0, const u8* row1, u32 width, bool bgr, u8* cb, u8* cr,
+                            u32 begin, u32 end) {
+    for (u32 cx = begin; cx < end; ++cx) {
+        const u32 x0 = cx * 2;
+        const u32 x1 = std::min(x0 + 1, width - 1);
+        float r = 0.0f, g = 0.0f, b = 0.0f;
+        for (const u8* row : {row0, row1}) {
+            for (const u32 x : {x0, x1}) {
+                float pr, pg, pb;
+                LoadRgb(row + x * 4, bgr, pr, pg, pb);
+                r += pr;
+                g += pg;
+                b += pb;
+            }
+        }
+        r *= 0.25f;
+        g *= 0.25f;
+        b *= 0.25f;
+        cb[cx] = ToU8(CbOf(r, g, b));
+        cr[cx] = ToU8(CrOf(r, g, b));
+    }
+}
+
+#ifdef ARCH_X86_64
+struct Rgb4 {
+    __m128 r, g, b;
+};
+
+Rgb4 LoadRgb4(const u8* pixels, bool bgr) {
+    const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    const __m128 c0 = _mm_cvtepi32_ps(_mm_and_si128(packed, mask));
+    const __m128 c1 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 8), mask));
+    const __m128 c2 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 16), mask));
+    return bgr ? Rgb4{c2, c1, c0} : Rgb4{c0, c1, c2};
+}
+
+/// Sums horizontally adjacent pixel pairs of eight pixels into four lanes.
+__m128 PairSum(__m128 lo, __m128 hi) {
+    return _mm_add_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)),
+                      _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+void StoreU8x4(u8* dst, __m128 value) {
+    const __m128i ints = _mm_cvtps_epi32(value);
+    const __m128i words = _mm_packs_epi32(ints, ints);
+    const s32 bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+    std::memcpy(dst, &bytes, sizeof(bytes));
+}
+
+__m128 Dot(const Rgb4& c, float kr, float kg, float kb, float bias) {
+    const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c.r, _mm_set1_ps(kr)),
+                                             _mm_mul_ps(c.g, _mm_set1_ps(kg))),
+                                  _mm_mul_ps(c.b, _mm_set1_ps(kb)));
+    return _mm_add_ps(sum, _mm_set1_ps(bias));
+}
+#endif
+
+void ConvertLumaRow(const u8* src, u32 width, bool bgr, u8* dst) {
+    u32 x = 0;
+#ifdef ARCH_X86_64
+    for (; x + 4 <= width; x += 4) {
+        StoreU8x4(dst + x, Dot(LoadRgb4(src + x * 4, bgr), 0.299f, 0.587f, 0.114f, 0.0f));
+    }
+#endif
+    ConvertLumaRowScalar(src, bgr, dst, x, width);
+}
+
+void ConvertChromaRow(const u8* row0, const u8* row1, u32 width, bool bgr, u8* cb, u8* cr) {
+    const u32 chroma_width = (width + 1) / 2;
+    u32 cx = 0;
+#ifdef ARCH_X86_64
+    // Four chroma samples cover eight source pixels of both rows.
+    for (; cx * 2 + 8 <= width; cx += 4) {
+        const u8* p0 = row0 + cx * 8;
+        const u8* p1 = row1 + cx * 8;
+        const Rgb4 a0 = LoadRgb4(p0, bgr), b0 = LoadRgb4(p0 + 16, bgr);
+        const Rgb4 a1 = LoadRgb4(p1, bgr), b1 = LoadRgb4(p1 + 16, bgr);
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        const Rgb4 avg = {
+            _mm_mul_ps(_mm_add_ps(PairSum(a0.r, b0.r), PairSum(a1.r, b1.r)), quarter),
+            _mm_mul_ps(_mm_add_ps(PairSum(a0.g, b0.g), PairSum(a1.g, b1.g)), quarter),
+            _mm_mul_ps(_mm_add_ps(PairSum(a0.b, b0.b), PairSum(a1.b, b1.b)), quarter),
+        };
+        StoreU8x4(cb + cx, Dot(avg, -0.168736f, -0.331264f, 0.5f, 128.0f));
+        StoreU8x4(cr + cx, Dot(avg, 0.5f, -0.418688f, -0.081312f, 128.0f));
+    }
+#endif
+    ConvertChromaRowScalar(row0, row1, width, bgr, cb, cr, cx, chroma_width);
+}
+
+// Forward DCT, floating point AAN algorithm. V is either a float or four SIMD lanes, so the
+// same butterflies transform one column at a time or four at once.
+
+#ifdef ARCH_X86_64
+struct Lane4 {
+    __m128 v;
+};
+
+inline Lane4 operator+(Lane4 a, Lane4 b) {
+    return {_mm_add_ps(a.v, b.v)};
+}
+
+inline Lane4 operator-(Lane4 a, Lane4 b) {
+    return {_mm_sub_ps(a.v, b.v)};
+}
+
+inline Lane4 operator*(Lane4 a, float b) {
+    return {_mm_mul_ps(a.v, _mm_set1_ps(b))};
+}
+#endif
+
+template <typename V>
+void Fdct8(V* d) {
+    const V tmp0 = d[0] + d[7];
+    const V tmp7 = d[0] - d[7];
+    const V tmp1 = d[1] + d[6];
+    const V tmp6 = d[1] - d[6];
+    const V tmp2 = d[2] + d[5];
+    const V tmp5 = d[2] - d[5];
+    const V tmp3 = d[3] + d[4];
+    const V tmp4 = d[3] - d[4];
+
+    // Even part
+    const V tmp10 = tmp0 + tmp3;
+    const V tmp13 = tmp0 - tmp3;
+    const V tmp11 = tmp1 + tmp2;
+    const V tmp12 = tmp1 - tmp2;
+    d[0] = tmp10 + tmp11;
+    d[4] = tmp10 - tmp11;
+    const V z1 = (tmp12 + tmp13) * 0.707106781f;
+    d[2] = tmp13 + z1;
+    d[6] = tmp13 - z1;
+
+    // Odd part
+    const V odd10 = tmp4 + tmp5;
+    const V odd11 = tmp5 + tmp6;
+    const V odd12 = tmp6 + tmp7;
+    const V z5 = (odd10 - odd12) * 0.382683433f;
+    const V z2 = odd10 * 0.541196100f + z5;
+    const V z4 = odd12 * 1.306562965f + z5;
+    const V z3 = odd11 * 0.707106781f;
+    const V z11 = tmp7 + z3;
+    const V z13 = tmp7 - z3;
+    d[5] = z13 + z2;
+    d[3] = z13 - z2;
+    d[1] = z11 + z4;
+    d[7] = z11 - z4;
+}
+
+[[maybe_unused]] void ForwardDctScalar(float* block) {
+    std::array<float, 8> d;
+    for (u32 pass = 0; pass < 2; ++pass) {
+        // First pass transforms columns, second pass rows.
+        const u32 stride = pass == 0 ? 8 : 1;
+        const u32 step = pass == 0 ? 1 : 8;
+        for (u32 i = 0; i < 8; ++i) {
+            float* line = block + i * step;
+            for (u32 k = 0; k < 8; ++k) {
+                d[k] = line[k * stride];
+            }
+            Fdct8(d.data());
+            for (u32 k = 0; k < 8; ++k) {
+                line[k * stride] = d[k];
+            }
+        }
+    }
+}
+
+#ifdef ARCH_X86_64
+void Transpose8x8(std::array<Lane4, 16>& rows) {
+    // rows[2 * r] holds columns 0-3 of row r, rows[2 * r + 1] columns 4-7.
+    const auto transpose4 = [&](u32 row, u32 half) {
+        _MM_TRANSPOSE4_PS(rows[row * 2 + half].v, rows[(row + 1) * 2 + half].v,
+                          rows[(row + 2) * 2 + half].v, rows[(row + 3) * 2 + half].v);
+    };
+    transpose4(0, 0);
+    transpose4(0, 1);
+    transpose4(4, 0);
+    transpose4(4, 1);
+    for (u32 r = 0; r < 4; ++r) {
+        std::swap(rows[r * 2 + 1], rows[(r + 4) * 2]);
+    }
+}
+
+void ForwardDct(float* block) {
+    std::array<Lane4, 16> rows;
+    for (u32 r = 0; r < 8; ++r) {
+        rows[r * 2] = {_mm_loadu_ps(block + r * 8)};
+        rows[r * 2 + 1] = {_mm_loadu_ps(block + r * 8 + 4)};
+    }
+    // Rows are the vector lanes, so each pass transforms four columns at a time.
+    for (u32 pass = 0; pass < 2; ++pass) {
+        for (u32 half = 0; half < 2; ++half) {
+            std::array<Lane4, 8> d;
+            for (u32 r = 0; r < 8; ++r) {
+                d[r] = rows[r * 2 + half];
+            }
+            Fdct8(d.data());
+            for (u32 r = 0; r < 8; ++r) {
+                rows[r * 2 + half] = d[r];
+            }
+        }
+        Transpose8x8(rows);
+    }
+    for (u32 r = 0; r < 8; ++r) {
+        _mm_storeu_ps(block + r * 8, rows[r * 2].v);
+        _mm_storeu_ps(block + r * 8 + 4, rows[r * 2 + 1].v);
+    }
+}
+
+void Quantize(const float* block, const QuantTable& table, s16* coefs) {
+    for (u32 i = 0; i < 64; i += 8) {
+        const __m128 lo = _mm_mul_ps(_mm_loadu_ps(block + i), _mm_loadu_ps(&table.inverse[i]));
+        const __m128 hi =
+            _mm_mul_ps(_mm_loadu_ps(block + i + 4), _mm_loadu_ps(&table.inverse[i + 4]));
+        const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(coefs + i), packed);
+    }
+}
+#else
+void ForwardDct(float* block) {
+    ForwardDctScalar(block);
+}
+
+void Quantize(const float* block, const QuantTable& table, s16* coefs) {
+    for (u32 i = 0; i < 64; ++i) {
+        coefs[i] = static_cast<s16>(std::lround(block[i] * table.inverse[i]));
+    }
+}
+#endif
+
+void LoadBlock(const Plane& plane, u32 x0, u32 y0, float* block) {
+    for (u32 r = 0; r < 8; ++r) {
+        // Blocks past the image edge repeat the last row and column.
+        const u8* row = plane.data + u64(std::min(y0 + r, plane.height - 1)) * plane.pitch;
+        if (x0 + 8 <= plane.width) {
+            for (u32 c = 0; c < 8; ++c) {
+                block[r * 8 + c] = static_cast<float>(row[x0 + c]) - 128.0f;
+            }
+        } else {
+            for (u32 c = 0; c < 8; ++c) {
+                const u32 x = std::min(x0 + c, plane.width - 1);
+                block[r * 8 + c] = static_cast<float>(row[x]) - 128.0f;
+            }
+        }
+    }
+}
+
+class BlockEncoder {
+public:
+    BlockEncoder(BitWriter& writer, const QuantTable& quant, const HuffmanTable& dc,
+                 const HuffmanTable& ac)
+        : writer{writer}, quant{quant}, dc{dc}, ac{ac} {}
+
+    void Encode(const Plane& plane, u32 x0, u32 y0) {
+        alignas(16) std::array<float, 64> block;
+        alignas(16) std::array<s16, 64> coefs;
+        LoadBlock(plane, x0, y0, block.data());
+        ForwardDct(block.data());
+        Quantize(block.data(), quant, coefs.data());
+
+        const s32 diff = coefs[0] - dc_pred;
+        dc_pred = coefs[0];
+        EmitValue(dc, 0, diff);
+
+        u32 run = 0;
+        for (u32 k = 1; k < 64; ++k) {
+            const s32 value = std::clamp<s32>(coefs[ZigZag[k]], -1023, 1023);
+            if (value == 0) {
+                ++run;
+                continue;
+            }
+            for (; run >= 16; run -= 16) {
+                writer.Bits(ac.codes[0xF0], ac.sizes[0xF0]); // ZRL
+            }
+            EmitValue(ac, run, value);
+            run = 0;
+        }
+        if (run > 0) {
+            writer.Bits(ac.codes[0x00], ac.sizes[0x00]); // EOB
+        }
+    }
+
+    void ResetPredictor() {
+        dc_pred = 0;
+    }
+
+private:
+    void EmitValue(const HuffmanTable& table, u32 run, s32 value) {
+        const u32 magnitude = static_cast<u32>(value < 0 ? -value : value);
+        const u32 category = static_cast<u32>(std::bit_width(magnitude));
+        const u32 symbol = (run << 4) | category;
+        writer.Bits(table.codes[symbol], table.sizes[symbol]);
+        if (category > 0) {
+            writer.Bits(static_cast<u32>(value < 0 ? value - 1 : value), category);
+        }
+    }
+
+    BitWriter& writer;
+    const QuantTable& quant;
+    const HuffmanTable& dc;
+    const HuffmanTable& ac;
+    s32 dc_pred{};
+};
+
+void WriteQuantTable(BitWriter& writer, u8 id, const QuantTable& table) {
+    writer.Marker(0xDB);
+    writer.Word(2 + 65);
+    writer.Byte(id);
+    for (const u8 index : ZigZag) {
+        writer.Byte(table.values[index]);
+    }
+}
+
+void WriteHuffmanTable(BitWriter& writer, u8 id, const HuffmanTable& table) {
+    writer.Marker(0xC4);
+    writer.Word(static_cast<u16>(2 + 1 + 16 + table.values.size()));
+    writer.Byte(id);
+    for (const u8 count : table.bits) {
+        writer.Byte(count);
+    }
+    for (const u8 value : table.values) {
+        writer.Byte(value);
+    }
+}
+
+} // Anonymous namespace
+
+std::optional<u32> EncodeJpeg(const OrbisJpegEncEncodeParam& param, std::span<u8> output) {
+    const u32 width = param.image_width;
+    const u32 height = param.image_height;
+    const auto* image = static_cast<const u8*>(param.image);
+    const bool grayscale = param.color_space == ORBIS_JPEG_ENC_COLOR_SPACE_GRAYSCALE;
+    const bool subsample_rows = param.sampling_type == ORBIS_JPEG_ENC_SAMPLING_TYPE_420;
+    // The compression ratio is treated as an IJG style quality level.
+    const u32 quality =
+        param.compression_ratio == 0 ? 90 : std::min<u32>(param.compression_ratio, 100);
+
+    // Gather the source into planes. Y8 input is read in place.
+    const u32 chroma_width = (width + 1) / 2;
+    const u32 chroma_height = subsample_rows ? (height + 1) / 2 : height;
+    std::vector<u8> luma_storage;
+    std::vector<u8> cb_storage;
+    std::vector<u8> cr_storage;
+    Plane luma{image, param.image_pitch, width, height};
+    Plane cb{};
+    Plane cr{};
+    if (!grayscale) {
+        luma_storage.resize(u64(width) * height);
+        cb_storage.resize(u64(chroma_width) * chroma_height);
+        cr_storage.resize(u64(chroma_width) * chroma_height);
+        luma = {luma_storage.data(), width, width, height};
+        cb = {cb_storage.data(), chroma_width, chroma_width, chroma_height};
+        cr = {cr_storage.data(), chroma_width, chroma_width, chroma_height};
+
+        const u32 row_step = subsample_rows ? 2 : 1;
+        if (param.pixel_format == ORBIS_JPEG_ENC_PIXEL_FORMAT_Y8U8Y8V8) {
+            for (u32 y = 0; y < height; ++y) {
+                const u8* row = image + u64(y) * param.image_pitch;
+                for (u32 x = 0; x < width; ++x) {
+                    luma_storage[u64(y) * width + x] = row[x * 2];
+                }
+            }
+            for (u32 cy = 0; cy < chroma_height; ++cy) {
+                const u32 y0 = cy * row_step;
+                const u8* row0 = image + u64(y0) * param.image_pitch;
+                const u8* row1 = image + u64(std::min(y0 + 1, height - 1)) * param.image_pitch;
+                for (u32 cx = 0; cx < chroma_width; ++cx) {
+                    const u32 offset = cx * 4;
+                    const u64 index = u64(cy) * chroma_width + cx;
+                    if (subsample_rows) {
+                        cb_storage[index] =
+                            static_cast<u8>((row0[offset + 1] + row1[offset + 1] + 1) / 2);
+                        cr_storage[index] =
+                            static_cast<u8>((row0[offset + 3] + row1[offset + 3] + 1) / 2);
+                    } else {
+                        cb_storage[index] = row0[offset + 1];
+                        cr_storage[index] = row0[offset + 3];
+                    }
+                }
+            }
+        } else {
+            const bool bgr = param.pixel_format == ORBIS_JPEG_ENC_PIXEL_FORMAT_B8G8R8A8;
+            for (u32 y = 0; y < height; ++y) {
+                ConvertLumaRow(image + u64(y) * param.image_pitch, width, bgr,
+                               luma_storage.data() + u64(y) * width);
+            }
+            for (u32 cy = 0; cy < chroma_height; ++cy) {
+                // 4:2:2 averages each row with itself so both layouts share the 2x2 kernel.
+                const u32 y0 = cy * row_step;
+                const u32 y1 = subsample_rows ? std::min(y0 + 1, height - 1) : y0;
+                ConvertChromaRow(image + u64(y0) * param.image_pitch,
+                                 image + u64(y1) * param.image_pitch, width, bgr,
+                                 cb_storage.data() + u64(cy) * chroma_width,
+                                 cr_storage.data() + u64(cy) * chroma_width);
+            }
+        }
+    }
+
+    const QuantTable luma_quant(LumaQuant, quality);
+    const QuantTable chroma_quant(ChromaQuant, quality);
+    const HuffmanTable dc_luma(DcLumaBits, DcValues);
+    const HuffmanTable ac_luma(AcLumaBits, AcLumaValues);
+    const HuffmanTable dc_chroma(DcChromaBits, DcValues);
+    const HuffmanTable ac_chroma(AcChromaBits, AcChromaValues);
+    const bool mjpeg = param.encode_mode == ORBIS_JPEG_ENC_ENCODE_MODE_MJPEG;
+
+    BitWriter writer(output);
+    writer.Marker(0xD8); // SOI
+    if (!mjpeg) {
+        // APP0 JFIF 1.01, no density, no thumbnail.
+        static constexpr std::array<u8, 14> Jfif = {'J', 'F', 'I', 'F', 0, 1, 1,
+                                                    0,   0,   1,   0,   1, 0, 0};
+        writer.Marker(0xE0);
+        writer.Word(2 + Jfif.size());
+        for (const u8 value : Jfif) {
+            writer.Byte(value);
+        }
+    }
+    WriteQuantTable(writer, 0, luma_quant);
+    if (!grayscale) {
+        WriteQuantTable(writer, 1, chroma_quant);
+    }
+
+    // SOF0
+    const u8 num_components = grayscale ? 1 : 3;
+    const u8 luma_sampling = grayscale ? 0x11 : subsample_rows ? 0x22 : 0x21;
+    writer.Marker(0xC0);
+    writer.Word(8 + 3 * num_components);
+    writer.Byte(8);
+    writer.Word(static_cast<u16>(height));
+    writer.Word(static_cast<u16>(width));
+    writer.Byte(num_components);
+    for (u8 component = 0; component < num_components; ++component) {
+        writer.Byte(component + 1);
+        writer.Byte(component == 0 ? luma_sampling : 0x11);
+        writer.Byte(component == 0 ? 0 : 1);
+    }
+
+    // Motion JPEG frames rely on the standard Annex K tables instead of carrying them.
+    if (!mjpeg) {
+        WriteHuffmanTable(writer, 0x00, dc_luma);
+        WriteHuffmanTable(writer, 0x10, ac_luma);
+        if (!grayscale) {
+            WriteHuffmanTable(writer, 0x01, dc_chroma);
+            WriteHuffmanTable(writer, 0x11, ac_chroma);
+        }
+    }
+
+    const u32 restart_interval = static_cast<u32>(std::max(param.restart_interval, 0));
+    if (restart_interval > 0) {
+        writer.Marker(0xDD); // DRI
+        writer.Word(4);
+        writer.Word(static_cast<u16>(restart_interval));
+    }
+
+    // SOS
+    writer.Marker(0xDA);
+    writer.Word(6 + 2 * num_components);
+    writer.Byte(num_components);
+    for (u8 component = 0; component < num_components; ++component) {
+        writer.Byte(component + 1);
+        writer.Byte(component == 0 ? 0x00 : 0x11);
+    }
+    writer.Byte(0);
+    writer.Byte(63);
+    writer.Byte(0);
+
+    BlockEncoder y_encoder(writer, luma_quant, dc_luma, ac_luma);
+    BlockEncoder cb_encoder(writer, chroma_quant, dc_chroma, ac_chroma);
+    BlockEncoder cr_encoder(writer, chroma_quant, dc_chroma, ac_chroma);
+
+    const u32 mcu_width = grayscale ? 8 : 16;
+    const u32 mcu_height = subsample_rows ? 16 : 8;
+    const u32 mcus_x = (width + mcu_width - 1) / mcu_width;
+    const u32 mcus_y = (height + mcu_height - 1) / mcu_height;
+    const u32 total_mcus = mcus_x * mcus_y;
+    u32 mcu_index = 0;
+    for (u32 my = 0; my < mcus_y && !writer.Overflow(); ++my) {
+        for (u32 mx = 0; mx < mcus_x; ++mx) {
+            const u32 x0 = mx * mcu_width;
+            const u32 y0 = my * mcu_height;
+            for (u32 by = 0; by < mcu_height; by += 8) {
+                for (u32 bx = 0; bx < mcu_width; bx += 8) {
+                    y_encoder.Encode(luma, x0 + bx, y0 + by);
+                }
+            }
+            if (!grayscale) {
+                cb_encoder.Encode(cb, mx * 8, my * 8);
+                cr_encoder.Encode(cr, mx * 8, my * 8);
+            }
+
+            ++mcu_index;
+            if (restart_interval > 0 && mcu_index % restart_interval == 0 &&
+                mcu_index < total_mcus) {
+                writer.FlushBits();
+                writer.Marker(0xD0 + ((mcu_index / restart_interval - 1) & 7)); // RSTn
+                y_encoder.ResetPredictor();
+                cb_encoder.ResetPredictor();
+                cr_encoder.ResetPredictor();
+            }
+        }
+    }
+    writer.FlushBits();
+    writer.Marker(0xD9); // EOI
+
+    if (writer.Overflow()) {
+        return std::nullopt;
+    }
+    return static_cast<u32>(writer.Size());
+}
+
+} // namespace Libraries::JpegEnc
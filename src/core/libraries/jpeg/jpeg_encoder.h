@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <optional>
+#include <span>
+
+#include "core/libraries/jpeg/jpegenc.h"
+
+namespace Libraries::JpegEnc {
+
+/// Baseline JPEG encoder for the formats accepted by sceJpegEncEncode. RGBA/BGRA and YUYV input
+/// is encoded as 4:2:2 or 4:2:0 YCbCr, Y8 input as grayscale.
+///
+/// Returns the number of bytes written, or std::nullopt if the output does not fit.
+std::optional<u32> EncodeJpeg(const OrbisJpegEncEncodeParam& param, std::span<u8> output);
+
+} // namespace Libraries::JpegEnc
@@ -7,6 +7,7 @@
 #include "common/assert.h"
 #include "common/logging/log.h"
 #include "core/libraries/error_codes.h"
+#include "core/libraries/jpeg/jpeg_encoder.h"
 #include "core/libraries/libs.h"
 #include "jpeg_error.h"
 #include "jpegenc.h"
@@ -172,8 +173,8 @@ s32 PS4_SYSV_ABI sceJpegEncEncode(OrbisJpegEncHandle handle, const OrbisJpegEncE
         return param_ret;
     }
 
-    LOG_ERROR(Lib_Jpeg,
-              "(STUBBED) image_size = {} , jpeg_size = {} , image_width = {} , image_height = {} , "
+    LOG_DEBUG(Lib_Jpeg,
+              "image_size = {} , jpeg_size = {} , image_width = {} , image_height = {} , "
               "image_pitch = {} , pixel_format = {} , encode_mode = {} , color_space = {} , "
               "sampling_type = {} , compression_ratio = {} , restart_interval = {}",
               param->image_size, param->jpeg_size, param->image_width, param->image_height,
@@ -182,8 +183,16 @@ s32 PS4_SYSV_ABI sceJpegEncEncode(OrbisJpegEncHandle handle, const OrbisJpegEncE
               magic_enum::enum_name(param->sampling_type), param->compression_ratio,
               param->restart_interval);
 
+    const auto size =
+        EncodeJpeg(*param, {static_cast<u8*>(param->jpeg), static_cast<size_t>(param->jpeg_size)});
+    if (!size) {
+        LOG_ERROR(Lib_Jpeg, "Encoded image does not fit the {} byte output buffer",
+                  param->jpeg_size);
+        return ORBIS_JPEG_ENC_ERROR_INVALID_SIZE;
+    }
+
     if (output_info) {
-        output_info->size = param->jpeg_size;
+        output_info->size = *size;
         output_info->height = param->image_height;
     }
     return ORBIS_OK;
@@ -138,6 +138,9 @@ int PS4_SYSV_ABI sceKernelOpen(const char* raw_path, int flags, u16 mode) {
             h->DeleteHandle(handle);
             return ErrnoToSceKernelError(e);
         }
+        if (create) {
+            mnt->InvalidateHostPath(file->m_host_name);
+        }
     }
     file->is_opened = true;
     return handle;
@@ -232,6 +235,7 @@ int PS4_SYSV_ABI sceKernelUnlink(const char* path) {
     if (file != nullptr) {
         file->f.Unlink();
     }
+    mnt->InvalidateHostPath(host_path);
 
     LOG_INFO(Kernel_Fs, "Unlinked {}", path);
     return ORBIS_OK;
@@ -373,6 +377,7 @@ int PS4_SYSV_ABI sceKernelMkdir(const char* path, u16 mode) {
     if (dir_name.empty() || !std::filesystem::create_directory(dir_name, ec)) {
         return ORBIS_KERNEL_ERROR_EIO;
     }
+    mnt->InvalidateHostPath(dir_name);
 
     if (!std::filesystem::exists(dir_name)) {
         return ORBIS_KERNEL_ERROR_ENOENT;
@@ -422,6 +427,7 @@ int PS4_SYSV_ABI sceKernelRmdir(const char* path) {
 
     std::error_code ec;
     int result = std::filesystem::remove_all(dir_name, ec);
+    mnt->InvalidateHostPath(dir_name);
 
     if (!ec) {
         LOG_INFO(Kernel_Fs, "Removed directory: {}", fmt::UTF(dir_name.u8string()));
@@ -736,6 +742,7 @@ s32 PS4_SYSV_ABI sceKernelRename(const char* from, const char* to) {
         return ORBIS_KERNEL_ERROR_ENOTEMPTY;
     }
     std::filesystem::copy(src_path, dst_path, std::filesystem::copy_options::overwrite_existing);
+    mnt->InvalidateHostPath(dst_path);
     return ORBIS_OK;
 }
 
@@ -1,13 +1,22 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <cstring>
 #include <png.h>
+#include "common/arch.h"
 #include "common/assert.h"
+#include "common/config.h"
 #include "common/logging/log.h"
 #include "core/libraries/libpng/pngdec.h"
+#include "core/libraries/libpng/pngdec_cache.h"
 #include "core/libraries/libpng/pngdec_error.h"
 #include "core/libraries/libs.h"
 
+#ifdef ARCH_X86_64
+#include <emmintrin.h>
+#endif
+
 namespace Libraries::PngDec {
 
 struct PngHandler {
@@ -77,102 +86,195 @@ s32 PS4_SYSV_ABI scePngDecCreate(const OrbisPngDecCreateParam* param, void* memo
     return ORBIS_OK;
 }
 
-s32 PS4_SYSV_ABI scePngDecDecode(OrbisPngDecHandle handle, const OrbisPngDecDecodeParam* param,
-                                 OrbisPngDecImageInfo* imageInfo) {
-    if (handle == nullptr) {
-        LOG_ERROR(Lib_Png, "invalid handle!");
-        return ORBIS_PNG_DEC_ERROR_INVALID_HANDLE;
-    }
-    if (param == nullptr) {
-        LOG_ERROR(Lib_Png, "Invalid param!");
-        return ORBIS_PNG_DEC_ERROR_INVALID_PARAM;
+static DecodedImageCache& GetDecodeCache() {
+    static DecodedImageCache cache{u64(std::max(Config::getPngDecodeCacheSize(), 0)) * 1_MB};
+    return cache;
+}
+
+/// Decodes a PNG to tightly packed RGBA8, or returns nullptr if libpng reports an error.
+static std::shared_ptr<DecodedImage> DecodeImage(std::span<const u8> png) {
+    const auto start = std::chrono::steady_clock::now();
+    auto png_ptr =
+        png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, PngDecError, PngDecWarning);
+    if (png_ptr == nullptr) {
+        return nullptr;
     }
-    if (param->png_mem_addr == nullptr || param->image_mem_addr == nullptr) {
-        LOG_ERROR(Lib_Png, "invalid image address!");
-        return ORBIS_PNG_DEC_ERROR_INVALID_ADDR;
+    auto info_ptr = png_create_info_struct(png_ptr);
+    if (info_ptr == nullptr) {
+        png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+        return nullptr;
     }
-    LOG_TRACE(Lib_Png,
-              "pngMemSize = {} , imageMemSize = {} , pixelFormat = {} , alphaValue = {} , "
-              "imagePitch = {}",
-              param->png_mem_size, param->image_mem_size, int(param->pixel_format),
-              param->alpha_value, param->image_pitch);
 
-    auto pngh = (PngHandler*)handle;
+    auto image = std::make_shared<DecodedImage>();
+    std::vector<png_bytep> rows;
+    if (setjmp(png_jmpbuf(png_ptr))) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+        return nullptr;
+    }
 
-    const auto pngdata = PngStruct{
-        .data = param->png_mem_addr,
-        .size = param->png_mem_size,
+    auto pngdata = PngStruct{
+        .data = png.data(),
+        .size = png.size(),
         .offset = 0,
     };
-    png_set_read_fn(pngh->png_ptr, (void*)&pngdata,
-                    [](png_structp ps, png_bytep data, png_size_t len) {
-                        if (len == 0)
-                            return;
-                        auto pngdata = (PngStruct*)png_get_io_ptr(ps);
-                        ::memcpy(data, pngdata->data + pngdata->offset, len);
-                        pngdata->offset += len;
-                    });
-
-    png_read_info(pngh->png_ptr, pngh->info_ptr);
-    const u32 width = png_get_image_width(pngh->png_ptr, pngh->info_ptr);
-    const u32 height = png_get_image_height(pngh->png_ptr, pngh->info_ptr);
-    const auto color_type = MapPngColor(png_get_color_type(pngh->png_ptr, pngh->info_ptr));
-    const auto bit_depth = png_get_bit_depth(pngh->png_ptr, pngh->info_ptr);
-
-    if (imageInfo != nullptr) {
-        imageInfo->bit_depth = bit_depth;
-        imageInfo->image_width = width;
-        imageInfo->image_height = height;
-        imageInfo->color_space = color_type;
-        imageInfo->image_flag = OrbisPngDecImageFlag::None;
-        if (png_get_interlace_type(pngh->png_ptr, pngh->info_ptr) == 1) {
-            imageInfo->image_flag |= OrbisPngDecImageFlag::Adam7Interlace;
-        }
-        if (png_get_valid(pngh->png_ptr, pngh->info_ptr, PNG_INFO_tRNS)) {
-            imageInfo->image_flag |= OrbisPngDecImageFlag::TrnsChunkExist;
+    png_set_read_fn(png_ptr, (void*)&pngdata, [](png_structp ps, png_bytep data, png_size_t len) {
+        if (len == 0)
+            return;
+        auto pngdata = (PngStruct*)png_get_io_ptr(ps);
+        if (pngdata->offset + len > pngdata->size) {
+            png_error(ps, "read past end of png data");
         }
+        ::memcpy(data, pngdata->data + pngdata->offset, len);
+        pngdata->offset += len;
+    });
+
+    png_read_info(png_ptr, info_ptr);
+    const u32 width = png_get_image_width(png_ptr, info_ptr);
+    const u32 height = png_get_image_height(png_ptr, info_ptr);
+    const auto color_type = MapPngColor(png_get_color_type(png_ptr, info_ptr));
+    const auto bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+    const bool has_trns = png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS);
+
+    image->info = {
+        .image_width = width,
+        .image_height = height,
+        .color_space = color_type,
+        .bit_depth = bit_depth,
+        .image_flag = OrbisPngDecImageFlag::None,
+    };
+    if (png_get_interlace_type(png_ptr, info_ptr) == 1) {
+        image->info.image_flag |= OrbisPngDecImageFlag::Adam7Interlace;
+    }
+    if (has_trns) {
+        image->info.image_flag |= OrbisPngDecImageFlag::TrnsChunkExist;
     }
+    image->has_alpha = has_trns || color_type == OrbisPngDecColorSpace::Rgba ||
+                       color_type == OrbisPngDecColorSpace::GrayscaleAlpha;
 
+    // Everything is expanded to RGBA8, the output format is applied when writing to the guest.
     if (bit_depth == 16) {
-        png_set_strip_16(pngh->png_ptr);
+        png_set_strip_16(png_ptr);
     }
     if (color_type == OrbisPngDecColorSpace::Clut) {
-        png_set_palette_to_rgb(pngh->png_ptr);
+        png_set_palette_to_rgb(png_ptr);
     }
     if (color_type == OrbisPngDecColorSpace::Grayscale && bit_depth < 8) {
-        png_set_expand_gray_1_2_4_to_8(pngh->png_ptr);
+        png_set_expand_gray_1_2_4_to_8(png_ptr);
     }
-    if (png_get_valid(pngh->png_ptr, pngh->info_ptr, PNG_INFO_tRNS)) {
-        png_set_tRNS_to_alpha(pngh->png_ptr);
+    if (has_trns) {
+        png_set_tRNS_to_alpha(png_ptr);
     }
     if (color_type == OrbisPngDecColorSpace::Grayscale ||
         color_type == OrbisPngDecColorSpace::GrayscaleAlpha) {
-        png_set_gray_to_rgb(pngh->png_ptr);
+        png_set_gray_to_rgb(png_ptr);
     }
-    if (param->pixel_format == OrbisPngDecPixelFormat::B8G8R8A8) {
-        png_set_bgr(pngh->png_ptr);
+    if (!image->has_alpha) {
+        png_set_add_alpha(png_ptr, 0xFF, PNG_FILLER_AFTER);
     }
-    if (color_type == OrbisPngDecColorSpace::Rgb ||
-        color_type == OrbisPngDecColorSpace::Grayscale ||
-        color_type == OrbisPngDecColorSpace::Clut) {
-        png_set_add_alpha(pngh->png_ptr, param->alpha_value, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png_ptr);
+    png_read_update_info(png_ptr, info_ptr);
+    ASSERT(png_get_channels(png_ptr, info_ptr) == 4);
+
+    const u64 row_bytes = u64(width) * 4;
+    image->pixels.resize(row_bytes * height);
+    rows.resize(height);
+    for (u32 y = 0; y < height; ++y) {
+        rows[y] = image->pixels.data() + y * row_bytes;
     }
+    png_read_image(png_ptr, rows.data());
+    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
 
-    const s32 pass = png_set_interlace_handling(pngh->png_ptr);
-    png_read_update_info(pngh->png_ptr, pngh->info_ptr);
+    image->decode_time = std::chrono::steady_clock::now() - start;
+    return image;
+}
 
-    const s32 num_channels = png_get_channels(pngh->png_ptr, pngh->info_ptr);
-    const s32 horizontal_bytes = num_channels * width;
-    const s32 stride = param->image_pitch > 0 ? param->image_pitch : horizontal_bytes;
+/// Copies one row of RGBA8 pixels, swizzling to BGRA and replacing alpha when requested.
+static void ConvertRow(const u8* src, u8* dst, u32 width, bool bgr, bool fill_alpha, u8 alpha) {
+    u32 x = 0;
+#ifdef ARCH_X86_64
+    const __m128i rb_mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i ga_mask = _mm_set1_epi32(static_cast<s32>(0xFF00FF00));
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i alpha_bits = _mm_set1_epi32(static_cast<s32>(u32(alpha) << 24));
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        if (bgr) {
+            const __m128i rb = _mm_and_si128(pixels, rb_mask);
+            const __m128i br = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+            pixels = _mm_or_si128(_mm_and_si128(pixels, ga_mask), br);
+        }
+        if (fill_alpha) {
+            pixels = _mm_or_si128(_mm_and_si128(pixels, rgb_mask), alpha_bits);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), pixels);
+    }
+#endif
+    for (; x < width; ++x) {
+        const u8* in = src + x * 4;
+        u8* out = dst + x * 4;
+        out[0] = in[bgr ? 2 : 0];
+        out[1] = in[1];
+        out[2] = in[bgr ? 0 : 2];
+        out[3] = fill_alpha ? alpha : in[3];
+    }
+}
 
-    for (int j = 0; j < pass; j++) {
-        auto ptr = reinterpret_cast<png_bytep>(param->image_mem_addr);
-        for (int y = 0; y < height; y++) {
-            png_read_row(pngh->png_ptr, ptr, nullptr);
-            ptr += stride;
+static void WriteImage(const DecodedImage& image, const OrbisPngDecDecodeParam& param) {
+    const u32 width = image.info.image_width;
+    const u32 height = image.info.image_height;
+    const u32 stride = param.image_pitch > 0 ? param.image_pitch : width * 4;
+    const bool bgr = param.pixel_format == OrbisPngDecPixelFormat::B8G8R8A8;
+    const bool fill_alpha = !image.has_alpha && static_cast<u8>(param.alpha_value) != 0xFF;
+    if (!bgr && !fill_alpha && stride == width * 4) {
+        std::memcpy(param.image_mem_addr, image.pixels.data(), image.pixels.size());
+        return;
+    }
+    for (u32 y = 0; y < height; ++y) {
+        ConvertRow(image.pixels.data() + u64(y) * width * 4, param.image_mem_addr + u64(y) * stride,
+                   width, bgr, fill_alpha, static_cast<u8>(param.alpha_value));
+    }
+}
+
+s32 PS4_SYSV_ABI scePngDecDecode(OrbisPngDecHandle handle, const OrbisPngDecDecodeParam* param,
+                                 OrbisPngDecImageInfo* imageInfo) {
+    if (handle == nullptr) {
+        LOG_ERROR(Lib_Png, "invalid handle!");
+        return ORBIS_PNG_DEC_ERROR_INVALID_HANDLE;
+    }
+    if (param == nullptr) {
+        LOG_ERROR(Lib_Png, "Invalid param!");
+        return ORBIS_PNG_DEC_ERROR_INVALID_PARAM;
+    }
+    if (param->png_mem_addr == nullptr || param->image_mem_addr == nullptr) {
+        LOG_ERROR(Lib_Png, "invalid image address!");
+        return ORBIS_PNG_DEC_ERROR_INVALID_ADDR;
+    }
+    LOG_TRACE(Lib_Png,
+              "pngMemSize = {} , imageMemSize = {} , pixelFormat = {} , alphaValue = {} , "
+              "imagePitch = {}",
+              param->png_mem_size, param->image_mem_size, int(param->pixel_format),
+              param->alpha_value, param->image_pitch);
+
+    // Decoded images are cached by content, UI heavy titles decode the same icons repeatedly.
+    const std::span<const u8> png{param->png_mem_addr, param->png_mem_size};
+    auto& cache = GetDecodeCache();
+    std::shared_ptr<const DecodedImage> image = cache.Find(png);
+    if (!image) {
+        auto decoded = DecodeImage(png);
+        if (!decoded) {
+            return ORBIS_PNG_DEC_ERROR_FATAL;
         }
+        image = decoded;
+        cache.Insert(png, std::move(decoded));
+    }
+
+    if (imageInfo != nullptr) {
+        *imageInfo = image->info;
     }
+    WriteImage(*image, *param);
 
+    const u32 width = image->info.image_width;
+    const u32 height = image->info.image_height;
     return (width > 32767 || height > 32767) ? 0 : (width << 16) | height;
 }
 
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <xxhash.h>
+
+#include "common/logging/log.h"
+#include "core/libraries/libpng/pngdec_cache.h"
+
+namespace Libraries::PngDec {
+
+DecodedImageCache::DecodedImageCache(u64 budget) : budget{budget} {}
+
+std::shared_ptr<const DecodedImage> DecodedImageCache::Find(std::span<const u8> png) {
+    if (!Enabled()) {
+        return nullptr;
+    }
+    const u64 hash = XXH3_64bits(png.data(), png.size());
+    std::scoped_lock lock{mutex};
+    const auto it = entries.find(hash);
+    if (it == entries.end() || it->second->png_size != png.size()) {
+        ++misses;
+        ReportStats();
+        return nullptr;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    const auto& image = it->second->image;
+    ++hits;
+    saved_time += image->decode_time;
+    ReportStats();
+    return image;
+}
+
+void DecodedImageCache::Insert(std::span<const u8> png, std::shared_ptr<const DecodedImage> image) {
+    const u64 size = image->pixels.size();
+    if (!Enabled() || size > budget) {
+        return;
+    }
+    const u64 hash = XXH3_64bits(png.data(), png.size());
+    std::scoped_lock lock{mutex};
+    if (const auto it = entries.find(hash); it != entries.end()) {
+        used -= it->second->image->pixels.size();
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+    while (used + size > budget) {
+        const Entry& victim = lru.back();
+        used -= victim.image->pixels.size();
+        entries.erase(victim.hash);
+        lru.pop_back();
+    }
+    lru.push_front({hash, png.size(), std::move(image)});
+    entries.emplace(hash, lru.begin());
+    used += size;
+}
+
+void DecodedImageCache::ReportStats() {
+    const u64 lookups = hits + misses;
+    if (lookups % 256 != 0) {
+        return;
+    }
+    using namespace std::chrono;
+    LOG_DEBUG(Lib_Png, "Decode cache: {} lookups, {}% hits, {} images ({} KiB), {} ms saved",
+              lookups, hits * 100 / lookups, entries.size(), used / 1024,
+              duration_cast<milliseconds>(saved_time).count());
+}
+
+} // namespace Libraries::PngDec
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "core/libraries/libpng/pngdec.h"
+
+namespace Libraries::PngDec {
+
+/// A PNG decoded to tightly packed RGBA8. Images without an alpha channel store 0xFF alpha, the
+/// guest alpha value is applied when the image is written out.
+struct DecodedImage {
+    OrbisPngDecImageInfo info;
+    bool has_alpha;
+    std::vector<u8> pixels;
+    std::chrono::nanoseconds decode_time;
+};
+
+/// Content addressed cache of decoded images, bounded by a memory budget with LRU eviction.
+class DecodedImageCache {
+public:
+    explicit DecodedImageCache(u64 budget);
+
+    [[nodiscard]] bool Enabled() const {
+        return budget > 0;
+    }
+
+    std::shared_ptr<const DecodedImage> Find(std::span<const u8> png);
+    void Insert(std::span<const u8> png, std::shared_ptr<const DecodedImage> image);
+
+private:
+    struct Entry {
+        u64 hash;
+        u64 png_size;
+        std::shared_ptr<const DecodedImage> image;
+    };
+
+    void ReportStats();
+
+    std::mutex mutex;
+    u64 budget;
+    u64 used{};
+    std::list<Entry> lru; ///< Most recently used first.
+    std::unordered_map<u64, std::list<Entry>::iterator> entries;
+
+    u64 hits{};
+    u64 misses{};
+    std::chrono::nanoseconds saved_time{};
+};
+
+} // namespace Libraries::PngDec
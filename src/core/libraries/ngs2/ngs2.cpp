@@ -10,6 +10,67 @@
 
 namespace Libraries::Ngs2 {
 
+namespace {
+
+/// Nominal context buffer sizes. Engine state lives on the host heap, so these only need to
+/// satisfy the guest's own bookkeeping.
+constexpr size_t SystemBufferSize = 16_KB;
+constexpr size_t RackBaseBufferSize = 4_KB;
+constexpr size_t VoiceBufferSize = 1_KB;
+
+size_t RackBufferSize(const OrbisNgs2RackOption* option) {
+    const u32 max_voices = option ? option->maxVoices : 1;
+    return RackBaseBufferSize + max_voices * VoiceBufferSize;
+}
+
+s32 CreateSystem(const OrbisNgs2SystemOption* option,
+                 const OrbisNgs2ContextBufferInfo& buffer_info,
+                 const OrbisNgs2BufferAllocator* allocator, OrbisNgs2Handle* out_handle) {
+    if (const s32 result = Ngs2System::ValidateOption(option); result != ORBIS_OK) {
+        return result;
+    }
+    if (out_handle == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    auto* system = new Ngs2System(option, buffer_info);
+    if (allocator) {
+        system->allocator = *allocator;
+    }
+    LOG_INFO(Lib_Ngs2, "Created system: sample rate = {}, grain samples = {}/{}",
+             system->sample_rate, system->num_grain_samples, system->max_grain_samples);
+    *out_handle = system->Handle();
+    return ORBIS_OK;
+}
+
+s32 CreateRack(OrbisNgs2Handle system_handle, u32 rack_id, const OrbisNgs2RackOption* option,
+               const OrbisNgs2ContextBufferInfo& buffer_info,
+               const OrbisNgs2BufferAllocator* allocator, OrbisNgs2Handle* out_handle) {
+    auto* system = Ngs2Object::FromHandle<Ngs2System>(system_handle);
+    if (system == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_SYSTEM_HANDLE;
+    }
+    const auto id = static_cast<OrbisNgs2RackId>(rack_id);
+    if (Ngs2Rack::GetStage(id) == Ngs2Rack::Stage::Count) {
+        return ORBIS_NGS2_ERROR_INVALID_RACK_ID;
+    }
+    if (option && (option->maxVoices == 0 || option->maxVoices > 1024)) {
+        return ORBIS_NGS2_ERROR_INVALID_MAX_VOICES;
+    }
+    if (out_handle == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    std::scoped_lock lock{system->mutex};
+    auto* rack =
+        system->AddRack(std::make_unique<Ngs2Rack>(*system, id, option, buffer_info));
+    if (allocator) {
+        rack->allocator = *allocator;
+    }
+    *out_handle = rack->Handle();
+    return ORBIS_OK;
+}
+
+} // Anonymous namespace
+
 int PS4_SYSV_ABI sceNgs2CalcWaveformBlock() {
     LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
     return ORBIS_OK;
@@ -105,18 +166,53 @@ int PS4_SYSV_ABI sceNgs2ParseWaveformUser() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2RackCreate() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
-    return ORBIS_OK;
-}
-
-int PS4_SYSV_ABI sceNgs2RackCreateWithAllocator() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
-    return ORBIS_OK;
-}
-
-int PS4_SYSV_ABI sceNgs2RackDestroy() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2RackCreate(OrbisNgs2Handle systemHandle, u32 rackId,
+                                  const OrbisNgs2RackOption* option,
+                                  const OrbisNgs2ContextBufferInfo* bufferInfo,
+                                  OrbisNgs2Handle* outHandle) {
+    LOG_INFO(Lib_Ngs2, "rackId = {:#x}", rackId);
+    if (bufferInfo == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_BUFFER_INFO;
+    }
+    return CreateRack(systemHandle, rackId, option, *bufferInfo, nullptr, outHandle);
+}
+
+s32 PS4_SYSV_ABI sceNgs2RackCreateWithAllocator(OrbisNgs2Handle systemHandle, u32 rackId,
+                                               const OrbisNgs2RackOption* option,
+                                               const OrbisNgs2BufferAllocator* allocator,
+                                               OrbisNgs2Handle* outHandle) {
+    LOG_INFO(Lib_Ngs2, "rackId = {:#x}", rackId);
+    if (allocator == nullptr || allocator->allocHandler == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_BUFFER_ALLOCATOR;
+    }
+    OrbisNgs2ContextBufferInfo buffer_info{};
+    buffer_info.hostBufferSize = RackBufferSize(option);
+    buffer_info.userData = allocator->userData;
+    if (const s32 result = allocator->allocHandler(&buffer_info); result < 0) {
+        return result;
+    }
+    return CreateRack(systemHandle, rackId, option, buffer_info, allocator, outHandle);
+}
+
+s32 PS4_SYSV_ABI sceNgs2RackDestroy(OrbisNgs2Handle rackHandle,
+                                   OrbisNgs2ContextBufferInfo* outBufferInfo) {
+    auto* rack = Ngs2Object::FromHandle<Ngs2Rack>(rackHandle);
+    if (rack == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_RACK_HANDLE;
+    }
+    auto buffer_info = rack->buffer_info;
+    const auto allocator = rack->allocator;
+    {
+        auto& system = rack->system;
+        std::scoped_lock lock{system.mutex};
+        system.DestroyRack(rack);
+    }
+    if (outBufferInfo) {
+        *outBufferInfo = buffer_info;
+    }
+    if (allocator.freeHandler) {
+        allocator.freeHandler(&buffer_info);
+    }
     return ORBIS_OK;
 }
 
@@ -130,8 +226,19 @@ int PS4_SYSV_ABI sceNgs2RackGetUserData() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2RackGetVoiceHandle() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2RackGetVoiceHandle(OrbisNgs2Handle rackHandle, u32 voiceIndex,
+                                          OrbisNgs2Handle* outHandle) {
+    auto* rack = Ngs2Object::FromHandle<Ngs2Rack>(rackHandle);
+    if (rack == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_RACK_HANDLE;
+    }
+    if (voiceIndex >= rack->voices.size()) {
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_INDEX;
+    }
+    if (outHandle == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    *outHandle = rack->voices[voiceIndex]->Handle();
     return ORBIS_OK;
 }
 
@@ -140,8 +247,15 @@ int PS4_SYSV_ABI sceNgs2RackLock() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2RackQueryBufferSize() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2RackQueryBufferSize(u32 rackId, const OrbisNgs2RackOption* option,
+                                           OrbisNgs2ContextBufferInfo* outBufferInfo) {
+    if (Ngs2Rack::GetStage(static_cast<OrbisNgs2RackId>(rackId)) == Ngs2Rack::Stage::Count) {
+        return ORBIS_NGS2_ERROR_INVALID_RACK_ID;
+    }
+    if (outBufferInfo == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    outBufferInfo->hostBufferSize = RackBufferSize(option);
     return ORBIS_OK;
 }
 
@@ -175,18 +289,48 @@ int PS4_SYSV_ABI sceNgs2ReportUnregisterHandler() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2SystemCreate() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
-    return ORBIS_OK;
-}
-
-int PS4_SYSV_ABI sceNgs2SystemCreateWithAllocator() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
-    return ORBIS_OK;
-}
-
-int PS4_SYSV_ABI sceNgs2SystemDestroy() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2SystemCreate(const OrbisNgs2SystemOption* option,
+                                    const OrbisNgs2ContextBufferInfo* bufferInfo,
+                                    OrbisNgs2Handle* outHandle) {
+    if (bufferInfo == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_BUFFER_INFO;
+    }
+    return CreateSystem(option, *bufferInfo, nullptr, outHandle);
+}
+
+s32 PS4_SYSV_ABI sceNgs2SystemCreateWithAllocator(const OrbisNgs2SystemOption* option,
+                                                 const OrbisNgs2BufferAllocator* allocator,
+                                                 OrbisNgs2Handle* outHandle) {
+    if (allocator == nullptr || allocator->allocHandler == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_BUFFER_ALLOCATOR;
+    }
+    if (const s32 result = Ngs2System::ValidateOption(option); result != ORBIS_OK) {
+        return result;
+    }
+    OrbisNgs2ContextBufferInfo buffer_info{};
+    buffer_info.hostBufferSize = SystemBufferSize;
+    buffer_info.userData = allocator->userData;
+    if (const s32 result = allocator->allocHandler(&buffer_info); result < 0) {
+        return result;
+    }
+    return CreateSystem(option, buffer_info, allocator, outHandle);
+}
+
+s32 PS4_SYSV_ABI sceNgs2SystemDestroy(OrbisNgs2Handle systemHandle,
+                                     OrbisNgs2ContextBufferInfo* outBufferInfo) {
+    auto* system = Ngs2Object::FromHandle<Ngs2System>(systemHandle);
+    if (system == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_SYSTEM_HANDLE;
+    }
+    auto buffer_info = system->buffer_info;
+    const auto allocator = system->allocator;
+    delete system;
+    if (outBufferInfo) {
+        *outBufferInfo = buffer_info;
+    }
+    if (allocator.freeHandler) {
+        allocator.freeHandler(&buffer_info);
+    }
     return ORBIS_OK;
 }
 
@@ -215,8 +359,15 @@ int PS4_SYSV_ABI sceNgs2SystemLock() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2SystemQueryBufferSize() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2SystemQueryBufferSize(const OrbisNgs2SystemOption* option,
+                                             OrbisNgs2ContextBufferInfo* outBufferInfo) {
+    if (const s32 result = Ngs2System::ValidateOption(option); result != ORBIS_OK) {
+        return result;
+    }
+    if (outBufferInfo == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    outBufferInfo->hostBufferSize = SystemBufferSize;
     return ORBIS_OK;
 }
 
@@ -225,9 +376,17 @@ int PS4_SYSV_ABI sceNgs2SystemQueryInfo() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2SystemRender() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
-    return ORBIS_OK;
+s32 PS4_SYSV_ABI sceNgs2SystemRender(OrbisNgs2Handle systemHandle,
+                                    const OrbisNgs2RenderBufferInfo* aBufferInfo,
+                                    u32 numBufferInfo) {
+    auto* system = Ngs2Object::FromHandle<Ngs2System>(systemHandle);
+    if (system == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_SYSTEM_HANDLE;
+    }
+    if (numBufferInfo != 0 && aBufferInfo == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_BUFFER_INFO;
+    }
+    return system->Render({aBufferInfo, numBufferInfo});
 }
 
 int PS4_SYSV_ABI sceNgs2SystemResetOption() {
@@ -240,8 +399,17 @@ int PS4_SYSV_ABI sceNgs2SystemRunCommands() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2SystemSetGrainSamples() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2SystemSetGrainSamples(OrbisNgs2Handle systemHandle, u32 numSamples) {
+    auto* system = Ngs2Object::FromHandle<Ngs2System>(systemHandle);
+    if (system == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_SYSTEM_HANDLE;
+    }
+    std::scoped_lock lock{system->mutex};
+    if (numSamples < 64 || numSamples > system->max_grain_samples || (numSamples & 0x3F) != 0) {
+        LOG_ERROR(Lib_Ngs2, "Invalid grain samples {}", numSamples);
+        return ORBIS_NGS2_ERROR_INVALID_NUM_GRAIN_SAMPLES;
+    }
+    system->num_grain_samples = numSamples;
     return ORBIS_OK;
 }
 
@@ -250,8 +418,20 @@ int PS4_SYSV_ABI sceNgs2SystemSetLoudThreshold() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2SystemSetSampleRate() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2SystemSetSampleRate(OrbisNgs2Handle systemHandle, u32 sampleRate) {
+    auto* system = Ngs2Object::FromHandle<Ngs2System>(systemHandle);
+    if (system == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_SYSTEM_HANDLE;
+    }
+    OrbisNgs2SystemOption option{};
+    option.maxGrainSamples = system->max_grain_samples;
+    option.numGrainSamples = system->num_grain_samples;
+    option.sampleRate = sampleRate;
+    if (const s32 result = Ngs2System::ValidateOption(&option); result != ORBIS_OK) {
+        return result;
+    }
+    std::scoped_lock lock{system->mutex};
+    system->sample_rate = sampleRate;
     return ORBIS_OK;
 }
 
@@ -300,9 +480,17 @@ int PS4_SYSV_ABI sceNgs2StreamRunCommands() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2VoiceControl() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
-    return ORBIS_OK;
+s32 PS4_SYSV_ABI sceNgs2VoiceControl(OrbisNgs2Handle voiceHandle,
+                                    const OrbisNgs2VoiceParamHead* paramList) {
+    auto* voice = Ngs2Object::FromHandle<Ngs2Voice>(voiceHandle);
+    if (voice == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_HANDLE;
+    }
+    if (paramList == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_CONTROL_ADDRESS;
+    }
+    std::scoped_lock lock{voice->rack.system.mutex};
+    return voice->Control(paramList);
 }
 
 int PS4_SYSV_ABI sceNgs2VoiceGetMatrixInfo() {
@@ -320,13 +508,30 @@ int PS4_SYSV_ABI sceNgs2VoiceGetPortInfo() {
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2VoiceGetState() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2VoiceGetState(OrbisNgs2Handle voiceHandle, OrbisNgs2VoiceState* outState,
+                                     size_t stateSize) {
+    auto* voice = Ngs2Object::FromHandle<Ngs2Voice>(voiceHandle);
+    if (voice == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_HANDLE;
+    }
+    if (outState == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    std::scoped_lock lock{voice->rack.system.mutex};
+    voice->GetState(outState, stateSize);
     return ORBIS_OK;
 }
 
-int PS4_SYSV_ABI sceNgs2VoiceGetStateFlags() {
-    LOG_ERROR(Lib_Ngs2, "(STUBBED) called");
+s32 PS4_SYSV_ABI sceNgs2VoiceGetStateFlags(OrbisNgs2Handle voiceHandle, u32* outFlags) {
+    auto* voice = Ngs2Object::FromHandle<Ngs2Voice>(voiceHandle);
+    if (voice == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_HANDLE;
+    }
+    if (outFlags == nullptr) {
+        return ORBIS_NGS2_ERROR_INVALID_OUT_ADDRESS;
+    }
+    std::scoped_lock lock{voice->rack.system.mutex};
+    *outFlags = voice->GetStateFlags();
     return ORBIS_OK;
 }
 
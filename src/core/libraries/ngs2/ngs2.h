@@ -68,6 +68,233 @@ struct StackBuffer {
     char padding[7];
 };
 
+using OrbisNgs2Handle = void*;
+
+enum class OrbisNgs2RackId : u32 {
+    Sampler = 0x1000,
+    Submixer = 0x2000,
+    Reverb = 0x2001,
+    Equalizer = 0x2002,
+    Mastering = 0x3000,
+    CustomSampler = 0x4001,
+    CustomSubmixer = 0x4002,
+    CustomMastering = 0x4003,
+};
+
+enum class OrbisNgs2WaveformType : u32 {
+    PcmI16Little = 0x12,
+    PcmI16Big = 0x13,
+    PcmF32Little = 0x18,
+    PcmF32Big = 0x19,
+    Vag = 0x1C,
+    Atrac9 = 0x40,
+};
+
+enum OrbisNgs2VoiceParamId : u32 {
+    ORBIS_NGS2_VOICE_PARAM_MATRIX_LEVELS = 1,
+    ORBIS_NGS2_VOICE_PARAM_PORT_MATRIX = 2,
+    ORBIS_NGS2_VOICE_PARAM_PORT_VOLUME = 3,
+    ORBIS_NGS2_VOICE_PARAM_PORT_DELAY = 4,
+    ORBIS_NGS2_VOICE_PARAM_PATCH = 5,
+    ORBIS_NGS2_VOICE_PARAM_EVENT = 6,
+    ORBIS_NGS2_VOICE_PARAM_CALLBACK = 7,
+
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SETUP = 0x10000000,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_ADD_WAVEFORM_BLOCKS = 0x10000001,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_REPLACE_WAVEFORM_ADDRESS = 0x10000002,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_WAVEFORM_FRAME_OFFSET = 0x10000003,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_EXIT_LOOP = 0x10000004,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_PITCH = 0x10000005,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_ENVELOPE = 0x10000006,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_DISTORTION = 0x10000007,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_USER_FX = 0x10000008,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_PEAKMETER = 0x10000009,
+    ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_FILTER = 0x1000000A,
+};
+
+enum class OrbisNgs2VoiceEvent : u32 {
+    Play = 0,
+    Stop = 1,
+    StopImm = 2,
+    Kill = 3,
+    Pause = 4,
+    Resume = 5,
+};
+
+enum OrbisNgs2VoiceStateFlags : u32 {
+    ORBIS_NGS2_VOICE_STATE_FLAG_INUSE = 1 << 0,
+    ORBIS_NGS2_VOICE_STATE_FLAG_PLAYING = 1 << 1,
+    ORBIS_NGS2_VOICE_STATE_FLAG_PAUSED = 1 << 2,
+    ORBIS_NGS2_VOICE_STATE_FLAG_STOPPED = 1 << 3,
+    ORBIS_NGS2_VOICE_STATE_FLAG_ERROR = 1 << 4,
+    ORBIS_NGS2_VOICE_STATE_FLAG_EMPTY = 1 << 5,
+};
+
+struct OrbisNgs2ContextBufferInfo {
+    void* hostBuffer;
+    size_t hostBufferSize;
+    uintptr_t reserved[5];
+    uintptr_t userData;
+};
+
+struct OrbisNgs2BufferAllocator {
+    s32 PS4_SYSV_ABI (*allocHandler)(OrbisNgs2ContextBufferInfo* bufferInfo);
+    s32 PS4_SYSV_ABI (*freeHandler)(OrbisNgs2ContextBufferInfo* bufferInfo);
+    uintptr_t userData;
+};
+
+struct OrbisNgs2SystemOption {
+    size_t size;
+    char name[16];
+    u32 flags;
+    u32 maxGrainSamples;
+    u32 numGrainSamples;
+    u32 sampleRate;
+    u32 reserved[6];
+};
+
+struct OrbisNgs2RackOption {
+    size_t size;
+    char name[16];
+    u32 flags;
+    u32 maxGrainSamples;
+    u32 maxVoices;
+    u32 maxInputDelayBlocks;
+    u32 maxMatrices;
+    u32 maxPorts;
+    u32 reserved[20];
+};
+
+struct OrbisNgs2RenderBufferInfo {
+    void* buffer;
+    size_t bufferSize;
+    OrbisNgs2WaveformType waveformType;
+    u32 numChannels;
+};
+
+struct OrbisNgs2VoiceParamHead {
+    u16 size;
+    s16 next; ///< Byte offset to the next parameter, 0 terminates the list.
+    u32 id;
+};
+
+struct OrbisNgs2VoiceMatrixLevelsParam {
+    OrbisNgs2VoiceParamHead header;
+    u32 matrixId;
+    u32 numLevels;
+    const float* aLevel;
+};
+
+struct OrbisNgs2VoicePortMatrixParam {
+    OrbisNgs2VoiceParamHead header;
+    u32 port;
+    s32 matrixId;
+};
+
+struct OrbisNgs2VoicePortVolumeParam {
+    OrbisNgs2VoiceParamHead header;
+    u32 port;
+    float level;
+};
+
+struct OrbisNgs2VoicePatchParam {
+    OrbisNgs2VoiceParamHead header;
+    u32 port;
+    u32 destInputId;
+    OrbisNgs2Handle destHandle;
+};
+
+struct OrbisNgs2VoiceEventParam {
+    OrbisNgs2VoiceParamHead header;
+    OrbisNgs2VoiceEvent eventId;
+};
+
+struct OrbisNgs2WaveformFormat {
+    OrbisNgs2WaveformType waveformType;
+    u32 numChannels;
+    u32 sampleRate;
+    u32 configData;
+    u32 frameOffset;
+    u32 frameMargin;
+};
+
+struct OrbisNgs2WaveformBlock {
+    u32 dataOffset;
+    u32 dataSize;
+    u32 numRepeats;
+    u32 numSkipSamples;
+    u32 numSamples;
+    u32 reserved;
+    uintptr_t userData;
+};
+
+struct OrbisNgs2SamplerVoiceSetupParam {
+    OrbisNgs2VoiceParamHead header;
+    OrbisNgs2WaveformFormat format;
+    u32 flags;
+    u32 reserved;
+};
+
+struct OrbisNgs2SamplerVoiceWaveformBlocksParam {
+    OrbisNgs2VoiceParamHead header;
+    const void* data;
+    u32 flags;
+    u32 numBlocks;
+    const OrbisNgs2WaveformBlock* aBlock;
+};
+
+struct OrbisNgs2SamplerVoiceWaveformAddressParam {
+    OrbisNgs2VoiceParamHead header;
+    const void* from;
+    const void* to;
+};
+
+struct OrbisNgs2SamplerVoicePitchParam {
+    OrbisNgs2VoiceParamHead header;
+    float ratio;
+    u32 reserved;
+};
+
+struct OrbisNgs2EnvelopePoint {
+    u32 curve;
+    u32 duration;
+    float height;
+};
+
+struct OrbisNgs2SamplerVoiceEnvelopeParam {
+    OrbisNgs2VoiceParamHead header;
+    u32 numForwardPoints;
+    u32 numReleasePoints;
+    const OrbisNgs2EnvelopePoint* aPoint;
+};
+
+struct OrbisNgs2SamplerVoiceFilterParam {
+    OrbisNgs2VoiceParamHead header;
+    u32 index;
+    u32 location;
+    u32 type;
+    u32 channelMask;
+    float fc;
+    float q;
+    float level;
+    u32 reserved[3];
+};
+
+struct OrbisNgs2VoiceState {
+    u32 stateFlags;
+};
+
+struct OrbisNgs2SamplerVoiceState {
+    OrbisNgs2VoiceState voiceState;
+    float envelopeHeight;
+    float peakHeight;
+    u32 reserved;
+    u64 numDecodedSamples;
+    u64 decodedDataSize;
+    uintptr_t userData;
+    const void* waveformData;
+};
+
 void RegisterlibSceNgs2(Core::Loader::SymbolsResolver* sym);
 
 } // namespace Libraries::Ngs2
@@ -0,0 +1,244 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "common/arch.h"
+#include "core/libraries/ngs2/ngs2_dsp.h"
+
+#ifdef ARCH_X86_64
+#include <immintrin.h>
+#include <xbyak/xbyak_util.h>
+#endif
+
+#if defined(ARCH_X86_64) && !defined(_MSC_VER)
+#define NGS2_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define NGS2_TARGET_AVX2
+#endif
+
+namespace Libraries::Ngs2::Dsp {
+
+namespace {
+
+void MixAddScalar(float* dst, const float* src, float gain, u32 count) {
+    for (u32 i = 0; i < count; ++i) {
+        dst[i] += src[i] * gain;
+    }
+}
+
+void MultiplyScalar(float* dst, const float* gain, u32 count) {
+    for (u32 i = 0; i < count; ++i) {
+        dst[i] *= gain[i];
+    }
+}
+
+#ifdef ARCH_X86_64
+NGS2_TARGET_AVX2 void MixAddAvx2(float* dst, const float* src, float gain, u32 count) {
+    const __m256 vgain = _mm256_set1_ps(gain);
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 acc = _mm256_loadu_ps(dst + i);
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(_mm256_loadu_ps(src + i), vgain, acc));
+    }
+    MixAddScalar(dst + i, src + i, gain, count - i);
+}
+
+NGS2_TARGET_AVX2 void MultiplyAvx2(float* dst, const float* gain, u32 count) {
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(dst + i,
+                         _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(gain + i)));
+    }
+    MultiplyScalar(dst + i, gain + i, count - i);
+}
+
+bool HasAvx2() {
+    static const bool has_avx2 = [] {
+        const Xbyak::util::Cpu cpu;
+        return cpu.has(Xbyak::util::Cpu::tAVX2) && cpu.has(Xbyak::util::Cpu::tFMA);
+    }();
+    return has_avx2;
+}
+#endif
+
+} // Anonymous namespace
+
+void MixAdd(float* dst, const float* src, float gain, u32 count) {
+#ifdef ARCH_X86_64
+    if (HasAvx2()) {
+        MixAddAvx2(dst, src, gain, count);
+        return;
+    }
+#endif
+    MixAddScalar(dst, src, gain, count);
+}
+
+void Multiply(float* dst, const float* gain, u32 count) {
+#ifdef ARCH_X86_64
+    if (HasAvx2()) {
+        MultiplyAvx2(dst, gain, count);
+        return;
+    }
+#endif
+    MultiplyScalar(dst, gain, count);
+}
+
+Biquad::Coefficients Biquad::Design(Type type, float cutoff, float q, float sample_rate) {
+    // RBJ audio EQ cookbook designs.
+    cutoff = std::clamp(cutoff, 10.0f, sample_rate * 0.49f);
+    q = std::max(q, 0.01f);
+    const float w0 = 2.0f * std::numbers::pi_v<float> * cutoff / sample_rate;
+    const float cos_w0 = std::cos(w0);
+    const float alpha = std::sin(w0) / (2.0f * q);
+    float b0, b1, b2;
+    switch (type) {
+    case Type::LowPass:
+        b0 = (1.0f - cos_w0) / 2.0f;
+        b1 = 1.0f - cos_w0;
+        b2 = b0;
+        break;
+    case Type::HighPass:
+        b0 = (1.0f + cos_w0) / 2.0f;
+        b1 = -(1.0f + cos_w0);
+        b2 = b0;
+        break;
+    case Type::BandPass:
+        b0 = alpha;
+        b1 = 0.0f;
+        b2 = -alpha;
+        break;
+    case Type::Notch:
+    default:
+        b0 = 1.0f;
+        b1 = -2.0f * cos_w0;
+        b2 = 1.0f;
+        break;
+    }
+    const float a0 = 1.0f + alpha;
+    return {
+        .b0 = b0 / a0,
+        .b1 = b1 / a0,
+        .b2 = b2 / a0,
+        .a1 = -2.0f * cos_w0 / a0,
+        .a2 = (1.0f - alpha) / a0,
+    };
+}
+
+void Biquad::Process(float* samples, u32 count) {
+    auto [x1, x2, y1, y2] = history;
+    for (u32 i = 0; i < count; ++i) {
+        const float x0 = samples[i];
+        const float y0 = c.b0 * x0 + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        samples[i] = y0;
+    }
+    history = {x1, x2, y1, y2};
+}
+
+void Envelope::Setup(std::span<const Point> forward, std::span<const Point> release) {
+    points.assign(forward.begin(), forward.end());
+    points.insert(points.end(), release.begin(), release.end());
+    num_forward = static_cast<u32>(forward.size());
+    index = 0;
+    position = 0;
+    start_height = 0.0f;
+    height = points.empty() ? 1.0f : 0.0f;
+    released = false;
+}
+
+bool Envelope::Release() {
+    if (num_forward == points.size()) {
+        return false;
+    }
+    released = true;
+    index = num_forward;
+    position = 0;
+    start_height = height;
+    return true;
+}
+
+bool Envelope::Generate(float* gain, u32 count) {
+    if (points.empty()) {
+        std::fill_n(gain, count, 1.0f);
+        return true;
+    }
+    const u32 end = released ? static_cast<u32>(points.size()) : num_forward;
+    for (u32 i = 0; i < count; ++i) {
+        // Advance over finished segments; the last forward point is held as sustain level.
+        while (index < end && position >= points[index].duration) {
+            start_height = points[index].height;
+            height = start_height;
+            position = 0;
+            ++index;
+        }
+        if (index < end) {
+            const auto& point = points[index];
+            const float t = static_cast<float>(position) / point.duration;
+            height = start_height + (point.height - start_height) * t;
+            ++position;
+        } else if (released) {
+            std::fill_n(gain + i, count - i, height);
+            return false;
+        }
+        gain[i] = height;
+    }
+    return true;
+}
+
+Reverb::Reverb(float sample_rate) {
+    // Classic Freeverb tunings at 44.1kHz, with a stereo spread for the right channel.
+    static constexpr std::array<u32, 4> CombTunings = {1116, 1188, 1277, 1356};
+    static constexpr std::array<u32, 2> AllpassTunings = {556, 441};
+    static constexpr u32 StereoSpread = 23;
+    const float scale = sample_rate / 44100.0f;
+    for (u32 ch = 0; ch < 2; ++ch) {
+        for (u32 i = 0; i < CombTunings.size(); ++i) {
+            const u32 size = static_cast<u32>((CombTunings[i] + ch * StereoSpread) * scale);
+            combs[ch][i].buffer.resize(std::max(size, 1U));
+        }
+        for (u32 i = 0; i < AllpassTunings.size(); ++i) {
+            const u32 size = static_cast<u32>((AllpassTunings[i] + ch * StereoSpread) * scale);
+            allpasses[ch][i].buffer.resize(std::max(size, 1U));
+        }
+    }
+}
+
+float Reverb::ProcessComb(Line& line, float input) {
+    const float output = line.buffer[line.pos];
+    line.filter_state = output * (1.0f - damping) + line.filter_state * damping;
+    line.buffer[line.pos] = input + line.filter_state * feedback;
+    line.pos = (line.pos + 1) % line.buffer.size();
+    return output;
+}
+
+float Reverb::ProcessAllpass(Line& line, float input) {
+    const float buffered = line.buffer[line.pos];
+    line.buffer[line.pos] = input + buffered * 0.5f;
+    line.pos = (line.pos + 1) % line.buffer.size();
+    return buffered - input;
+}
+
+void Reverb::Process(float* left, float* right, u32 count) {
+    for (u32 i = 0; i < count; ++i) {
+        const float input = (left[i] + right[i]) * 0.015f;
+        std::array<float*, 2> channels = {left, right};
+        for (u32 ch = 0; ch < 2; ++ch) {
+            float out = 0.0f;
+            for (auto& comb : combs[ch]) {
+                out += ProcessComb(comb, input);
+            }
+            for (auto& allpass : allpasses[ch]) {
+                out = ProcessAllpass(allpass, out);
+            }
+            channels[ch][i] += out * wet;
+        }
+    }
+}
+
+} // namespace Libraries::Ngs2::Dsp
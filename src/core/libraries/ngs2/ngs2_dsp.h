@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "common/types.h"
+
+namespace Libraries::Ngs2::Dsp {
+
+/// dst[i] += src[i] * gain
+void MixAdd(float* dst, const float* src, float gain, u32 count);
+
+/// dst[i] *= gain[i]
+void Multiply(float* dst, const float* gain, u32 count);
+
+/// Direct form 1 biquad filter with per-channel history.
+class Biquad {
+public:
+    struct Coefficients {
+        float b0{1.0f};
+        float b1{};
+        float b2{};
+        float a1{};
+        float a2{};
+    };
+
+    enum class Type : u32 {
+        LowPass,
+        HighPass,
+        BandPass,
+        Notch,
+    };
+
+    static Coefficients Design(Type type, float cutoff, float q, float sample_rate);
+
+    void SetCoefficients(const Coefficients& coeffs) {
+        c = coeffs;
+    }
+
+    void Reset() {
+        history = {};
+    }
+
+    void Process(float* samples, u32 count);
+
+private:
+    Coefficients c{};
+    std::array<float, 4> history{}; // x1, x2, y1, y2
+};
+
+/// Piecewise linear volume envelope with separate attack/sustain and release segments.
+class Envelope {
+public:
+    struct Point {
+        u32 duration; ///< Segment length in samples.
+        float height;
+    };
+
+    void Setup(std::span<const Point> forward, std::span<const Point> release);
+
+    /// Enters the release segment, returns false if the envelope has none.
+    bool Release();
+
+    /// Writes count gain values, returns false once the release segment has finished.
+    bool Generate(float* gain, u32 count);
+
+    [[nodiscard]] bool IsActive() const {
+        return !points.empty();
+    }
+
+    [[nodiscard]] float Height() const {
+        return height;
+    }
+
+private:
+    std::vector<Point> points;
+    u32 num_forward{};
+    u32 index{};
+    u32 position{};
+    float start_height{};
+    float height{1.0f};
+    bool released{};
+};
+
+/// Small Schroeder style stereo reverb.
+class Reverb {
+public:
+    explicit Reverb(float sample_rate);
+
+    /// Processes planar left/right channels in place.
+    void Process(float* left, float* right, u32 count);
+
+    void SetWetLevel(float level) {
+        wet = level;
+    }
+
+private:
+    struct Line {
+        std::vector<float> buffer;
+        u32 pos{};
+        float filter_state{};
+    };
+
+    float ProcessComb(Line& line, float input);
+    float ProcessAllpass(Line& line, float input);
+
+    std::array<std::array<Line, 4>, 2> combs;
+    std::array<std::array<Line, 2>, 2> allpasses;
+    float wet{0.3f};
+    float feedback{0.84f};
+    float damping{0.2f};
+};
+
+} // namespace Libraries::Ngs2::Dsp
@@ -1,10 +1,16 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <tsl/robin_set.h>
+
 #include "ngs2_error.h"
 #include "ngs2_impl.h"
 
 #include "common/logging/log.h"
+#include "common/thread.h"
 #include "core/libraries/error_codes.h"
 #include "core/libraries/kernel/kernel.h"
 
@@ -161,4 +167,870 @@ s32 Ngs2::SystemSetupCore(StackBuffer* buf, SystemOptions* options, Ngs2Handle**
     return result; // Success
 }
 
+namespace {
+
+std::mutex object_mutex;
+tsl::robin_set<const Ngs2Object*> live_objects;
+
+constexpr u32 ChFL = 0, ChFR = 1, ChFC = 2, ChLFE = 3, ChBL = 4, ChBR = 5, ChSL = 6, ChSR = 7;
+
+/// Upper bound on parameters in one control list, protects against lists that loop.
+constexpr u32 MaxControlParams = 1024;
+
+/// Voices handed to a render worker at a time.
+constexpr u32 VoicesPerRenderJob = 8;
+
+u32 BytesPerSample(OrbisNgs2WaveformType type) {
+    switch (type) {
+    case OrbisNgs2WaveformType::PcmI16Little:
+    case OrbisNgs2WaveformType::PcmI16Big:
+        return sizeof(s16);
+    case OrbisNgs2WaveformType::PcmF32Little:
+    case OrbisNgs2WaveformType::PcmF32Big:
+        return sizeof(float);
+    default:
+        return 0;
+    }
+}
+
+bool IsValidSampleRate(u32 sample_rate) {
+    switch (sample_rate) {
+    case 11025:
+    case 12000:
+    case 22050:
+    case 24000:
+    case 44100:
+    case 48000:
+    case 88200:
+    case 96000:
+        return true;
+    default:
+        return false;
+    }
+}
+
+u32 NumRenderThreads() {
+    return std::clamp(std::thread::hardware_concurrency() / 4, 1U, 3U);
+}
+
+/// Converts the planar 7.1 master bus into an interleaved guest buffer.
+void WriteRenderBuffer(const OrbisNgs2RenderBufferInfo& info, std::span<const float> master,
+                       u32 stride, u32 num_samples) {
+    const bool is_float = info.waveformType == OrbisNgs2WaveformType::PcmF32Little;
+    const u32 num_channels = info.numChannels;
+    const u32 frame_size = num_channels * BytesPerSample(info.waveformType);
+    const u32 num_frames =
+        static_cast<u32>(std::min<u64>(num_samples, info.bufferSize / frame_size));
+    const auto bus = [&](u32 channel, u32 frame) { return master[channel * stride + frame]; };
+
+    // ITU-R BS.775 downmix for stereo and mono outputs, LFE is dropped.
+    constexpr float Center = 0.7071f;
+    constexpr float Surround = 0.7071f;
+    std::array<float, BusChannels> out;
+    for (u32 i = 0; i < num_frames; ++i) {
+        switch (num_channels) {
+        case 1:
+        case 2: {
+            const float center = Center * bus(ChFC, i);
+            const float left = bus(ChFL, i) + center + Surround * (bus(ChBL, i) + bus(ChSL, i));
+            const float right = bus(ChFR, i) + center + Surround * (bus(ChBR, i) + bus(ChSR, i));
+            if (num_channels == 1) {
+                out[0] = (left + right) * 0.5f;
+            } else {
+                out[0] = left;
+                out[1] = right;
+            }
+            break;
+        }
+        case 6:
+            for (u32 ch = 0; ch < ChBL; ++ch) {
+                out[ch] = bus(ch, i);
+            }
+            out[4] = bus(ChBL, i) + bus(ChSL, i);
+            out[5] = bus(ChBR, i) + bus(ChSR, i);
+            break;
+        default:
+            for (u32 ch = 0; ch < BusChannels; ++ch) {
+                out[ch] = bus(ch, i);
+            }
+            break;
+        }
+        if (is_float) {
+            std::memcpy(static_cast<float*>(info.buffer) + i * num_channels, out.data(),
+                        num_channels * sizeof(float));
+            continue;
+        }
+        s16* dst = static_cast<s16*>(info.buffer) + i * num_channels;
+        for (u32 ch = 0; ch < num_channels; ++ch) {
+            dst[ch] = static_cast<s16>(std::clamp(out[ch], -1.0f, 1.0f) * 32767.0f);
+        }
+    }
+}
+
+} // Anonymous namespace
+
+Ngs2Object::Ngs2Object(Ngs2ObjectType type_) : type{type_} {
+    std::scoped_lock lock{object_mutex};
+    live_objects.insert(this);
+}
+
+Ngs2Object::~Ngs2Object() {
+    std::scoped_lock lock{object_mutex};
+    live_objects.erase(this);
+}
+
+Ngs2Object* Ngs2Object::Lookup(OrbisNgs2Handle handle) {
+    auto* object = static_cast<Ngs2Object*>(handle);
+    std::scoped_lock lock{object_mutex};
+    return live_objects.contains(object) ? object : nullptr;
+}
+
+RenderWorkers::RenderWorkers(u32 num_threads) {
+    for (u32 i = 0; i < num_threads; ++i) {
+        threads.emplace_back([this](std::stop_token stop) { WorkerThread(stop); });
+    }
+}
+
+RenderWorkers::~RenderWorkers() {
+    for (auto& thread : threads) {
+        thread.request_stop();
+    }
+    threads.clear();
+}
+
+void RenderWorkers::Run(u32 count, const std::function<void(u32)>& func) {
+    if (count <= 1 || threads.empty()) {
+        for (u32 i = 0; i < count; ++i) {
+            func(i);
+        }
+        return;
+    }
+    {
+        std::scoped_lock lock{mutex};
+        job = &func;
+        job_count = count;
+        next_index = 0;
+        ++generation;
+    }
+    work_cv.notify_all();
+
+    // The calling thread takes part in the work. Once it runs out of indices, every remaining
+    // one is being processed by an active worker.
+    Execute();
+    std::unique_lock lock{mutex};
+    done_cv.wait(lock, [this] { return active == 0; });
+    job = nullptr;
+}
+
+void RenderWorkers::Execute() {
+    for (u32 index = next_index++; index < job_count; index = next_index++) {
+        (*job)(index);
+    }
+}
+
+void RenderWorkers::WorkerThread(std::stop_token stop) {
+    Common::SetCurrentThreadName("shadPS4:Ngs2Render");
+    u64 seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock{mutex};
+            if (!work_cv.wait(lock, stop, [&] {
+                    return job != nullptr && generation != seen_generation;
+                })) {
+                return;
+            }
+            seen_generation = generation;
+            ++active;
+        }
+        Execute();
+        std::scoped_lock lock{mutex};
+        if (--active == 0) {
+            done_cv.notify_one();
+        }
+    }
+}
+
+Ngs2Voice::Ngs2Voice(Ngs2Rack& rack_, u32 index_)
+    : Ngs2Object{Type}, rack{rack_}, index{index_} {
+    const u32 stride = rack.system.max_grain_samples;
+    input.resize(BusChannels * stride);
+    output.resize(BusChannels * stride);
+    matrices.resize(rack.max_matrices);
+    if (rack.GetStage() == Ngs2Rack::Stage::Sampler) {
+        envelope_gain.resize(stride);
+        return;
+    }
+    // Bus voices have no setup of their own and pass their input through while in use.
+    state_flags = ORBIS_NGS2_VOICE_STATE_FLAG_INUSE | ORBIS_NGS2_VOICE_STATE_FLAG_PLAYING;
+    if (rack.id == OrbisNgs2RackId::Reverb) {
+        reverb = std::make_unique<Dsp::Reverb>(static_cast<float>(rack.system.sample_rate));
+    }
+}
+
+float* Ngs2Voice::Channel(std::vector<float>& buffer, u32 channel) {
+    return buffer.data() + channel * rack.system.max_grain_samples;
+}
+
+const float* Ngs2Voice::Channel(const std::vector<float>& buffer, u32 channel) const {
+    return buffer.data() + channel * rack.system.max_grain_samples;
+}
+
+bool Ngs2Voice::IsActive() const {
+    return (state_flags & ORBIS_NGS2_VOICE_STATE_FLAG_PLAYING) &&
+           !(state_flags & ORBIS_NGS2_VOICE_STATE_FLAG_PAUSED);
+}
+
+s32 Ngs2Voice::Control(const OrbisNgs2VoiceParamHead* param) {
+    for (u32 count = 0; param != nullptr; ++count) {
+        if (count == MaxControlParams) {
+            return ORBIS_NGS2_ERROR_DETECTED_CIRCULAR_VOICE_CONTROL;
+        }
+        if (const s32 result = ApplyParam(param); result != ORBIS_OK) {
+            return result;
+        }
+        if (param->next == 0) {
+            break;
+        }
+        param = reinterpret_cast<const OrbisNgs2VoiceParamHead*>(
+            reinterpret_cast<const u8*>(param) + param->next);
+    }
+    return ORBIS_OK;
+}
+
+s32 Ngs2Voice::ApplyParam(const OrbisNgs2VoiceParamHead* param) {
+    const bool is_sampler = rack.GetStage() == Ngs2Rack::Stage::Sampler;
+    if ((param->id & 0xF0000000) == ORBIS_NGS2_SAMPLER_VOICE_PARAM_SETUP && !is_sampler) {
+        LOG_ERROR(Lib_Ngs2, "Sampler parameter {:#x} sent to a non-sampler voice", param->id);
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_CONTROL_ID;
+    }
+
+    switch (param->id) {
+    case ORBIS_NGS2_VOICE_PARAM_MATRIX_LEVELS: {
+        const auto* p = reinterpret_cast<const OrbisNgs2VoiceMatrixLevelsParam*>(param);
+        if (p->matrixId >= matrices.size()) {
+            return ORBIS_NGS2_ERROR_INVALID_MAX_MATRICES;
+        }
+        if (p->numLevels == 0 || p->numLevels > BusChannels * BusChannels) {
+            return ORBIS_NGS2_ERROR_INVALID_NUM_MATRIX_LEVELS;
+        }
+        if (p->aLevel == nullptr) {
+            return ORBIS_NGS2_ERROR_INVALID_MATRIX_LEVEL_ADDRESS;
+        }
+        matrices[p->matrixId].assign(p->aLevel, p->aLevel + p->numLevels);
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_VOICE_PARAM_PORT_MATRIX: {
+        const auto* p = reinterpret_cast<const OrbisNgs2VoicePortMatrixParam*>(param);
+        if (p->port >= MaxVoicePorts) {
+            return ORBIS_NGS2_ERROR_INVALID_PORT_INDEX;
+        }
+        if (p->matrixId < -1 || p->matrixId >= static_cast<s32>(matrices.size())) {
+            return ORBIS_NGS2_ERROR_INVALID_MAX_MATRICES;
+        }
+        ports[p->port].matrix_id = p->matrixId;
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_VOICE_PARAM_PORT_VOLUME: {
+        const auto* p = reinterpret_cast<const OrbisNgs2VoicePortVolumeParam*>(param);
+        if (p->port >= MaxVoicePorts) {
+            return ORBIS_NGS2_ERROR_INVALID_PORT_INDEX;
+        }
+        ports[p->port].volume = p->level;
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_VOICE_PARAM_PATCH: {
+        const auto* p = reinterpret_cast<const OrbisNgs2VoicePatchParam*>(param);
+        if (p->port >= MaxVoicePorts) {
+            return ORBIS_NGS2_ERROR_INVALID_PORT_INDEX;
+        }
+        if (p->destHandle == nullptr) {
+            ports[p->port].dest = nullptr;
+            rack.system.InvalidateRenderOrder();
+            return ORBIS_OK;
+        }
+        auto* dest = FromHandle<Ngs2Voice>(p->destHandle);
+        if (dest == nullptr) {
+            return ORBIS_NGS2_ERROR_INVALID_VOICE_HANDLE;
+        }
+        // Samplers have no input, and a patch back into this voice would form a cycle.
+        if (&dest->rack.system != &rack.system ||
+            dest->rack.GetStage() == Ngs2Rack::Stage::Sampler || dest == this ||
+            dest->Feeds(this)) {
+            return ORBIS_NGS2_ERROR_INVALID_PATCH;
+        }
+        ports[p->port].dest = dest;
+        rack.system.InvalidateRenderOrder();
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_VOICE_PARAM_EVENT: {
+        const auto* p = reinterpret_cast<const OrbisNgs2VoiceEventParam*>(param);
+        if (p->eventId > OrbisNgs2VoiceEvent::Resume) {
+            return ORBIS_NGS2_ERROR_INVALID_EVENT_TYPE;
+        }
+        HandleEvent(p->eventId);
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_VOICE_PARAM_PORT_DELAY:
+    case ORBIS_NGS2_VOICE_PARAM_CALLBACK:
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_WAVEFORM_FRAME_OFFSET:
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_DISTORTION:
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_USER_FX:
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_PEAKMETER:
+        LOG_DEBUG(Lib_Ngs2, "Ignoring unimplemented voice parameter {:#x}", param->id);
+        return ORBIS_OK;
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SETUP: {
+        const auto& setup = reinterpret_cast<const OrbisNgs2SamplerVoiceSetupParam*>(param)->format;
+        switch (setup.waveformType) {
+        case OrbisNgs2WaveformType::PcmI16Little:
+        case OrbisNgs2WaveformType::PcmI16Big:
+        case OrbisNgs2WaveformType::PcmF32Little:
+        case OrbisNgs2WaveformType::PcmF32Big:
+        case OrbisNgs2WaveformType::Vag:
+        case OrbisNgs2WaveformType::Atrac9:
+            break;
+        default:
+            return ORBIS_NGS2_ERROR_UNKNOWN_WAVEFORM_FORMAT;
+        }
+        if (setup.numChannels == 0 || setup.numChannels > BusChannels) {
+            return ORBIS_NGS2_ERROR_INVALID_NUM_CHANNELS;
+        }
+        if (setup.sampleRate == 0) {
+            return ORBIS_NGS2_ERROR_INVALID_WAVEFORM_SAMPLE_RATE;
+        }
+        format = setup;
+        blocks.clear();
+        block_index = 0;
+        position = 0.0;
+        peak = 0.0f;
+        decoded_samples = 0;
+        stopping = false;
+        filter_mask = 0;
+        state_flags = ORBIS_NGS2_VOICE_STATE_FLAG_INUSE | ORBIS_NGS2_VOICE_STATE_FLAG_EMPTY;
+        if (BytesPerSample(format.waveformType) == 0) {
+            LOG_ERROR(Lib_Ngs2, "Unsupported waveform type {:#x}, voice will be silent",
+                      static_cast<u32>(format.waveformType));
+            state_flags |= ORBIS_NGS2_VOICE_STATE_FLAG_ERROR;
+        }
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_ADD_WAVEFORM_BLOCKS: {
+        const auto* p = reinterpret_cast<const OrbisNgs2SamplerVoiceWaveformBlocksParam*>(param);
+        if (p->data == nullptr) {
+            return ORBIS_NGS2_ERROR_INVALID_WAVEFORM_ADDRESS;
+        }
+        if (p->numBlocks != 0 && p->aBlock == nullptr) {
+            return ORBIS_NGS2_ERROR_INVALID_WAVEFORM_BLOCK_ADDRESS;
+        }
+        const auto* base = static_cast<const u8*>(p->data);
+        for (u32 i = 0; i < p->numBlocks; ++i) {
+            blocks.push_back({base, p->aBlock[i], p->aBlock[i].numRepeats});
+        }
+        if (!blocks.empty()) {
+            state_flags &= ~ORBIS_NGS2_VOICE_STATE_FLAG_EMPTY;
+        }
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_REPLACE_WAVEFORM_ADDRESS: {
+        const auto* p = reinterpret_cast<const OrbisNgs2SamplerVoiceWaveformAddressParam*>(param);
+        for (auto& block : blocks) {
+            if (block.base == p->from) {
+                block.base = static_cast<const u8*>(p->to);
+            }
+        }
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_EXIT_LOOP:
+        for (auto& block : blocks) {
+            block.repeats_left = 0;
+        }
+        return ORBIS_OK;
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_PITCH: {
+        const auto* p = reinterpret_cast<const OrbisNgs2SamplerVoicePitchParam*>(param);
+        pitch = std::clamp(p->ratio, 1.0f / 64.0f, 64.0f);
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_ENVELOPE: {
+        const auto* p = reinterpret_cast<const OrbisNgs2SamplerVoiceEnvelopeParam*>(param);
+        const u32 num_points = p->numForwardPoints + p->numReleasePoints;
+        if (num_points != 0 && p->aPoint == nullptr) {
+            return ORBIS_NGS2_ERROR_INVALID_ENVELOPE_POINT_ADDRESS;
+        }
+        envelope_points.clear();
+        for (u32 i = 0; i < num_points; ++i) {
+            envelope_points.push_back({p->aPoint[i].duration, p->aPoint[i].height});
+        }
+        num_forward_points = p->numForwardPoints;
+        const std::span points{envelope_points};
+        envelope.Setup(points.first(num_forward_points), points.subspan(num_forward_points));
+        return ORBIS_OK;
+    }
+    case ORBIS_NGS2_SAMPLER_VOICE_PARAM_SET_FILTER: {
+        const auto* p = reinterpret_cast<const OrbisNgs2SamplerVoiceFilterParam*>(param);
+        if (p->type > static_cast<u32>(Dsp::Biquad::Type::Notch)) {
+            LOG_WARNING(Lib_Ngs2, "Unsupported filter type {}, bypassing", p->type);
+            filter_mask = 0;
+            return ORBIS_OK;
+        }
+        const auto coeffs =
+            Dsp::Biquad::Design(static_cast<Dsp::Biquad::Type>(p->type), p->fc, p->q,
+                                static_cast<float>(rack.system.sample_rate));
+        for (u32 ch = 0; ch < BusChannels; ++ch) {
+            if (!(filter_mask & (1U << ch))) {
+                filters[ch].Reset();
+            }
+            filters[ch].SetCoefficients(coeffs);
+        }
+        filter_mask = p->channelMask;
+        return ORBIS_OK;
+    }
+    default:
+        LOG_ERROR(Lib_Ngs2, "Unknown voice parameter {:#x}", param->id);
+        return ORBIS_NGS2_ERROR_INVALID_VOICE_CONTROL_ID;
+    }
+}
+
+void Ngs2Voice::HandleEvent(OrbisNgs2VoiceEvent event) {
+    switch (event) {
+    case OrbisNgs2VoiceEvent::Play:
+        block_index = 0;
+        position = 0.0;
+        stopping = false;
+        for (auto& block : blocks) {
+            block.repeats_left = block.info.numRepeats;
+        }
+        if (!envelope_points.empty()) {
+            const std::span points{envelope_points};
+            envelope.Setup(points.first(num_forward_points), points.subspan(num_forward_points));
+        }
+        state_flags |= ORBIS_NGS2_VOICE_STATE_FLAG_INUSE | ORBIS_NGS2_VOICE_STATE_FLAG_PLAYING;
+        state_flags &= ~(ORBIS_NGS2_VOICE_STATE_FLAG_PAUSED | ORBIS_NGS2_VOICE_STATE_FLAG_STOPPED);
+        break;
+    case OrbisNgs2VoiceEvent::Stop:
+        // Let the release segment of the envelope play out before stopping.
+        if (IsActive() && envelope.Release()) {
+            stopping = true;
+        } else {
+            Stop();
+        }
+        break;
+    case OrbisNgs2VoiceEvent::StopImm:
+        Stop();
+        break;
+    case OrbisNgs2VoiceEvent::Kill:
+        Stop();
+        if (rack.GetStage() == Ngs2Rack::Stage::Sampler) {
+            blocks.clear();
+            state_flags &= ~ORBIS_NGS2_VOICE_STATE_FLAG_INUSE;
+        }
+        break;
+    case OrbisNgs2VoiceEvent::Pause:
+        if (state_flags & ORBIS_NGS2_VOICE_STATE_FLAG_PLAYING) {
+            state_flags |= ORBIS_NGS2_VOICE_STATE_FLAG_PAUSED;
+        }
+        break;
+    case OrbisNgs2VoiceEvent::Resume:
+        state_flags &= ~ORBIS_NGS2_VOICE_STATE_FLAG_PAUSED;
+        break;
+    }
+}
+
+void Ngs2Voice::Stop() {
+    state_flags &= ~(ORBIS_NGS2_VOICE_STATE_FLAG_PLAYING | ORBIS_NGS2_VOICE_STATE_FLAG_PAUSED);
+    state_flags |= ORBIS_NGS2_VOICE_STATE_FLAG_STOPPED;
+    stopping = false;
+}
+
+void Ngs2Voice::GetState(void* out_state, size_t state_size) const {
+    if (rack.GetStage() == Ngs2Rack::Stage::Sampler &&
+        state_size >= sizeof(OrbisNgs2SamplerVoiceState)) {
+        const Block* block = block_index < blocks.size() ? &blocks[block_index] : nullptr;
+        const OrbisNgs2SamplerVoiceState state = {
+            .voiceState = {.stateFlags = state_flags},
+            .envelopeHeight = envelope.Height(),
+            .peakHeight = peak,
+            .reserved = 0,
+            .numDecodedSamples = decoded_samples,
+            .decodedDataSize =
+                decoded_samples * format.numChannels * BytesPerSample(format.waveformType),
+            .userData = block ? block->info.userData : 0,
+            .waveformData = block ? block->base : nullptr,
+        };
+        std::memcpy(out_state, &state, sizeof(state));
+        return;
+    }
+    const OrbisNgs2VoiceState state = {.stateFlags = state_flags};
+    std::memcpy(out_state, &state, std::min(state_size, sizeof(state)));
+}
+
+float Ngs2Voice::ReadSample(const Block& block, u32 frame, u32 channel) const {
+    const u32 sample_size = BytesPerSample(format.waveformType);
+    const u64 offset =
+        (static_cast<u64>(block.info.numSkipSamples) + frame) * format.numChannels * sample_size +
+        channel * sample_size;
+    if (offset + sample_size > block.info.dataSize) {
+        return 0.0f;
+    }
+    const u8* src = block.base + block.info.dataOffset + offset;
+    switch (format.waveformType) {
+    case OrbisNgs2WaveformType::PcmI16Little: {
+        s16 value;
+        std::memcpy(&value, src, sizeof(value));
+        return value / 32768.0f;
+    }
+    case OrbisNgs2WaveformType::PcmI16Big: {
+        u16 value;
+        std::memcpy(&value, src, sizeof(value));
+        return static_cast<s16>(std::byteswap(value)) / 32768.0f;
+    }
+    case OrbisNgs2WaveformType::PcmF32Little: {
+        float value;
+        std::memcpy(&value, src, sizeof(value));
+        return value;
+    }
+    case OrbisNgs2WaveformType::PcmF32Big: {
+        u32 value;
+        std::memcpy(&value, src, sizeof(value));
+        return std::bit_cast<float>(std::byteswap(value));
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+void Ngs2Voice::Render(u32 num_samples) {
+    num_output_channels = 0;
+    if (rack.GetStage() == Ngs2Rack::Stage::Sampler) {
+        if (IsActive()) {
+            RenderSampler(num_samples);
+        }
+        return;
+    }
+    // Bus voices pass through what earlier stages accumulated into their input.
+    std::swap(input, output);
+    std::ranges::fill(input, 0.0f);
+    if (!IsActive()) {
+        return;
+    }
+    num_output_channels = BusChannels;
+    if (reverb) {
+        reverb->Process(Channel(output, ChFL), Channel(output, ChFR), num_samples);
+    }
+}
+
+void Ngs2Voice::RenderSampler(u32 num_samples) {
+    if (BytesPerSample(format.waveformType) == 0) {
+        Stop();
+        return;
+    }
+    const u32 num_channels = format.numChannels;
+    for (u32 ch = 0; ch < num_channels; ++ch) {
+        std::fill_n(Channel(output, ch), num_samples, 0.0f);
+    }
+    num_output_channels = num_channels;
+
+    // Resample with linear interpolation, which also applies the pitch ratio.
+    const double step = static_cast<double>(pitch) * format.sampleRate /
+                        static_cast<double>(rack.system.sample_rate);
+    u32 i = 0;
+    while (i < num_samples && block_index < blocks.size()) {
+        Block& block = blocks[block_index];
+        const u32 num_frames = block.info.numSamples;
+        if (num_frames == 0) {
+            ++block_index;
+            continue;
+        }
+        if (position >= num_frames) {
+            position -= num_frames;
+            if (block.repeats_left > 0) {
+                --block.repeats_left;
+            } else {
+                ++block_index;
+            }
+            continue;
+        }
+        const u32 frame = static_cast<u32>(position);
+        const float frac = static_cast<float>(position - frame);
+        const bool has_next = frame + 1 < num_frames;
+        for (u32 ch = 0; ch < num_channels; ++ch) {
+            const float s0 = ReadSample(block, frame, ch);
+            const float s1 = has_next ? ReadSample(block, frame + 1, ch) : s0;
+            Channel(output, ch)[i] = s0 + (s1 - s0) * frac;
+        }
+        position += step;
+        ++i;
+    }
+    decoded_samples += i;
+
+    if (envelope.IsActive()) {
+        const bool running = envelope.Generate(envelope_gain.data(), num_samples);
+        for (u32 ch = 0; ch < num_channels; ++ch) {
+            Dsp::Multiply(Channel(output, ch), envelope_gain.data(), num_samples);
+        }
+        if (!running && stopping) {
+            Stop();
+        }
+    }
+    for (u32 ch = 0; ch < num_channels; ++ch) {
+        if (filter_mask & (1U << ch)) {
+            filters[ch].Process(Channel(output, ch), num_samples);
+        }
+    }
+
+    peak = 0.0f;
+    for (u32 ch = 0; ch < num_channels; ++ch) {
+        const float* samples = Channel(output, ch);
+        for (u32 s = 0; s < num_samples; ++s) {
+            peak = std::max(peak, std::abs(samples[s]));
+        }
+    }
+
+    if (block_index >= blocks.size()) {
+        Stop();
+        state_flags |= ORBIS_NGS2_VOICE_STATE_FLAG_EMPTY;
+    }
+}
+
+void Ngs2Voice::MixInto(std::span<float> dest, u32 dest_stride, const Port& port,
+                        u32 num_samples) const {
+    const auto dest_channel = [&](u32 ch) { return dest.data() + ch * dest_stride; };
+    if (port.matrix_id >= 0 && !matrices[port.matrix_id].empty()) {
+        // Levels are stored per destination channel, one entry per source channel.
+        const auto& levels = matrices[port.matrix_id];
+        const u32 num_in = num_output_channels;
+        const u32 num_out = std::min(static_cast<u32>(levels.size()) / num_in, BusChannels);
+        for (u32 out = 0; out < num_out; ++out) {
+            for (u32 in = 0; in < num_in; ++in) {
+                const float level = levels[out * num_in + in] * port.volume;
+                if (level != 0.0f) {
+                    Dsp::MixAdd(dest_channel(out), Channel(output, in), level, num_samples);
+                }
+            }
+        }
+        return;
+    }
+    if (num_output_channels == 1) {
+        Dsp::MixAdd(dest_channel(ChFL), Channel(output, 0), port.volume, num_samples);
+        Dsp::MixAdd(dest_channel(ChFR), Channel(output, 0), port.volume, num_samples);
+        return;
+    }
+    for (u32 ch = 0; ch < num_output_channels; ++ch) {
+        Dsp::MixAdd(dest_channel(ch), Channel(output, ch), port.volume, num_samples);
+    }
+}
+
+void Ngs2Voice::Route(u32 num_samples, std::span<float> master) {
+    if (num_output_channels == 0) {
+        return;
+    }
+    const u32 stride = rack.system.max_grain_samples;
+    if (rack.GetStage() == Ngs2Rack::Stage::Mastering) {
+        MixInto(master, stride, ports[0], num_samples);
+        return;
+    }
+    for (const auto& port : ports) {
+        if (port.dest != nullptr) {
+            MixInto(port.dest->input, stride, port, num_samples);
+        }
+    }
+}
+
+void Ngs2Voice::Unpatch(const Ngs2Rack& dest_rack) {
+    for (auto& port : ports) {
+        if (port.dest != nullptr && &port.dest->rack == &dest_rack) {
+            port.dest = nullptr;
+        }
+    }
+}
+
+bool Ngs2Voice::Feeds(const Ngs2Voice* voice) const {
+    if (rack.GetStage() == Ngs2Rack::Stage::Mastering) {
+        return false;
+    }
+    return std::ranges::any_of(ports, [voice](const Port& port) {
+        return port.dest != nullptr && (port.dest == voice || port.dest->Feeds(voice));
+    });
+}
+
+bool Ngs2Voice::PropagateLevel() {
+    if (rack.GetStage() == Ngs2Rack::Stage::Mastering) {
+        return false;
+    }
+    bool changed = false;
+    for (const auto& port : ports) {
+        if (port.dest != nullptr && port.dest->level <= level) {
+            port.dest->level = level + 1;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+Ngs2Rack::Ngs2Rack(Ngs2System& system_, OrbisNgs2RackId id_, const OrbisNgs2RackOption* option,
+                   const OrbisNgs2ContextBufferInfo& buffer_info_)
+    : Ngs2Object{Type}, system{system_}, id{id_},
+      max_matrices{option ? std::max(option->maxMatrices, 1U) : 1U}, buffer_info{buffer_info_} {
+    const u32 max_voices = option ? option->maxVoices : 1;
+    voices.reserve(max_voices);
+    for (u32 i = 0; i < max_voices; ++i) {
+        voices.push_back(std::make_unique<Ngs2Voice>(*this, i));
+    }
+}
+
+Ngs2Rack::Stage Ngs2Rack::GetStage(OrbisNgs2RackId id) {
+    switch (id) {
+    case OrbisNgs2RackId::Sampler:
+    case OrbisNgs2RackId::CustomSampler:
+        return Stage::Sampler;
+    case OrbisNgs2RackId::Submixer:
+    case OrbisNgs2RackId::CustomSubmixer:
+    case OrbisNgs2RackId::Equalizer:
+        return Stage::Submixer;
+    case OrbisNgs2RackId::Reverb:
+        return Stage::Effect;
+    case OrbisNgs2RackId::Mastering:
+    case OrbisNgs2RackId::CustomMastering:
+        return Stage::Mastering;
+    default:
+        return Stage::Count;
+    }
+}
+
+Ngs2System::Ngs2System(const OrbisNgs2SystemOption* option,
+                       const OrbisNgs2ContextBufferInfo& buffer_info_)
+    : Ngs2Object{Type}, buffer_info{buffer_info_}, workers{NumRenderThreads()} {
+    if (option) {
+        max_grain_samples = option->maxGrainSamples;
+        num_grain_samples = option->numGrainSamples;
+        sample_rate = option->sampleRate;
+    }
+    master.resize(BusChannels * max_grain_samples);
+}
+
+Ngs2System::~Ngs2System() {
+    if (num_voices_rendered != 0) {
+        const auto ms = std::chrono::duration<double, std::milli>(render_time).count();
+        LOG_INFO(Lib_Ngs2, "Rendered {} voice grains in {:.1f} ms ({:.0f} voices/ms)",
+                 num_voices_rendered, ms, num_voices_rendered / std::max(ms, 0.001));
+    }
+}
+
+s32 Ngs2System::ValidateOption(const OrbisNgs2SystemOption* option) {
+    if (option == nullptr) {
+        return ORBIS_OK;
+    }
+    const u32 max_grain = option->maxGrainSamples;
+    if (max_grain < 64 || max_grain > 1024 || (max_grain & 0x3F) != 0) {
+        LOG_ERROR(Lib_Ngs2, "Invalid system option (maxGrainSamples={},x64)", max_grain);
+        return ORBIS_NGS2_ERROR_INVALID_MAX_GRAIN_SAMPLES;
+    }
+    const u32 num_grain = option->numGrainSamples;
+    if (num_grain < 64 || num_grain > max_grain || (num_grain & 0x3F) != 0) {
+        LOG_ERROR(Lib_Ngs2, "Invalid system option (numGrainSamples={},x64)", num_grain);
+        return ORBIS_NGS2_ERROR_INVALID_NUM_GRAIN_SAMPLES;
+    }
+    if (!IsValidSampleRate(option->sampleRate)) {
+        LOG_ERROR(Lib_Ngs2, "Invalid system option(sampleRate={}:44.1/48kHz series)",
+                  option->sampleRate);
+        return ORBIS_NGS2_ERROR_INVALID_SAMPLE_RATE;
+    }
+    return ORBIS_OK;
+}
+
+Ngs2Rack* Ngs2System::AddRack(std::unique_ptr<Ngs2Rack> rack) {
+    InvalidateRenderOrder();
+    return racks.emplace_back(std::move(rack)).get();
+}
+
+void Ngs2System::DestroyRack(Ngs2Rack* rack) {
+    for (const auto& other : racks) {
+        for (const auto& voice : other->voices) {
+            voice->Unpatch(*rack);
+        }
+    }
+    std::erase_if(racks, [rack](const auto& entry) { return entry.get() == rack; });
+    InvalidateRenderOrder();
+}
+
+void Ngs2System::UpdateRenderOrder() {
+    render_order.clear();
+    for (const auto& rack : racks) {
+        for (const auto& voice : rack->voices) {
+            voice->level = 0;
+            render_order.push_back(voice.get());
+        }
+    }
+    // The patch graph is acyclic, so raising levels along patches settles after at most one
+    // pass per level.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto* voice : render_order) {
+            changed |= voice->PropagateLevel();
+        }
+    }
+    std::ranges::stable_sort(render_order, {}, &Ngs2Voice::level);
+    level_ends.clear();
+    for (u32 i = 0; i < render_order.size(); ++i) {
+        if (i + 1 == render_order.size() || render_order[i]->level != render_order[i + 1]->level) {
+            level_ends.push_back(i + 1);
+        }
+    }
+    is_order_dirty = false;
+}
+
+s32 Ngs2System::Render(std::span<const OrbisNgs2RenderBufferInfo> buffers) {
+    for (const auto& info : buffers) {
+        if (info.buffer == nullptr) {
+            return ORBIS_NGS2_ERROR_INVALID_BUFFER_ADDRESS;
+        }
+        if (info.waveformType != OrbisNgs2WaveformType::PcmI16Little &&
+            info.waveformType != OrbisNgs2WaveformType::PcmF32Little) {
+            return ORBIS_NGS2_ERROR_INVALID_WAVEFORM_TYPE;
+        }
+        if (info.numChannels != 1 && info.numChannels != 2 && info.numChannels != 6 &&
+            info.numChannels != 8) {
+            return ORBIS_NGS2_ERROR_INVALID_NUM_CHANNELS;
+        }
+    }
+
+    std::scoped_lock lock{mutex};
+    const auto start = std::chrono::steady_clock::now();
+    const u32 num_samples = num_grain_samples;
+    std::ranges::fill(master, 0.0f);
+
+    if (is_order_dirty) {
+        UpdateRenderOrder();
+    }
+
+    // Voices within a level are independent and rendered in parallel, routing into later levels
+    // is done serially afterwards so that no two threads accumulate into the same bus.
+    std::span<Ngs2Voice* const> level_voices;
+    const auto render_job = [&](u32 job) {
+        const u32 first = job * VoicesPerRenderJob;
+        const u32 last =
+            std::min(first + VoicesPerRenderJob, static_cast<u32>(level_voices.size()));
+        for (u32 i = first; i < last; ++i) {
+            level_voices[i]->Render(num_samples);
+        }
+    };
+    u32 level_begin = 0;
+    for (const u32 level_end : level_ends) {
+        level_voices = std::span{render_order}.subspan(level_begin, level_end - level_begin);
+        level_begin = level_end;
+        const u32 num_jobs =
+            (static_cast<u32>(level_voices.size()) + VoicesPerRenderJob - 1) / VoicesPerRenderJob;
+        workers.Run(num_jobs, render_job);
+        for (auto* voice : level_voices) {
+            num_voices_rendered += voice->IsActive();
+            voice->Route(num_samples, master);
+        }
+    }
+
+    for (const auto& info : buffers) {
+        WriteRenderBuffer(info, master, max_grain_samples, num_samples);
+    }
+    render_time += std::chrono::steady_clock::now() - start;
+    return ORBIS_OK;
+}
+
 } // namespace Libraries::Ngs2
@@ -3,6 +3,17 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "core/libraries/ngs2/ngs2_dsp.h"
 #include "ngs2.h"
 
 namespace Libraries::Ngs2 {
@@ -22,4 +33,229 @@ public:
 private:
 };
 
+class Ngs2System;
+class Ngs2Rack;
+
+/// Voices are mixed on planar buses with a fixed 7.1 layout: FL, FR, FC, LFE, BL, BR, SL, SR.
+constexpr u32 BusChannels = 8;
+constexpr u32 MaxVoicePorts = 4;
+
+/// Object types, the values match the handle types reported by Ngs2::ReportInvalid.
+enum class Ngs2ObjectType : u32 {
+    System = 1,
+    Rack = 2,
+    Voice = 4,
+};
+
+class Ngs2Object {
+public:
+    explicit Ngs2Object(Ngs2ObjectType type);
+    virtual ~Ngs2Object();
+
+    Ngs2Object(const Ngs2Object&) = delete;
+    Ngs2Object& operator=(const Ngs2Object&) = delete;
+
+    [[nodiscard]] OrbisNgs2Handle Handle() {
+        return static_cast<OrbisNgs2Handle>(this);
+    }
+
+    /// Returns the object behind a guest handle, or nullptr if it is not a live object of T.
+    template <typename T>
+    static T* FromHandle(OrbisNgs2Handle handle) {
+        auto* object = Lookup(handle);
+        if (object == nullptr || object->type != T::Type) {
+            return nullptr;
+        }
+        return static_cast<T*>(object);
+    }
+
+private:
+    static Ngs2Object* Lookup(OrbisNgs2Handle handle);
+
+    Ngs2ObjectType type;
+};
+
+/// Runs independent racks of a render stage in parallel.
+class RenderWorkers {
+public:
+    explicit RenderWorkers(u32 num_threads);
+    ~RenderWorkers();
+
+    /// Calls func for every index in [0, count) and waits for completion.
+    void Run(u32 count, const std::function<void(u32)>& func);
+
+private:
+    void WorkerThread(std::stop_token stop);
+    void Execute();
+
+    std::mutex mutex;
+    std::condition_variable_any work_cv;
+    std::condition_variable done_cv;
+    const std::function<void(u32)>* job{};
+    u32 job_count{};
+    std::atomic<u32> next_index{};
+    u32 active{};
+    u64 generation{};
+    std::vector<std::jthread> threads;
+};
+
+class Ngs2Voice final : public Ngs2Object {
+public:
+    static constexpr auto Type = Ngs2ObjectType::Voice;
+
+    Ngs2Voice(Ngs2Rack& rack, u32 index);
+
+    /// Applies a linked list of voice parameters. Caller must hold the system lock.
+    s32 Control(const OrbisNgs2VoiceParamHead* param_list);
+
+    [[nodiscard]] u32 GetStateFlags() const {
+        return state_flags;
+    }
+    void GetState(void* out_state, size_t state_size) const;
+
+    /// Renders one grain into the voice output, consuming the accumulated input.
+    void Render(u32 num_samples);
+
+    /// Mixes the rendered output into patched voices, or into master for mastering voices.
+    void Route(u32 num_samples, std::span<float> master);
+
+    /// Drops patches that point into the given rack.
+    void Unpatch(const Ngs2Rack& dest_rack);
+
+    /// Returns true if the output of this voice reaches the given voice through patches.
+    [[nodiscard]] bool Feeds(const Ngs2Voice* voice) const;
+
+    /// Raises the render level of patched voices above this one, returns true if any changed.
+    bool PropagateLevel();
+
+    [[nodiscard]] bool IsActive() const;
+
+    Ngs2Rack& rack;
+    u32 level{}; ///< Render level, voices are rendered after every voice that feeds them.
+
+private:
+    struct Port {
+        Ngs2Voice* dest{};
+        float volume{1.0f};
+        s32 matrix_id{-1};
+    };
+
+    struct Block {
+        const u8* base;
+        OrbisNgs2WaveformBlock info;
+        u32 repeats_left;
+    };
+
+    s32 ApplyParam(const OrbisNgs2VoiceParamHead* param);
+    void HandleEvent(OrbisNgs2VoiceEvent event);
+    void Stop();
+    void RenderSampler(u32 num_samples);
+    float ReadSample(const Block& block, u32 frame, u32 channel) const;
+    void MixInto(std::span<float> dest, u32 dest_stride, const Port& port, u32 num_samples) const;
+
+    float* Channel(std::vector<float>& buffer, u32 channel);
+    const float* Channel(const std::vector<float>& buffer, u32 channel) const;
+
+    u32 index;
+    u32 state_flags{};
+    std::array<Port, MaxVoicePorts> ports{};
+    std::vector<std::vector<float>> matrices;
+
+    std::vector<float> input;
+    std::vector<float> output;
+    u32 num_output_channels{};
+
+    // Sampler state
+    OrbisNgs2WaveformFormat format{};
+    std::vector<Block> blocks;
+    u32 block_index{};
+    double position{};
+    float pitch{1.0f};
+    float peak{};
+    u64 decoded_samples{};
+    std::vector<Dsp::Envelope::Point> envelope_points;
+    u32 num_forward_points{};
+    Dsp::Envelope envelope;
+    std::vector<float> envelope_gain;
+    std::array<Dsp::Biquad, BusChannels> filters{};
+    u32 filter_mask{};
+    bool stopping{};
+
+    // Effect state
+    std::unique_ptr<Dsp::Reverb> reverb;
+};
+
+class Ngs2Rack final : public Ngs2Object {
+public:
+    static constexpr auto Type = Ngs2ObjectType::Rack;
+
+    /// Rack kinds by position in the usual signal chain. Patches may not feed sampler racks.
+    enum class Stage : u32 {
+        Sampler,
+        Submixer,
+        Effect,
+        Mastering,
+        Count,
+    };
+
+    Ngs2Rack(Ngs2System& system, OrbisNgs2RackId id, const OrbisNgs2RackOption* option,
+             const OrbisNgs2ContextBufferInfo& buffer_info);
+
+    /// Returns the render stage of a rack id, or Stage::Count if the id is unknown.
+    static Stage GetStage(OrbisNgs2RackId id);
+
+    [[nodiscard]] Stage GetStage() const {
+        return GetStage(id);
+    }
+
+    Ngs2System& system;
+    OrbisNgs2RackId id;
+    u32 max_matrices;
+    OrbisNgs2ContextBufferInfo buffer_info;
+    OrbisNgs2BufferAllocator allocator{};
+    std::vector<std::unique_ptr<Ngs2Voice>> voices;
+};
+
+class Ngs2System final : public Ngs2Object {
+public:
+    static constexpr auto Type = Ngs2ObjectType::System;
+
+    Ngs2System(const OrbisNgs2SystemOption* option, const OrbisNgs2ContextBufferInfo& buffer_info);
+    ~Ngs2System() override;
+
+    static s32 ValidateOption(const OrbisNgs2SystemOption* option);
+
+    /// Renders one grain of all racks into the guest buffers.
+    s32 Render(std::span<const OrbisNgs2RenderBufferInfo> buffers);
+
+    /// Rack management, the caller must hold the system lock.
+    Ngs2Rack* AddRack(std::unique_ptr<Ngs2Rack> rack);
+    void DestroyRack(Ngs2Rack* rack);
+
+    /// Marks the render order stale after the patch graph changed.
+    void InvalidateRenderOrder() {
+        is_order_dirty = true;
+    }
+
+    std::mutex mutex;
+    u32 sample_rate{48000};
+    u32 max_grain_samples{512};
+    u32 num_grain_samples{256};
+    OrbisNgs2ContextBufferInfo buffer_info;
+    OrbisNgs2BufferAllocator allocator{};
+
+private:
+    void UpdateRenderOrder();
+
+    std::vector<std::unique_ptr<Ngs2Rack>> racks;
+    std::vector<Ngs2Voice*> render_order; ///< All voices sorted by render level.
+    std::vector<u32> level_ends;          ///< End of each level in render_order.
+    bool is_order_dirty{true};
+    std::vector<float> master;
+    RenderWorkers workers;
+
+    u64 num_voices_rendered{};
+    std::chrono::nanoseconds render_time{};
+};
+
 } // namespace Libraries::Ngs2
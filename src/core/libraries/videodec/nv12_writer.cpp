@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cstring>
+
+#include "common/arch.h"
+#include "common/logging/log.h"
+#include "core/libraries/videodec/nv12_writer.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+#include "common/support/avdec.h"
+
+#ifdef ARCH_X86_64
+#include <emmintrin.h>
+#endif
+
+namespace Libraries::Videodec {
+
+static void CopyPlane(u8* dst, u32 dst_pitch, const u8* src, s32 src_pitch, u32 row_bytes,
+                      u32 rows) {
+    if (src_pitch == static_cast<s32>(dst_pitch) && row_bytes == dst_pitch) {
+        std::memcpy(dst, src, u64(row_bytes) * rows);
+        return;
+    }
+    for (u32 y = 0; y < rows; ++y) {
+        std::memcpy(dst + u64(y) * dst_pitch, src + s64(y) * src_pitch, row_bytes);
+    }
+}
+
+static void InterleaveRow(u8* dst, const u8* u, const u8* v, u32 count) {
+    u32 i = 0;
+#ifdef ARCH_X86_64
+    for (; i + 16 <= count; i += 16) {
+        const __m128i u_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + i));
+        const __m128i v_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2),
+                         _mm_unpacklo_epi8(u_bytes, v_bytes));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 2 + 16),
+                         _mm_unpackhi_epi8(u_bytes, v_bytes));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i * 2] = u[i];
+        dst[i * 2 + 1] = v[i];
+    }
+}
+
+Nv12Writer::~Nv12Writer() {
+    sws_freeContext(sws_context);
+}
+
+bool Nv12Writer::Write(const AVFrame& frame, const Nv12Surface& surface) {
+    const u32 width = u32(frame.width);
+    const u32 height = u32(frame.height);
+    const u32 chroma_width = (width + 1) / 2;
+    const u32 chroma_height = (height + 1) / 2;
+    if (surface.data == nullptr || chroma_width * 2 > surface.pitch || height > surface.height ||
+        surface.RequiredSize() > surface.size) {
+        LOG_ERROR(Lib_Videodec, "Frame {}x{} does not fit NV12 surface (pitch {}, {} bytes)",
+                  width, height, surface.pitch, surface.size);
+        return false;
+    }
+
+    u8* const luma = surface.data;
+    u8* const chroma = surface.data + u64(surface.pitch) * surface.height;
+
+    switch (frame.format) {
+    case AV_PIX_FMT_NV12:
+        CopyPlane(luma, surface.pitch, frame.data[0], frame.linesize[0], width, height);
+        CopyPlane(chroma, surface.pitch, frame.data[1], frame.linesize[1], chroma_width * 2,
+                  chroma_height);
+        return true;
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+        CopyPlane(luma, surface.pitch, frame.data[0], frame.linesize[0], width, height);
+        for (u32 y = 0; y < chroma_height; ++y) {
+            InterleaveRow(chroma + u64(y) * surface.pitch,
+                          frame.data[1] + s64(y) * frame.linesize[1],
+                          frame.data[2] + s64(y) * frame.linesize[2], chroma_width);
+        }
+        return true;
+    default:
+        break;
+    }
+
+    // Anything else goes through swscale, still targeting guest memory directly.
+    sws_context = sws_getCachedContext(sws_context, frame.width, frame.height,
+                                       AVPixelFormat(frame.format), frame.width, frame.height,
+                                       AV_PIX_FMT_NV12, SWS_FAST_BILINEAR, nullptr, nullptr,
+                                       nullptr);
+    if (sws_context == nullptr) {
+        LOG_ERROR(Lib_Videodec, "Could not create NV12 conversion context for format {}",
+                  frame.format);
+        return false;
+    }
+    u8* const dst_data[4] = {luma, chroma, nullptr, nullptr};
+    const int dst_linesize[4] = {int(surface.pitch), int(surface.pitch), 0, 0};
+    const auto res = sws_scale(sws_context, frame.data, frame.linesize, 0, frame.height, dst_data,
+                               dst_linesize);
+    if (res < 0) {
+        LOG_ERROR(Lib_Videodec, "Could not convert to NV12: {}", av_err2str(res));
+        return false;
+    }
+    return true;
+}
+
+} // namespace Libraries::Videodec
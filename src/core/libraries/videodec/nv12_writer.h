@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "common/types.h"
+
+struct AVFrame;
+struct SwsContext;
+
+namespace Libraries::Videodec {
+
+/// NV12 picture in guest memory: a luma plane of pitch * height bytes followed by the interleaved
+/// chroma plane. Height may be larger than the frame height when the guest expects aligned planes.
+struct Nv12Surface {
+    u8* data;
+    u32 pitch;
+    u32 height;
+    u64 size;
+
+    [[nodiscard]] u64 RequiredSize() const {
+        return u64(pitch) * height + u64(pitch) * ((height + 1) / 2);
+    }
+};
+
+/// Writes decoded frames straight into guest NV12 surfaces. NV12 and YUV420P frames are copied or
+/// interleaved plane by plane, other formats are converted by swscale directly into the surface.
+class Nv12Writer {
+public:
+    Nv12Writer() = default;
+    ~Nv12Writer();
+
+    Nv12Writer(const Nv12Writer&) = delete;
+    Nv12Writer& operator=(const Nv12Writer&) = delete;
+
+    /// Returns false if the frame does not fit the surface or could not be converted.
+    bool Write(const AVFrame& frame, const Nv12Surface& surface);
+
+private:
+    SwsContext* sws_context = nullptr;
+};
+
+} // namespace Libraries::Videodec
@@ -3,7 +3,10 @@
 
 #include "videodec2_impl.h"
 
+#include <algorithm>
+
 #include "common/assert.h"
+#include "common/config.h"
 #include "common/logging/log.h"
 #include "core/libraries/videodec/videodec_error.h"
 
@@ -13,9 +16,23 @@ namespace Libraries::Vdec2 {
 
 std::vector<OrbisVideodec2AvcPictureInfo> gPictureInfos;
 
-static inline void CopyNV12Data(u8* dst, const AVFrame& src) {
-    std::memcpy(dst, src.data[0], src.width * src.height);
-    std::memcpy(dst + (src.width * src.height), src.data[1], (src.width * src.height) / 2);
+/// Frame threading delays output by roughly one frame per thread, so bound the metadata kept
+/// for inputs whose pictures have not come out yet.
+constexpr size_t MaxPendingInputs = 64;
+
+static void ConfigureThreading(AVCodecContext* context) {
+    const auto mode = Config::getVideoDecoderThreading();
+    if (mode == "frame") {
+        context->thread_type = FF_THREAD_FRAME;
+    } else if (mode == "slice") {
+        context->thread_type = FF_THREAD_SLICE;
+    } else {
+        if (mode != "auto") {
+            LOG_WARNING(Lib_Vdec2, "Unknown decoder threading mode {}, using auto", mode);
+        }
+        context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    }
+    context->thread_count = std::max(Config::getVideoDecoderThreads(), 0);
 }
 
 VdecDecoder::VdecDecoder(const OrbisVideodec2DecoderConfigInfo& configInfo,
@@ -29,13 +46,21 @@ VdecDecoder::VdecDecoder(const OrbisVideodec2DecoderConfigInfo& configInfo,
     ASSERT(mCodecContext);
     mCodecContext->width = configInfo.maxFrameWidth;
     mCodecContext->height = configInfo.maxFrameHeight;
+    ConfigureThreading(mCodecContext);
+
+    // Decoded pictures are received into one reused frame and written straight to guest memory.
+    mFrame = av_frame_alloc();
+    ASSERT(mFrame);
 
     avcodec_open2(mCodecContext, codec, nullptr);
+    LOG_INFO(Lib_Vdec2, "Opened decoder {}x{}, thread_type = {}, thread_count = {}",
+             configInfo.maxFrameWidth, configInfo.maxFrameHeight,
+             mCodecContext->active_thread_type, mCodecContext->thread_count);
 }
 
 VdecDecoder::~VdecDecoder() {
     avcodec_free_context(&mCodecContext);
-    sws_freeContext(mSwsContext);
+    av_frame_free(&mFrame);
 
     gPictureInfos.clear();
 }
@@ -56,6 +81,13 @@ s32 VdecDecoder::Decode(const OrbisVideodec2InputData& inputData,
         return ORBIS_VIDEODEC2_ERROR_ACCESS_UNIT_SIZE;
     }
 
+    if (mDraining) {
+        // New input after a partial flush starts a fresh stream.
+        avcodec_flush_buffers(mCodecContext);
+        mPendingInputs.clear();
+        mDraining = false;
+    }
+
     AVPacket* packet = av_packet_alloc();
     if (!packet) {
         LOG_ERROR(Lib_Vdec2, "Failed to allocate packet");
@@ -68,73 +100,29 @@ s32 VdecDecoder::Decode(const OrbisVideodec2InputData& inputData,
     packet->dts = inputData.dtsData;
 
     int ret = avcodec_send_packet(mCodecContext, packet);
+    if (ret == AVERROR(EAGAIN)) {
+        // The decoder holds finished frames, hand one out before feeding more input.
+        if (const s32 result = ReceiveFrame(frameBuffer, outputInfo); result != ORBIS_OK) {
+            av_packet_free(&packet);
+            return result;
+        }
+        ret = avcodec_send_packet(mCodecContext, packet);
+    }
+    av_packet_free(&packet);
     if (ret < 0) {
         LOG_ERROR(Lib_Vdec2, "Error sending packet to decoder: {}", ret);
-        av_packet_free(&packet);
         return ORBIS_VIDEODEC2_ERROR_API_FAIL;
     }
 
-    AVFrame* frame = av_frame_alloc();
-    if (frame == nullptr) {
-        LOG_ERROR(Lib_Vdec2, "Failed to allocate frame");
-        av_packet_free(&packet);
-        return ORBIS_VIDEODEC2_ERROR_API_FAIL;
+    mPendingInputs.push_back({inputData.ptsData, inputData.dtsData, inputData.attachedData});
+    if (mPendingInputs.size() > MaxPendingInputs) {
+        mPendingInputs.pop_front();
     }
 
-    while (true) {
-        ret = avcodec_receive_frame(mCodecContext, frame);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            LOG_ERROR(Lib_Vdec2, "Error receiving frame from decoder: {}", ret);
-            av_packet_free(&packet);
-            av_frame_free(&frame);
-            return ORBIS_VIDEODEC2_ERROR_API_FAIL;
-        }
-
-        if (frame->format != AV_PIX_FMT_NV12) {
-            AVFrame* nv12_frame = ConvertNV12Frame(*frame);
-            ASSERT(nv12_frame);
-            av_frame_free(&frame);
-            frame = nv12_frame;
-        }
-
-        CopyNV12Data((u8*)frameBuffer.frameBuffer, *frame);
-        frameBuffer.isAccepted = true;
-
-        outputInfo.codecType = 1; // FIXME: Hardcoded to AVC
-        outputInfo.frameWidth = frame->width;
-        outputInfo.frameHeight = frame->height;
-        outputInfo.framePitch = frame->linesize[0];
-        outputInfo.frameBufferSize = frameBuffer.frameBufferSize;
-        outputInfo.frameBuffer = frameBuffer.frameBuffer;
-
-        outputInfo.isValid = true;
-        outputInfo.isErrorFrame = false;
-        outputInfo.pictureCount = 1; // TODO: 2 pictures for interlaced video
-
-        if (outputInfo.isValid) {
-            OrbisVideodec2AvcPictureInfo pictureInfo = {};
-
-            pictureInfo.thisSize = sizeof(OrbisVideodec2AvcPictureInfo);
-            pictureInfo.isValid = true;
-
-            pictureInfo.ptsData = inputData.ptsData;
-            pictureInfo.dtsData = inputData.dtsData;
-            pictureInfo.attachedData = inputData.attachedData;
-
-            pictureInfo.frameCropLeftOffset = frame->crop_left;
-            pictureInfo.frameCropRightOffset = frame->crop_right;
-            pictureInfo.frameCropTopOffset = frame->crop_top;
-            pictureInfo.frameCropBottomOffset = frame->crop_bottom;
-
-            gPictureInfos.push_back(pictureInfo);
-        }
+    if (frameBuffer.isAccepted) {
+        return ORBIS_OK;
     }
-
-    av_packet_free(&packet);
-    av_frame_free(&frame);
-    return ORBIS_OK;
+    return ReceiveFrame(frameBuffer, outputInfo);
 }
 
 s32 VdecDecoder::Flush(OrbisVideodec2FrameBuffer& frameBuffer,
@@ -145,85 +133,99 @@ s32 VdecDecoder::Flush(OrbisVideodec2FrameBuffer& frameBuffer,
     outputInfo.isErrorFrame = true;
     outputInfo.pictureCount = 0;
 
-    AVFrame* frame = av_frame_alloc();
-    if (!frame) {
-        LOG_ERROR(Lib_Vdec2, "Failed to allocate frame");
-        return ORBIS_VIDEODEC2_ERROR_API_FAIL;
+    // Frames are drained one per call, the guest keeps flushing until no valid output is left.
+    if (!mDraining) {
+        avcodec_send_packet(mCodecContext, nullptr);
+        mDraining = true;
     }
-
-    while (true) {
-        int ret = avcodec_receive_frame(mCodecContext, frame);
-        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            break;
-        } else if (ret < 0) {
-            LOG_ERROR(Lib_Vdec2, "Error receiving frame from decoder: {}", ret);
-            av_frame_free(&frame);
-            return ORBIS_VIDEODEC2_ERROR_API_FAIL;
-        }
-
-        if (frame->format != AV_PIX_FMT_NV12) {
-            AVFrame* nv12_frame = ConvertNV12Frame(*frame);
-            ASSERT(nv12_frame);
-            av_frame_free(&frame);
-            frame = nv12_frame;
-        }
-
-        CopyNV12Data((u8*)frameBuffer.frameBuffer, *frame);
-        frameBuffer.isAccepted = true;
-
-        outputInfo.codecType = 1; // FIXME: Hardcoded to AVC
-        outputInfo.frameWidth = frame->width;
-        outputInfo.frameHeight = frame->height;
-        outputInfo.framePitch = frame->linesize[0];
-        outputInfo.frameBufferSize = frameBuffer.frameBufferSize;
-        outputInfo.frameBuffer = frameBuffer.frameBuffer;
-
-        outputInfo.isValid = true;
-        outputInfo.isErrorFrame = false;
-        outputInfo.pictureCount = 1; // TODO: 2 pictures for interlaced video
-
-        // FIXME: Should we add picture info here too?
+    if (const s32 result = ReceiveFrame(frameBuffer, outputInfo); result != ORBIS_OK) {
+        return result;
+    }
+    if (!outputInfo.isValid) {
+        avcodec_flush_buffers(mCodecContext);
+        mPendingInputs.clear();
+        mDraining = false;
     }
-
-    av_frame_free(&frame);
     return ORBIS_OK;
 }
 
 s32 VdecDecoder::Reset() {
     avcodec_flush_buffers(mCodecContext);
+    mPendingInputs.clear();
+    mDraining = false;
     gPictureInfos.clear();
     return ORBIS_OK;
 }
 
-AVFrame* VdecDecoder::ConvertNV12Frame(AVFrame& frame) {
-    AVFrame* nv12_frame = av_frame_alloc();
-    nv12_frame->pts = frame.pts;
-    nv12_frame->pkt_dts = frame.pkt_dts < 0 ? 0 : frame.pkt_dts;
-    nv12_frame->format = AV_PIX_FMT_NV12;
-    nv12_frame->width = frame.width;
-    nv12_frame->height = frame.height;
-    nv12_frame->sample_aspect_ratio = frame.sample_aspect_ratio;
-    nv12_frame->crop_top = frame.crop_top;
-    nv12_frame->crop_bottom = frame.crop_bottom;
-    nv12_frame->crop_left = frame.crop_left;
-    nv12_frame->crop_right = frame.crop_right;
-
-    av_frame_get_buffer(nv12_frame, 0);
+VdecDecoder::PendingInput VdecDecoder::TakePendingInput(s64 pts) {
+    if (mPendingInputs.empty()) {
+        return {};
+    }
+    // Pictures leave the decoder in presentation order, match them back to their input by pts.
+    auto it = std::ranges::find_if(mPendingInputs, [pts](const PendingInput& input) {
+        return static_cast<s64>(input.ptsData) == pts;
+    });
+    if (it == mPendingInputs.end()) {
+        it = mPendingInputs.begin();
+    }
+    const PendingInput input = *it;
+    mPendingInputs.erase(it);
+    return input;
+}
 
-    if (mSwsContext == nullptr) {
-        mSwsContext = sws_getContext(frame.width, frame.height, AVPixelFormat(frame.format),
-                                     nv12_frame->width, nv12_frame->height, AV_PIX_FMT_NV12,
-                                     SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+s32 VdecDecoder::ReceiveFrame(OrbisVideodec2FrameBuffer& frameBuffer,
+                              OrbisVideodec2OutputInfo& outputInfo) {
+    const int ret = avcodec_receive_frame(mCodecContext, mFrame);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+        return ORBIS_OK;
+    } else if (ret < 0) {
+        LOG_ERROR(Lib_Vdec2, "Error receiving frame from decoder: {}", ret);
+        return ORBIS_VIDEODEC2_ERROR_API_FAIL;
     }
 
-    const auto res = sws_scale(mSwsContext, frame.data, frame.linesize, 0, frame.height,
-                               nv12_frame->data, nv12_frame->linesize);
-    if (res < 0) {
-        LOG_ERROR(Lib_Vdec2, "Could not convert to NV12: {}", av_err2str(res));
-        return nullptr;
+    const AVFrame& frame = *mFrame;
+    const Videodec::Nv12Surface surface = {
+        .data = static_cast<u8*>(frameBuffer.frameBuffer),
+        .pitch = u32(frame.width),
+        .height = u32(frame.height),
+        .size = frameBuffer.frameBufferSize,
+    };
+    if (!mNv12Writer.Write(frame, surface)) {
+        av_frame_unref(mFrame);
+        return ORBIS_VIDEODEC2_ERROR_FRAME_BUFFER_SIZE;
     }
+    frameBuffer.isAccepted = true;
+
+    outputInfo.codecType = 1; // FIXME: Hardcoded to AVC
+    outputInfo.frameWidth = frame.width;
+    outputInfo.frameHeight = frame.height;
+    outputInfo.framePitch = surface.pitch;
+    outputInfo.frameBufferSize = frameBuffer.frameBufferSize;
+    outputInfo.frameBuffer = frameBuffer.frameBuffer;
+
+    outputInfo.isValid = true;
+    outputInfo.isErrorFrame = false;
+    outputInfo.pictureCount = 1; // TODO: 2 pictures for interlaced video
 
-    return nv12_frame;
+    const PendingInput input = TakePendingInput(frame.pts);
+    OrbisVideodec2AvcPictureInfo pictureInfo = {};
+
+    pictureInfo.thisSize = sizeof(OrbisVideodec2AvcPictureInfo);
+    pictureInfo.isValid = true;
+
+    pictureInfo.ptsData = input.ptsData;
+    pictureInfo.dtsData = input.dtsData;
+    pictureInfo.attachedData = input.attachedData;
+
+    pictureInfo.frameCropLeftOffset = frame.crop_left;
+    pictureInfo.frameCropRightOffset = frame.crop_right;
+    pictureInfo.frameCropTopOffset = frame.crop_top;
+    pictureInfo.frameCropBottomOffset = frame.crop_bottom;
+
+    gPictureInfos.push_back(pictureInfo);
+
+    av_frame_unref(mFrame);
+    return ORBIS_OK;
 }
 
 } // namespace Libraries::Vdec2
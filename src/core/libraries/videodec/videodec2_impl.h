@@ -3,8 +3,10 @@
 
 #pragma once
 
+#include <deque>
 #include <vector>
 
+#include "core/libraries/videodec/nv12_writer.h"
 #include "videodec2.h"
 
 extern "C" {
@@ -29,11 +31,21 @@ public:
     s32 Reset();
 
 private:
-    AVFrame* ConvertNV12Frame(AVFrame& frame);
+    struct PendingInput {
+        u64 ptsData;
+        u64 dtsData;
+        u64 attachedData;
+    };
+
+    s32 ReceiveFrame(OrbisVideodec2FrameBuffer& frameBuffer, OrbisVideodec2OutputInfo& outputInfo);
+    PendingInput TakePendingInput(s64 pts);
 
 private:
     AVCodecContext* mCodecContext = nullptr;
-    SwsContext* mSwsContext = nullptr;
+    AVFrame* mFrame = nullptr;
+    Videodec::Nv12Writer mNv12Writer;
+    std::deque<PendingInput> mPendingInputs;
+    bool mDraining = false;
 };
 
 } // namespace Libraries::Vdec2
\ No newline at end of file
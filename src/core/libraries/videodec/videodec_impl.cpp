@@ -12,13 +12,6 @@
 
 namespace Libraries::Videodec {
 
-static inline void CopyNV12Data(u8* dst, const AVFrame& src) {
-    u32 width = Common::AlignUp((u32)src.width, 16);
-    u32 height = Common::AlignUp((u32)src.height, 16);
-    std::memcpy(dst, src.data[0], src.width * src.height);
-    std::memcpy(dst + src.width * height, src.data[1], (src.width * src.height) / 2);
-}
-
 VdecDecoder::VdecDecoder(const OrbisVideodecConfigInfo& pCfgInfoIn,
                          const OrbisVideodecResourceInfo& pRsrcInfoIn) {
 
@@ -31,11 +24,14 @@ VdecDecoder::VdecDecoder(const OrbisVideodecConfigInfo& pCfgInfoIn,
     mCodecContext->height = pCfgInfoIn.maxFrameHeight;
 
     avcodec_open2(mCodecContext, codec, nullptr);
+
+    mFrame = av_frame_alloc();
+    ASSERT(mFrame);
 }
 
 VdecDecoder::~VdecDecoder() {
     avcodec_free_context(&mCodecContext);
-    sws_freeContext(mSwsContext);
+    av_frame_free(&mFrame);
 }
 
 s32 VdecDecoder::Decode(const OrbisVideodecInputData& pInputDataIn,
@@ -64,54 +60,33 @@ s32 VdecDecoder::Decode(const OrbisVideodecInputData& pInputDataIn,
     packet->dts = pInputDataIn.dtsData;
 
     int ret = avcodec_send_packet(mCodecContext, packet);
+    av_packet_free(&packet);
     if (ret < 0) {
         LOG_ERROR(Lib_Videodec, "Error sending packet to decoder: {}", ret);
-        av_packet_free(&packet);
         return ORBIS_VIDEODEC_ERROR_API_FAIL;
     }
 
-    AVFrame* frame = av_frame_alloc();
-    if (frame == nullptr) {
-        LOG_ERROR(Lib_Videodec, "Failed to allocate frame");
-        av_packet_free(&packet);
-        return ORBIS_VIDEODEC_ERROR_API_FAIL;
-    }
     int frameCount = 0;
     while (true) {
-        ret = avcodec_receive_frame(mCodecContext, frame);
+        ret = avcodec_receive_frame(mCodecContext, mFrame);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         } else if (ret < 0) {
             LOG_ERROR(Lib_Videodec, "Error receiving frame from decoder: {}", ret);
-            av_packet_free(&packet);
-            av_frame_free(&frame);
             return ORBIS_VIDEODEC_ERROR_API_FAIL;
         }
 
-        if (frame->format != AV_PIX_FMT_NV12) {
-            AVFrame* nv12_frame = ConvertNV12Frame(*frame);
-            ASSERT(nv12_frame);
-            av_frame_free(&frame);
-            frame = nv12_frame;
+        const bool written = WriteFrame(pFrameBufferInOut, pPictureInfoOut);
+        av_frame_unref(mFrame);
+        if (!written) {
+            return ORBIS_VIDEODEC_ERROR_FRAME_BUFFER_SIZE;
         }
-
-        CopyNV12Data((u8*)pFrameBufferInOut.pFrameBuffer, *frame);
-
-        pPictureInfoOut.codecType = 0;
-        pPictureInfoOut.frameWidth = Common::AlignUp((u32)frame->width, 16);
-        pPictureInfoOut.frameHeight = Common::AlignUp((u32)frame->height, 16);
-        pPictureInfoOut.framePitch = frame->linesize[0];
-
-        pPictureInfoOut.isValid = true;
-        pPictureInfoOut.isErrorPic = false;
         frameCount++;
         if (frameCount > 1) {
             LOG_WARNING(Lib_Videodec, "We have more than 1 frame");
         }
     }
 
-    av_packet_free(&packet);
-    av_frame_free(&frame);
     return ORBIS_OK;
 }
 
@@ -121,48 +96,21 @@ s32 VdecDecoder::Flush(OrbisVideodecFrameBuffer& pFrameBufferInOut,
     pPictureInfoOut.isValid = false;
     pPictureInfoOut.isErrorPic = true;
 
-    AVFrame* frame = av_frame_alloc();
-    if (!frame) {
-        LOG_ERROR(Lib_Videodec, "Failed to allocate frame");
-        return ORBIS_VIDEODEC_ERROR_API_FAIL;
-    }
-
     int frameCount = 0;
     while (true) {
-        int ret = avcodec_receive_frame(mCodecContext, frame);
+        int ret = avcodec_receive_frame(mCodecContext, mFrame);
         if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
             break;
         } else if (ret < 0) {
             LOG_ERROR(Lib_Videodec, "Error receiving frame from decoder: {}", ret);
-            av_frame_free(&frame);
             return ORBIS_VIDEODEC_ERROR_API_FAIL;
         }
 
-        if (frame->format != AV_PIX_FMT_NV12) {
-            AVFrame* nv12_frame = ConvertNV12Frame(*frame);
-            ASSERT(nv12_frame);
-            av_frame_free(&frame);
-            frame = nv12_frame;
+        const bool written = WriteFrame(pFrameBufferInOut, pPictureInfoOut);
+        av_frame_unref(mFrame);
+        if (!written) {
+            return ORBIS_VIDEODEC_ERROR_FRAME_BUFFER_SIZE;
         }
-
-        CopyNV12Data((u8*)pFrameBufferInOut.pFrameBuffer, *frame);
-
-        pPictureInfoOut.codecType = 0;
-        pPictureInfoOut.frameWidth = Common::AlignUp((u32)frame->width, 16);
-        pPictureInfoOut.frameHeight = Common::AlignUp((u32)frame->height, 16);
-        pPictureInfoOut.framePitch = frame->linesize[0];
-
-        pPictureInfoOut.isValid = true;
-        pPictureInfoOut.isErrorPic = false;
-
-        u32 width = Common::AlignUp((u32)frame->width, 16);
-        u32 height = Common::AlignUp((u32)frame->height, 16);
-        pPictureInfoOut.codec.avc.frameCropLeftOffset = u32(frame->crop_left);
-        pPictureInfoOut.codec.avc.frameCropRightOffset =
-            u32(frame->crop_right + (width - frame->width));
-        pPictureInfoOut.codec.avc.frameCropTopOffset = u32(frame->crop_top);
-        pPictureInfoOut.codec.avc.frameCropBottomOffset =
-            u32(frame->crop_bottom + (height - frame->height));
         // TODO maybe more avc?
 
         if (frameCount > 1) {
@@ -170,7 +118,6 @@ s32 VdecDecoder::Flush(OrbisVideodecFrameBuffer& pFrameBufferInOut,
         }
     }
 
-    av_frame_free(&frame);
     return ORBIS_OK;
 }
 
@@ -179,35 +126,37 @@ s32 VdecDecoder::Reset() {
     return ORBIS_OK;
 }
 
-AVFrame* VdecDecoder::ConvertNV12Frame(AVFrame& frame) {
-    AVFrame* nv12_frame = av_frame_alloc();
-    nv12_frame->pts = frame.pts;
-    nv12_frame->pkt_dts = frame.pkt_dts < 0 ? 0 : frame.pkt_dts;
-    nv12_frame->format = AV_PIX_FMT_NV12;
-    nv12_frame->width = frame.width;
-    nv12_frame->height = frame.height;
-    nv12_frame->sample_aspect_ratio = frame.sample_aspect_ratio;
-    nv12_frame->crop_top = frame.crop_top;
-    nv12_frame->crop_bottom = frame.crop_bottom;
-    nv12_frame->crop_left = frame.crop_left;
-    nv12_frame->crop_right = frame.crop_right;
-
-    av_frame_get_buffer(nv12_frame, 0);
-
-    if (mSwsContext == nullptr) {
-        mSwsContext = sws_getContext(frame.width, frame.height, AVPixelFormat(frame.format),
-                                     nv12_frame->width, nv12_frame->height, AV_PIX_FMT_NV12,
-                                     SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+bool VdecDecoder::WriteFrame(OrbisVideodecFrameBuffer& pFrameBufferInOut,
+                             OrbisVideodecPictureInfo& pPictureInfoOut) {
+    const AVFrame& frame = *mFrame;
+    u32 width = Common::AlignUp((u32)frame.width, 16);
+    u32 height = Common::AlignUp((u32)frame.height, 16);
+
+    // The guest picture uses 16 aligned planes, the decoder writes into it without a staging copy.
+    const Nv12Surface surface = {
+        .data = (u8*)pFrameBufferInOut.pFrameBuffer,
+        .pitch = width,
+        .height = height,
+        .size = pFrameBufferInOut.frameBufferSize,
+    };
+    if (!mNv12Writer.Write(frame, surface)) {
+        return false;
     }
 
-    const auto res = sws_scale(mSwsContext, frame.data, frame.linesize, 0, frame.height,
-                               nv12_frame->data, nv12_frame->linesize);
-    if (res < 0) {
-        LOG_ERROR(Lib_Videodec, "Could not convert to NV12: {}", av_err2str(res));
-        return nullptr;
-    }
+    pPictureInfoOut.codecType = 0;
+    pPictureInfoOut.frameWidth = width;
+    pPictureInfoOut.frameHeight = height;
+    pPictureInfoOut.framePitch = width;
+
+    pPictureInfoOut.isValid = true;
+    pPictureInfoOut.isErrorPic = false;
 
-    return nv12_frame;
+    pPictureInfoOut.codec.avc.frameCropLeftOffset = u32(frame.crop_left);
+    pPictureInfoOut.codec.avc.frameCropRightOffset = u32(frame.crop_right + (width - frame.width));
+    pPictureInfoOut.codec.avc.frameCropTopOffset = u32(frame.crop_top);
+    pPictureInfoOut.codec.avc.frameCropBottomOffset =
+        u32(frame.crop_bottom + (height - frame.height));
+    return true;
 }
 
 } // namespace Libraries::Videodec
@@ -5,6 +5,7 @@
 
 #include <vector>
 
+#include "core/libraries/videodec/nv12_writer.h"
 #include "videodec.h"
 
 extern "C" {
@@ -28,11 +29,13 @@ public:
     s32 Reset();
 
 private:
-    AVFrame* ConvertNV12Frame(AVFrame& frame);
+    bool WriteFrame(OrbisVideodecFrameBuffer& pFrameBufferInOut,
+                    OrbisVideodecPictureInfo& pPictureInfoOut);
 
 private:
     AVCodecContext* mCodecContext = nullptr;
-    SwsContext* mSwsContext = nullptr;
+    AVFrame* mFrame = nullptr;
+    Nv12Writer mNv12Writer;
 };
 
 } // namespace Libraries::Videodec
\ No newline at end of file
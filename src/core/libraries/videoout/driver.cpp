@@ -39,11 +39,20 @@ constexpr u32 PixelFormatBpp(PixelFormat pixel_format) {
     }
 }
 
-VideoOutDriver::VideoOutDriver(u32 width, u32 height) {
+static std::chrono::nanoseconds HostTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+}
+
+VideoOutDriver::VideoOutDriver(u32 width, u32 height)
+    : pacer{ParsePacingMode(Config::framePacing()), Config::frameQueueDepth()} {
     main_port.resolution.full_width = width;
     main_port.resolution.full_height = height;
     main_port.resolution.pane_width = width;
     main_port.resolution.pane_height = height;
+    if (const auto timings_path = Config::getFrameTimingsPath(); !timings_path.empty()) {
+        pacer.SetTimingsOutput(timings_path);
+    }
     present_thread = std::jthread([&](std::stop_token token) { PresentThread(token); });
 }
 
@@ -159,11 +168,20 @@ int VideoOutDriver::UnregisterBuffers(VideoOutPort* port, s32 attributeIndex) {
     return ORBIS_OK;
 }
 
-void VideoOutDriver::Flip(const Request& req) {
-    // Whatever the game is rendering show splash if it is active
-    if (!presenter->ShowSplash(req.frame)) {
-        // Present the frame.
-        presenter->Present(req.frame);
+void VideoOutDriver::Flip(const Request& req, bool is_dropped /*= false*/) {
+    FrameTimings timings{.submit = req.submit_time};
+    if (is_dropped) {
+        presenter->DiscardFrame(req.frame);
+    } else {
+        if (presenter->IsFrameReady(req.frame)) {
+            timings.gpu_done = HostTime();
+        }
+        // Whatever the game is rendering show splash if it is active
+        if (!presenter->ShowSplash(req.frame)) {
+            // Present the frame.
+            presenter->Present(req.frame);
+        }
+        timings.present = HostTime();
     }
 
     // Update flip status.
@@ -192,6 +210,8 @@ void VideoOutDriver::Flip(const Request& req) {
                                         (req.flip_arg << 16)));
         }
     }
+    timings.flip = HostTime();
+    pacer.OnFlip(port->vblank_status.count, port->flip_rate, timings, is_dropped);
 
     // Reset flip label
     if (req.index != -1) {
@@ -200,6 +220,43 @@ void VideoOutDriver::Flip(const Request& req) {
     }
 }
 
+bool VideoOutDriver::FlipQueued() {
+    while (true) {
+        Request request{};
+        bool is_dropped{};
+        {
+            std::scoped_lock lk{mutex};
+            if (requests.empty()) {
+                return false;
+            }
+            // Frames past the queue depth still count as flipped for the guest.
+            is_dropped = pacer.NumFramesToDrop(requests.size()) != 0;
+            request = requests.front();
+            requests.pop();
+        }
+        Flip(request, is_dropped);
+        if (!is_dropped) {
+            FRAME_END;
+            return true;
+        }
+    }
+}
+
+void VideoOutDriver::FlipUntil(std::chrono::steady_clock::time_point deadline) {
+    while (!DebugState.IsGuestThreadsPaused()) {
+        {
+            std::unique_lock lk{mutex};
+            if (!requests_cv.wait_until(lk, deadline, [this] { return !requests.empty(); })) {
+                return;
+            }
+        }
+        if (!pacer.CanFlip(main_port.vblank_status.count, main_port.flip_rate, false) ||
+            !FlipQueued()) {
+            return;
+        }
+    }
+}
+
 void VideoOutDriver::DrawBlankFrame() {
     if (presenter->ShowSplash(nullptr)) {
         return;
@@ -217,6 +274,7 @@ void VideoOutDriver::DrawLastFrame() {
 
 bool VideoOutDriver::SubmitFlip(VideoOutPort* port, s32 index, s64 flip_arg,
                                 bool is_eop /*= false*/) {
+    const auto submit_time = HostTime();
     {
         std::unique_lock lock{port->port_mutex};
         if (index != -1 && port->flip_status.flip_pending_num >= port->NumRegisteredBuffers()) {
@@ -237,16 +295,17 @@ bool VideoOutDriver::SubmitFlip(VideoOutPort* port, s32 index, s64 flip_arg,
         // Vulkan image at the time of frame presentation.
         liverpool->SendCommand([=, this]() {
             presenter->FlushDraw();
-            SubmitFlipInternal(port, index, flip_arg, is_eop);
+            SubmitFlipInternal(port, index, flip_arg, submit_time, is_eop);
         });
     } else {
-        SubmitFlipInternal(port, index, flip_arg, is_eop);
+        SubmitFlipInternal(port, index, flip_arg, submit_time, is_eop);
     }
 
     return true;
 }
 
 void VideoOutDriver::SubmitFlipInternal(VideoOutPort* port, s32 index, s64 flip_arg,
+                                        std::chrono::nanoseconds submit_time,
                                         bool is_eop /*= false*/) {
     Vulkan::Frame* frame;
     if (index == -1) {
@@ -264,7 +323,9 @@ void VideoOutDriver::SubmitFlipInternal(VideoOutPort* port, s32 index, s64 flip_
         .flip_arg = flip_arg,
         .index = index,
         .eop = is_eop,
+        .submit_time = submit_time,
     });
+    requests_cv.notify_one();
 }
 
 void VideoOutDriver::PresentThread(std::stop_token token) {
@@ -276,17 +337,15 @@ void VideoOutDriver::PresentThread(std::stop_token token) {
 
     Common::AccurateTimer timer{vblank_period};
 
-    const auto receive_request = [this] -> Request {
-        std::scoped_lock lk{mutex};
-        if (!requests.empty()) {
-            const auto request = requests.front();
-            requests.pop();
-            return request;
-        }
-        return {};
-    };
+    // Leave some time for the vblank itself when flipping frames between vblanks.
+    static constexpr std::chrono::milliseconds FlipWaitMargin{1};
 
     while (!token.stop_requested()) {
+        if (pacer.FlipsBetweenVblanks() && timer.GetTotalWait() > FlipWaitMargin) {
+            const auto begin_wait = std::chrono::steady_clock::now();
+            FlipUntil(begin_wait + timer.GetTotalWait() - FlipWaitMargin);
+            timer.Consume(std::chrono::steady_clock::now() - begin_wait);
+        }
         timer.Start();
 
         if (DebugState.IsGuestThreadsPaused()) {
@@ -297,19 +356,13 @@ void VideoOutDriver::PresentThread(std::stop_token token) {
 
         // Check if it's time to take a request.
         auto& vblank_status = main_port.vblank_status;
-        if (vblank_status.count % (main_port.flip_rate + 1) == 0) {
-            const auto request = receive_request();
-            if (!request) {
-                if (timer.GetTotalWait().count() < 0) { // Dont draw too fast
-                    if (!main_port.is_open) {
-                        DrawBlankFrame();
-                    } else if (ImGui::Core::MustKeepDrawing()) {
-                        DrawLastFrame();
-                    }
+        if (pacer.CanFlip(vblank_status.count, main_port.flip_rate, true) && !FlipQueued()) {
+            if (timer.GetTotalWait().count() < 0) { // Dont draw too fast
+                if (!main_port.is_open) {
+                    DrawBlankFrame();
+                } else if (ImGui::Core::MustKeepDrawing()) {
+                    DrawLastFrame();
                 }
-            } else {
-                Flip(request);
-                FRAME_END;
             }
         }
 
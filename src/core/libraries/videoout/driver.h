@@ -5,6 +5,7 @@
 
 #include "common/debug.h"
 #include "common/polyfill_thread.h"
+#include "core/libraries/videoout/frame_pacer.h"
 #include "core/libraries/videoout/video_out.h"
 
 #include <condition_variable>
@@ -96,20 +97,26 @@ private:
         s64 flip_arg;
         s32 index;
         bool eop;
+        std::chrono::nanoseconds submit_time;
 
         operator bool() const noexcept {
             return frame != nullptr;
         }
     };
 
-    void Flip(const Request& req);
+    void Flip(const Request& req, bool is_dropped = false);
+    bool FlipQueued(); // Flips the next request, retiring the ones the pacer drops
+    void FlipUntil(std::chrono::steady_clock::time_point deadline); // Flips between vblanks
     void DrawBlankFrame(); // Video port out not open
     void DrawLastFrame();  // Used when there is no flip request
-    void SubmitFlipInternal(VideoOutPort* port, s32 index, s64 flip_arg, bool is_eop = false);
+    void SubmitFlipInternal(VideoOutPort* port, s32 index, s64 flip_arg,
+                            std::chrono::nanoseconds submit_time, bool is_eop = false);
     void PresentThread(std::stop_token token);
 
     std::mutex mutex;
+    std::condition_variable requests_cv;
     VideoOutPort main_port{};
+    FramePacer pacer;
     std::jthread present_thread;
     std::queue<Request> requests;
 };
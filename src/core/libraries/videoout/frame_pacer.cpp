@@ -0,0 +1,113 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <fmt/format.h>
+
+#include "common/logging/log.h"
+#include "core/libraries/videoout/frame_pacer.h"
+
+namespace Libraries::VideoOut {
+
+PacingMode ParsePacingMode(std::string_view name) {
+    if (name == "vblank") {
+        return PacingMode::Vblank;
+    }
+    if (name == "low-latency") {
+        return PacingMode::LowLatency;
+    }
+    if (name == "queue") {
+        return PacingMode::Queue;
+    }
+    LOG_WARNING(Lib_VideoOut, "Unknown frame pacing mode {}, using vblank", name);
+    return PacingMode::Vblank;
+}
+
+FramePacer::FramePacer(PacingMode mode, u32 queue_depth)
+    : mode{mode}, queue_depth{std::max(queue_depth, 1U)} {}
+
+bool FramePacer::CanFlip(u64 vblank_count, u32 flip_rate, bool at_vblank) const {
+    const u64 interval = u64(flip_rate) + 1;
+    if (mode != PacingMode::LowLatency) {
+        return at_vblank && vblank_count % interval == 0;
+    }
+    // Keep the guest flip rate, but flip as soon as the frame is there rather than waiting for
+    // the vblank that opens the next window.
+    return !has_flipped || vblank_count / interval > last_flip_window;
+}
+
+size_t FramePacer::NumFramesToDrop(size_t num_queued) const {
+    if (mode != PacingMode::Queue || num_queued <= queue_depth) {
+        return 0;
+    }
+    return num_queued - queue_depth;
+}
+
+void FramePacer::OnFlip(u64 vblank_count, u32 flip_rate, const FrameTimings& timings,
+                        bool dropped) {
+    WriteTimings(timings, dropped);
+    if (dropped) {
+        ++num_dropped;
+        ReportStats();
+        return;
+    }
+    has_flipped = true;
+    last_flip_window = vblank_count / (u64(flip_rate) + 1);
+
+    ++num_frames;
+    if (timings.gpu_done.count() != 0) {
+        total_gpu += timings.gpu_done - timings.submit;
+    } else {
+        ++num_late;
+    }
+    total_present += timings.present - timings.submit;
+    total_latency += timings.flip - timings.submit;
+    ReportStats();
+}
+
+void FramePacer::SetTimingsOutput(const std::filesystem::path& path) {
+    using namespace Common::FS;
+    timings_file.Open(path, FileAccessMode::Write, FileType::TextFile);
+    if (!timings_file.IsOpen()) {
+        LOG_ERROR(Lib_VideoOut, "Failed to open frame timings file {}", path.string());
+        return;
+    }
+    timings_file.WriteString(std::string_view{"frame,dropped,submit,gpu_done,present,flip\n"});
+}
+
+void FramePacer::WriteTimings(const FrameTimings& timings, bool dropped) {
+    if (!timings_file.IsOpen()) {
+        return;
+    }
+    if (timings_epoch.count() == 0) {
+        timings_epoch = timings.submit;
+    }
+    // Unset timestamps are written as empty fields.
+    const auto field = [this](std::chrono::nanoseconds time) {
+        return time.count() != 0 ? fmt::format("{}", (time - timings_epoch).count()) : "";
+    };
+    const auto line = fmt::format("{},{},{},{},{},{}\n", num_frames + num_dropped, dropped ? 1 : 0,
+                                  field(timings.submit), field(timings.gpu_done),
+                                  field(timings.present), field(timings.flip));
+    timings_file.WriteString(line);
+    // The emulator exits without running destructors, keep the file complete as it goes.
+    timings_file.Flush();
+}
+
+void FramePacer::ReportStats() {
+    const u64 num_flips = num_frames + num_dropped;
+    if (num_flips % 256 != 0 || num_frames == 0) {
+        return;
+    }
+    using namespace std::chrono;
+    const auto average_us = [](nanoseconds total, u64 count) {
+        return count != 0 ? duration_cast<microseconds>(total).count() / s64(count) : 0;
+    };
+    LOG_DEBUG(Lib_VideoOut,
+              "Frame pacing: {} flips, {} dropped, {} late, submit to GPU done {} us, to present "
+              "{} us, to flip {} us",
+              num_flips, num_dropped, num_late, average_us(total_gpu, num_frames - num_late),
+              average_us(total_present, num_frames), average_us(total_latency, num_frames));
+}
+
+} // namespace Libraries::VideoOut
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+#include "common/io_file.h"
+#include "common/types.h"
+
+namespace Libraries::VideoOut {
+
+enum class PacingMode : u32 {
+    Vblank,     ///< Flip at most one frame on each eligible vblank, like the hardware.
+    LowLatency, ///< Flip a frame as soon as it is submitted, at the guest flip rate.
+    Queue,      ///< Flip on vblanks, retire frames queued beyond the depth limit unshown.
+};
+
+/// Parses the frame pacing mode from the config, falling back to Vblank.
+PacingMode ParsePacingMode(std::string_view name);
+
+/// Host timestamps of a flip, as durations since an arbitrary epoch. A zero value is unset.
+struct FrameTimings {
+    std::chrono::nanoseconds submit{};   ///< Guest submitted the flip.
+    std::chrono::nanoseconds gpu_done{}; ///< Present thread saw the frame finished rendering.
+    std::chrono::nanoseconds present{};  ///< Host present was queued.
+    std::chrono::nanoseconds flip{};     ///< Flip event was signaled to the guest.
+};
+
+/**
+ * Flip pacing policy of the video out present thread. It only makes decisions from the vblank
+ * counter and the queue state it is given, and keeps timing statistics from the timestamps it is
+ * given, so it does not depend on the host clock or the presenter.
+ */
+class FramePacer {
+public:
+    explicit FramePacer(PacingMode mode, u32 queue_depth);
+
+    [[nodiscard]] PacingMode Mode() const noexcept {
+        return mode;
+    }
+
+    /// Whether the present thread should flip frames as they arrive between vblanks.
+    [[nodiscard]] bool FlipsBetweenVblanks() const noexcept {
+        return mode == PacingMode::LowLatency;
+    }
+
+    /// Whether a queued frame may be flipped now. at_vblank is set on the vblank tick itself.
+    [[nodiscard]] bool CanFlip(u64 vblank_count, u32 flip_rate, bool at_vblank) const;
+
+    /// Number of queued frames, oldest first, to retire without presenting before a flip.
+    [[nodiscard]] size_t NumFramesToDrop(size_t num_queued) const;
+
+    /// Records a flip of a presented frame, or of a dropped one.
+    void OnFlip(u64 vblank_count, u32 flip_rate, const FrameTimings& timings, bool dropped);
+
+    /// Writes the timings of every flip to a CSV file, in nanoseconds since the first submit.
+    void SetTimingsOutput(const std::filesystem::path& path);
+
+private:
+    void ReportStats();
+    void WriteTimings(const FrameTimings& timings, bool dropped);
+
+    PacingMode mode;
+    u32 queue_depth;
+    bool has_flipped{};
+    u64 last_flip_window{};
+
+    u64 num_frames{};
+    u64 num_dropped{};
+    u64 num_late{}; ///< Frames presented before the present thread saw them finished.
+    std::chrono::nanoseconds total_gpu{};
+    std::chrono::nanoseconds total_present{};
+    std::chrono::nanoseconds total_latency{};
+
+    Common::FS::IOFile timings_file;
+    std::chrono::nanoseconds timings_epoch{};
+};
+
+} // namespace Libraries::VideoOut
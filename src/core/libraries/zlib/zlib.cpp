@@ -1,13 +1,17 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <array>
 #include <condition_variable>
 #include <mutex>
 #include <stop_token>
+#include <thread>
 #include <unordered_map>
 #include <queue>
 #include <zlib.h>
 
+#include "common/config.h"
 #include "common/logging/log.h"
 #include "common/thread.h"
 #include "core/libraries/kernel/threads.h"
@@ -30,7 +34,16 @@ struct InflateResult {
     s32 status;
 };
 
-static Kernel::Thread task_thread;
+/// Upper bound of the inflate worker pool.
+constexpr u32 MaxWorkers = 8;
+
+/// Requests with an output buffer up to this size are inflated on the calling thread, the
+/// handoff to a worker would cost more than the decompression itself.
+constexpr u32 SyncInflateMaxLength = 8_KB;
+
+static std::array<Kernel::Thread, MaxWorkers> workers;
+static u32 num_workers;
+static bool initialized;
 
 static std::mutex mutex;
 static std::queue<InflateTask> task_queue;
@@ -40,8 +53,31 @@ static std::condition_variable_any done_queue_cv;
 static std::unordered_map<u64, InflateResult> results;
 static u64 next_request_id;
 
-void ZlibTaskThread(const std::stop_token& stop) {
-    Common::SetCurrentThreadName("shadPS4:ZlibTaskThread");
+static InflateResult Inflate(const InflateTask& task) {
+    uLongf decompressed_length = task.dst_length;
+    const auto ret = uncompress(static_cast<Bytef*>(task.dst), &decompressed_length,
+                                static_cast<const Bytef*>(task.src), task.src_length);
+    return InflateResult{
+        .length = static_cast<u32>(decompressed_length),
+        .status = ret == Z_BUF_ERROR ? ORBIS_ZLIB_ERROR_NOSPACE
+                  : ret == Z_OK      ? ORBIS_OK
+                                     : ORBIS_ZLIB_ERROR_FATAL,
+    };
+}
+
+static void CompleteRequest(u64 request_id, const InflateResult& result) {
+    {
+        // Lock, insert the new result, and push the finished request ID to the done queue.
+        std::unique_lock lock(mutex);
+        results[request_id] = result;
+        done_queue.push(request_id);
+    }
+    done_queue_cv.notify_one();
+}
+
+void ZlibTaskThread(const std::stop_token& stop, u32 index) {
+    const auto thread_name = fmt::format("shadPS4:ZlibWorker{}", index);
+    Common::SetCurrentThreadName(thread_name.c_str());
 
     while (!stop.stop_requested()) {
         InflateTask task;
@@ -51,32 +87,16 @@ void ZlibTaskThread(const std::stop_token& stop) {
             if (!task_queue_cv.wait(lock, stop, [&] { return !task_queue.empty(); })) {
                 break;
             }
-            task = task_queue.back();
+            task = task_queue.front();
             task_queue.pop();
         }
-
-        uLongf decompressed_length = task.dst_length;
-        const auto ret = uncompress(static_cast<Bytef*>(task.dst), &decompressed_length,
-                                    static_cast<const Bytef*>(task.src), task.src_length);
-
-        {
-            // Lock, insert the new result, and push the finished request ID to the done queue.
-            std::unique_lock lock(mutex);
-            results[task.request_id] = InflateResult{
-                .length = static_cast<u32>(decompressed_length),
-                .status = ret == Z_BUF_ERROR ? ORBIS_ZLIB_ERROR_NOSPACE
-                          : ret == Z_OK      ? ORBIS_OK
-                                             : ORBIS_ZLIB_ERROR_FATAL,
-            };
-            done_queue.push(task.request_id);
-        }
-        done_queue_cv.notify_one();
+        CompleteRequest(task.request_id, Inflate(task));
     }
 }
 
 s32 PS4_SYSV_ABI sceZlibInitialize(const void* buffer, u32 length) {
     LOG_INFO(Lib_Zlib, "called");
-    if (task_thread.Joinable()) {
+    if (initialized) {
         return ORBIS_ZLIB_ERROR_ALREADY_INITIALIZED;
     }
 
@@ -86,14 +106,23 @@ s32 PS4_SYSV_ABI sceZlibInitialize(const void* buffer, u32 length) {
     results.clear();
     next_request_id = 1;
 
-    task_thread.Run([](const std::stop_token& stop) { ZlibTaskThread(stop); });
+    const int configured_workers = Config::getZlibWorkerThreads();
+    num_workers = configured_workers > 0
+                      ? static_cast<u32>(configured_workers)
+                      : std::max(std::thread::hardware_concurrency() / 2, 1U);
+    num_workers = std::min(num_workers, MaxWorkers);
+    for (u32 i = 0; i < num_workers; ++i) {
+        workers[i].Run([i](const std::stop_token& stop) { ZlibTaskThread(stop, i); });
+    }
+    initialized = true;
+    LOG_INFO(Lib_Zlib, "Started {} inflate workers", num_workers);
     return ORBIS_OK;
 }
 
 s32 PS4_SYSV_ABI sceZlibInflate(const void* src, u32 src_len, void* dst, u32 dst_len,
                                 u64* request_id) {
-    LOG_DEBUG(Lib_Zlib, "(STUBBED) called");
-    if (!task_thread.Joinable()) {
+    LOG_DEBUG(Lib_Zlib, "called");
+    if (!initialized) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
     if (!src || !src_len || !dst || !dst_len || !request_id || dst_len > 64_KB ||
@@ -101,24 +130,35 @@ s32 PS4_SYSV_ABI sceZlibInflate(const void* src, u32 src_len, void* dst, u32 dst
         return ORBIS_ZLIB_ERROR_INVALID;
     }
 
+    InflateTask task{
+        .src = src,
+        .src_length = src_len,
+        .dst = dst,
+        .dst_length = dst_len,
+    };
+    if (dst_len <= SyncInflateMaxLength) {
+        {
+            std::unique_lock lock(mutex);
+            task.request_id = next_request_id++;
+        }
+        *request_id = task.request_id;
+        CompleteRequest(task.request_id, Inflate(task));
+        return ORBIS_OK;
+    }
+
     {
         std::unique_lock lock(mutex);
-        *request_id = next_request_id++;
-        task_queue.emplace(InflateTask{
-            .request_id = *request_id,
-            .src = src,
-            .src_length = src_len,
-            .dst = dst,
-            .dst_length = dst_len,
-        });
-        task_queue_cv.notify_one();
+        task.request_id = next_request_id++;
+        *request_id = task.request_id;
+        task_queue.push(task);
     }
+    task_queue_cv.notify_one();
     return ORBIS_OK;
 }
 
 s32 PS4_SYSV_ABI sceZlibWaitForDone(u64* request_id, const u32* timeout) {
-    LOG_DEBUG(Lib_Zlib, "(STUBBED) called");
-    if (!task_thread.Joinable()) {
+    LOG_DEBUG(Lib_Zlib, "called");
+    if (!initialized) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
     if (!request_id) {
@@ -136,15 +176,15 @@ s32 PS4_SYSV_ABI sceZlibWaitForDone(u64* request_id, const u32* timeout) {
         } else {
             done_queue_cv.wait(lock, pred);
         }
-        *request_id = done_queue.back();
+        *request_id = done_queue.front();
         done_queue.pop();
     }
     return ORBIS_OK;
 }
 
 s32 PS4_SYSV_ABI sceZlibGetResult(const u64 request_id, u32* dst_length, s32* status) {
-    LOG_DEBUG(Lib_Zlib, "(STUBBED) called");
-    if (!task_thread.Joinable()) {
+    LOG_DEBUG(Lib_Zlib, "called");
+    if (!initialized) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
     if (!dst_length || !status) {
@@ -165,10 +205,13 @@ s32 PS4_SYSV_ABI sceZlibGetResult(const u64 request_id, u32* dst_length, s32* st
 
 s32 PS4_SYSV_ABI sceZlibFinalize() {
     LOG_INFO(Lib_Zlib, "called");
-    if (!task_thread.Joinable()) {
+    if (!initialized) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
-    task_thread.Stop();
+    for (u32 i = 0; i < num_workers; ++i) {
+        workers[i].Stop();
+    }
+    initialized = false;
     return ORBIS_OK;
 }
 
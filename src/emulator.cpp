@@ -130,6 +130,7 @@ void Emulator::Run(const std::filesystem::path& file, const std::vector<std::str
         LOG_INFO(Config, "General LogType: {}", Config::getLogType());
         LOG_INFO(Config, "General isNeo: {}", Config::isNeoModeConsole());
         LOG_INFO(Config, "GPU isNullGpu: {}", Config::nullGpu());
+        LOG_INFO(Config, "GPU headless: {}", Config::headless());
         LOG_INFO(Config, "GPU shouldDumpShaders: {}", Config::dumpShaders());
         LOG_INFO(Config, "GPU vblankDivider: {}", Config::vblankDiv());
         LOG_INFO(Config, "Vulkan gpuId: {}", Config::getGpuId());
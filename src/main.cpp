@@ -45,6 +45,11 @@ int main(int argc, char* argv[]) {
                           "  -f, --fullscreen <true|false> Specify window initial fullscreen "
                           "state. Does not overwrite the config file.\n"
                           "  --add-game-folder <folder>    Adds a new game folder to the config.\n"
+                          "  --headless                    Run without showing a window or "
+                          "creating a swapchain.\n"
+                          "  --null-gpu                    Parse GPU commands without executing "
+                          "draws and dispatches.\n"
+                          "  --frame-timings <file>        Write per-frame timings to a CSV file.\n"
                           "  -h, --help                    Display this help message\n";
              exit(0);
          }},
@@ -93,6 +98,16 @@ int main(int argc, char* argv[]) {
              Config::setIsFullscreen(is_fullscreen);
          }},
         {"--fullscreen", [&](int& i) { arg_map["-f"](i); }},
+        {"--headless", [&](int&) { Config::setHeadless(true); }},
+        {"--null-gpu", [&](int&) { Config::setNullGpu(true); }},
+        {"--frame-timings",
+         [&](int& i) {
+             if (++i >= argc) {
+                 std::cerr << "Error: Missing argument for --frame-timings\n";
+                 exit(1);
+             }
+             Config::setFrameTimingsPath(argv[i]);
+         }},
         {"--add-game-folder",
          [&](int& i) {
              if (++i >= argc) {
@@ -256,6 +256,10 @@ WindowSDL::WindowSDL(s32 width_, s32 height_, Input::GameController* controller_
     if (!SDL_SetHint(SDL_HINT_APP_NAME, "shadPS4")) {
         UNREACHABLE_MSG("Failed to set SDL window hint: {}", SDL_GetError());
     }
+    const bool is_headless = Config::headless();
+    if (is_headless && !SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen")) {
+        UNREACHABLE_MSG("Failed to set SDL video driver hint: {}", SDL_GetError());
+    }
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         UNREACHABLE_MSG("Failed to initialize SDL video subsystem: {}", SDL_GetError());
     }
@@ -268,7 +272,8 @@ WindowSDL::WindowSDL(s32 width_, s32 height_, Input::GameController* controller_
     SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_Y_NUMBER, SDL_WINDOWPOS_CENTERED);
     SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_WIDTH_NUMBER, width);
     SDL_SetNumberProperty(props, SDL_PROP_WINDOW_CREATE_HEIGHT_NUMBER, height);
-    SDL_SetNumberProperty(props, "flags", SDL_WINDOW_VULKAN);
+    // Headless runs render without a surface, the window only serves the event loop.
+    SDL_SetNumberProperty(props, "flags", is_headless ? SDL_WINDOW_HIDDEN : SDL_WINDOW_VULKAN);
     SDL_SetBooleanProperty(props, SDL_PROP_WINDOW_CREATE_RESIZABLE_BOOLEAN, true);
     window = SDL_CreateWindowWithProperties(props);
     SDL_DestroyProperties(props);
@@ -278,48 +283,52 @@ WindowSDL::WindowSDL(s32 width_, s32 height_, Input::GameController* controller_
 
     SDL_SetWindowMinimumSize(window, 640, 360);
 
-    bool error = false;
-    const SDL_DisplayID displayIndex = SDL_GetDisplayForWindow(window);
-    if (displayIndex < 0) {
-        LOG_ERROR(Frontend, "Error getting display index: {}", SDL_GetError());
-        error = true;
-    }
-    const SDL_DisplayMode* displayMode;
-    if ((displayMode = SDL_GetCurrentDisplayMode(displayIndex)) == 0) {
-        LOG_ERROR(Frontend, "Error getting display mode: {}", SDL_GetError());
-        error = true;
-    }
-    if (!error) {
-        SDL_SetWindowFullscreenMode(
-            window, Config::getFullscreenMode() == "Fullscreen" ? displayMode : NULL);
+    if (!is_headless) {
+        bool error = false;
+        const SDL_DisplayID displayIndex = SDL_GetDisplayForWindow(window);
+        if (displayIndex < 0) {
+            LOG_ERROR(Frontend, "Error getting display index: {}", SDL_GetError());
+            error = true;
+        }
+        const SDL_DisplayMode* displayMode;
+        if ((displayMode = SDL_GetCurrentDisplayMode(displayIndex)) == 0) {
+            LOG_ERROR(Frontend, "Error getting display mode: {}", SDL_GetError());
+            error = true;
+        }
+        if (!error) {
+            SDL_SetWindowFullscreenMode(
+                window, Config::getFullscreenMode() == "Fullscreen" ? displayMode : NULL);
+        }
+        SDL_SetWindowFullscreen(window, Config::getIsFullscreen());
     }
-    SDL_SetWindowFullscreen(window, Config::getIsFullscreen());
 
     SDL_InitSubSystem(SDL_INIT_GAMEPAD);
     controller->SetEngine(std::make_unique<Input::SDLInputEngine>());
 
+    if (!is_headless) {
 #if defined(SDL_PLATFORM_WIN32)
-    window_info.type = WindowSystemType::Windows;
-    window_info.render_surface = SDL_GetPointerProperty(SDL_GetWindowProperties(window),
-                                                        SDL_PROP_WINDOW_WIN32_HWND_POINTER, NULL);
-#elif defined(SDL_PLATFORM_LINUX)
-    if (SDL_strcmp(SDL_GetCurrentVideoDriver(), "x11") == 0) {
-        window_info.type = WindowSystemType::X11;
-        window_info.display_connection = SDL_GetPointerProperty(
-            SDL_GetWindowProperties(window), SDL_PROP_WINDOW_X11_DISPLAY_POINTER, NULL);
-        window_info.render_surface = (void*)SDL_GetNumberProperty(
-            SDL_GetWindowProperties(window), SDL_PROP_WINDOW_X11_WINDOW_NUMBER, 0);
-    } else if (SDL_strcmp(SDL_GetCurrentVideoDriver(), "wayland") == 0) {
-        window_info.type = WindowSystemType::Wayland;
-        window_info.display_connection = SDL_GetPointerProperty(
-            SDL_GetWindowProperties(window), SDL_PROP_WINDOW_WAYLAND_DISPLAY_POINTER, NULL);
+        window_info.type = WindowSystemType::Windows;
         window_info.render_surface = SDL_GetPointerProperty(
-            SDL_GetWindowProperties(window), SDL_PROP_WINDOW_WAYLAND_SURFACE_POINTER, NULL);
-    }
+            SDL_GetWindowProperties(window), SDL_PROP_WINDOW_WIN32_HWND_POINTER, NULL);
+#elif defined(SDL_PLATFORM_LINUX)
+        if (SDL_strcmp(SDL_GetCurrentVideoDriver(), "x11") == 0) {
+            window_info.type = WindowSystemType::X11;
+            window_info.display_connection = SDL_GetPointerProperty(
+                SDL_GetWindowProperties(window), SDL_PROP_WINDOW_X11_DISPLAY_POINTER, NULL);
+            window_info.render_surface = (void*)SDL_GetNumberProperty(
+                SDL_GetWindowProperties(window), SDL_PROP_WINDOW_X11_WINDOW_NUMBER, 0);
+        } else if (SDL_strcmp(SDL_GetCurrentVideoDriver(), "wayland") == 0) {
+            window_info.type = WindowSystemType::Wayland;
+            window_info.display_connection = SDL_GetPointerProperty(
+                SDL_GetWindowProperties(window), SDL_PROP_WINDOW_WAYLAND_DISPLAY_POINTER, NULL);
+            window_info.render_surface = SDL_GetPointerProperty(
+                SDL_GetWindowProperties(window), SDL_PROP_WINDOW_WAYLAND_SURFACE_POINTER, NULL);
+        }
 #elif defined(SDL_PLATFORM_MACOS)
-    window_info.type = WindowSystemType::Metal;
-    window_info.render_surface = SDL_Metal_GetLayer(SDL_Metal_CreateView(window));
+        window_info.type = WindowSystemType::Metal;
+        window_info.render_surface = SDL_Metal_GetLayer(SDL_Metal_CreateView(window));
 #endif
+    }
     // input handler init-s
     Input::ControllerOutput::SetControllerOutputController(controller);
     Input::ControllerOutput::LinkJoystickAxes();
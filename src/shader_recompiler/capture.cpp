@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <bit>
+#include <type_traits>
+#include "common/io_file.h"
+#include "common/logging/log.h"
+#include "shader_recompiler/capture.h"
+
+namespace Shader {
+
+static_assert(std::is_trivially_copyable_v<ShaderCapture>);
+
+namespace {
+
+constexpr u32 CaptureMagic = 0x50414353; // SCAP
+constexpr u32 CaptureVersion = 1;
+
+struct CaptureHeader {
+    u32 magic = CaptureMagic;
+    u32 version = CaptureVersion;
+    u32 capture_size = sizeof(ShaderCapture);
+    u32 runtime_info_size = sizeof(RuntimeInfo);
+};
+
+} // Anonymous namespace
+
+void WriteShaderCapture(const std::filesystem::path& path, const ShaderCapture& capture) {
+    using namespace Common::FS;
+    const auto file = IOFile{path, FileAccessMode::Write};
+    if (!file.WriteObject(CaptureHeader{}) || !file.WriteObject(capture)) {
+        LOG_ERROR(Render_Recompiler, "Failed to write shader capture {}", path.string());
+    }
+}
+
+std::optional<ShaderCapture> ReadShaderCapture(const std::filesystem::path& path) {
+    using namespace Common::FS;
+    const auto file = IOFile{path, FileAccessMode::Read};
+    CaptureHeader header{};
+    if (!file.ReadObject(header) || header.magic != CaptureMagic) {
+        LOG_ERROR(Render_Recompiler, "{} is not a shader capture", path.string());
+        return std::nullopt;
+    }
+    const CaptureHeader expected{};
+    if (header.version != expected.version || header.capture_size != expected.capture_size ||
+        header.runtime_info_size != expected.runtime_info_size) {
+        LOG_ERROR(Render_Recompiler, "Shader capture {} was written by a different build",
+                  path.string());
+        return std::nullopt;
+    }
+    // RuntimeInfo is not default constructible, read the raw bytes and reinterpret them.
+    std::array<u8, sizeof(ShaderCapture)> bytes;
+    if (!file.ReadObject(bytes)) {
+        LOG_ERROR(Render_Recompiler, "Shader capture {} is truncated", path.string());
+        return std::nullopt;
+    }
+    return std::bit_cast<ShaderCapture>(bytes);
+}
+
+} // namespace Shader
@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <optional>
+#include "shader_recompiler/backend/bindings.h"
+#include "shader_recompiler/params.h"
+#include "shader_recompiler/profile.h"
+#include "shader_recompiler/runtime_info.h"
+
+namespace Shader {
+
+/// Inputs needed to translate a dumped shader again outside of the emulator. Captures are written
+/// next to the dumped binaries and are only valid for the build that produced them.
+struct ShaderCapture {
+    Stage stage;
+    LogicalStage l_stage;
+    u64 hash;
+    std::array<u32, ShaderParams::NumShaderUserData> user_data;
+    RuntimeInfo runtime_info;
+    Profile profile;
+    Backend::Bindings binding;
+    /// Translation dereferenced guest memory (fetch shader, SRT, tessellation constants or the
+    /// geometry copy shader), so the shader cannot be replayed from the capture alone.
+    bool reads_guest_memory;
+};
+
+void WriteShaderCapture(const std::filesystem::path& path, const ShaderCapture& capture);
+
+[[nodiscard]] std::optional<ShaderCapture> ReadShaderCapture(const std::filesystem::path& path);
+
+} // namespace Shader
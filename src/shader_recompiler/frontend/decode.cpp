@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <algorithm>
+#include <array>
 #include "common/assert.h"
 #include "shader_recompiler/frontend/decode.h"
 
@@ -16,7 +17,11 @@ T extract(T value, u32 lst, u32 fst) {
 }
 } // namespace bit
 
-InstEncoding GetInstructionEncoding(u32 token) {
+/// Encodings are fully identified by at most the top 9 bits of the first instruction token.
+constexpr u32 EncodingTableShift = 23;
+constexpr u32 EncodingTableSize = 1U << (32 - EncodingTableShift);
+
+constexpr InstEncoding EncodingFromToken(u32 token) {
     auto encoding = static_cast<InstEncoding>(token & (u32)EncodingMask::MASK_9bit);
     switch (encoding) {
     case InstEncoding::SOP1:
@@ -82,10 +87,77 @@ InstEncoding GetInstructionEncoding(u32 token) {
         break;
     }
 
-    UNREACHABLE();
     return InstEncoding::ILLEGAL;
 }
 
+constexpr u32 EncodingLength(InstEncoding encoding) {
+    switch (encoding) {
+    case InstEncoding::SOP1:
+    case InstEncoding::SOPP:
+    case InstEncoding::SOPC:
+    case InstEncoding::SOPK:
+    case InstEncoding::SOP2:
+    case InstEncoding::VOP1:
+    case InstEncoding::VOPC:
+    case InstEncoding::VOP2:
+    case InstEncoding::SMRD:
+    case InstEncoding::VINTRP:
+        return sizeof(u32);
+    case InstEncoding::VOP3:
+    case InstEncoding::MUBUF:
+    case InstEncoding::MTBUF:
+    case InstEncoding::MIMG:
+    case InstEncoding::DS:
+    case InstEncoding::EXP:
+        return sizeof(u64);
+    default:
+        return 0;
+    }
+}
+
+struct EncodingInfo {
+    InstEncoding encoding = InstEncoding::ILLEGAL;
+    u32 length = 0;
+};
+
+/// Encoding and length for every value of the high token bits, built from the mask cascade
+/// above so decoding an instruction is a single indexed load.
+constexpr auto EncodingTable = [] {
+    std::array<EncodingInfo, EncodingTableSize> table{};
+    for (u32 i = 0; i < EncodingTableSize; ++i) {
+        const InstEncoding encoding = EncodingFromToken(i << EncodingTableShift);
+        table[i] = {encoding, EncodingLength(encoding)};
+    }
+    return table;
+}();
+
+constexpr const EncodingInfo& LookupEncoding(u32 token) {
+    return EncodingTable[token >> EncodingTableShift];
+}
+
+// Every encoding must map back to itself through the table, whatever its low bits hold.
+static_assert([] {
+    constexpr std::array encodings = {
+        InstEncoding::SOP1, InstEncoding::SOPP,   InstEncoding::SOPC,  InstEncoding::VOP1,
+        InstEncoding::VOPC, InstEncoding::VOP3,   InstEncoding::EXP,   InstEncoding::VINTRP,
+        InstEncoding::DS,   InstEncoding::MUBUF,  InstEncoding::MTBUF, InstEncoding::MIMG,
+        InstEncoding::SMRD, InstEncoding::SOPK,   InstEncoding::SOP2,  InstEncoding::VOP2,
+    };
+    for (const InstEncoding encoding : encodings) {
+        for (const u32 low : {0U, 0x7FFFFFU, 0x123456U}) {
+            const auto& info = LookupEncoding(u32(encoding) | low);
+            if (info.encoding != encoding || info.length == 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}());
+
+InstEncoding GetInstructionEncoding(u32 token) {
+    return LookupEncoding(token).encoding;
+}
+
 bool HasAdditionalLiteral(InstEncoding encoding, Opcode opcode) {
     switch (encoding) {
     case InstEncoding::SOPK: {
@@ -110,9 +182,8 @@ bool IsVop3BEncoding(Opcode opcode) {
 GcnInst GcnDecodeContext::decodeInstruction(GcnCodeSlice& code) {
     const uint32_t token = code.at(0);
 
-    InstEncoding encoding = GetInstructionEncoding(token);
-    ASSERT_MSG(encoding != InstEncoding::ILLEGAL, "illegal encoding");
-    uint32_t encodingLen = getEncodingLength(encoding);
+    const auto [encoding, encodingLen] = LookupEncoding(token);
+    ASSERT_MSG(encoding != InstEncoding::ILLEGAL, "illegal encoding 0x{:08x}", token);
 
     // Clear the instruction
     m_instruction = GcnInst();
@@ -138,34 +209,7 @@ GcnInst GcnDecodeContext::decodeInstruction(GcnCodeSlice& code) {
 }
 
 uint32_t GcnDecodeContext::getEncodingLength(InstEncoding encoding) {
-    uint32_t instLength = 0;
-
-    switch (encoding) {
-    case InstEncoding::SOP1:
-    case InstEncoding::SOPP:
-    case InstEncoding::SOPC:
-    case InstEncoding::SOPK:
-    case InstEncoding::SOP2:
-    case InstEncoding::VOP1:
-    case InstEncoding::VOPC:
-    case InstEncoding::VOP2:
-    case InstEncoding::SMRD:
-    case InstEncoding::VINTRP:
-        instLength = sizeof(uint32_t);
-        break;
-
-    case InstEncoding::VOP3:
-    case InstEncoding::MUBUF:
-    case InstEncoding::MTBUF:
-    case InstEncoding::MIMG:
-    case InstEncoding::DS:
-    case InstEncoding::EXP:
-        instLength = sizeof(uint64_t);
-        break;
-    default:
-        break;
-    }
-    return instLength;
+    return EncodingLength(encoding);
 }
 
 uint32_t GcnDecodeContext::getOpMapOffset(InstEncoding encoding) {
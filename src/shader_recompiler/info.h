@@ -253,9 +253,9 @@ struct Info {
         flattened_ud_buf.resize(srt_info.flattened_bufsize_dw);
         ASSERT(user_data.size() <= NumUserDataRegs);
         std::memcpy(flattened_ud_buf.data(), user_data.data(), user_data.size_bytes());
-        // Run the JIT program to walk the SRT and write the leaves to a flat buffer
-        if (srt_info.walker_func) {
-            srt_info.walker_func(user_data.data(), flattened_ud_buf.data());
+        // Run the walker program to walk the SRT and write the leaves to a flat buffer
+        if (srt_info.walker) {
+            srt_info.walker->Run(user_data.data(), flattened_ud_buf.data());
         }
     }
 
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: Copyright 2021 yuzu Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <array>
 #include <bit>
 #include <optional>
 #include <type_traits>
@@ -542,14 +543,33 @@ void ConstantPropagation(IR::Block& block, IR::Inst& inst) {
     }
 }
 
-void ConstantPropagationPass(IR::BlockList& program) {
+bool ConstantPropagationPass(IR::BlockList& program) {
+    // Folding either rewrites the arguments of an instruction or turns it into an identity, so
+    // comparing each instruction before and after is enough to tell if anything was folded.
+    // Phi arguments are never rewritten in place, only the opcode needs checking for them.
+    bool changed = false;
+    std::array<IR::Value, 6> args;
     const auto end{program.rend()};
     for (auto it = program.rbegin(); it != end; ++it) {
         IR::Block* const block{*it};
         for (IR::Inst& inst : block->Instructions()) {
+            if (changed) {
+                ConstantPropagation(*block, inst);
+                continue;
+            }
+            const IR::Opcode opcode = inst.GetOpcode();
+            const size_t num_args = opcode == IR::Opcode::Phi ? 0 : inst.NumArgs();
+            for (size_t i = 0; i < num_args; ++i) {
+                args[i] = inst.Arg(i);
+            }
             ConstantPropagation(*block, inst);
+            changed = inst.GetOpcode() != opcode;
+            for (size_t i = 0; i < num_args && !changed; ++i) {
+                changed = inst.Arg(i) != args[i];
+            }
         }
     }
+    return changed;
 }
 
 } // namespace Shader::Optimization
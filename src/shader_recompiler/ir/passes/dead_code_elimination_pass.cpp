@@ -5,7 +5,8 @@
 
 namespace Shader::Optimization {
 
-void DeadCodeEliminationPass(IR::Program& program) {
+bool DeadCodeEliminationPass(IR::Program& program) {
+    bool changed = false;
     // We iterate over the instructions in reverse order.
     // This is because removing an instruction reduces the number of uses for earlier instructions.
     for (IR::Block* const block : program.post_order_blocks) {
@@ -15,9 +16,11 @@ void DeadCodeEliminationPass(IR::Program& program) {
             if (!it->HasUses() && !it->MayHaveSideEffects()) {
                 it->Invalidate();
                 it = block->Instructions().erase(it);
+                changed = true;
             }
         }
     }
+    return changed;
 }
 
 } // namespace Shader::Optimization
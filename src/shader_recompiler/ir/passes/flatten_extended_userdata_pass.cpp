@@ -4,8 +4,7 @@
 
 #include <unordered_map>
 #include <boost/container/flat_map.hpp>
-#include <xbyak/xbyak.h>
-#include <xbyak/xbyak_util.h>
+#include <magic_enum/magic_enum.hpp>
 #include "common/config.h"
 #include "common/io_file.h"
 #include "common/logging/log.h"
@@ -21,14 +20,9 @@
 #include "src/common/arch.h"
 #include "src/common/decoder.h"
 
-using namespace Xbyak::util;
-
-static Xbyak::CodeGenerator g_srt_codegen(32_MB);
-
 namespace {
 
-static void DumpSrtProgram(const Shader::Info& info, const u8* code, size_t codesize) {
-#ifdef ARCH_X86_64
+static void DumpSrtProgram(const Shader::Info& info, const Shader::SrtWalker& walker) {
     using namespace Common::FS;
 
     const auto dump_dir = GetUserPath(PathType::ShaderDir) / "dumps";
@@ -38,11 +32,19 @@ static void DumpSrtProgram(const Shader::Info& info, const u8* code, size_t code
     const auto filename = fmt::format("{}_{:#018x}.srtprogram.txt", info.stage, info.pgm_hash);
     const auto file = IOFile{dump_dir / filename, FileAccessMode::Write, FileType::TextFile};
 
-    u64 address = reinterpret_cast<u64>(code);
-    u64 code_end = address + codesize;
+    const auto code = walker.Code();
+    if (code.empty()) {
+        for (const auto& op : walker.Ops()) {
+            file.WriteString(fmt::format("{} src={} dst={}\n", magic_enum::enum_name(op.type),
+                                         op.src_off_dw, op.dst_off_dw));
+        }
+        return;
+    }
+#ifdef ARCH_X86_64
+    u64 address = reinterpret_cast<u64>(code.data());
+    u64 code_end = address + code.size();
     ZydisDecodedInstruction instruction;
     ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
-    ZyanStatus status = ZYAN_STATUS_SUCCESS;
     while (address < code_end && ZYAN_SUCCESS(Common::Decoder::Instance()->decodeInstruction(
                                      instruction, operands, reinterpret_cast<void*>(address)))) {
         std::string s =
@@ -94,20 +96,9 @@ namespace Shader::Optimization {
 
 namespace {
 
-static inline void PushPtr(Xbyak::CodeGenerator& c, u32 off_dw) {
-    c.push(rdi);
-    c.mov(rdi, ptr[rdi + (off_dw << 2)]);
-    c.mov(r10, 0xFFFFFFFFFFFFULL);
-    c.and_(rdi, r10);
-}
-
-static inline void PopPtr(Xbyak::CodeGenerator& c) {
-    c.pop(rdi);
-};
-
 static void VisitPointer(u32 off_dw, IR::Inst* subtree, PassInfo& pass_info,
-                         Xbyak::CodeGenerator& c) {
-    PushPtr(c, off_dw);
+                         std::vector<SrtOp>& ops) {
+    ops.push_back({SrtOp::Type::PushPtr, off_dw, 0});
     PassInfo::PtrUserList* use_list = pass_info.GetUsesAsPointer(subtree);
     ASSERT(use_list);
 
@@ -117,8 +108,7 @@ static void VisitPointer(u32 off_dw, IR::Inst* subtree, PassInfo& pass_info,
     // TODO src and dst are contiguous. Optimize with wider loads/stores
     // TODO if this subtree is dynamically indexed, don't compact it (keep it sparse)
     for (auto [src_off_dw, use] : *use_list) {
-        c.mov(r10d, ptr[rdi + (src_off_dw << 2)]);
-        c.mov(ptr[rsi + (pass_info.dst_off_dw << 2)], r10d);
+        ops.push_back({SrtOp::Type::Copy, src_off_dw, pass_info.dst_off_dw});
 
         use->SetFlags<u32>(pass_info.dst_off_dw);
         pass_info.dst_off_dw++;
@@ -127,56 +117,47 @@ static void VisitPointer(u32 off_dw, IR::Inst* subtree, PassInfo& pass_info,
     // Then visit any children used as pointers
     for (const auto [src_off_dw, use] : *use_list) {
         if (pass_info.GetUsesAsPointer(use)) {
-            VisitPointer(src_off_dw, use, pass_info, c);
+            VisitPointer(src_off_dw, use, pass_info, ops);
         }
     }
 
-    PopPtr(c);
+    ops.push_back({SrtOp::Type::PopPtr, 0, 0});
 }
 
 static void GenerateSrtProgram(Info& info, PassInfo& pass_info) {
-    Xbyak::CodeGenerator& c = g_srt_codegen;
-
     if (info.srt_info.srt_reservations.empty() && pass_info.srt_roots.empty()) {
         return;
     }
 
-    info.srt_info.walker_func = c.getCurr<PFN_SrtWalker>();
-
+    std::vector<SrtOp> ops;
     pass_info.dst_off_dw = NumUserDataRegs;
 
     // Special case for V# step rate buffers in fetch shader
     for (const auto [sgpr_base, dword_offset, num_dwords] : info.srt_info.srt_reservations) {
         // get pointer to V#
         if (sgpr_base != IR::NumScalarRegs) {
-            PushPtr(c, sgpr_base);
+            ops.push_back({SrtOp::Type::PushPtr, sgpr_base, 0});
         }
-        u32 src_off = dword_offset << 2;
-
-        for (auto j = 0; j < num_dwords; j++) {
-            c.mov(r11d, ptr[rdi + src_off]);
-            c.mov(ptr[rsi + (pass_info.dst_off_dw << 2)], r11d);
-
-            src_off += 4;
+        for (u32 j = 0; j < num_dwords; j++) {
+            ops.push_back({SrtOp::Type::Copy, dword_offset + j, pass_info.dst_off_dw});
             ++pass_info.dst_off_dw;
         }
         if (sgpr_base != IR::NumScalarRegs) {
-            PopPtr(c);
+            ops.push_back({SrtOp::Type::PopPtr, 0, 0});
         }
     }
 
     ASSERT(pass_info.dst_off_dw == info.srt_info.flattened_bufsize_dw);
 
     for (const auto& [sgpr_base, root] : pass_info.srt_roots) {
-        VisitPointer(static_cast<u32>(sgpr_base), root, pass_info, c);
+        VisitPointer(static_cast<u32>(sgpr_base), root, pass_info, ops);
     }
 
-    c.ret();
-    c.ready();
+    // Identical programs share a walker, the JIT code is freed with its last user.
+    info.srt_info.walker = SrtWalker::Get(std::move(ops));
 
     if (Config::dumpShaders()) {
-        size_t codesize = c.getCurr() - reinterpret_cast<const u8*>(info.srt_info.walker_func);
-        DumpSrtProgram(info, reinterpret_cast<const u8*>(info.srt_info.walker_func), codesize);
+        DumpSrtProgram(info, *info.srt_info.walker);
     }
 
     info.srt_info.flattened_bufsize_dw = pass_info.dst_off_dw;
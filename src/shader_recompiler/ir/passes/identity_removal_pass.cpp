@@ -6,8 +6,9 @@
 
 namespace Shader::Optimization {
 
-void IdentityRemovalPass(IR::BlockList& program) {
+bool IdentityRemovalPass(IR::BlockList& program) {
     std::vector<IR::Inst*> to_invalidate;
+    bool changed = false;
     for (IR::Block* const block : program) {
         for (auto inst = block->begin(); inst != block->end();) {
             const size_t num_args{inst->NumArgs()};
@@ -15,6 +16,7 @@ void IdentityRemovalPass(IR::BlockList& program) {
                 IR::Value arg;
                 while ((arg = inst->Arg(i)).IsIdentity()) {
                     inst->SetArg(i, arg.Inst()->Arg(0));
+                    changed = true;
                 }
             }
             if (inst->GetOpcode() == IR::Opcode::Identity ||
@@ -29,6 +31,7 @@ void IdentityRemovalPass(IR::BlockList& program) {
     for (IR::Inst* const inst : to_invalidate) {
         inst->Invalidate();
     }
+    return changed || !to_invalidate.empty();
 }
 
 } // namespace Shader::Optimization
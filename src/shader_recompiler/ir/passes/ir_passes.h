@@ -13,9 +13,9 @@ struct Profile;
 namespace Shader::Optimization {
 
 void SsaRewritePass(IR::BlockList& program);
-void IdentityRemovalPass(IR::BlockList& program);
-void DeadCodeEliminationPass(IR::Program& program);
-void ConstantPropagationPass(IR::BlockList& program);
+bool IdentityRemovalPass(IR::BlockList& program);
+bool DeadCodeEliminationPass(IR::Program& program);
+bool ConstantPropagationPass(IR::BlockList& program);
 void FlattenExtendedUserdataPass(IR::Program& program);
 void ResourceTrackingPass(IR::Program& program);
 void CollectShaderInfoPass(IR::Program& program);
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <fmt/format.h>
+#include "common/logging/log.h"
+#include "shader_recompiler/ir/passes/ir_passes.h"
+#include "shader_recompiler/ir/passes/pass_manager.h"
+
+namespace Shader::Optimization {
+
+// Constant propagation converges in one or two sweeps in practice, this only guards against
+// folds that keep rewriting each other.
+constexpr u32 MaxSimplifyIterations = 8;
+
+PassManager::PassManager(IR::Program& program)
+    : program{program}, start_time{std::chrono::steady_clock::now()} {}
+
+void PassManager::Simplify() {
+    if (!dirty) {
+        return;
+    }
+    for (u32 i = 0; i < MaxSimplifyIterations; ++i) {
+        if (!Run("ConstantPropagation",
+                 [this] { return ConstantPropagationPass(program.post_order_blocks); })) {
+            dirty = false;
+            return;
+        }
+    }
+    LOG_WARNING(Render_Recompiler, "Constant propagation did not converge after {} iterations",
+                MaxSimplifyIterations);
+}
+
+size_t PassManager::CountInstructions() const {
+    size_t count = 0;
+    for (const IR::Block* const block : program.blocks) {
+        count += block->Instructions().size();
+    }
+    return count;
+}
+
+void PassManager::Record(std::string_view name, bool changed, std::chrono::nanoseconds time,
+                         size_t num_insts_before) {
+    auto& stats = program.pass_stats;
+    auto it = std::ranges::find(stats, name, &IR::PassStats::name);
+    if (it == stats.end()) {
+        it = stats.insert(it, IR::PassStats{.name = name});
+    }
+    ++it->runs;
+    it->changed_runs += changed ? 1 : 0;
+    it->time += time;
+    it->inst_delta += static_cast<s64>(CountInstructions()) - static_cast<s64>(num_insts_before);
+}
+
+void PassManager::Report() const {
+    using namespace std::chrono;
+    const auto total = duration_cast<microseconds>(steady_clock::now() - start_time);
+    std::string summary;
+    for (const auto& stats : program.pass_stats) {
+        fmt::format_to(std::back_inserter(summary),
+                       "\n  {}: {} runs ({} changed), {} us, {:+} insts", stats.name, stats.runs,
+                       stats.changed_runs, duration_cast<microseconds>(stats.time).count(),
+                       stats.inst_delta);
+    }
+    LOG_DEBUG(Render_Recompiler, "Optimized {} shader in {} us, {} insts:{}",
+              program.info.stage, total.count(), CountInstructions(), summary);
+}
+
+} // namespace Shader::Optimization
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <string_view>
+#include <type_traits>
+#include "shader_recompiler/ir/program.h"
+
+namespace Shader::Optimization {
+
+/// Runs optimization passes over a program, recording time and instruction count deltas per pass
+/// into the program's pass statistics. Passes returning bool report whether they modified the IR,
+/// passes returning void are assumed to always modify it.
+class PassManager {
+public:
+    explicit PassManager(IR::Program& program);
+
+    template <typename Pass>
+    bool Run(std::string_view name, Pass&& pass) {
+        const size_t num_insts = CountInstructions();
+        const auto start = std::chrono::steady_clock::now();
+        bool changed = true;
+        if constexpr (std::is_void_v<std::invoke_result_t<Pass>>) {
+            pass();
+        } else {
+            changed = pass();
+        }
+        Record(name, changed, std::chrono::steady_clock::now() - start, num_insts);
+        dirty |= changed;
+        return changed;
+    }
+
+    /// Runs constant propagation until it stops folding. Skipped entirely when no pass has
+    /// modified the IR since the last time it converged.
+    void Simplify();
+
+    /// Logs the collected statistics to the recompiler debug log.
+    void Report() const;
+
+private:
+    size_t CountInstructions() const;
+    void Record(std::string_view name, bool changed, std::chrono::nanoseconds time,
+                size_t num_insts_before);
+
+    IR::Program& program;
+    bool dirty{true};
+    std::chrono::steady_clock::time_point start_time;
+};
+
+} // namespace Shader::Optimization
@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <xbyak/xbyak.h>
+#include <xbyak/xbyak_util.h>
+#include <xxhash.h>
+#include "common/assert.h"
+#include "shader_recompiler/ir/passes/srt.h"
+
+namespace Shader {
+
+using namespace Xbyak::util;
+
+constexpr u64 PointerMask = 0xFFFFFFFFFFFFULL;
+
+// Upper bound of the bytes emitted per op, the largest is PushPtr at 21 bytes.
+constexpr size_t MaxBytesPerOp = 32;
+
+namespace {
+
+struct WalkerCache {
+    std::mutex mutex;
+    std::unordered_multimap<u64, std::weak_ptr<const SrtWalker>> walkers;
+    size_t inserts_since_sweep{};
+
+    static constexpr size_t SweepInterval = 256;
+
+    void SweepExpired() {
+        std::erase_if(walkers, [](const auto& entry) { return entry.second.expired(); });
+        inserts_since_sweep = 0;
+    }
+};
+
+WalkerCache& GetWalkerCache() {
+    static WalkerCache cache;
+    return cache;
+}
+
+} // Anonymous namespace
+
+SrtWalker::SrtWalker(std::vector<SrtOp> ops_) : ops{std::move(ops_)} {
+    if (ops.size() > MaxInterpretedOps) {
+        Compile();
+    }
+}
+
+SrtWalker::~SrtWalker() = default;
+
+std::shared_ptr<const SrtWalker> SrtWalker::Get(std::vector<SrtOp> ops) {
+    const u64 hash = XXH3_64bits(ops.data(), ops.size() * sizeof(SrtOp));
+    auto& cache = GetWalkerCache();
+    std::scoped_lock lk{cache.mutex};
+    const auto [begin, end] = cache.walkers.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+        if (auto walker = it->second.lock(); walker && std::ranges::equal(walker->ops, ops)) {
+            return walker;
+        }
+    }
+    auto walker = std::make_shared<const SrtWalker>(std::move(ops));
+    cache.walkers.emplace(hash, walker);
+    if (++cache.inserts_since_sweep >= WalkerCache::SweepInterval) {
+        cache.SweepExpired();
+    }
+    return walker;
+}
+
+void SrtWalker::Interpret(const u32* user_data, u32* flat_dst) const {
+    boost::container::small_vector<const u32*, 4> saved;
+    const u32* table = user_data;
+    for (const SrtOp& op : ops) {
+        switch (op.type) {
+        case SrtOp::Type::PushPtr: {
+            u64 address;
+            std::memcpy(&address, table + op.src_off_dw, sizeof(address));
+            saved.push_back(table);
+            table = reinterpret_cast<const u32*>(address & PointerMask);
+            break;
+        }
+        case SrtOp::Type::PopPtr:
+            table = saved.back();
+            saved.pop_back();
+            break;
+        case SrtOp::Type::Copy:
+            flat_dst[op.dst_off_dw] = table[op.src_off_dw];
+            break;
+        }
+    }
+}
+
+std::span<const u8> SrtWalker::Code() const noexcept {
+    if (!code) {
+        return {};
+    }
+    return {code->getCode(), code->getSize()};
+}
+
+void SrtWalker::Compile() {
+    code = std::make_unique<Xbyak::CodeGenerator>(ops.size() * MaxBytesPerOp + 16);
+    Xbyak::CodeGenerator& c = *code;
+    for (const SrtOp& op : ops) {
+        switch (op.type) {
+        case SrtOp::Type::PushPtr:
+            c.push(rdi);
+            c.mov(rdi, ptr[rdi + (op.src_off_dw << 2)]);
+            c.mov(r10, PointerMask);
+            c.and_(rdi, r10);
+            break;
+        case SrtOp::Type::PopPtr:
+            c.pop(rdi);
+            break;
+        case SrtOp::Type::Copy:
+            c.mov(r10d, ptr[rdi + (op.src_off_dw << 2)]);
+            c.mov(ptr[rsi + (op.dst_off_dw << 2)], r10d);
+            break;
+        }
+    }
+    c.ret();
+    c.ready();
+    func = c.getCode<PFN_SrtWalker>();
+}
+
+} // namespace Shader
@@ -3,14 +3,76 @@
 
 #pragma once
 
+#include <memory>
+#include <span>
+#include <vector>
 #include <boost/container/set.hpp>
 #include <boost/container/small_vector.hpp>
 #include "common/types.h"
 
+namespace Xbyak {
+class CodeGenerator;
+}
+
 namespace Shader {
 
 using PFN_SrtWalker = void PS4_SYSV_ABI (*)(const u32* /*user_data*/, u32* /*flat_dst*/);
 
+/// One step of walking a shader resource table. Offsets are relative to the current table, which
+/// starts as the user data registers and changes when a pointer is followed.
+struct SrtOp {
+    enum class Type : u32 {
+        PushPtr, ///< Follow the pointer at src_off_dw, saving the current table.
+        PopPtr,  ///< Return to the saved table.
+        Copy,    ///< Copy the dword at src_off_dw to dst_off_dw of the flat buffer.
+    };
+
+    Type type;
+    u32 src_off_dw;
+    u32 dst_off_dw;
+
+    bool operator==(const SrtOp&) const = default;
+};
+
+/// Copies the sharps a shader reads through its SRT into a flat buffer. Walkers are shared
+/// between shaders with identical programs. Small programs are interpreted, larger ones are JIT
+/// compiled and their code is freed once the last shader using them is destroyed.
+class SrtWalker {
+public:
+    static constexpr size_t MaxInterpretedOps = 16;
+
+    explicit SrtWalker(std::vector<SrtOp> ops);
+    ~SrtWalker();
+
+    /// Returns a walker for the program, reusing a live one when an identical program exists.
+    [[nodiscard]] static std::shared_ptr<const SrtWalker> Get(std::vector<SrtOp> ops);
+
+    void Run(const u32* user_data, u32* flat_dst) const {
+        if (func) {
+            func(user_data, flat_dst);
+        } else {
+            Interpret(user_data, flat_dst);
+        }
+    }
+
+    /// Reference implementation of the program, also used for small programs.
+    void Interpret(const u32* user_data, u32* flat_dst) const;
+
+    [[nodiscard]] std::span<const SrtOp> Ops() const noexcept {
+        return ops;
+    }
+
+    /// Generated machine code, empty when the program is interpreted.
+    [[nodiscard]] std::span<const u8> Code() const noexcept;
+
+private:
+    void Compile();
+
+    std::vector<SrtOp> ops;
+    std::unique_ptr<Xbyak::CodeGenerator> code;
+    PFN_SrtWalker func{};
+};
+
 struct PersistentSrtInfo {
     // Special case when fetch shader uses step rates.
     struct SrtSharpReservation {
@@ -19,7 +81,7 @@ struct PersistentSrtInfo {
         u32 num_dwords;
     };
 
-    PFN_SrtWalker walker_func{};
+    std::shared_ptr<const SrtWalker> walker;
     boost::container::small_vector<SrtSharpReservation, 2> srt_reservations;
     u32 flattened_bufsize_dw = 16; // NumUserDataRegs
 
@@ -34,4 +96,4 @@ struct PersistentSrtInfo {
     }
 };
 
-} // namespace Shader
\ No newline at end of file
+} // namespace Shader
@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "shader_recompiler/frontend/instruction.h"
 #include "shader_recompiler/info.h"
 #include "shader_recompiler/ir/abstract_syntax_list.h"
@@ -11,6 +14,23 @@
 
 namespace Shader::IR {
 
+/// Statistics gathered for one optimization pass over the whole pipeline.
+struct PassStats {
+    std::string_view name;
+    u32 runs{};
+    u32 changed_runs{};
+    std::chrono::nanoseconds time{};
+    s64 inst_delta{};
+};
+
+/// Wall time spent in each phase of translating a program.
+struct PhaseTimes {
+    std::chrono::nanoseconds decode{};
+    std::chrono::nanoseconds cfg{};
+    std::chrono::nanoseconds structurize{};
+    std::chrono::nanoseconds passes{};
+};
+
 struct Program {
     explicit Program(Info& info_) : info{info_} {}
 
@@ -18,6 +38,8 @@ struct Program {
     BlockList blocks;
     BlockList post_order_blocks;
     std::vector<Gcn::GcnInst> ins_list;
+    std::vector<PassStats> pass_stats;
+    PhaseTimes times;
     Info& info;
 };
 
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <chrono>
 #include "common/config.h"
 #include "common/io_file.h"
 #include "common/path_util.h"
@@ -8,6 +9,7 @@
 #include "shader_recompiler/frontend/decode.h"
 #include "shader_recompiler/frontend/structured_control_flow.h"
 #include "shader_recompiler/ir/passes/ir_passes.h"
+#include "shader_recompiler/ir/passes/pass_manager.h"
 #include "shader_recompiler/ir/post_order.h"
 #include "shader_recompiler/recompiler.h"
 
@@ -39,6 +41,14 @@ IR::Program TranslateProgram(std::span<const u32> code, Pools& pools, Info& info
         LOG_WARNING(Render_Recompiler, "First instruction is not s_mov_b32 vcc_hi, #imm");
     }
 
+    using Clock = std::chrono::steady_clock;
+    auto phase_start = Clock::now();
+    const auto end_phase = [&phase_start](std::chrono::nanoseconds& time) {
+        const auto now = Clock::now();
+        time = now - phase_start;
+        phase_start = now;
+    };
+
     Gcn::GcnCodeSlice slice(code.data(), code.data() + code.size());
     Gcn::GcnDecodeContext decoder;
 
@@ -48,6 +58,7 @@ IR::Program TranslateProgram(std::span<const u32> code, Pools& pools, Info& info
     while (!slice.atEnd()) {
         program.ins_list.emplace_back(decoder.decodeInstruction(slice));
     }
+    end_phase(program.times.decode);
 
     // Clear any previous pooled data.
     pools.ReleaseContents();
@@ -55,43 +66,54 @@ IR::Program TranslateProgram(std::span<const u32> code, Pools& pools, Info& info
     // Create control flow graph
     Common::ObjectPool<Gcn::Block> gcn_block_pool{64};
     Gcn::CFG cfg{gcn_block_pool, program.ins_list};
+    end_phase(program.times.cfg);
 
     // Structurize control flow graph and create program.
     program.syntax_list = Shader::Gcn::BuildASL(pools.inst_pool, pools.block_pool, cfg,
                                                 program.info, runtime_info, profile);
     program.blocks = GenerateBlocks(program.syntax_list);
     program.post_order_blocks = Shader::IR::PostOrder(program.syntax_list.front());
+    end_phase(program.times.structurize);
 
     // Run optimization passes
     const auto stage = program.info.stage;
 
-    Shader::Optimization::SsaRewritePass(program.post_order_blocks);
-    Shader::Optimization::IdentityRemovalPass(program.blocks);
+    using namespace Shader::Optimization;
+    PassManager passes{program};
+    passes.Run("SsaRewrite", [&] { SsaRewritePass(program.post_order_blocks); });
+    passes.Run("IdentityRemoval", [&] { return IdentityRemovalPass(program.blocks); });
     if (info.l_stage == LogicalStage::TessellationControl) {
         // Tess passes require previous const prop passes for now (for simplicity). TODO allow
         // fine grained folding or opportunistic folding we set an operand to an immediate
-        Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-        Shader::Optimization::TessellationPreprocess(program, runtime_info);
-        Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-        Shader::Optimization::HullShaderTransform(program, runtime_info);
+        passes.Simplify();
+        passes.Run("TessellationPreprocess",
+                   [&] { TessellationPreprocess(program, runtime_info); });
+        passes.Simplify();
+        passes.Run("HullShaderTransform", [&] { HullShaderTransform(program, runtime_info); });
     } else if (info.l_stage == LogicalStage::TessellationEval) {
-        Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-        Shader::Optimization::TessellationPreprocess(program, runtime_info);
-        Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-        Shader::Optimization::DomainShaderTransform(program, runtime_info);
+        passes.Simplify();
+        passes.Run("TessellationPreprocess",
+                   [&] { TessellationPreprocess(program, runtime_info); });
+        passes.Simplify();
+        passes.Run("DomainShaderTransform", [&] { DomainShaderTransform(program, runtime_info); });
     }
-    Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-    Shader::Optimization::RingAccessElimination(program, runtime_info, stage);
-    Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-    Shader::Optimization::FlattenExtendedUserdataPass(program);
-    Shader::Optimization::ResourceTrackingPass(program);
-    Shader::Optimization::LowerBufferFormatToRaw(program);
-    Shader::Optimization::SharedMemoryToStoragePass(program, runtime_info, profile);
-    Shader::Optimization::SharedMemoryBarrierPass(program, runtime_info, profile);
-    Shader::Optimization::IdentityRemovalPass(program.blocks);
-    Shader::Optimization::DeadCodeEliminationPass(program);
-    Shader::Optimization::ConstantPropagationPass(program.post_order_blocks);
-    Shader::Optimization::CollectShaderInfoPass(program);
+    passes.Simplify();
+    passes.Run("RingAccessElimination",
+               [&] { RingAccessElimination(program, runtime_info, stage); });
+    passes.Simplify();
+    passes.Run("FlattenExtendedUserdata", [&] { FlattenExtendedUserdataPass(program); });
+    passes.Run("ResourceTracking", [&] { ResourceTrackingPass(program); });
+    passes.Run("LowerBufferFormatToRaw", [&] { LowerBufferFormatToRaw(program); });
+    passes.Run("SharedMemoryToStorage",
+               [&] { SharedMemoryToStoragePass(program, runtime_info, profile); });
+    passes.Run("SharedMemoryBarrier",
+               [&] { SharedMemoryBarrierPass(program, runtime_info, profile); });
+    passes.Run("IdentityRemoval", [&] { return IdentityRemovalPass(program.blocks); });
+    passes.Run("DeadCodeElimination", [&] { return DeadCodeEliminationPass(program); });
+    passes.Simplify();
+    passes.Run("CollectShaderInfo", [&] { CollectShaderInfoPass(program); });
+    end_phase(program.times.passes);
+    passes.Report();
 
     return program;
 }
@@ -0,0 +1,312 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Offline driver for the shader recompiler. Translates every shader captured in a dump directory
+// (enable dumpShaders in the emulator config to produce one) and reports per-phase compile times,
+// so recompiler performance and correctness can be checked without a GPU or a game.
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fmt/core.h>
+
+#include "common/io_file.h"
+#include "common/logging/backend.h"
+#include "common/logging/log.h"
+#include "shader_recompiler/backend/spirv/emit_spirv.h"
+#include "shader_recompiler/capture.h"
+#include "shader_recompiler/exception.h"
+#include "shader_recompiler/info.h"
+#include "shader_recompiler/recompiler.h"
+#include "shader_recompiler/specialization.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::nanoseconds;
+
+enum class Status {
+    Ok,
+    Skipped,
+    Failed,
+};
+
+struct ShaderResult {
+    std::string name;
+    Status status{Status::Failed};
+    std::string error;
+    Shader::IR::PhaseTimes times;
+    nanoseconds emit{};
+    size_t num_spirv_words{};
+    std::vector<Shader::IR::PassStats> pass_stats;
+
+    nanoseconds Total() const {
+        return times.decode + times.cfg + times.structurize + times.passes + emit;
+    }
+};
+
+struct Options {
+    std::filesystem::path dump_dir;
+    std::filesystem::path output_dir;
+    u32 num_threads = std::max(1U, std::thread::hardware_concurrency());
+};
+
+/// Structural SPIR-V checks: header, instruction word counts and balanced function bodies.
+std::string ValidateSpirv(std::span<const u32> spv, const Shader::Profile& profile) {
+    constexpr u32 SpirvMagic = 0x07230203;
+    constexpr u32 OpMemoryModel = 14;
+    constexpr u32 OpEntryPoint = 15;
+    constexpr u32 OpFunction = 54;
+    constexpr u32 OpFunctionEnd = 56;
+
+    if (spv.size() < 5 || spv[0] != SpirvMagic) {
+        return "missing SPIR-V header";
+    }
+    if (spv[1] > profile.supported_spirv) {
+        return fmt::format("version {:#x} exceeds supported {:#x}", spv[1],
+                           profile.supported_spirv);
+    }
+    if (spv[3] == 0 || spv[4] != 0) {
+        return "invalid id bound or schema";
+    }
+    u32 num_memory_models{};
+    u32 num_entry_points{};
+    s32 function_depth{};
+    for (size_t offset = 5; offset < spv.size();) {
+        const u32 word_count = spv[offset] >> 16;
+        const u32 opcode = spv[offset] & 0xFFFF;
+        if (word_count == 0 || offset + word_count > spv.size()) {
+            return fmt::format("malformed instruction at word {}", offset);
+        }
+        switch (opcode) {
+        case OpMemoryModel:
+            ++num_memory_models;
+            break;
+        case OpEntryPoint:
+            ++num_entry_points;
+            break;
+        case OpFunction:
+            if (function_depth++ != 0) {
+                return fmt::format("nested function at word {}", offset);
+            }
+            break;
+        case OpFunctionEnd:
+            if (--function_depth != 0) {
+                return fmt::format("unmatched function end at word {}", offset);
+            }
+            break;
+        default:
+            break;
+        }
+        offset += word_count;
+    }
+    if (num_memory_models != 1 || num_entry_points == 0 || function_depth != 0) {
+        return "missing memory model, entry point or function end";
+    }
+    return {};
+}
+
+ShaderResult CompileShader(const std::filesystem::path& capture_path, const Options& options,
+                           Shader::Pools& pools) {
+    ShaderResult result{.name = capture_path.stem().string()};
+    const auto capture = Shader::ReadShaderCapture(capture_path);
+    if (!capture) {
+        result.error = "unreadable capture";
+        return result;
+    }
+    if (capture->reads_guest_memory) {
+        result.status = Status::Skipped;
+        return result;
+    }
+
+    auto code_path = capture_path;
+    code_path.replace_extension(".bin");
+    const auto file = Common::FS::IOFile{code_path, Common::FS::FileAccessMode::Read};
+    std::vector<u32> code(file.GetSize() / sizeof(u32));
+    if (code.empty() || file.ReadSpan<u32>(code) != code.size()) {
+        result.error = fmt::format("could not read {}", code_path.filename().string());
+        return result;
+    }
+
+    const Shader::ShaderParams params{
+        .user_data = capture->user_data,
+        .code = code,
+        .hash = capture->hash,
+    };
+    Shader::Info info{capture->stage, capture->l_stage, params};
+    auto runtime_info = capture->runtime_info;
+    auto binding = capture->binding;
+    try {
+        const auto program =
+            Shader::TranslateProgram(code, pools, info, runtime_info, capture->profile);
+        const auto emit_start = Clock::now();
+        const auto spv =
+            Shader::Backend::SPIRV::EmitSPIRV(capture->profile, runtime_info, program, binding);
+        result.emit = Clock::now() - emit_start;
+        result.times = program.times;
+        result.pass_stats = program.pass_stats;
+        result.num_spirv_words = spv.size();
+
+        // Build the specialization key like the pipeline cache does after compiling.
+        [[maybe_unused]] const Shader::StageSpecialization spec{info, runtime_info,
+                                                                capture->profile, capture->binding};
+
+        result.error = ValidateSpirv(spv, capture->profile);
+        if (!options.output_dir.empty()) {
+            Common::FS::IOFile::WriteBytes(options.output_dir / (result.name + ".spv"), spv);
+        }
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    result.status = result.error.empty() ? Status::Ok : Status::Failed;
+    return result;
+}
+
+std::vector<ShaderResult> CompileAll(const std::vector<std::filesystem::path>& captures,
+                                     const Options& options) {
+    std::vector<ShaderResult> results(captures.size());
+    std::atomic<size_t> next_index{};
+    const auto worker = [&] {
+        Shader::Pools pools;
+        for (size_t i = next_index++; i < captures.size(); i = next_index++) {
+            results[i] = CompileShader(captures[i], options, pools);
+        }
+    };
+    std::vector<std::jthread> threads;
+    const u32 num_threads = std::min<u32>(options.num_threads, captures.size());
+    for (u32 i = 0; i < num_threads; ++i) {
+        threads.emplace_back(worker);
+    }
+    threads.clear();
+    return results;
+}
+
+double ToMs(nanoseconds time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+void PrintReport(const std::vector<ShaderResult>& results, nanoseconds wall_time) {
+    Shader::IR::PhaseTimes phases{};
+    nanoseconds emit{};
+    std::vector<Shader::IR::PassStats> passes;
+    std::vector<const ShaderResult*> compiled;
+    size_t num_skipped{};
+    size_t num_failed{};
+    for (const auto& result : results) {
+        if (result.status == Status::Skipped) {
+            ++num_skipped;
+            continue;
+        }
+        if (result.status == Status::Failed) {
+            ++num_failed;
+            fmt::print("FAIL {}: {}\n", result.name, result.error);
+            continue;
+        }
+        compiled.push_back(&result);
+        phases.decode += result.times.decode;
+        phases.cfg += result.times.cfg;
+        phases.structurize += result.times.structurize;
+        phases.passes += result.times.passes;
+        emit += result.emit;
+        for (const auto& stats : result.pass_stats) {
+            auto it = std::ranges::find(passes, stats.name, &Shader::IR::PassStats::name);
+            if (it == passes.end()) {
+                it = passes.insert(it, Shader::IR::PassStats{.name = stats.name});
+            }
+            it->runs += stats.runs;
+            it->changed_runs += stats.changed_runs;
+            it->time += stats.time;
+            it->inst_delta += stats.inst_delta;
+        }
+    }
+
+    fmt::print("\n{} shaders: {} compiled, {} skipped (need guest memory), {} failed\n",
+               results.size(), compiled.size(), num_skipped, num_failed);
+    fmt::print("Wall time {:.2f} ms\n\n", ToMs(wall_time));
+    fmt::print("{:<14} {:>12}\n", "phase", "total ms");
+    fmt::print("{:<14} {:>12.2f}\n", "decode", ToMs(phases.decode));
+    fmt::print("{:<14} {:>12.2f}\n", "cfg", ToMs(phases.cfg));
+    fmt::print("{:<14} {:>12.2f}\n", "structurize", ToMs(phases.structurize));
+    fmt::print("{:<14} {:>12.2f}\n", "passes", ToMs(phases.passes));
+    fmt::print("{:<14} {:>12.2f}\n\n", "emit", ToMs(emit));
+
+    fmt::print("{:<28} {:>8} {:>8} {:>12} {:>10}\n", "pass", "runs", "changed", "total ms",
+               "insts");
+    for (const auto& stats : passes) {
+        fmt::print("{:<28} {:>8} {:>8} {:>12.2f} {:>+10}\n", stats.name, stats.runs,
+                   stats.changed_runs, ToMs(stats.time), stats.inst_delta);
+    }
+
+    constexpr size_t NumSlowest = 10;
+    const size_t num_slowest = std::min(NumSlowest, compiled.size());
+    std::ranges::partial_sort(compiled, compiled.begin() + num_slowest, std::greater{},
+                              &ShaderResult::Total);
+    fmt::print("\nSlowest shaders\n");
+    for (size_t i = 0; i < num_slowest; ++i) {
+        fmt::print("{:>10.3f} ms  {} ({} SPIR-V words)\n", ToMs(compiled[i]->Total()),
+                   compiled[i]->name, compiled[i]->num_spirv_words);
+    }
+}
+
+void PrintUsage() {
+    fmt::print("Usage: shadps4-shader-compiler [-j threads] [-o spirv_dir] <dump_dir>\n");
+}
+
+} // Anonymous namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "-j" && i + 1 < argc) {
+            const std::string_view value{argv[++i]};
+            const auto [ptr, ec] =
+                std::from_chars(value.data(), value.data() + value.size(), options.num_threads);
+            if (ec != std::errc{} || options.num_threads == 0) {
+                PrintUsage();
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "-o" && i + 1 < argc) {
+            options.output_dir = argv[++i];
+        } else if (options.dump_dir.empty() && !arg.starts_with('-')) {
+            options.dump_dir = arg;
+        } else {
+            PrintUsage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.dump_dir.empty() || !std::filesystem::is_directory(options.dump_dir)) {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+    if (!options.output_dir.empty()) {
+        std::filesystem::create_directories(options.output_dir);
+    }
+
+    Common::Log::Initialize("shader_compiler.log");
+    Common::Log::Start();
+
+    std::vector<std::filesystem::path> captures;
+    for (const auto& entry : std::filesystem::directory_iterator{options.dump_dir}) {
+        if (entry.is_regular_file() && entry.path().extension() == ".capture") {
+            captures.push_back(entry.path());
+        }
+    }
+    std::ranges::sort(captures);
+
+    const auto start = Clock::now();
+    const auto results = CompileAll(captures, options);
+    PrintReport(results, Clock::now() - start);
+
+    Common::Log::Stop();
+    const bool any_failed = std::ranges::any_of(
+        results, [](const ShaderResult& result) { return result.status == Status::Failed; });
+    return any_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -586,12 +586,20 @@ Liverpool::Task Liverpool::ProcessGraphics(std::span<const u32> dcb, std::span<c
             }
             case PM4ItOpcode::EventWriteEop: {
                 const auto* event_eop = reinterpret_cast<const PM4CmdEventWriteEop*>(header);
-                event_eop->SignalFence([](void* address, u64 data, u32 num_bytes) {
-                    auto* memory = Core::Memory::Instance();
-                    if (!memory->TryWriteBacking(address, &data, num_bytes)) {
-                        memcpy(address, &data, num_bytes);
-                    }
-                });
+                auto signal_fence = [event_eop = *event_eop] {
+                    event_eop.SignalFence([](void* address, u64 data, u32 num_bytes) {
+                        auto* memory = Core::Memory::Instance();
+                        if (!memory->TryWriteBacking(address, &data, num_bytes)) {
+                            memcpy(address, &data, num_bytes);
+                        }
+                    });
+                };
+                // The guest may read what the GPU wrote as soon as it sees the fence.
+                if (rasterizer) {
+                    rasterizer->ScheduleDownloads(std::move(signal_fence));
+                } else {
+                    signal_fence();
+                }
                 break;
             }
             case PM4ItOpcode::DmaData: {
@@ -886,7 +894,14 @@ Liverpool::Task Liverpool::ProcessCompute(std::span<const u32> acb, u32 vqid) {
         }
         case PM4ItOpcode::ReleaseMem: {
             const auto* release_mem = reinterpret_cast<const PM4CmdReleaseMem*>(header);
-            release_mem->SignalFence(static_cast<Platform::InterruptId>(queue.pipe_id));
+            auto signal_fence = [release_mem = *release_mem, pipe_id = queue.pipe_id] {
+                release_mem.SignalFence(static_cast<Platform::InterruptId>(pipe_id));
+            };
+            if (rasterizer) {
+                rasterizer->ScheduleDownloads(std::move(signal_fence));
+            } else {
+                signal_fence();
+            }
             break;
         }
         case PM4ItOpcode::EventWrite: {
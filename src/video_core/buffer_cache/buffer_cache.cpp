@@ -2,29 +2,38 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <algorithm>
+#include <utility>
 #include "common/alignment.h"
+#include "common/config.h"
+#include "common/logging/log.h"
 #include "common/scope_exit.h"
 #include "common/types.h"
+#include "core/memory.h"
 #include "video_core/amdgpu/liverpool.h"
 #include "video_core/buffer_cache/buffer_cache.h"
 #include "video_core/renderer_vulkan/vk_graphics_pipeline.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
+#include "video_core/renderer_vulkan/vk_resource_pool.h"
 #include "video_core/renderer_vulkan/vk_scheduler.h"
 #include "video_core/texture_cache/texture_cache.h"
 
+#include <vk_mem_alloc.h>
+
 namespace VideoCore {
 
 static constexpr size_t DataShareBufferSize = 64_KB;
 static constexpr size_t StagingBufferSize = 512_MB;
 static constexpr size_t UboStreamBufferSize = 128_MB;
+static constexpr size_t DownloadBufferSize = 128_MB;
 
 BufferCache::BufferCache(const Vulkan::Instance& instance_, Vulkan::Scheduler& scheduler_,
-                         AmdGpu::Liverpool* liverpool_, TextureCache& texture_cache_,
-                         PageManager& tracker_)
-    : instance{instance_}, scheduler{scheduler_}, liverpool{liverpool_},
+                         Vulkan::DescriptorHeap& desc_heap_, AmdGpu::Liverpool* liverpool_,
+                         TextureCache& texture_cache_, PageManager& tracker_)
+    : instance{instance_}, scheduler{scheduler_}, desc_heap{desc_heap_}, liverpool{liverpool_},
       texture_cache{texture_cache_}, tracker{tracker_},
       staging_buffer{instance, scheduler, MemoryUsage::Upload, StagingBufferSize},
       stream_buffer{instance, scheduler, MemoryUsage::Stream, UboStreamBufferSize},
+      download_buffer{instance, scheduler, MemoryUsage::Download, DownloadBufferSize},
       gds_buffer{instance, scheduler, MemoryUsage::Stream, 0, AllFlags, DataShareBufferSize},
       memory_tracker{&tracker} {
     Vulkan::SetObjectName(instance.GetDevice(), gds_buffer.Handle(), "GDS Buffer");
@@ -69,6 +78,7 @@ void BufferCache::DownloadBufferMemory(Buffer& buffer, VAddr device_addr, u64 si
     if (total_size_bytes == 0) {
         return;
     }
+    FlushUploads();
     const auto [staging, offset] = staging_buffer.Map(total_size_bytes);
     for (auto& copy : copies) {
         // Modify copies to have the staging offset in mind
@@ -86,6 +96,203 @@ void BufferCache::DownloadBufferMemory(Buffer& buffer, VAddr device_addr, u64 si
     }
 }
 
+u64 BufferCache::ScheduleDownloads() {
+    if (!Config::readbacks()) {
+        return 0;
+    }
+    struct Download {
+        Buffer* buffer;
+        vk::BufferCopy copy;
+    };
+    boost::container::small_vector<Download, 16> downloads;
+    boost::container::small_vector<std::pair<VAddr, VAddr>, 16> cpu_written;
+    u64 total_size_bytes = 0;
+    gpu_modified_ranges.ForEach([&](VAddr start, VAddr end) {
+        ForEachBufferInRange(start, end - start, [&](BufferId, Buffer& buffer) {
+            const VAddr range_start = std::max(start, buffer.CpuAddr());
+            const VAddr range_end = std::min(end, buffer.CpuAddr() + buffer.SizeBytes());
+            if (range_start >= range_end) {
+                return;
+            }
+            // Pages the CPU wrote after the GPU hold newer data, they are left out and dropped
+            // from the GPU modified ranges.
+            VAddr written_start = range_start;
+            const auto add_download = [&](VAddr copy_start, VAddr copy_end) {
+                if (written_start < copy_start) {
+                    cpu_written.emplace_back(written_start, copy_start);
+                }
+                written_start = copy_end;
+                const u64 copy_size = copy_end - copy_start;
+                if (total_size_bytes + copy_size > DownloadBufferSize) {
+                    // Whatever does not fit stays GPU modified for the next batch.
+                    return;
+                }
+                const vk::BufferCopy copy = {
+                    .srcOffset = copy_start - buffer.CpuAddr(),
+                    .dstOffset = total_size_bytes,
+                    .size = copy_size,
+                };
+                downloads.push_back({&buffer, copy});
+                total_size_bytes += copy_size;
+            };
+            memory_tracker.ForEachDownloadRange<false>(
+                range_start, range_end - range_start, [&](VAddr page_addr, u64 pages_size) {
+                    add_download(std::max(range_start, page_addr),
+                                 std::min(range_end, page_addr + pages_size));
+                });
+            if (written_start < range_end) {
+                cpu_written.emplace_back(written_start, range_end);
+            }
+        });
+    });
+    for (const auto& [written_start, written_end] : cpu_written) {
+        gpu_modified_ranges.Subtract(written_start, written_end - written_start);
+    }
+    if (total_size_bytes == 0) {
+        return 0;
+    }
+
+    std::unique_lock lk{download_mutex};
+    const u64 offset = download_buffer.Map(total_size_bytes).second;
+    // Older downloads still waiting in the reused part of the staging buffer have finished on
+    // the GPU by now, write them back before they are overwritten.
+    CompleteDownloadsIf([&](const PendingDownload& download) {
+        return download.staging_offset < offset + total_size_bytes &&
+               offset < download.staging_offset + download.size;
+    });
+    download_buffer.Commit();
+
+    FlushUploads();
+    scheduler.EndRendering();
+    const auto cmdbuf = scheduler.CommandBuffer();
+    const vk::MemoryBarrier2 pre_barrier = {
+        .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+        .srcAccessMask = vk::AccessFlagBits2::eMemoryWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+    };
+    const vk::MemoryBarrier2 post_barrier = {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+        .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+    };
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &pre_barrier,
+    });
+    const u64 tick = scheduler.CurrentTick();
+    for (auto& [buffer, copy] : downloads) {
+        const VAddr device_addr = buffer->CpuAddr() + copy.srcOffset;
+        gpu_modified_ranges.Subtract(device_addr, copy.size);
+        pending_downloads.push_back({tick, device_addr, copy.size, offset + copy.dstOffset});
+        copy.dstOffset += offset;
+        cmdbuf.copyBuffer(buffer->Handle(), download_buffer.Handle(), copy);
+    }
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &post_barrier,
+    });
+
+    ++readback_stats.batches;
+    readback_stats.downloads += downloads.size();
+    readback_stats.bytes += total_size_bytes;
+    if (readback_stats.batches % 256 == 0) {
+        using namespace std::chrono;
+        LOG_DEBUG(Render_Vulkan, "Readbacks: {} downloads ({} MiB), {} stalls ({} ms)",
+                  readback_stats.downloads, readback_stats.bytes >> 20, readback_stats.stalls,
+                  duration_cast<milliseconds>(readback_stats.stall_time).count());
+    }
+    WriteDeferredDownloads(lk);
+
+    // Submit now so that the downloads start early.
+    Vulkan::SubmitInfo info{};
+    scheduler.Flush(info);
+    return tick;
+}
+
+void BufferCache::CompleteDownloadsUntil(u64 tick) {
+    std::unique_lock lk{download_mutex};
+    CompleteDownloadsIf([tick](const PendingDownload& download) { return download.tick <= tick; });
+    WriteDeferredDownloads(lk);
+}
+
+void BufferCache::CompleteDownloads(VAddr device_addr, u64 size) {
+    std::unique_lock lk{download_mutex};
+    if (pending_downloads.empty()) {
+        return;
+    }
+    const VAddr end_addr = device_addr + size;
+    CompleteDownloadsIf([&](const PendingDownload& download) {
+        return download.device_addr < end_addr &&
+               device_addr < download.device_addr + download.size;
+    });
+    WriteDeferredDownloads(lk);
+}
+
+void BufferCache::DiscardDownloads(VAddr device_addr, u64 size) {
+    std::scoped_lock lk{download_mutex};
+    const VAddr end_addr = device_addr + size;
+    std::erase_if(pending_downloads, [&](const PendingDownload& download) {
+        return download.device_addr < end_addr &&
+               device_addr < download.device_addr + download.size;
+    });
+}
+
+BufferCache::ReadbackStats BufferCache::GetReadbackStats() {
+    std::scoped_lock lk{download_mutex};
+    return readback_stats;
+}
+
+template <typename Pred>
+void BufferCache::CompleteDownloadsIf(Pred&& pred) {
+    for (auto it = pending_downloads.begin(); it != pending_downloads.end();) {
+        if (!pred(*it)) {
+            ++it;
+            continue;
+        }
+        if (!scheduler.IsFree(it->tick)) {
+            // Only the thread touching the memory waits, and only for the tick of this download.
+            const auto start = std::chrono::steady_clock::now();
+            scheduler.GetMasterSemaphore()->Wait(it->tick);
+            ++readback_stats.stalls;
+            readback_stats.stall_time += std::chrono::steady_clock::now() - start;
+        }
+        WriteBackDownload(*it);
+        it = pending_downloads.erase(it);
+    }
+}
+
+void BufferCache::WriteBackDownload(const PendingDownload& download) {
+    if (!download_buffer.is_coherent) {
+        vmaInvalidateAllocation(instance.GetAllocator(), download_buffer.buffer.allocation,
+                                download.staging_offset, download.size);
+    }
+    const u8* staging = download_buffer.mapped_data.data() + download.staging_offset;
+    auto* memory = Core::Memory::Instance();
+    const VAddr end_addr = download.device_addr + download.size;
+    for (VAddr addr = download.device_addr; addr < end_addr;) {
+        const VAddr chunk_end = std::min(PageManager::GetNextPageAddr(addr), end_addr);
+        const u32 chunk_size = static_cast<u32>(chunk_end - addr);
+        const u8* src = staging + (addr - download.device_addr);
+        // Write through the backing memory so tracked pages keep their protection.
+        if (!memory->TryWriteBacking(std::bit_cast<void*>(addr), src, chunk_size)) {
+            memory_tracker.MarkRegionAsCpuModified(addr, chunk_size);
+            deferred_writes.push_back({addr, {src, src + chunk_size}});
+        }
+        addr = chunk_end;
+    }
+}
+
+void BufferCache::WriteDeferredDownloads(std::unique_lock<std::mutex>& lk) {
+    const auto writes = std::move(deferred_writes);
+    deferred_writes.clear();
+    lk.unlock();
+    for (const auto& write : writes) {
+        std::memcpy(std::bit_cast<void*>(write.device_addr), write.data.data(), write.data.size());
+    }
+}
+
 void BufferCache::BindVertexBuffers(const Vulkan::GraphicsPipeline& pipeline) {
     Vulkan::VertexInputs<vk::VertexInputAttributeDescription2EXT> attributes;
     Vulkan::VertexInputs<vk::VertexInputBindingDescription2EXT> bindings;
@@ -206,6 +413,7 @@ void BufferCache::InlineData(VAddr address, const void* value, u32 num_bytes, bo
         memcpy(std::bit_cast<void*>(address), value, num_bytes);
         return;
     }
+    FlushUploads();
     scheduler.EndRendering();
     const Buffer* buffer = [&] {
         if (is_gds) {
@@ -277,6 +485,8 @@ std::pair<Buffer*, u32> BufferCache::ObtainViewBuffer(VAddr gpu_addr, u32 size,
         Buffer& buffer = slot_buffers[buffer_id];
         if (buffer.IsInBounds(gpu_addr, size)) {
             SynchronizeBuffer(buffer, gpu_addr, size, false);
+            // The caller copies from the buffer right away.
+            FlushUploads();
             return {&buffer, buffer.Offset(gpu_addr)};
         }
     }
@@ -284,7 +494,9 @@ std::pair<Buffer*, u32> BufferCache::ObtainViewBuffer(VAddr gpu_addr, u32 size,
     // fall back to ObtainBuffer to create a full buffer and avoid losing GPU modifications.
     // This is only done if the request prefers to use GPU memory, otherwise we can skip it.
     if (prefer_gpu && memory_tracker.IsRegionGpuModified(gpu_addr, size)) {
-        return ObtainBuffer(gpu_addr, size, false, false);
+        const auto result = ObtainBuffer(gpu_addr, size, false, false);
+        FlushUploads();
+        return result;
     }
     // In all other cases, just do a CPU copy to the staging buffer.
     const u32 offset = staging_buffer.Copy(gpu_addr, size, 16);
@@ -469,6 +681,8 @@ BufferId BufferCache::CreateBuffer(VAddr device_addr, u32 wanted_size) {
     const VAddr device_addr_end = Common::AlignUp(device_addr + wanted_size, CACHING_PAGESIZE);
     device_addr = Common::AlignDown(device_addr, CACHING_PAGESIZE);
     wanted_size = static_cast<u32>(device_addr_end - device_addr);
+    // Pending uploads of the buffers joined below must land before they are copied.
+    FlushUploads();
     const OverlapResult overlap = ResolveOverlaps(device_addr, wanted_size);
     const u32 size = static_cast<u32>(overlap.end - overlap.begin);
     const BufferId new_buffer_id = [&] {
@@ -534,35 +748,41 @@ void BufferCache::SynchronizeBuffer(Buffer& buffer, VAddr device_addr, u32 size,
     if (total_size_bytes == 0) {
         return;
     }
-    vk::Buffer src_buffer = staging_buffer.Handle();
-    if (total_size_bytes < StagingBufferSize) {
-        const auto [staging, offset] = staging_buffer.Map(total_size_bytes);
-        for (auto& copy : copies) {
-            u8* const src_pointer = staging + copy.srcOffset;
-            const VAddr device_addr = buffer.CpuAddr() + copy.dstOffset;
-            std::memcpy(src_pointer, std::bit_cast<const u8*>(device_addr), copy.size);
-            // Apply the staging offset
-            copy.srcOffset += offset;
-        }
-        staging_buffer.Commit();
-    } else {
-        // For large one time transfers use a temporary host buffer.
-        // RenderDoc can lag quite a bit if the stream buffer is too large.
-        Buffer temp_buffer{instance,
-                           scheduler,
-                           MemoryUsage::Upload,
-                           0,
-                           vk::BufferUsageFlagBits::eTransferSrc,
-                           total_size_bytes};
-        src_buffer = temp_buffer.Handle();
-        u8* const staging = temp_buffer.mapped_data.data();
-        for (auto& copy : copies) {
-            u8* const src_pointer = staging + copy.srcOffset;
-            const VAddr device_addr = buffer.CpuAddr() + copy.dstOffset;
-            std::memcpy(src_pointer, std::bit_cast<const u8*>(device_addr), copy.size);
+    if (total_size_bytes >= StagingBufferSize) {
+        UploadFromTempBuffer(buffer, {copies.data(), copies.size()}, total_size_bytes);
+        return;
+    }
+    if (upload_batch.SizeBytes() + total_size_bytes > StagingBufferSize) {
+        FlushUploads();
+    }
+    for (auto& copy : copies) {
+        // The data is staged when the batch is recorded, until then the source is the guest.
+        copy.srcOffset = buffer.CpuAddr() + copy.dstOffset;
+        if (!upload_batch.Add(buffer.Handle(), copy)) {
+            // The range was uploaded earlier in the batch, keep the copies in order.
+            FlushUploads();
+            const bool is_added = upload_batch.Add(buffer.Handle(), copy);
+            ASSERT(is_added);
         }
-        scheduler.DeferOperation([buffer = std::move(temp_buffer)]() mutable {});
     }
+    if (!is_batching_uploads) {
+        FlushUploads();
+    }
+}
+
+void BufferCache::UploadFromTempBuffer(Buffer& buffer, std::span<const vk::BufferCopy> copies,
+                                       u64 size) {
+    // For large one time transfers use a temporary host buffer.
+    // RenderDoc can lag quite a bit if the stream buffer is too large.
+    Buffer temp_buffer{
+        instance, scheduler, MemoryUsage::Upload, 0, vk::BufferUsageFlagBits::eTransferSrc, size};
+    u8* const staging = temp_buffer.mapped_data.data();
+    for (const auto& copy : copies) {
+        u8* const src_pointer = staging + copy.srcOffset;
+        const VAddr device_addr = buffer.CpuAddr() + copy.dstOffset;
+        std::memcpy(src_pointer, std::bit_cast<const u8*>(device_addr), copy.size);
+    }
+    FlushUploads();
     scheduler.EndRendering();
     const auto cmdbuf = scheduler.CommandBuffer();
     const vk::BufferMemoryBarrier2 pre_barrier = {
@@ -589,12 +809,109 @@ void BufferCache::SynchronizeBuffer(Buffer& buffer, VAddr device_addr, u32 size,
         .bufferMemoryBarrierCount = 1,
         .pBufferMemoryBarriers = &pre_barrier,
     });
-    cmdbuf.copyBuffer(src_buffer, buffer.buffer, copies);
+    cmdbuf.copyBuffer(temp_buffer.Handle(), buffer.buffer, copies);
     cmdbuf.pipelineBarrier2(vk::DependencyInfo{
         .dependencyFlags = vk::DependencyFlagBits::eByRegion,
         .bufferMemoryBarrierCount = 1,
         .pBufferMemoryBarriers = &post_barrier,
     });
+    scheduler.DeferOperation([buffer = std::move(temp_buffer)]() mutable {});
+
+    ++upload_stats.batches;
+    ++upload_stats.copies;
+    upload_stats.regions += copies.size();
+    upload_stats.barriers += 2;
+    upload_stats.bytes += size;
+}
+
+void BufferCache::BeginUploadBatch() {
+    is_batching_uploads = true;
+}
+
+void BufferCache::EndUploadBatch() {
+    FlushUploads();
+    is_batching_uploads = false;
+}
+
+void BufferCache::FlushUploads() {
+    if (upload_batch.Empty()) {
+        return;
+    }
+    upload_stats.merged += upload_batch.Merge();
+    const auto groups = upload_batch.Groups();
+
+    // Stage the data only now. Waiting for room in the staging buffer may submit the command
+    // buffer, which must not happen between staging and recording the copies reading it.
+    const u64 size_bytes = upload_batch.SizeBytes();
+    const auto [staging, offset] = staging_buffer.Map(size_bytes);
+    u64 staging_offset = 0;
+    for (auto& group : groups) {
+        for (auto& copy : group.copies) {
+            const VAddr device_addr = copy.srcOffset;
+            std::memcpy(staging + staging_offset, std::bit_cast<const u8*>(device_addr),
+                        copy.size);
+            copy.srcOffset = offset + staging_offset;
+            staging_offset += copy.size;
+        }
+    }
+    staging_buffer.Commit();
+
+    boost::container::small_vector<vk::BufferMemoryBarrier2, 16> pre_barriers;
+    boost::container::small_vector<vk::BufferMemoryBarrier2, 16> post_barriers;
+    for (const auto& group : groups) {
+        pre_barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .srcAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite |
+                             vk::AccessFlagBits2::eTransferRead |
+                             vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .buffer = group.dst,
+            .offset = group.begin,
+            .size = group.end - group.begin,
+        });
+        post_barriers.push_back({
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite,
+            .buffer = group.dst,
+            .offset = group.begin,
+            .size = group.end - group.begin,
+        });
+    }
+
+    scheduler.EndRendering();
+    const auto cmdbuf = scheduler.CommandBuffer();
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .dependencyFlags = vk::DependencyFlagBits::eByRegion,
+        .bufferMemoryBarrierCount = static_cast<u32>(pre_barriers.size()),
+        .pBufferMemoryBarriers = pre_barriers.data(),
+    });
+    for (const auto& group : groups) {
+        cmdbuf.copyBuffer(staging_buffer.Handle(), group.dst, group.copies);
+        upload_stats.regions += group.copies.size();
+    }
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .dependencyFlags = vk::DependencyFlagBits::eByRegion,
+        .bufferMemoryBarrierCount = static_cast<u32>(post_barriers.size()),
+        .pBufferMemoryBarriers = post_barriers.data(),
+    });
+
+    ++upload_stats.batches;
+    upload_stats.copies += groups.size();
+    upload_stats.barriers += 2;
+    upload_stats.bytes += size_bytes;
+    upload_batch.Clear();
+}
+
+void BufferCache::EndUploadFrame() {
+    last_upload_stats = std::exchange(upload_stats, {});
+    LOG_DEBUG(Render_Vulkan,
+              "Buffer uploads: {} batches, {} copies, {} regions ({} merged), {} barriers, {} "
+              "bytes",
+              last_upload_stats.batches, last_upload_stats.copies, last_upload_stats.regions,
+              last_upload_stats.merged, last_upload_stats.barriers, last_upload_stats.bytes);
 }
 
 bool BufferCache::SynchronizeBufferFromImage(Buffer& buffer, VAddr device_addr, u32 size) {
@@ -648,6 +965,7 @@ bool BufferCache::SynchronizeBufferFromImage(Buffer& buffer, VAddr device_addr,
         });
     }
     if (!copies.empty()) {
+        FlushUploads();
         scheduler.EndRendering();
         const vk::BufferMemoryBarrier2 pre_barrier = {
             .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
@@ -692,6 +1010,7 @@ bool BufferCache::SynchronizeBufferFromImage(Buffer& buffer, VAddr device_addr,
 void BufferCache::DeleteBuffer(BufferId buffer_id) {
     Buffer& buffer = slot_buffers[buffer_id];
     Unregister(buffer_id);
+    desc_heap.InvalidateHandle(std::bit_cast<u64>(buffer.Handle()));
     scheduler.DeferOperation([this, buffer_id] { slot_buffers.erase(buffer_id); });
     buffer.is_deleted = true;
 }
@@ -3,7 +3,12 @@
 
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <mutex>
 #include <shared_mutex>
+#include <span>
+#include <vector>
 #include <boost/container/small_vector.hpp>
 #include "common/div_ceil.h"
 #include "common/slot_vector.h"
@@ -11,6 +16,7 @@
 #include "video_core/buffer_cache/buffer.h"
 #include "video_core/buffer_cache/memory_tracker_base.h"
 #include "video_core/buffer_cache/range_set.h"
+#include "video_core/buffer_cache/upload_batch.h"
 #include "video_core/multi_level_page_table.h"
 
 namespace AmdGpu {
@@ -26,6 +32,7 @@ struct Info;
 
 namespace Vulkan {
 class GraphicsPipeline;
+class DescriptorHeap;
 }
 
 namespace VideoCore {
@@ -57,10 +64,27 @@ public:
         bool has_stream_leap = false;
     };
 
+    struct ReadbackStats {
+        u64 batches{};
+        u64 downloads{};
+        u64 bytes{};
+        u64 stalls{};
+        std::chrono::nanoseconds stall_time{};
+    };
+
+    struct UploadStats {
+        u64 batches{};
+        u64 copies{};   ///< Copy commands, one per destination buffer of a batch.
+        u64 regions{};  ///< Copy regions after merging.
+        u64 merged{};   ///< Dirty ranges merged into a neighbouring region.
+        u64 barriers{}; ///< Pipeline barriers around the copies.
+        u64 bytes{};
+    };
+
 public:
     explicit BufferCache(const Vulkan::Instance& instance, Vulkan::Scheduler& scheduler,
-                         AmdGpu::Liverpool* liverpool, TextureCache& texture_cache,
-                         PageManager& tracker);
+                         Vulkan::DescriptorHeap& desc_heap, AmdGpu::Liverpool* liverpool,
+                         TextureCache& texture_cache, PageManager& tracker);
     ~BufferCache();
 
     /// Returns a pointer to GDS device local buffer.
@@ -81,6 +105,40 @@ public:
     /// Invalidates any buffer in the logical page range.
     void InvalidateMemory(VAddr device_addr, u64 size);
 
+    /// Records downloads of all GPU modified memory and submits them. Returns the tick they
+    /// complete on, or zero if there was nothing to download.
+    u64 ScheduleDownloads();
+
+    /// Writes back the pending downloads recorded up to the tick, waiting for the GPU to finish
+    /// it.
+    void CompleteDownloadsUntil(u64 tick);
+
+    /// Writes back the pending downloads overlapping the region, waiting on their tick if the
+    /// GPU has not finished them yet. Called when the CPU touches GPU modified memory.
+    void CompleteDownloads(VAddr device_addr, u64 size);
+
+    /// Drops the pending downloads overlapping a region that is being unmapped.
+    void DiscardDownloads(VAddr device_addr, u64 size);
+
+    /// Returns the readback counters.
+    [[nodiscard]] ReadbackStats GetReadbackStats();
+
+    /// Gathers the uploads of buffers obtained from now on, instead of recording each one with
+    /// its own barriers. The batch is recorded by EndUploadBatch, or earlier by any buffer cache
+    /// operation that records commands itself.
+    void BeginUploadBatch();
+
+    /// Records the gathered uploads and stops gathering.
+    void EndUploadBatch();
+
+    /// Ends the upload counters of the current frame and logs them.
+    void EndUploadFrame();
+
+    /// Returns the upload counters of the last frame.
+    [[nodiscard]] const UploadStats& GetUploadStats() const noexcept {
+        return last_upload_stats;
+    }
+
     /// Binds host vertex buffers for the current draw.
     void BindVertexBuffers(const Vulkan::GraphicsPipeline& pipeline);
 
@@ -128,8 +186,25 @@ private:
         }
     }
 
+    struct PendingDownload {
+        u64 tick;
+        VAddr device_addr;
+        u64 size;
+        u64 staging_offset;
+    };
+
     void DownloadBufferMemory(Buffer& buffer, VAddr device_addr, u64 size);
 
+    /// Writes back and removes the pending downloads matching the predicate, in tick order.
+    template <typename Pred>
+    void CompleteDownloadsIf(Pred&& pred);
+
+    void WriteBackDownload(const PendingDownload& download);
+
+    /// Releases the download lock and performs the writes that could not go through the backing
+    /// memory. They may fault on tracked pages, which completes downloads again.
+    void WriteDeferredDownloads(std::unique_lock<std::mutex>& lk);
+
     [[nodiscard]] OverlapResult ResolveOverlaps(VAddr device_addr, u32 wanted_size);
 
     void JoinOverlap(BufferId new_buffer_id, BufferId overlap_id, bool accumulate_stream_score);
@@ -145,23 +220,43 @@ private:
 
     void SynchronizeBuffer(Buffer& buffer, VAddr device_addr, u32 size, bool is_texel_buffer);
 
+    void UploadFromTempBuffer(Buffer& buffer, std::span<const vk::BufferCopy> copies, u64 size);
+
+    /// Records the pending uploads. Must be called before recording anything that accesses
+    /// cached buffers.
+    void FlushUploads();
+
     bool SynchronizeBufferFromImage(Buffer& buffer, VAddr device_addr, u32 size);
 
     void DeleteBuffer(BufferId buffer_id);
 
     const Vulkan::Instance& instance;
     Vulkan::Scheduler& scheduler;
+    Vulkan::DescriptorHeap& desc_heap;
     AmdGpu::Liverpool* liverpool;
     TextureCache& texture_cache;
     PageManager& tracker;
     StreamBuffer staging_buffer;
     StreamBuffer stream_buffer;
+    StreamBuffer download_buffer;
     Buffer gds_buffer;
     std::shared_mutex mutex;
     Common::SlotVector<Buffer> slot_buffers;
     RangeSet gpu_modified_ranges;
     MemoryTracker memory_tracker;
     PageTable page_table;
+    std::mutex download_mutex;
+    std::deque<PendingDownload> pending_downloads;
+    struct DeferredWrite {
+        VAddr device_addr;
+        std::vector<u8> data;
+    };
+    std::vector<DeferredWrite> deferred_writes;
+    ReadbackStats readback_stats;
+    UploadBatch upload_batch;
+    bool is_batching_uploads{};
+    UploadStats upload_stats;
+    UploadStats last_upload_stats;
 };
 
 } // namespace VideoCore
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <vector>
+#include <boost/container/small_vector.hpp>
+
+#include "common/types.h"
+#include "video_core/renderer_vulkan/vk_common.h"
+
+namespace VideoCore {
+
+/**
+ * Buffer uploads gathered before they are recorded. Copies are grouped by destination buffer so
+ * a batch needs a single copy command per buffer and a single barrier on each side, and copies
+ * contiguous in both source and destination are merged into one region. The source offset is
+ * whatever the caller stages the data from. Copies of one batch never overlap in a destination
+ * buffer, the caller records the batch before adding a copy that would.
+ */
+class UploadBatch {
+public:
+    struct Group {
+        vk::Buffer dst;
+        u64 begin; ///< Lowest destination offset written.
+        u64 end;   ///< Highest destination offset written, exclusive.
+        boost::container::small_vector<vk::BufferCopy, 8> copies;
+    };
+
+    /// Adds a copy, returns false if it overlaps a pending copy.
+    [[nodiscard]] bool Add(vk::Buffer dst, const vk::BufferCopy& copy) {
+        const auto it = std::ranges::find(groups, dst, &Group::dst);
+        if (it == groups.end()) {
+            groups.push_back({dst, copy.dstOffset, copy.dstOffset + copy.size, {copy}});
+            size_bytes += copy.size;
+            return true;
+        }
+        const u64 copy_end = copy.dstOffset + copy.size;
+        if (copy.dstOffset < it->end && it->begin < copy_end) {
+            const bool overlaps = std::ranges::any_of(it->copies, [&](const vk::BufferCopy& c) {
+                return copy.dstOffset < c.dstOffset + c.size && c.dstOffset < copy_end;
+            });
+            if (overlaps) {
+                return false;
+            }
+        }
+        it->begin = std::min(it->begin, copy.dstOffset);
+        it->end = std::max(it->end, copy_end);
+        it->copies.push_back(copy);
+        size_bytes += copy.size;
+        return true;
+    }
+
+    /// Sorts the copies of each group by destination and merges the contiguous ones. Returns
+    /// the number of copies merged away.
+    u64 Merge() {
+        u64 num_merged = 0;
+        for (auto& group : groups) {
+            auto& copies = group.copies;
+            std::ranges::sort(copies, {}, &vk::BufferCopy::dstOffset);
+            size_t last = 0;
+            for (size_t i = 1; i < copies.size(); ++i) {
+                auto& prev = copies[last];
+                const auto& copy = copies[i];
+                if (prev.srcOffset + prev.size == copy.srcOffset &&
+                    prev.dstOffset + prev.size == copy.dstOffset) {
+                    prev.size += copy.size;
+                    ++num_merged;
+                } else {
+                    copies[++last] = copy;
+                }
+            }
+            copies.resize(last + 1);
+        }
+        return num_merged;
+    }
+
+    [[nodiscard]] std::span<Group> Groups() noexcept {
+        return groups;
+    }
+
+    /// Total size of the pending copies.
+    [[nodiscard]] u64 SizeBytes() const noexcept {
+        return size_bytes;
+    }
+
+    [[nodiscard]] bool Empty() const noexcept {
+        return groups.empty();
+    }
+
+    void Clear() {
+        groups.clear();
+        size_bytes = 0;
+    }
+
+private:
+    std::vector<Group> groups;
+    u64 size_bytes{};
+};
+
+} // namespace VideoCore
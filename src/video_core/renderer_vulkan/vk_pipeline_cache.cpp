@@ -26,13 +26,6 @@ using Shader::LogicalStage;
 using Shader::Stage;
 using Shader::VsOutput;
 
-constexpr static std::array DescriptorHeapSizes = {
-    vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer, 8192},
-    vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 1024},
-    vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, 8192},
-    vk::DescriptorPoolSize{vk::DescriptorType::eSampler, 1024},
-};
-
 void GatherVertexOutputs(Shader::VertexRuntimeInfo& info,
                          const AmdGpu::Liverpool::VsOutputControl& ctl) {
     const auto add_output = [&](VsOutput x, VsOutput y, VsOutput z, VsOutput w) {
@@ -187,9 +180,8 @@ const Shader::RuntimeInfo& PipelineCache::BuildRuntimeInfo(Stage stage, LogicalS
 }
 
 PipelineCache::PipelineCache(const Instance& instance_, Scheduler& scheduler_,
-                             AmdGpu::Liverpool* liverpool_)
-    : instance{instance_}, scheduler{scheduler_}, liverpool{liverpool_},
-      desc_heap{instance, scheduler.GetMasterSemaphore(), DescriptorHeapSizes} {
+                             DescriptorHeap& desc_heap_, AmdGpu::Liverpool* liverpool_)
+    : instance{instance_}, scheduler{scheduler_}, liverpool{liverpool_}, desc_heap{desc_heap_} {
     const auto& vk12_props = instance.GetVk12Properties();
     profile = Shader::Profile{
         .supported_spirv = instance.ApiVersion() >= VK_API_VERSION_1_3 ? 0x00010600U : 0x00010500U,
@@ -503,9 +495,25 @@ vk::ShaderModule PipelineCache::CompileModule(Shader::Info& info, Shader::Runtim
              perm_idx != 0 ? "(permutation)" : "");
     DumpShader(code, info.pgm_hash, info.stage, perm_idx, "bin");
 
+    // Translation may update the runtime info and bindings, capture the inputs beforehand.
+    std::optional<Shader::ShaderCapture> capture;
+    if (Config::dumpShaders()) {
+        capture.emplace(Shader::ShaderCapture{
+            .stage = info.stage,
+            .l_stage = info.l_stage,
+            .hash = info.pgm_hash,
+            .runtime_info = runtime_info,
+            .profile = profile,
+            .binding = binding,
+        });
+    }
+
     const auto ir_program = Shader::TranslateProgram(code, pools, info, runtime_info, profile);
     auto spv = Shader::Backend::SPIRV::EmitSPIRV(profile, runtime_info, ir_program, binding);
     DumpShader(spv, info.pgm_hash, info.stage, perm_idx, "spv");
+    if (capture) {
+        DumpCapture(*capture, info, perm_idx);
+    }
 
     vk::ShaderModule module;
 
@@ -617,6 +625,28 @@ void PipelineCache::DumpShader(std::span<const u32> code, u64 hash, Shader::Stag
     file.WriteSpan(code);
 }
 
+void PipelineCache::DumpCapture(Shader::ShaderCapture& capture, const Shader::Info& info,
+                                size_t perm_idx) {
+    const size_t num_user_data = std::min(info.user_data.size(), capture.user_data.size());
+    std::copy_n(info.user_data.begin(), num_user_data, capture.user_data.begin());
+    // Without robust buffer access fetch shaders are inlined, which reads them from guest memory
+    // without marking the program as having a fetch shader.
+    const bool may_inline_fetch = !profile.supports_robust_buffer_access &&
+                                  (info.stage == Stage::Vertex || info.stage == Stage::Export ||
+                                   info.stage == Stage::Local);
+    // Geometry shaders parse the copy shader through a span into guest memory.
+    capture.reads_guest_memory = info.has_fetch_shader || may_inline_fetch ||
+                                 info.srt_info.walker != nullptr ||
+                                 info.l_stage == LogicalStage::TessellationControl ||
+                                 info.stage == Stage::Geometry;
+
+    using namespace Common::FS;
+    const auto dump_dir = GetUserPath(PathType::ShaderDir) / "dumps";
+    const auto filename =
+        fmt::format("{}.capture", GetShaderName(info.stage, info.pgm_hash, perm_idx));
+    Shader::WriteShaderCapture(dump_dir / filename, capture);
+}
+
 std::optional<std::vector<u32>> PipelineCache::GetShaderPatch(u64 hash, Shader::Stage stage,
                                                               size_t perm_idx,
                                                               std::string_view ext) {
@@ -5,6 +5,7 @@
 
 #include <variant>
 #include <tsl/robin_map.h>
+#include "shader_recompiler/capture.h"
 #include "shader_recompiler/profile.h"
 #include "shader_recompiler/recompiler.h"
 #include "shader_recompiler/specialization.h"
@@ -50,7 +51,7 @@ struct Program {
 class PipelineCache {
 public:
     explicit PipelineCache(const Instance& instance, Scheduler& scheduler,
-                           AmdGpu::Liverpool* liverpool);
+                           DescriptorHeap& desc_heap, AmdGpu::Liverpool* liverpool);
     ~PipelineCache();
 
     const GraphicsPipeline* GetGraphicsPipeline();
@@ -78,6 +79,7 @@ private:
 
     void DumpShader(std::span<const u32> code, u64 hash, Shader::Stage stage, size_t perm_idx,
                     std::string_view ext);
+    void DumpCapture(Shader::ShaderCapture& capture, const Shader::Info& info, size_t perm_idx);
     std::optional<std::vector<u32>> GetShaderPatch(u64 hash, Shader::Stage stage, size_t perm_idx,
                                                    std::string_view ext);
     vk::ShaderModule CompileModule(Shader::Info& info, Shader::RuntimeInfo& runtime_info,
@@ -89,7 +91,7 @@ private:
     const Instance& instance;
     Scheduler& scheduler;
     AmdGpu::Liverpool* liverpool;
-    DescriptorHeap desc_heap;
+    DescriptorHeap& desc_heap;
     vk::UniquePipelineCache pipeline_cache;
     vk::UniquePipelineLayout pipeline_layout;
     Shader::Profile profile{};
@@ -1,6 +1,7 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <boost/container/small_vector.hpp>
 #include <boost/container/static_vector.hpp>
 
 #include "shader_recompiler/info.h"
@@ -50,11 +51,35 @@ void Pipeline::BindResources(DescriptorWrites& set_writes, const BufferBarriers&
         return;
     }
 
-    const auto desc_set = desc_heap.Commit(*desc_layout);
-    for (auto& set_write : set_writes) {
-        set_write.dstSet = desc_set;
+    // Identical bindings reuse the set written by an earlier draw.
+    boost::container::small_vector<u64, 64> key;
+    key.push_back(std::bit_cast<u64>(*desc_layout));
+    for (const auto& set_write : set_writes) {
+        key.push_back(u64(set_write.dstBinding) << 32 | u64(set_write.dstArrayElement));
+        key.push_back(u64(set_write.descriptorType));
+        for (u32 i = 0; i < set_write.descriptorCount; i++) {
+            if (set_write.pBufferInfo) {
+                const auto& info = set_write.pBufferInfo[i];
+                key.push_back(std::bit_cast<u64>(info.buffer));
+                key.push_back(info.offset);
+                key.push_back(info.range);
+            } else if (set_write.pImageInfo) {
+                const auto& info = set_write.pImageInfo[i];
+                key.push_back(std::bit_cast<u64>(info.sampler));
+                key.push_back(std::bit_cast<u64>(info.imageView));
+                key.push_back(u64(info.imageLayout));
+            } else if (set_write.pTexelBufferView) {
+                key.push_back(std::bit_cast<u64>(set_write.pTexelBufferView[i]));
+            }
+        }
+    }
+    const auto [desc_set, is_cached] = desc_heap.CommitCached(*desc_layout, key);
+    if (!is_cached) {
+        for (auto& set_write : set_writes) {
+            set_write.dstSet = desc_set;
+        }
+        instance.GetDevice().updateDescriptorSets(set_writes, {});
     }
-    instance.GetDevice().updateDescriptorSets(set_writes, {});
     cmdbuf.bindDescriptorSets(bind_point, *pipeline_layout, 0, desc_set, {});
 }
 
@@ -25,6 +25,10 @@
 
 namespace Vulkan {
 
+// Number and format of the presentation frames when rendering without a surface.
+static constexpr u32 HeadlessFrameCount = 3;
+static constexpr vk::Format HeadlessFrameFormat = vk::Format::eB8G8R8A8Unorm;
+
 bool CanBlitToSwapchain(const vk::PhysicalDevice physical_device, vk::Format format) {
     const vk::FormatProperties props{physical_device.getFormatProperties(format)};
     return static_cast<bool>(props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitDst);
@@ -295,11 +299,18 @@ Presenter::Presenter(Frontend::WindowSDL& window_, AmdGpu::Liverpool* liverpool_
     : window{window_}, liverpool{liverpool_},
       instance{window, Config::getGpuId(), Config::vkValidationEnabled(),
                Config::getVkCrashDiagnosticEnabled()},
-      draw_scheduler{instance}, present_scheduler{instance}, flip_scheduler{instance},
-      swapchain{instance, window},
+      draw_scheduler{instance, Config::threadedSubmit()}, present_scheduler{instance},
+      flip_scheduler{instance},
       rasterizer{std::make_unique<Rasterizer>(instance, draw_scheduler, liverpool)},
       texture_cache{rasterizer->GetTextureCache()} {
-    const u32 num_images = swapchain.GetImageCount();
+    u32 num_images = HeadlessFrameCount;
+    if (window.GetWindowInfo().type != Frontend::WindowSystemType::Headless) {
+        swapchain.emplace(instance, window);
+        num_images = swapchain->GetImageCount();
+    } else {
+        // Frames are consumed without a surface, the overlay still needs a renderer.
+        ImGui::Core::Initialize(instance, window, num_images, HeadlessFrameFormat);
+    }
     const vk::Device device = instance.GetDevice();
 
     // Create presentation frames.
@@ -343,7 +354,8 @@ void Presenter::RecreateFrame(Frame* frame, u32 width, u32 height) {
         vmaDestroyImage(instance.GetAllocator(), frame->image, frame->allocation);
     }
 
-    const vk::Format format = swapchain.GetSurfaceFormat().format;
+    const vk::Format format =
+        swapchain ? swapchain->GetSurfaceFormat().format : HeadlessFrameFormat;
     const vk::ImageCreateInfo image_info = {
         .flags = vk::ImageCreateFlagBits::eMutableFormat,
         .imageType = vk::ImageType::e2D,
@@ -397,7 +409,7 @@ void Presenter::RecreateFrame(Frame* frame, u32 width, u32 height) {
     frame->height = height;
 
     frame->imgui_texture = ImGui::Vulkan::AddTexture(view, vk::ImageLayout::eShaderReadOnlyOptimal);
-    frame->is_hdr = swapchain.GetHDR();
+    frame->is_hdr = IsHDR();
 }
 
 Frame* Presenter::PrepareLastFrame() {
@@ -557,6 +569,9 @@ bool Presenter::ShowSplash(Frame* frame /*= nullptr*/) {
 }
 
 Frame* Presenter::PrepareFrameInternal(VideoCore::ImageId image_id, bool is_eop) {
+    // Flips are prepared on the GPU thread, also when submitted from the CPU.
+    rasterizer->GetBufferCache().EndUploadFrame();
+
     // Request a free presentation frame.
     Frame* frame = GetRenderFrame();
 
@@ -564,7 +579,7 @@ Frame* Presenter::PrepareFrameInternal(VideoCore::ImageId image_id, bool is_eop)
         const auto& image = texture_cache.GetImage(image_id);
         const auto extent = image.info.size;
         if (frame->width != extent.width || frame->height != extent.height ||
-            frame->is_hdr != swapchain.GetHDR()) {
+            frame->is_hdr != IsHDR()) {
             RecreateFrame(frame, extent.width, extent.height);
         }
     }
@@ -729,14 +744,29 @@ void Presenter::Present(Frame* frame, bool is_reusing_frame) {
         }
     };
 
+    if (!swapchain) {
+        // Nothing to show, wait for the frame so the pacing and timings include the GPU work.
+        const vk::SemaphoreWaitInfo wait_info = {
+            .semaphoreCount = 1,
+            .pSemaphores = &frame->ready_semaphore,
+            .pValues = &frame->ready_tick,
+        };
+        while (instance.GetDevice().waitSemaphores(&wait_info, std::numeric_limits<u64>::max()) ==
+               vk::Result::eTimeout) {
+        }
+        free_frame();
+        return;
+    }
+
     // Recreate the swapchain if the window was resized.
-    if (window.GetWidth() != swapchain.GetWidth() || window.GetHeight() != swapchain.GetHeight()) {
-        swapchain.Recreate(window.GetWidth(), window.GetHeight());
+    if (window.GetWidth() != swapchain->GetWidth() ||
+        window.GetHeight() != swapchain->GetHeight()) {
+        swapchain->Recreate(window.GetWidth(), window.GetHeight());
     }
 
-    if (!swapchain.AcquireNextImage()) {
-        swapchain.Recreate(window.GetWidth(), window.GetHeight());
-        if (!swapchain.AcquireNextImage()) {
+    if (!swapchain->AcquireNextImage()) {
+        swapchain->Recreate(window.GetWidth(), window.GetHeight());
+        if (!swapchain->AcquireNextImage()) {
             // User resizes the window too fast and GPU can't keep up. Skip this frame.
             LOG_WARNING(Render_Vulkan, "Skipping frame!");
             free_frame();
@@ -751,8 +781,8 @@ void Presenter::Present(Frame* frame, bool is_reusing_frame) {
 
     ImGuiID dockId = ImGui::Core::NewFrame(is_reusing_frame);
 
-    const vk::Image swapchain_image = swapchain.Image();
-    const vk::ImageView swapchain_image_view = swapchain.ImageView();
+    const vk::Image swapchain_image = swapchain->Image();
+    const vk::ImageView swapchain_image_view = swapchain->ImageView();
 
     auto& scheduler = present_scheduler;
     const auto cmdbuf = scheduler.CommandBuffer();
@@ -768,7 +798,7 @@ void Presenter::Present(Frame* frame, bool is_reusing_frame) {
         TracyVkNamedZoneC(profiler_ctx, renderer_gpu_zone, cmdbuf, "Host frame",
                           MarkersPalette::GpuMarkerColor, profiler_ctx != nullptr);
 
-        const vk::Extent2D extent = swapchain.GetExtent();
+        const vk::Extent2D extent = swapchain->GetExtent();
         const std::array pre_barriers{
             vk::ImageMemoryBarrier{
                 .srcAccessMask = vk::AccessFlagBits::eNone,
@@ -848,7 +878,7 @@ void Presenter::Present(Frame* frame, bool is_reusing_frame) {
             ImGui::PopStyleVar(3);
             ImGui::PopStyleColor();
         }
-        ImGui::Core::Render(cmdbuf, swapchain_image_view, swapchain.GetExtent());
+        ImGui::Core::Render(cmdbuf, swapchain_image_view, swapchain->GetExtent());
 
         cmdbuf.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
                                vk::PipelineStageFlagBits::eAllCommands,
@@ -865,16 +895,16 @@ void Presenter::Present(Frame* frame, bool is_reusing_frame) {
 
     // Flush vulkan commands.
     SubmitInfo info{};
-    info.AddWait(swapchain.GetImageAcquiredSemaphore());
+    info.AddWait(swapchain->GetImageAcquiredSemaphore());
     info.AddWait(frame->ready_semaphore, frame->ready_tick);
-    info.AddSignal(swapchain.GetPresentReadySemaphore());
+    info.AddSignal(swapchain->GetPresentReadySemaphore());
     info.AddSignal(frame->present_done);
     scheduler.Flush(info);
 
     // Present to swapchain.
     std::scoped_lock submit_lock{Scheduler::submit_mutex};
-    if (!swapchain.Present()) {
-        swapchain.Recreate(window.GetWidth(), window.GetHeight());
+    if (!swapchain->Present()) {
+        swapchain->Recreate(window.GetWidth(), window.GetHeight());
     }
 
     free_frame();
@@ -883,6 +913,12 @@ void Presenter::Present(Frame* frame, bool is_reusing_frame) {
     }
 }
 
+void Presenter::DiscardFrame(Frame* frame) {
+    std::scoped_lock fl{free_mutex};
+    free_queue.push(frame);
+    free_cv.notify_one();
+}
+
 Frame* Presenter::GetRenderFrame() {
     // Wait for free presentation frames
     Frame* frame;
@@ -915,7 +951,7 @@ Frame* Presenter::GetRenderFrame() {
     }
 
     // Initialize default frame image
-    if (frame->width == 0 || frame->height == 0 || frame->is_hdr != swapchain.GetHDR()) {
+    if (frame->width == 0 || frame->height == 0 || frame->is_hdr != IsHDR()) {
         RecreateFrame(frame, Config::getScreenWidth(), Config::getScreenHeight());
     }
 
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <condition_variable>
+#include <optional>
 
 #include "imgui/imgui_config.h"
 #include "video_core/amdgpu/liverpool.h"
@@ -92,12 +93,25 @@ public:
 
     bool ShowSplash(Frame* frame = nullptr);
     void Present(Frame* frame, bool is_reusing_frame = false);
+
+    /// Returns a frame to the free queue without presenting it.
+    void DiscardFrame(Frame* frame);
+
+    /// Returns true once the GPU has finished rendering the frame.
+    bool IsFrameReady(const Frame* frame) const {
+        const auto [result, counter] =
+            instance.GetDevice().getSemaphoreCounterValue(frame->ready_semaphore);
+        return result == vk::Result::eSuccess && counter >= frame->ready_tick;
+    }
+
     void RecreateFrame(Frame* frame, u32 width, u32 height);
     Frame* PrepareLastFrame();
 
     void FlushDraw() {
         SubmitInfo info{};
         draw_scheduler.Flush(info);
+        // The flip scheduler submits directly, so the draws it reads must reach the queue first.
+        draw_scheduler.WaitWorker();
     }
 
     Rasterizer& GetRasterizer() const {
@@ -105,14 +119,14 @@ public:
     }
 
     bool IsHDRSupported() const {
-        return swapchain.HasHDR();
+        return swapchain && swapchain->HasHDR();
     }
 
     void SetHDR(bool enable) {
         if (!IsHDRSupported()) {
             return;
         }
-        swapchain.SetHDR(enable);
+        swapchain->SetHDR(enable);
         pp_settings.hdr = enable ? 1 : 0;
     }
 
@@ -121,6 +135,10 @@ private:
     Frame* PrepareFrameInternal(VideoCore::ImageId image_id, bool is_eop = true);
     Frame* GetRenderFrame();
 
+    [[nodiscard]] bool IsHDR() const {
+        return swapchain && swapchain->GetHDR();
+    }
+
 private:
     PostProcessSettings pp_settings{};
     vk::UniquePipeline pp_pipeline{};
@@ -133,7 +151,7 @@ private:
     Scheduler draw_scheduler;
     Scheduler present_scheduler;
     Scheduler flip_scheduler;
-    Swapchain swapchain;
+    std::optional<Swapchain> swapchain; ///< Not present in headless mode.
     std::unique_ptr<Rasterizer> rasterizer;
     VideoCore::TextureCache& texture_cache;
     vk::UniqueCommandPool command_pool;
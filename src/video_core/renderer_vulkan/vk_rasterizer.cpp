@@ -3,6 +3,8 @@
 
 #include "common/config.h"
 #include "common/debug.h"
+#include "common/polyfill_thread.h"
+#include "common/thread.h"
 #include "core/memory.h"
 #include "shader_recompiler/runtime_info.h"
 #include "video_core/amdgpu/liverpool.h"
@@ -19,6 +21,13 @@
 
 namespace Vulkan {
 
+constexpr static std::array DescriptorHeapSizes = {
+    vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer, 8192},
+    vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer, 1024},
+    vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage, 8192},
+    vk::DescriptorPoolSize{vk::DescriptorType::eSampler, 1024},
+};
+
 static Shader::PushData MakeUserData(const AmdGpu::Liverpool::Regs& regs) {
     Shader::PushData push_data{};
     push_data.step0 = regs.vgt_instance_step_rate_0;
@@ -35,14 +44,17 @@ static Shader::PushData MakeUserData(const AmdGpu::Liverpool::Regs& regs) {
 
 Rasterizer::Rasterizer(const Instance& instance_, Scheduler& scheduler_,
                        AmdGpu::Liverpool* liverpool_)
-    : instance{instance_}, scheduler{scheduler_}, page_manager{this},
-      buffer_cache{instance, scheduler, liverpool_, texture_cache, page_manager},
-      texture_cache{instance, scheduler, buffer_cache, page_manager}, liverpool{liverpool_},
-      memory{Core::Memory::Instance()}, pipeline_cache{instance, scheduler, liverpool} {
+    : instance{instance_}, scheduler{scheduler_},
+      desc_heap{instance, scheduler.GetMasterSemaphore(), DescriptorHeapSizes}, page_manager{this},
+      buffer_cache{instance, scheduler, desc_heap, liverpool_, texture_cache, page_manager},
+      texture_cache{instance, scheduler, desc_heap, buffer_cache, page_manager},
+      liverpool{liverpool_}, memory{Core::Memory::Instance()},
+      pipeline_cache{instance, scheduler, desc_heap, liverpool} {
     if (!Config::nullGpu()) {
         liverpool->BindRasterizer(this);
     }
     memory->SetRasterizer(this);
+    readback_thread = std::jthread{[this](std::stop_token stoken) { ReadbackThread(stoken); }};
 }
 
 Rasterizer::~Rasterizer() = default;
@@ -291,6 +303,7 @@ void Rasterizer::Draw(bool is_indexed, u32 index_offset) {
     if (is_indexed) {
         buffer_cache.BindIndexBuffer(index_offset);
     }
+    buffer_cache.EndUploadBatch();
 
     BeginRendering(*pipeline, state);
     UpdateDynamicState(*pipeline);
@@ -344,6 +357,7 @@ void Rasterizer::DrawIndirect(bool is_indexed, VAddr arg_address, u32 offset, u3
     if (count_address != 0) {
         std::tie(count_buffer, count_base) = buffer_cache.ObtainBuffer(count_address, 4, false);
     }
+    buffer_cache.EndUploadBatch();
 
     BeginRendering(*pipeline, state);
     UpdateDynamicState(*pipeline);
@@ -394,6 +408,7 @@ void Rasterizer::DispatchDirect() {
     if (!BindResources(pipeline)) {
         return;
     }
+    buffer_cache.EndUploadBatch();
 
     scheduler.EndRendering();
 
@@ -420,6 +435,7 @@ void Rasterizer::DispatchIndirect(VAddr address, u32 offset, u32 size) {
     scheduler.EndRendering();
 
     const auto [buffer, base] = buffer_cache.ObtainBuffer(address + offset, size, false);
+    buffer_cache.EndUploadBatch();
 
     const auto cmdbuf = scheduler.CommandBuffer();
     cmdbuf.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->Handle());
@@ -439,6 +455,43 @@ void Rasterizer::Finish() {
     scheduler.Finish();
 }
 
+void Rasterizer::ScheduleDownloads(Common::UniqueFunction<void>&& on_written) {
+    const u64 image_tick = texture_cache.ScheduleDownloads();
+    const u64 tick = std::max(image_tick, buffer_cache.ScheduleDownloads());
+    std::unique_lock lk{readback_mutex};
+    if (tick == 0 && readback_queue.empty()) {
+        lk.unlock();
+        on_written();
+        return;
+    }
+    readback_queue.push({tick, std::move(on_written)});
+    readback_cv.notify_one();
+}
+
+void Rasterizer::ReadbackThread(std::stop_token stoken) {
+    Common::SetCurrentThreadName("shadPS4:GpuReadback");
+    while (!stoken.stop_requested()) {
+        PendingReadback* readback;
+        {
+            std::unique_lock lk{readback_mutex};
+            Common::CondvarWait(readback_cv, lk, stoken,
+                                [this] { return !readback_queue.empty(); });
+            if (stoken.stop_requested()) {
+                break;
+            }
+            // Stays in the queue until its callback has run, so later ones wait behind it.
+            readback = &readback_queue.front();
+        }
+        if (readback->tick != 0) {
+            texture_cache.CompleteDownloadsUntil(readback->tick);
+            buffer_cache.CompleteDownloadsUntil(readback->tick);
+        }
+        readback->on_written();
+        std::scoped_lock lk{readback_mutex};
+        readback_queue.pop();
+    }
+}
+
 bool Rasterizer::BindResources(const Pipeline* pipeline) {
     if (IsComputeMetaClear(pipeline)) {
         return false;
@@ -448,6 +501,9 @@ bool Rasterizer::BindResources(const Pipeline* pipeline) {
     buffer_barriers.clear();
     buffer_infos.clear();
     image_infos.clear();
+    texture_cache.ResetBoundViews();
+    // Uploads of every buffer bound for the draw are recorded together once it is bound.
+    buffer_cache.BeginUploadBatch();
 
     // Bind resource buffers and textures.
     Shader::Backend::Bindings binding{};
@@ -920,6 +976,9 @@ bool Rasterizer::InvalidateMemory(VAddr addr, u64 size) {
         // Not GPU mapped memory, can skip invalidation logic entirely.
         return false;
     }
+    // Pending GPU writes must land before the CPU modifies the page.
+    buffer_cache.CompleteDownloads(addr, size);
+    texture_cache.CompleteDownloads(addr, size);
     buffer_cache.InvalidateMemory(addr, size);
     texture_cache.InvalidateMemory(addr, size);
     return true;
@@ -940,6 +999,8 @@ void Rasterizer::MapMemory(VAddr addr, u64 size) {
 }
 
 void Rasterizer::UnmapMemory(VAddr addr, u64 size) {
+    buffer_cache.DiscardDownloads(addr, size);
+    texture_cache.DiscardDownloads(addr, size);
     buffer_cache.InvalidateMemory(addr, size);
     texture_cache.UnmapMemory(addr, size);
     page_manager.OnGpuUnmap(addr, size);
@@ -3,6 +3,11 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "common/unique_function.h"
 #include "video_core/buffer_cache/buffer_cache.h"
 #include "video_core/page_manager.h"
 #include "video_core/renderer_vulkan/vk_pipeline_cache.h"
@@ -64,6 +69,10 @@ public:
     u64 Flush();
     void Finish();
 
+    /// Records and submits downloads of GPU modified memory. The callback runs once they are
+    /// written back to guest memory, after the callbacks of earlier calls.
+    void ScheduleDownloads(Common::UniqueFunction<void>&& on_written);
+
     PipelineCache& GetPipelineCache() {
         return pipeline_cache;
     }
@@ -95,9 +104,12 @@ private:
 
     bool IsComputeMetaClear(const Pipeline* pipeline);
 
+    void ReadbackThread(std::stop_token stoken);
+
 private:
     const Instance& instance;
     Scheduler& scheduler;
+    DescriptorHeap desc_heap;
     VideoCore::PageManager page_manager;
     VideoCore::BufferCache buffer_cache;
     VideoCore::TextureCache texture_cache;
@@ -121,6 +133,15 @@ private:
     boost::container::static_vector<BufferBindingInfo, Shader::NumBuffers> buffer_bindings;
     using ImageBindingInfo = std::pair<VideoCore::ImageId, VideoCore::TextureCache::TextureDesc>;
     boost::container::static_vector<ImageBindingInfo, Shader::NumImages> image_bindings;
+
+    struct PendingReadback {
+        u64 tick; ///< Zero if there is nothing to wait for.
+        Common::UniqueFunction<void> on_written;
+    };
+    std::mutex readback_mutex;
+    std::condition_variable_any readback_cv;
+    std::queue<PendingReadback> readback_queue; ///< Completed in order by the readback thread.
+    std::jthread readback_thread;
 };
 
 } // namespace Vulkan
@@ -1,9 +1,13 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
 #include <cstddef>
 #include <optional>
+#include <utility>
+#include <xxhash.h>
 #include "common/assert.h"
+#include "common/logging/log.h"
 #include "common/scope_exit.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
 #include "video_core/renderer_vulkan/vk_master_semaphore.h"
@@ -167,14 +171,88 @@ vk::DescriptorSet DescriptorHeap::Commit(vk::DescriptorSetLayout set_layout) {
     ASSERT_MSG(result == vk::Result::eSuccess,
                "Unexpected error during descriptor set allocation {}", vk::to_string(result));
 
-    // We've changed pool so also reset descriptor batch cache.
+    // We've changed pool so also reset descriptor batch cache. Cached sets of the old pool must
+    // not be bound past its retire tick either.
     descriptor_sets.clear();
+    cached_sets.clear();
     const auto desc_set = desc_sets.back();
     desc_sets.pop_back();
     descriptor_sets[set_key] = std::move(desc_sets);
     return desc_set;
 }
 
+std::pair<vk::DescriptorSet, bool> DescriptorHeap::CommitCached(
+    vk::DescriptorSetLayout set_layout, std::span<const u64> key) {
+    static constexpr size_t MaxCachedSets = 4096;
+
+    DropInvalidatedSets();
+    const u64 hash = XXH3_64bits(key.data(), key.size_bytes());
+    if (const auto it = cached_sets.find(hash);
+        it != cached_sets.end() && std::ranges::equal(it->second.key, key)) {
+        ++cache_hits;
+        ReportCacheStats();
+        return {it->second.set, true};
+    }
+    const auto desc_set = Commit(set_layout);
+    if (cached_sets.size() >= MaxCachedSets) {
+        cached_sets.clear();
+    }
+    cached_sets.insert_or_assign(hash, CachedSet{desc_set, {key.begin(), key.end()}});
+    ++cache_updates;
+    ReportCacheStats();
+    return {desc_set, false};
+}
+
+void DescriptorHeap::InvalidateHandle(u64 handle) {
+    static constexpr size_t MaxInvalidatedHandles = 4096;
+    std::scoped_lock lk{invalidated_mutex};
+    if (is_cache_invalidated) {
+        return;
+    }
+    if (invalidated_handles.size() >= MaxInvalidatedHandles) {
+        // Nothing drained them, the cache may not be in use at all.
+        invalidated_handles.clear();
+        is_cache_invalidated = true;
+        return;
+    }
+    invalidated_handles.push_back(handle);
+}
+
+void DescriptorHeap::DropInvalidatedSets() {
+    std::vector<u64> handles;
+    {
+        std::scoped_lock lk{invalidated_mutex};
+        if (std::exchange(is_cache_invalidated, false)) {
+            cached_sets.clear();
+            return;
+        }
+        if (invalidated_handles.empty()) {
+            return;
+        }
+        handles.swap(invalidated_handles);
+    }
+    std::ranges::sort(handles);
+    for (auto it = cached_sets.begin(); it != cached_sets.end();) {
+        const bool is_invalid = std::ranges::any_of(it->second.key, [&](u64 value) {
+            return std::ranges::binary_search(handles, value);
+        });
+        if (is_invalid) {
+            it = cached_sets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DescriptorHeap::ReportCacheStats() {
+    const u64 lookups = cache_hits + cache_updates;
+    if (lookups % 4096 != 0) {
+        return;
+    }
+    LOG_DEBUG(Render_Vulkan, "Descriptor set cache: {} lookups, {}% hits, {} set updates",
+              lookups, cache_hits * 100 / lookups, cache_updates);
+}
+
 void DescriptorHeap::CreateDescriptorPool() {
     const vk::DescriptorPoolCreateInfo pool_info = {
         .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
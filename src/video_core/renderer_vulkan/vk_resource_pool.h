@@ -4,6 +4,8 @@
 #pragma once
 
 #include <deque>
+#include <mutex>
+#include <span>
 #include <vector>
 #include <boost/container/static_vector.hpp>
 #include <tsl/robin_map.h>
@@ -75,9 +77,22 @@ public:
 
     vk::DescriptorSet Commit(vk::DescriptorSetLayout set_layout);
 
+    /// Returns a set previously committed with the same key and true, or a new set that the
+    /// caller has to write and false. The key holds the layout and every bound handle and range.
+    std::pair<vk::DescriptorSet, bool> CommitCached(vk::DescriptorSetLayout set_layout,
+                                                    std::span<const u64> key);
+
+    /// Drops the cached sets that reference a resource handle which is being destroyed. Safe to
+    /// call from any thread, the sets are dropped on the next cached commit.
+    void InvalidateHandle(u64 handle);
+
 private:
     void CreateDescriptorPool();
 
+    void DropInvalidatedSets();
+
+    void ReportCacheStats();
+
 private:
     vk::Device device;
     MasterSemaphore* master_semaphore;
@@ -87,6 +102,17 @@ private:
     std::deque<std::pair<vk::DescriptorPool, u64>> pending_pools;
     using DescSetBatch = boost::container::static_vector<vk::DescriptorSet, DescriptorSetBatch>;
     tsl::robin_map<u64, DescSetBatch> descriptor_sets;
+
+    struct CachedSet {
+        vk::DescriptorSet set;
+        std::vector<u64> key;
+    };
+    tsl::robin_map<u64, CachedSet> cached_sets;
+    std::mutex invalidated_mutex;
+    std::vector<u64> invalidated_handles;
+    bool is_cache_invalidated{}; ///< Too many handles were queued, drop every cached set.
+    u64 cache_hits{};
+    u64 cache_updates{};
 };
 
 } // namespace Vulkan
@@ -4,6 +4,7 @@
 #include <mutex>
 #include "common/assert.h"
 #include "common/debug.h"
+#include "common/thread.h"
 #include "imgui/renderer/texture_manager.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
 #include "video_core/renderer_vulkan/vk_scheduler.h"
@@ -12,15 +13,19 @@ namespace Vulkan {
 
 std::mutex Scheduler::submit_mutex;
 
-Scheduler::Scheduler(const Instance& instance)
+Scheduler::Scheduler(const Instance& instance, bool threaded)
     : instance{instance}, master_semaphore{instance}, command_pool{instance, &master_semaphore} {
 #if TRACY_GPU_ENABLED
     profiler_scope = reinterpret_cast<tracy::VkCtxScope*>(std::malloc(sizeof(tracy::VkCtxScope)));
 #endif
     AllocateWorkerCommandBuffers();
+    if (threaded) {
+        worker_thread = std::jthread([this](std::stop_token stoken) { WorkerThread(stoken); });
+    }
 }
 
 Scheduler::~Scheduler() {
+    WaitWorker();
 #if TRACY_GPU_ENABLED
     std::free(profiler_scope);
 #endif
@@ -87,6 +92,14 @@ void Scheduler::Wait(u64 tick) {
     master_semaphore.Wait(tick);
 }
 
+void Scheduler::WaitWorker() {
+    if (!worker_thread.joinable()) {
+        return;
+    }
+    std::unique_lock lk{work_mutex};
+    idle_cv.wait(lk, [this] { return work_queue.empty() && !worker_busy; });
+}
+
 void Scheduler::AllocateWorkerCommandBuffers() {
     const vk::CommandBufferBeginInfo begin_info = {
         .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
@@ -108,7 +121,7 @@ void Scheduler::AllocateWorkerCommandBuffers() {
 }
 
 void Scheduler::SubmitExecution(SubmitInfo& info) {
-    std::scoped_lock lk{submit_mutex};
+    std::unique_lock lk{submit_mutex};
     const u64 signal_value = master_semaphore.NextTick();
 
 #if TRACY_GPU_ENABLED
@@ -124,9 +137,37 @@ void Scheduler::SubmitExecution(SubmitInfo& info) {
     ASSERT_MSG(end_result == vk::Result::eSuccess, "Failed to end command buffer: {}",
                vk::to_string(end_result));
 
-    const vk::Semaphore timeline = master_semaphore.Handle();
-    info.AddSignal(timeline, signal_value);
+    const bool has_external_signal = info.fence || !info.signal_semas.empty();
+    info.AddSignal(master_semaphore.Handle(), signal_value);
+
+    if (worker_thread.joinable()) {
+        // Ticks are handed out here, so Wait keeps working while the submission is queued.
+        lk.unlock();
+        {
+            std::scoped_lock work_lk{work_mutex};
+            work_queue.push({current_cmdbuf, info});
+        }
+        work_cv.notify_one();
+        if (has_external_signal) {
+            // The caller may act on binary semaphores or fences right away, like presenting.
+            WaitWorker();
+        }
+    } else {
+        SubmitCommands(current_cmdbuf, info);
+        lk.unlock();
+    }
+
+    master_semaphore.Refresh();
+    AllocateWorkerCommandBuffers();
+
+    // Apply pending operations
+    while (!pending_ops.empty() && IsFree(pending_ops.front().gpu_tick)) {
+        pending_ops.front().callback();
+        pending_ops.pop();
+    }
+}
 
+void Scheduler::SubmitCommands(vk::CommandBuffer cmdbuf, const SubmitInfo& info) {
     static constexpr std::array<vk::PipelineStageFlags, 2> wait_stage_masks = {
         vk::PipelineStageFlagBits::eAllCommands,
         vk::PipelineStageFlagBits::eColorAttachmentOutput,
@@ -145,7 +186,7 @@ void Scheduler::SubmitExecution(SubmitInfo& info) {
         .pWaitSemaphores = info.wait_semas.data(),
         .pWaitDstStageMask = wait_stage_masks.data(),
         .commandBufferCount = 1U,
-        .pCommandBuffers = &current_cmdbuf,
+        .pCommandBuffers = &cmdbuf,
         .signalSemaphoreCount = static_cast<u32>(info.signal_semas.size()),
         .pSignalSemaphores = info.signal_semas.data(),
     };
@@ -153,14 +194,31 @@ void Scheduler::SubmitExecution(SubmitInfo& info) {
     ImGui::Core::TextureManager::Submit();
     auto submit_result = instance.GetGraphicsQueue().submit(submit_info, info.fence);
     ASSERT_MSG(submit_result != vk::Result::eErrorDeviceLost, "Device lost during submit");
+}
 
-    master_semaphore.Refresh();
-    AllocateWorkerCommandBuffers();
-
-    // Apply pending operations
-    while (!pending_ops.empty() && IsFree(pending_ops.front().gpu_tick)) {
-        pending_ops.front().callback();
-        pending_ops.pop();
+void Scheduler::WorkerThread(std::stop_token stoken) {
+    Common::SetCurrentThreadName("shadPS4:GpuSubmit");
+    while (!stoken.stop_requested()) {
+        PendingSubmit submit;
+        {
+            std::unique_lock lk{work_mutex};
+            work_cv.wait(lk, stoken, [this] { return !work_queue.empty(); });
+            if (work_queue.empty()) {
+                break;
+            }
+            submit = std::move(work_queue.front());
+            work_queue.pop();
+            worker_busy = true;
+        }
+        {
+            std::scoped_lock lk{submit_mutex};
+            SubmitCommands(submit.cmdbuf, submit.info);
+        }
+        {
+            std::scoped_lock lk{work_mutex};
+            worker_busy = false;
+        }
+        idle_cv.notify_all();
     }
 }
 
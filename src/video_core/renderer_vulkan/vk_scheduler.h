@@ -4,6 +4,9 @@
 #pragma once
 
 #include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
 #include <boost/container/static_vector.hpp>
 #include "common/types.h"
 #include "common/unique_function.h"
@@ -57,11 +60,15 @@ struct SubmitInfo {
 
 class Scheduler {
 public:
-    explicit Scheduler(const Instance& instance);
+    /// When threaded is set, queue submission is handed off to a worker thread so that the
+    /// recording thread does not block on the driver.
+    explicit Scheduler(const Instance& instance, bool threaded = false);
     ~Scheduler();
 
     /// Sends the current execution context to the GPU
     /// and increments the scheduler timeline semaphore.
+    /// Binary semaphores and fences in the submit info are signalled by a submission that has
+    /// reached the queue by the time this returns, timeline ticks may still be in flight.
     void Flush(SubmitInfo& info);
 
     /// Sends the current execution context to the GPU and waits for it to complete.
@@ -70,6 +77,9 @@ public:
     /// Waits for the given tick to trigger on the GPU.
     void Wait(u64 tick);
 
+    /// Waits for the submit worker to hand every flushed command buffer to the queue.
+    void WaitWorker();
+
     /// Starts a new rendering scope with provided state.
     void BeginRendering(const RenderState& new_state);
 
@@ -113,6 +123,10 @@ private:
 
     void SubmitExecution(SubmitInfo& info);
 
+    void SubmitCommands(vk::CommandBuffer cmdbuf, const SubmitInfo& info);
+
+    void WorkerThread(std::stop_token stoken);
+
 private:
     const Instance& instance;
     MasterSemaphore master_semaphore;
@@ -127,6 +141,16 @@ private:
     RenderState render_state;
     bool is_rendering = false;
     tracy::VkCtxScope* profiler_scope{};
+    struct PendingSubmit {
+        vk::CommandBuffer cmdbuf;
+        SubmitInfo info;
+    };
+    std::mutex work_mutex;
+    std::condition_variable_any work_cv;
+    std::condition_variable_any idle_cv;
+    std::queue<PendingSubmit> work_queue; ///< Submitted in order by the worker thread.
+    bool worker_busy{};
+    std::jthread worker_thread;
 };
 
 } // namespace Vulkan
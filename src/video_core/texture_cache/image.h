@@ -10,6 +10,7 @@
 #include "video_core/texture_cache/image_view.h"
 
 #include <optional>
+#include <tsl/robin_map.h>
 
 namespace Vulkan {
 class Instance;
@@ -28,8 +29,8 @@ enum ImageFlagBits : u32 {
     GpuDirty = 1 << 2, ///< Contents have been modified from the GPU (valid data in buffer cache)
     Dirty = MaybeCpuDirty | CpuDirty | GpuDirty,
     GpuModified = 1 << 3,    ///< Contents have been modified from the GPU
+    DownloadQueued = 1 << 4, ///< Will be written back to guest memory with the next readbacks
     Registered = 1 << 6,     ///< True when the image is registered
-    Picked = 1 << 7,         ///< Temporary flag to mark the image as picked
     MetaRegistered = 1 << 8, ///< True when metadata for this surface is known and registered
 };
 DECLARE_ENUM_FLAG_OPERATORS(ImageFlagBits)
@@ -85,11 +86,8 @@ struct Image {
     }
 
     ImageViewId FindView(const ImageViewInfo& info) const {
-        const auto it = std::ranges::find(image_view_infos, info);
-        if (it == image_view_infos.end()) {
-            return {};
-        }
-        return image_view_ids[std::distance(image_view_infos.begin(), it)];
+        const auto it = image_view_map.find(info);
+        return it != image_view_map.end() ? it->second : ImageViewId{};
     }
 
     void AssociateDepth(ImageId image_id) {
@@ -110,6 +108,11 @@ struct Image {
         return track_addr != 0 && track_addr_end != 0;
     }
 
+    bool IsFullyTracked() const {
+        return track_addr == info.guest_address &&
+               track_addr_end == info.guest_address + info.guest_size;
+    }
+
     const Vulkan::Instance* instance;
     Vulkan::Scheduler* scheduler;
     ImageInfo info;
@@ -118,7 +121,7 @@ struct Image {
     ImageFlagBits flags = ImageFlagBits::Dirty;
     VAddr track_addr = 0;
     VAddr track_addr_end = 0;
-    std::vector<ImageViewInfo> image_view_infos;
+    tsl::robin_map<ImageViewInfo, ImageViewId, ImageViewInfoHash> image_view_map;
     std::vector<ImageViewId> image_view_ids;
     ImageId depth_id{};
 
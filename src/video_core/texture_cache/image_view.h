@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "common/hash.h"
 #include "shader_recompiler/info.h"
 #include "video_core/amdgpu/liverpool.h"
 #include "video_core/amdgpu/resource.h"
@@ -32,6 +33,17 @@ struct ImageViewInfo {
     auto operator<=>(const ImageViewInfo&) const = default;
 };
 
+struct ImageViewInfoHash {
+    [[nodiscard]] size_t operator()(const ImageViewInfo& info) const noexcept {
+        u64 hash = (u64(info.type) << 32) | u64(info.format);
+        hash = HashCombine(hash, (u64(info.range.base.level) << 32) | info.range.base.layer);
+        hash = HashCombine(hash, (u64(info.range.extent.levels) << 32) | info.range.extent.layers);
+        hash = HashCombine(hash, (u64(info.mapping.r) << 48) | (u64(info.mapping.g) << 32) |
+                                     (u64(info.mapping.b) << 16) | u64(info.mapping.a));
+        return HashCombine(hash, u64(info.is_storage));
+    }
+};
+
 struct Image;
 
 constexpr Common::SlotId NULL_IMAGE_VIEW_ID{0};
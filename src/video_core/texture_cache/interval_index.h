@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "common/assert.h"
+#include "common/types.h"
+
+namespace VideoCore {
+
+/**
+ * Index of address ranges answering overlap queries. Entries are kept sorted by start address
+ * under a tree of the maximum end address of each subrange, so a query only walks down to the
+ * entries it reports. Insertions and removals are linear and rebuild the tree right away, they
+ * are rare next to lookups, which stay read-only.
+ */
+template <typename Id>
+class IntervalIndex {
+public:
+    struct Entry {
+        VAddr start;
+        VAddr end;
+        u64 seq; ///< Insertion order
+        Id id;
+    };
+
+    void Insert(VAddr start, VAddr end, Id id) {
+        const auto it = std::ranges::upper_bound(entries, start, {}, &Entry::start);
+        entries.insert(it, {start, end, next_seq++, id});
+        Rebuild();
+    }
+
+    void Erase(VAddr start, Id id) {
+        auto it = std::ranges::lower_bound(entries, start, {}, &Entry::start);
+        while (it != entries.end() && it->start == start && it->id != id) {
+            ++it;
+        }
+        ASSERT_MSG(it != entries.end() && it->start == start, "Erasing unknown range {:#x}",
+                   start);
+        entries.erase(it);
+        Rebuild();
+    }
+
+    /// Calls func for every entry overlapping [start, end), in address order.
+    template <typename Func>
+    void ForEachOverlap(VAddr start, VAddr end, Func&& func) const {
+        const auto last = std::ranges::lower_bound(entries, end, {}, &Entry::start);
+        const size_t count = std::distance(entries.begin(), last);
+        if (count != 0) {
+            Visit(1, 0, leaf_count, count, start, func);
+        }
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return entries.size();
+    }
+
+private:
+    void Rebuild() {
+        leaf_count = std::bit_ceil(std::max<size_t>(entries.size(), 1));
+        max_end.assign(leaf_count * 2, 0);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            max_end[leaf_count + i] = entries[i].end;
+        }
+        for (size_t node = leaf_count - 1; node > 0; --node) {
+            max_end[node] = std::max(max_end[node * 2], max_end[node * 2 + 1]);
+        }
+    }
+
+    /// Visits the entries below node, covering [lo, hi), among the first count entries.
+    template <typename Func>
+    void Visit(size_t node, size_t lo, size_t hi, size_t count, VAddr start, Func& func) const {
+        if (lo >= count || max_end[node] <= start) {
+            return;
+        }
+        if (hi - lo == 1) {
+            func(entries[lo]);
+            return;
+        }
+        const size_t mid = lo + (hi - lo) / 2;
+        Visit(node * 2, lo, mid, count, start, func);
+        Visit(node * 2 + 1, mid, hi, count, start, func);
+    }
+
+    std::vector<Entry> entries;
+    std::vector<VAddr> max_end;
+    size_t leaf_count{};
+    u64 next_seq{};
+};
+
+} // namespace VideoCore
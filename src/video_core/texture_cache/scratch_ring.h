@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+#include "common/alignment.h"
+#include "common/types.h"
+
+namespace VideoCore {
+
+/**
+ * Ring suballocator for transient GPU scratch memory. Allocations are handed out in order and
+ * tagged with the tick of the command buffer using them, and are recycled once the GPU has
+ * passed that tick. It only does the bookkeeping, the caller owns the backing buffer.
+ */
+class ScratchRing {
+public:
+    explicit ScratchRing(u64 capacity_, u64 alignment_)
+        : capacity{capacity_}, alignment{alignment_} {}
+
+    /// Returns the offset of a region of the given size, or std::nullopt if the space still in
+    /// use by the GPU does not leave enough room.
+    [[nodiscard]] std::optional<u64> Allocate(u64 size, u64 tick, u64 gpu_tick) {
+        Release(gpu_tick);
+        size = Common::AlignUp(size, alignment);
+        if (size == 0 || size > capacity) {
+            return std::nullopt;
+        }
+
+        u64 offset;
+        if (live.empty()) {
+            offset = 0;
+        } else if (const u64 tail = live.front().offset; head > tail) {
+            // Used space is [tail, head), try the end first and wrap around if needed.
+            if (head + size <= capacity) {
+                offset = head;
+            } else if (size <= tail) {
+                offset = 0;
+            } else {
+                return std::nullopt;
+            }
+        } else if (head + size <= tail) {
+            // Wrapped around, used space is [tail, capacity) and [0, head).
+            offset = head;
+        } else {
+            return std::nullopt;
+        }
+
+        head = offset + size;
+        live.push_back({offset, size, tick});
+        used += size;
+        peak_used = std::max(peak_used, used);
+        return offset;
+    }
+
+    /// Recycles the allocations whose tick the GPU has passed.
+    void Release(u64 gpu_tick) {
+        while (!live.empty() && live.front().tick <= gpu_tick) {
+            used -= live.front().size;
+            live.pop_front();
+        }
+    }
+
+    [[nodiscard]] u64 Capacity() const noexcept {
+        return capacity;
+    }
+
+    [[nodiscard]] u64 Used() const noexcept {
+        return used;
+    }
+
+    [[nodiscard]] u64 PeakUsed() const noexcept {
+        return peak_used;
+    }
+
+private:
+    struct Allocation {
+        u64 offset;
+        u64 size;
+        u64 tick;
+    };
+
+    u64 capacity;
+    u64 alignment;
+    u64 head{};
+    u64 used{};
+    u64 peak_used{};
+    std::deque<Allocation> live; ///< Oldest allocation first.
+};
+
+} // namespace VideoCore
@@ -4,25 +4,33 @@
 #include <optional>
 #include <xxhash.h>
 
+#include "common/alignment.h"
 #include "common/assert.h"
+#include "common/config.h"
 #include "common/debug.h"
+#include "core/memory.h"
 #include "video_core/buffer_cache/buffer_cache.h"
 #include "video_core/page_manager.h"
 #include "video_core/renderer_vulkan/vk_instance.h"
+#include "video_core/renderer_vulkan/vk_resource_pool.h"
 #include "video_core/renderer_vulkan/vk_scheduler.h"
 #include "video_core/texture_cache/host_compatibility.h"
 #include "video_core/texture_cache/texture_cache.h"
 #include "video_core/texture_cache/tile_manager.h"
 
+#include <vk_mem_alloc.h>
+
 namespace VideoCore {
 
-static constexpr u64 PageShift = 12;
 static constexpr u64 NumFramesBeforeRemoval = 32;
+static constexpr u64 DownloadBufferSize = 64_MB;
 
 TextureCache::TextureCache(const Vulkan::Instance& instance_, Vulkan::Scheduler& scheduler_,
-                           BufferCache& buffer_cache_, PageManager& tracker_)
-    : instance{instance_}, scheduler{scheduler_}, buffer_cache{buffer_cache_}, tracker{tracker_},
-      tile_manager{instance, scheduler} {
+                           Vulkan::DescriptorHeap& desc_heap_, BufferCache& buffer_cache_,
+                           PageManager& tracker_)
+    : instance{instance_}, scheduler{scheduler_}, desc_heap{desc_heap_},
+      buffer_cache{buffer_cache_}, tracker{tracker_}, tile_manager{instance, scheduler},
+      download_buffer{instance, scheduler, MemoryUsage::Download, DownloadBufferSize} {
     ImageInfo info{};
     info.pixel_format = vk::Format::eR8G8B8A8Unorm;
     info.type = vk::ImageType::e2D;
@@ -70,6 +78,11 @@ void TextureCache::InvalidateMemory(VAddr addr, size_t size) {
             // Untrack the image, so that the range is unprotected and the guest can write freely.
             image.flags |= ImageFlagBits::CpuDirty;
             UntrackImage(image_id);
+            // The CPU contents are newer than the render target, drop its readback.
+            if (True(image.flags & ImageFlagBits::DownloadQueued)) {
+                image.flags &= ~ImageFlagBits::DownloadQueued;
+                std::erase(download_queue, image_id);
+            }
         } else if (pages_end < image_end) {
             // This page access may or may not modify the image.
             // We should not mark it as dirty now. If it really was modified
@@ -113,6 +126,201 @@ void TextureCache::UnmapMemory(VAddr cpu_addr, size_t size) {
     }
 }
 
+void TextureCache::QueueDownload(ImageId image_id, Image& image) {
+    if (!Config::readbacks() || image.info.num_samples > 1) {
+        return;
+    }
+    if (image.info.IsTiled() && !GetDetilerType(image.info)) {
+        // There is no way to put the data back in the guest layout.
+        return;
+    }
+    if (Common::AlignUp(image.info.guest_size, 256) > DownloadBufferSize) {
+        // It would never fit in a batch and stay queued forever.
+        return;
+    }
+    std::scoped_lock lock{mutex};
+    if (True(image.flags & ImageFlagBits::DownloadQueued)) {
+        return;
+    }
+    image.flags |= ImageFlagBits::DownloadQueued;
+    download_queue.push_back(image_id);
+}
+
+u64 TextureCache::ScheduleDownloads() {
+    if (!Config::readbacks()) {
+        return 0;
+    }
+    std::unique_lock lock{mutex};
+    boost::container::small_vector<ImageId, 16> images;
+    u64 total_size_bytes = 0;
+    std::erase_if(download_queue, [&](ImageId image_id) {
+        Image& image = slot_images[image_id];
+        const u64 size = Common::AlignUp(image.info.guest_size, 256);
+        if (total_size_bytes + size > DownloadBufferSize) {
+            // Whatever does not fit stays queued for the next batch.
+            return false;
+        }
+        image.flags &= ~ImageFlagBits::DownloadQueued;
+        images.push_back(image_id);
+        total_size_bytes += size;
+        return true;
+    });
+    if (images.empty()) {
+        return 0;
+    }
+
+    std::unique_lock lk{download_mutex};
+    const u64 offset = download_buffer.Map(total_size_bytes).second;
+    // Older downloads in the reused part of the staging buffer are done on the GPU by now.
+    CompleteDownloadsIf([&](const PendingDownload& download) {
+        return download.staging_offset < offset + total_size_bytes &&
+               offset < download.staging_offset + download.info.guest_size;
+    });
+    download_buffer.Commit();
+
+    scheduler.EndRendering();
+    const auto cmdbuf = scheduler.CommandBuffer();
+    const u64 tick = scheduler.CurrentTick();
+    u64 staging_offset = offset;
+    for (const ImageId image_id : images) {
+        Image& image = slot_images[image_id];
+        boost::container::small_vector<vk::BufferImageCopy, 14> image_copy;
+        for (u32 m = 0; m < image.info.resources.levels; m++) {
+            const auto& mip = image.info.mips_layout[m];
+            image_copy.push_back({
+                .bufferOffset = staging_offset + mip.offset,
+                .bufferRowLength = static_cast<u32>(mip.pitch),
+                .bufferImageHeight = static_cast<u32>(mip.height),
+                .imageSubresource{
+                    .aspectMask = image.aspect_mask,
+                    .mipLevel = m,
+                    .baseArrayLayer = 0,
+                    .layerCount = image.info.resources.layers,
+                },
+                .imageOffset = {0, 0, 0},
+                .imageExtent = {std::max(image.info.size.width >> m, 1u),
+                                std::max(image.info.size.height >> m, 1u),
+                                image.info.props.is_volume
+                                    ? std::max(image.info.size.depth >> m, 1u)
+                                    : 1u},
+            });
+        }
+        const auto barriers =
+            image.GetBarriers(vk::ImageLayout::eTransferSrcOptimal,
+                              vk::AccessFlagBits2::eTransferRead,
+                              vk::PipelineStageFlagBits2::eTransfer, {});
+        cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+            .dependencyFlags = vk::DependencyFlagBits::eByRegion,
+            .imageMemoryBarrierCount = static_cast<u32>(barriers.size()),
+            .pImageMemoryBarriers = barriers.data(),
+        });
+        cmdbuf.copyImageToBuffer(image.image, vk::ImageLayout::eTransferSrcOptimal,
+                                 download_buffer.Handle(), image_copy);
+        pending_downloads.push_back({tick, image.info, staging_offset});
+        staging_offset += Common::AlignUp(image.info.guest_size, 256);
+    }
+    const vk::MemoryBarrier2 post_barrier = {
+        .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+        .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+        .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+    };
+    cmdbuf.pipelineBarrier2(vk::DependencyInfo{
+        .memoryBarrierCount = 1,
+        .pMemoryBarriers = &post_barrier,
+    });
+    lock.unlock();
+    WriteDeferredDownloads(lk);
+
+    Vulkan::SubmitInfo info{};
+    scheduler.Flush(info);
+    return tick;
+}
+
+void TextureCache::CompleteDownloadsUntil(u64 tick) {
+    std::unique_lock lk{download_mutex};
+    CompleteDownloadsIf([tick](const PendingDownload& download) { return download.tick <= tick; });
+    WriteDeferredDownloads(lk);
+}
+
+void TextureCache::CompleteDownloads(VAddr addr, size_t size) {
+    std::unique_lock lk{download_mutex};
+    if (pending_downloads.empty()) {
+        return;
+    }
+    const VAddr end_addr = addr + size;
+    CompleteDownloadsIf([&](const PendingDownload& download) {
+        return download.info.guest_address < end_addr &&
+               addr < download.info.guest_address + download.info.guest_size;
+    });
+    WriteDeferredDownloads(lk);
+}
+
+void TextureCache::DiscardDownloads(VAddr addr, size_t size) {
+    std::scoped_lock lk{download_mutex};
+    const VAddr end_addr = addr + size;
+    std::erase_if(pending_downloads, [&](const PendingDownload& download) {
+        return download.info.guest_address < end_addr &&
+               addr < download.info.guest_address + download.info.guest_size;
+    });
+}
+
+template <typename Pred>
+void TextureCache::CompleteDownloadsIf(Pred&& pred) {
+    for (auto it = pending_downloads.begin(); it != pending_downloads.end();) {
+        if (!pred(*it)) {
+            ++it;
+            continue;
+        }
+        scheduler.GetMasterSemaphore()->Wait(it->tick);
+        WriteBackDownload(*it);
+        it = pending_downloads.erase(it);
+    }
+}
+
+void TextureCache::WriteBackDownload(const PendingDownload& download) {
+    const auto& info = download.info;
+    if (!download_buffer.is_coherent) {
+        vmaInvalidateAllocation(instance.GetAllocator(), download_buffer.buffer.allocation,
+                                download.staging_offset, info.guest_size);
+    }
+    const std::span<const u8> staging{
+        download_buffer.mapped_data.data() + download.staging_offset, info.guest_size};
+    const u8* data = staging.data();
+    if (info.IsTiled()) {
+        // Start from the guest contents so that padding in the tiled layout is preserved.
+        download_scratch.resize(info.guest_size);
+        std::memcpy(download_scratch.data(), std::bit_cast<const u8*>(info.guest_address),
+                    info.guest_size);
+        TileImage(info, staging, download_scratch);
+        data = download_scratch.data();
+    }
+    auto* memory = Core::Memory::Instance();
+    const VAddr end_addr = info.guest_address + info.guest_size;
+    for (VAddr addr = info.guest_address; addr < end_addr;) {
+        const VAddr chunk_end = std::min(PageManager::GetNextPageAddr(addr), end_addr);
+        const u32 chunk_size = static_cast<u32>(chunk_end - addr);
+        const u8* src = data + (addr - info.guest_address);
+        // Write through the backing memory so tracked pages keep their protection. Pages outside
+        // of direct memory are written once the locks are released.
+        if (!memory->TryWriteBacking(std::bit_cast<void*>(addr), src, chunk_size)) {
+            deferred_writes.push_back({addr, {src, src + chunk_size}});
+        }
+        addr = chunk_end;
+    }
+}
+
+void TextureCache::WriteDeferredDownloads(std::unique_lock<std::mutex>& lk) {
+    const auto writes = std::move(deferred_writes);
+    deferred_writes.clear();
+    lk.unlock();
+    for (const auto& write : writes) {
+        // Untrack the page and mark its images CPU modified, like a guest write would.
+        InvalidateMemory(write.addr, write.data.size());
+        std::memcpy(std::bit_cast<void*>(write.addr), write.data.data(), write.data.size());
+    }
+}
+
 ImageId TextureCache::ResolveDepthOverlap(const ImageInfo& requested_info, BindingType binding,
                                           ImageId cache_image_id) {
     const auto& cache_image = slot_images[cache_image_id];
@@ -394,15 +602,35 @@ ImageView& TextureCache::RegisterImageView(ImageId image_id, const ImageViewInfo
     }
 
     const ImageViewId view_id = slot_image_views.insert(instance, view_info, image, image_id);
-    image.image_view_infos.emplace_back(view_info);
+    image.image_view_map.emplace(view_info, view_id);
     image.image_view_ids.emplace_back(view_id);
     return slot_image_views[view_id];
 }
 
 ImageView& TextureCache::FindTexture(ImageId image_id, const ImageViewInfo& view_info) {
-    Image& image = slot_images[image_id];
+    // The same T# is often bound to several slots of a draw, skip the refresh and view lookup
+    // while the image stays clean and fully tracked. The memo is only touched on this thread,
+    // deletions from other threads drop it through the generation.
+    const u64 generation = delete_generation.load(std::memory_order_acquire);
+    if (generation != bound_generation) {
+        bound_views.clear();
+        bound_generation = generation;
+    }
+    const auto it = std::ranges::find_if(bound_views, [&](const BoundView& bound) {
+        return bound.image_id == image_id && bound.view_info == view_info;
+    });
+    if (it != bound_views.end()) {
+        const Image& image = slot_images[image_id];
+        if (True(image.flags & ImageFlagBits::Dirty) ||
+            (True(image.flags & ImageFlagBits::Registered) && !image.IsFullyTracked())) {
+            UpdateImage(image_id);
+        }
+        return slot_image_views[it->view_id];
+    }
     UpdateImage(image_id);
-    return RegisterImageView(image_id, view_info);
+    ImageView& image_view = RegisterImageView(image_id, view_info);
+    bound_views.push_back({image_id, view_info, slot_images[image_id].FindView(view_info)});
+    return image_view;
 }
 
 ImageView& TextureCache::FindRenderTarget(BaseDesc& desc) {
@@ -411,6 +639,7 @@ ImageView& TextureCache::FindRenderTarget(BaseDesc& desc) {
     image.flags |= ImageFlagBits::GpuModified;
     image.usage.render_target = 1u;
     UpdateImage(image_id);
+    QueueDownload(image_id, image);
 
     // Register meta data for this color buffer
     if (!(image.flags & ImageFlagBits::MetaRegistered)) {
@@ -452,6 +681,7 @@ ImageView& TextureCache::FindDepthTarget(BaseDesc& desc) {
 
     // If there is a stencil attachment, link depth and stencil.
     if (desc.info.stencil_addr != 0) {
+        std::scoped_lock lock{mutex};
         ImageId stencil_id{};
         ForEachImageInRegion(desc.info.stencil_addr, desc.info.stencil_size,
                              [&](ImageId image_id, Image& image) {
@@ -622,8 +852,8 @@ void TextureCache::RegisterImage(ImageId image_id) {
     ASSERT_MSG(False(image.flags & ImageFlagBits::Registered),
                "Trying to register an already registered image");
     image.flags |= ImageFlagBits::Registered;
-    ForEachPage(image.info.guest_address, image.info.guest_size,
-                [this, image_id](u64 page) { page_table[page].push_back(image_id); });
+    image_index.Insert(image.info.guest_address, image.info.guest_address + image.info.guest_size,
+                       image_id);
 }
 
 void TextureCache::UnregisterImage(ImageId image_id) {
@@ -631,20 +861,7 @@ void TextureCache::UnregisterImage(ImageId image_id) {
     ASSERT_MSG(True(image.flags & ImageFlagBits::Registered),
                "Trying to unregister an already unregistered image");
     image.flags &= ~ImageFlagBits::Registered;
-    ForEachPage(image.info.guest_address, image.info.guest_size, [this, image_id](u64 page) {
-        const auto page_it = page_table.find(page);
-        if (page_it == nullptr) {
-            UNREACHABLE_MSG("Unregistering unregistered page=0x{:x}", page << PageShift);
-            return;
-        }
-        auto& image_ids = *page_it;
-        const auto vector_it = std::ranges::find(image_ids, image_id);
-        if (vector_it == image_ids.end()) {
-            ASSERT_MSG(false, "Unregistering unregistered image in page=0x{:x}", page << PageShift);
-            return;
-        }
-        image_ids.erase(vector_it);
-    });
+    image_index.Erase(image.info.guest_address, image_id);
 }
 
 void TextureCache::TrackImage(ImageId image_id) {
@@ -772,6 +989,17 @@ void TextureCache::DeleteImage(ImageId image_id) {
         surface_metas.erase(meta_info.htile_addr);
     }
 
+    if (True(image.flags & ImageFlagBits::DownloadQueued)) {
+        std::erase(download_queue, image_id);
+    }
+    delete_generation.fetch_add(1, std::memory_order_release);
+
+    // Cached descriptor sets must not outlive the views, their handles may be reused.
+    for (const ImageViewId image_view_id : image.image_view_ids) {
+        const auto& image_view = slot_image_views[image_view_id];
+        desc_heap.InvalidateHandle(std::bit_cast<u64>(*image_view.image_view));
+    }
+
     // Reclaim image and any image views it references.
     scheduler.DeferOperation([this, image_id] {
         Image& image = slot_images[image_id];
@@ -3,14 +3,20 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <tuple>
+#include <vector>
 #include <boost/container/small_vector.hpp>
 #include <tsl/robin_map.h>
 
 #include "common/slot_vector.h"
 #include "video_core/amdgpu/resource.h"
-#include "video_core/multi_level_page_table.h"
 #include "video_core/texture_cache/image.h"
 #include "video_core/texture_cache/image_view.h"
+#include "video_core/texture_cache/interval_index.h"
 #include "video_core/texture_cache/sampler.h"
 #include "video_core/texture_cache/tile_manager.h"
 
@@ -18,6 +24,10 @@ namespace Core::Libraries::VideoOut {
 struct BufferAttributeGroup;
 }
 
+namespace Vulkan {
+class DescriptorHeap;
+}
+
 namespace VideoCore {
 
 class BufferCache;
@@ -35,13 +45,7 @@ DECLARE_ENUM_FLAG_OPERATORS(FindFlags)
 static constexpr u32 MaxInvalidateDist = 12_MB;
 
 class TextureCache {
-    struct Traits {
-        using Entry = boost::container::small_vector<ImageId, 16>;
-        static constexpr size_t AddressSpaceBits = 40;
-        static constexpr size_t FirstLevelBits = 10;
-        static constexpr size_t PageBits = 20;
-    };
-    using PageTable = MultiLevelPageTable<Traits>;
+    static constexpr size_t PageBits = 20;
 
 public:
     enum class BindingType : u32 {
@@ -92,7 +96,8 @@ public:
 
 public:
     TextureCache(const Vulkan::Instance& instance, Vulkan::Scheduler& scheduler,
-                 BufferCache& buffer_cache, PageManager& tracker);
+                 Vulkan::DescriptorHeap& desc_heap, BufferCache& buffer_cache,
+                 PageManager& tracker);
     ~TextureCache();
 
     /// Invalidates any image in the logical page range.
@@ -104,6 +109,20 @@ public:
     /// Evicts any images that overlap the unmapped range.
     void UnmapMemory(VAddr cpu_addr, size_t size);
 
+    /// Records downloads of the render targets drawn since the last call and submits them.
+    /// Returns the tick they complete on, or zero if there was nothing to download.
+    u64 ScheduleDownloads();
+
+    /// Retiles and writes back the pending downloads recorded up to the tick, waiting for the
+    /// GPU to finish it.
+    void CompleteDownloadsUntil(u64 tick);
+
+    /// Writes back pending image downloads overlapping the range, waiting for the GPU if needed.
+    void CompleteDownloads(VAddr addr, size_t size);
+
+    /// Drops pending image downloads overlapping the range without writing them back.
+    void DiscardDownloads(VAddr addr, size_t size);
+
     /// Retrieves the image handle of the image with the provided attributes.
     [[nodiscard]] ImageId FindImage(BaseDesc& desc, FindFlags flags = {});
 
@@ -154,6 +173,11 @@ public:
     /// Registers an image view for provided image
     ImageView& RegisterImageView(ImageId image_id, const ImageViewInfo& view_info);
 
+    /// Forgets the views handed out by FindTexture, called before binding the next draw.
+    void ResetBoundViews() {
+        bound_views.clear();
+    }
+
     bool IsMeta(VAddr address) const {
         return surface_metas.contains(address);
     }
@@ -192,60 +216,35 @@ public:
     void ForEachImageInRegion(VAddr cpu_addr, size_t size, Func&& func) {
         using FuncReturn = typename std::invoke_result<Func, ImageId, Image&>::type;
         static constexpr bool BOOL_BREAK = std::is_same_v<FuncReturn, bool>;
-        boost::container::small_vector<ImageId, 32> images;
-        ForEachPage(cpu_addr, size, [this, &images, cpu_addr, size, func](u64 page) {
-            const auto it = page_table.find(page);
-            if (it == nullptr) {
-                if constexpr (BOOL_BREAK) {
-                    return false;
-                } else {
-                    return;
-                }
-            }
-            for (const ImageId image_id : *it) {
-                Image& image = slot_images[image_id];
-                if (image.flags & ImageFlagBits::Picked) {
-                    continue;
-                }
-                if (!image.Overlaps(cpu_addr, size)) {
-                    continue;
-                }
-                image.flags |= ImageFlagBits::Picked;
-                images.push_back(image_id);
-                if constexpr (BOOL_BREAK) {
-                    if (func(image_id, image)) {
-                        return true;
-                    }
-                } else {
-                    func(image_id, image);
-                }
-            }
-            if constexpr (BOOL_BREAK) {
-                return false;
-            }
+        // Report images by the first page of the region they overlap, then by registration
+        // order. Callers pick among overlapping images in this order.
+        struct Match {
+            u64 page;
+            u64 seq;
+            ImageId image_id;
+        };
+        boost::container::small_vector<Match, 32> matches;
+        const u64 first_page = cpu_addr >> PageBits;
+        image_index.ForEachOverlap(cpu_addr, cpu_addr + size, [&](const auto& entry) {
+            const u64 page = std::max<u64>(entry.start >> PageBits, first_page);
+            matches.push_back({page, entry.seq, entry.id});
         });
-        for (const ImageId image_id : images) {
-            slot_images[image_id].flags &= ~ImageFlagBits::Picked;
-        }
-    }
-
-private:
-    /// Iterate over all page indices in a range
-    template <typename Func>
-    static void ForEachPage(PAddr addr, size_t size, Func&& func) {
-        static constexpr bool RETURNS_BOOL = std::is_same_v<std::invoke_result<Func, u64>, bool>;
-        const u64 page_end = (addr + size - 1) >> Traits::PageBits;
-        for (u64 page = addr >> Traits::PageBits; page <= page_end; ++page) {
-            if constexpr (RETURNS_BOOL) {
-                if (func(page)) {
-                    break;
+        std::ranges::sort(matches, [](const Match& lhs, const Match& rhs) {
+            return std::tie(lhs.page, lhs.seq) < std::tie(rhs.page, rhs.seq);
+        });
+        for (const Match& match : matches) {
+            Image& image = slot_images[match.image_id];
+            if constexpr (BOOL_BREAK) {
+                if (func(match.image_id, image)) {
+                    return;
                 }
             } else {
-                func(page);
+                func(match.image_id, image);
             }
         }
     }
 
+private:
     /// Create an image from the given parameters
     [[nodiscard]] ImageId InsertImage(const ImageInfo& info, VAddr cpu_addr);
 
@@ -276,17 +275,57 @@ private:
         DeleteImage(image_id);
     }
 
+    /// Queues a render target for the next readback batch.
+    void QueueDownload(ImageId image_id, Image& image);
+
+    struct PendingDownload {
+        u64 tick;
+        ImageInfo info;
+        u64 staging_offset;
+    };
+
+    /// Writes back and removes the pending downloads matching the predicate, in tick order.
+    template <typename Pred>
+    void CompleteDownloadsIf(Pred&& pred);
+
+    void WriteBackDownload(const PendingDownload& download);
+
+    /// Releases the download lock and performs the writes that could not go through the backing
+    /// memory, invalidating the images they overlap first. The cache lock must not be held.
+    void WriteDeferredDownloads(std::unique_lock<std::mutex>& lk);
+
+    struct BoundView {
+        ImageId image_id;
+        ImageViewInfo view_info;
+        ImageViewId view_id;
+    };
+
 private:
     const Vulkan::Instance& instance;
     Vulkan::Scheduler& scheduler;
+    Vulkan::DescriptorHeap& desc_heap;
     BufferCache& buffer_cache;
     PageManager& tracker;
     TileManager tile_manager;
     Common::SlotVector<Image> slot_images;
     Common::SlotVector<ImageView> slot_image_views;
     tsl::robin_map<u64, Sampler> samplers;
-    PageTable page_table;
+    IntervalIndex<ImageId> image_index;
     std::mutex mutex;
+    StreamBuffer download_buffer;
+    std::vector<ImageId> download_queue;
+    std::mutex download_mutex;
+    std::deque<PendingDownload> pending_downloads;
+    std::vector<u8> download_scratch;
+    struct DeferredWrite {
+        VAddr addr;
+        std::vector<u8> data;
+    };
+    std::vector<DeferredWrite> deferred_writes;
+    boost::container::small_vector<BoundView, 16> bound_views; ///< Memo of FindTexture per draw.
+    u64 bound_generation{};
+    /// Bumped by image deletion on any thread, drops the memo on its next use.
+    std::atomic<u64> delete_generation{};
 
     struct MetaDataInfo {
         enum class Type {
@@ -24,47 +24,13 @@
 
 namespace VideoCore {
 
+static constexpr u64 ScratchBufferSize = 64_MB;
+// Larger outputs would take a big part of the ring, give them a buffer of their own.
+static constexpr u64 MaxScratchAllocSize = 16_MB;
+
 const DetilerContext* TileManager::GetDetiler(const ImageInfo& info) const {
-    const auto bpp = info.num_bits * (info.props.is_block ? 16 : 1);
-    switch (info.tiling_mode) {
-    case AmdGpu::TilingMode::Texture_MicroTiled:
-        switch (bpp) {
-        case 8:
-            return &detilers[DetilerType::Micro8];
-        case 16:
-            return &detilers[DetilerType::Micro16];
-        case 32:
-            return &detilers[DetilerType::Micro32];
-        case 64:
-            return &detilers[DetilerType::Micro64];
-        case 128:
-            return &detilers[DetilerType::Micro128];
-        default:
-            return nullptr;
-        }
-    case AmdGpu::TilingMode::Texture_Volume:
-        switch (bpp) {
-        case 8:
-            return &detilers[DetilerType::Macro8];
-        case 32:
-            return &detilers[DetilerType::Macro32];
-        case 64:
-            return &detilers[DetilerType::Macro64];
-        default:
-            return nullptr;
-        }
-        break;
-    case AmdGpu::TilingMode::Display_MicroTiled:
-        switch (bpp) {
-        case 64:
-            return &detilers[DetilerType::Display_Micro64];
-        default:
-            return nullptr;
-        }
-        break;
-    default:
-        return nullptr;
-    }
+    const auto type = GetDetilerType(info);
+    return type ? &detilers[*type] : nullptr;
 }
 
 struct DetilerParams {
@@ -75,7 +41,17 @@ struct DetilerParams {
 };
 
 TileManager::TileManager(const Vulkan::Instance& instance, Vulkan::Scheduler& scheduler)
-    : instance{instance}, scheduler{scheduler} {
+    : instance{instance}, scheduler{scheduler},
+      scratch_buffer{instance,
+                     scheduler,
+                     MemoryUsage::DeviceLocal,
+                     0,
+                     vk::BufferUsageFlagBits::eStorageBuffer |
+                         vk::BufferUsageFlagBits::eTransferSrc,
+                     ScratchBufferSize},
+      scratch_ring{ScratchBufferSize, instance.StorageMinAlignment()} {
+    Vulkan::SetObjectName(instance.GetDevice(), scratch_buffer.Handle(), "Detiler Scratch Buffer");
+
     static const std::array detiler_shaders{
         HostShaders::MICRO_8BPP_COMP,          HostShaders::MICRO_16BPP_COMP,
         HostShaders::MICRO_32BPP_COMP,         HostShaders::MICRO_64BPP_COMP,
@@ -205,6 +181,40 @@ void TileManager::FreeBuffer(ScratchBuffer buffer) {
     vmaDestroyBuffer(instance.GetAllocator(), buffer.first, buffer.second);
 }
 
+std::pair<vk::Buffer, u32> TileManager::AllocScratch(u32 size) {
+    if (size <= MaxScratchAllocSize) {
+        const u64 gpu_tick = scheduler.GetMasterSemaphore()->KnownGpuTick();
+        if (const auto offset = scratch_ring.Allocate(size, scheduler.CurrentTick(), gpu_tick)) {
+            ++ring_allocs;
+            ReportScratchStats();
+            return {scratch_buffer.Handle(), static_cast<u32>(*offset)};
+        }
+    }
+
+    // Oversized output, or the ring is still busy on the GPU.
+    const auto buffer = AllocBuffer(size, true);
+    ++dedicated_allocs;
+    dedicated_used += size;
+    peak_dedicated_used = std::max(peak_dedicated_used, dedicated_used);
+    scheduler.DeferOperation([=, this]() {
+        FreeBuffer(buffer);
+        dedicated_used -= size;
+    });
+    ReportScratchStats();
+    return {buffer.first, 0};
+}
+
+void TileManager::ReportScratchStats() {
+    if ((ring_allocs + dedicated_allocs) % 1024 != 0) {
+        return;
+    }
+    LOG_DEBUG(Render_Vulkan,
+              "Detiler scratch: {} ring and {} dedicated allocations, peak {} KiB of {} KiB ring, "
+              "peak {} KiB dedicated",
+              ring_allocs, dedicated_allocs, scratch_ring.PeakUsed() / 1024,
+              scratch_ring.Capacity() / 1024, peak_dedicated_used / 1024);
+}
+
 std::pair<vk::Buffer, u32> TileManager::TryDetile(vk::Buffer in_buffer, u32 in_offset,
                                                   const ImageInfo& info) {
     if (!info.props.is_tiled) {
@@ -225,8 +235,7 @@ std::pair<vk::Buffer, u32> TileManager::TryDetile(vk::Buffer in_buffer, u32 in_o
     const u32 image_size = info.guest_size;
 
     // Prepare output buffer
-    auto out_buffer = AllocBuffer(image_size, true);
-    scheduler.DeferOperation([=, this]() { FreeBuffer(out_buffer); });
+    const auto [out_buffer, out_offset] = AllocScratch(image_size);
 
     auto cmdbuf = scheduler.CommandBuffer();
     cmdbuf.bindPipeline(vk::PipelineBindPoint::eCompute, *detiler->pl);
@@ -238,8 +247,8 @@ std::pair<vk::Buffer, u32> TileManager::TryDetile(vk::Buffer in_buffer, u32 in_o
     };
 
     const vk::DescriptorBufferInfo output_buffer_info{
-        .buffer = out_buffer.first,
-        .offset = 0,
+        .buffer = out_buffer,
+        .offset = out_offset,
         .range = image_size,
     };
 
@@ -290,7 +299,7 @@ std::pair<vk::Buffer, u32> TileManager::TryDetile(vk::Buffer in_buffer, u32 in_o
     const auto bpp = info.num_bits * (info.props.is_block ? 16u : 1u);
     const auto num_tiles = image_size / (64 * (bpp / 8));
     cmdbuf.dispatch(num_tiles, 1, 1);
-    return {out_buffer.first, 0};
+    return {out_buffer, out_offset};
 }
 
 } // namespace VideoCore
@@ -5,28 +5,14 @@
 
 #include "common/types.h"
 #include "video_core/buffer_cache/buffer.h"
+#include "video_core/texture_cache/scratch_ring.h"
+#include "video_core/texture_cache/tiler.h"
 
 namespace VideoCore {
 
 class TextureCache;
 struct ImageInfo;
 
-enum DetilerType : u32 {
-    Micro8,
-    Micro16,
-    Micro32,
-    Micro64,
-    Micro128,
-
-    Macro8,
-    Macro32,
-    Macro64,
-
-    Display_Micro64,
-
-    Max
-};
-
 struct DetilerContext {
     vk::UniquePipeline pl;
     vk::UniquePipelineLayout pl_layout;
@@ -49,11 +35,22 @@ public:
 private:
     const DetilerContext* GetDetiler(const ImageInfo& info) const;
 
+    /// Returns scratch space for a detiler output, released once the GPU is done with it.
+    std::pair<vk::Buffer, u32> AllocScratch(u32 size);
+
+    void ReportScratchStats();
+
 private:
     const Vulkan::Instance& instance;
     Vulkan::Scheduler& scheduler;
     vk::UniqueDescriptorSetLayout desc_layout;
     std::array<DetilerContext, DetilerType::Max> detilers;
+    Buffer scratch_buffer;
+    ScratchRing scratch_ring;
+    u64 ring_allocs{};
+    u64 dedicated_allocs{};
+    u64 dedicated_used{};
+    u64 peak_dedicated_used{};
 };
 
 } // namespace VideoCore
@@ -0,0 +1,441 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <array>
+#include <cstring>
+
+#include "common/alignment.h"
+#include "common/arch.h"
+#include "common/assert.h"
+#include "common/div_ceil.h"
+#include "video_core/texture_cache/image_info.h"
+#include "video_core/texture_cache/tiler.h"
+
+#ifdef ARCH_X86_64
+#include <emmintrin.h>
+#endif
+
+namespace VideoCore {
+
+namespace {
+
+constexpr u32 MicroTileDim = 8;
+
+// Tile element order of the Texture_Volume and Display_MicroTiled detilers, as packed in the
+// shaders: byte x % 4 of dword (x + y * 8) / 4 is the index of texel (x, y) in the tile, one
+// table per slice of a thick tile.
+// clang-format off
+constexpr std::array<std::array<u32, 16>, 4> Macro8Lut = {{
+    {{
+        0x05040100, 0x45444140,
+        0x07060302, 0x47464342,
+        0x0d0c0908, 0x4d4c4948,
+        0x0f0e0b0a, 0x4f4e4b4a,
+        0x85848180, 0xc5c4c1c0,
+        0x87868382, 0xc7c6c3c2,
+        0x8d8c8988, 0xcdccc9c8,
+        0x8f8e8b8a, 0xcfcecbca,
+    }},
+    {{
+        0x15141110, 0x55545150,
+        0x17161312, 0x57565352,
+        0x1d1c1918, 0x5d5c5958,
+        0x1f1e1b1a, 0x5f5e5b5a,
+        0x95949190, 0xd5d4d1d0,
+        0x97969392, 0xd7d6d3d2,
+        0x9d9c9998, 0xdddcd9d8,
+        0x9f9e9b9a, 0xdfdedbda,
+    }},
+    {{
+        0x25242120, 0x65646160,
+        0x27262322, 0x67666362,
+        0x2d2c2928, 0x6d6c6968,
+        0x2f2e2b2a, 0x6f6e6b6a,
+        0xa5a4a1a0, 0xe5e4e1e0,
+        0xa7a6a3a2, 0xe7e6e3e2,
+        0xadaca9a8, 0xedece9e8,
+        0xafaeabaa, 0xefeeebea,
+    }},
+    {{
+        0x35343130, 0x75747170,
+        0x37363332, 0x77767372,
+        0x3d3c3938, 0x7d7c7978,
+        0x3f3e3b3a, 0x7f7e7b7a,
+        0xb5b4b1b0, 0xf5f4f1f0,
+        0xb7b6b3b2, 0xf7f6f3f2,
+        0xbdbcb9b8, 0xfdfcf9f8,
+        0xbfbebbba, 0xfffefbfa,
+    }},
+}};
+
+constexpr std::array<std::array<u32, 16>, 4> Macro32Lut = {{
+    {{
+        0x05040100, 0x45444140,
+        0x07060302, 0x47464342,
+        0x15141110, 0x55545150,
+        0x17161312, 0x57565352,
+        0x85848180, 0xc5c4c1c0,
+        0x87868382, 0xc7c6c3c2,
+        0x95949190, 0xd5d4d1d0,
+        0x97969392, 0xd7d6d3d2,
+    }},
+    {{
+        0x0d0c0908, 0x4d4c4948,
+        0x0f0e0b0a, 0x4f4e4b4a,
+        0x1d1c1918, 0x5d5c5958,
+        0x1f1e1b1a, 0x5f5e5b5a,
+        0x8d8c8988, 0xcdccc9c8,
+        0x8f8e8b8a, 0xcfcecbca,
+        0x9d9c9998, 0xdddcd9d8,
+        0x9f9e9b9a, 0xdfdedbda,
+    }},
+    {{
+        0x25242120, 0x65646160,
+        0x27262322, 0x67666362,
+        0x35343130, 0x75747170,
+        0x37363332, 0x77767372,
+        0xa5a4a1a0, 0xe5e4e1e0,
+        0xa7a6a3a2, 0xe7e6e3e2,
+        0xb5b4b1b0, 0xf5f4f1f0,
+        0xb7b6b3b2, 0xf7f6f3f2,
+    }},
+    {{
+        0x2d2c2928, 0x6d6c6968,
+        0x2f2e2b2a, 0x6f6e6b6a,
+        0x3d3c3938, 0x7d7c7978,
+        0x3f3e3b3a, 0x7f7e7b7a,
+        0xadaca9a8, 0xedece9e8,
+        0xafaeabaa, 0xefeeebea,
+        0xbdbcb9b8, 0xfdfcf9f8,
+        0xbfbebbba, 0xfffefbfa,
+    }},
+}};
+
+constexpr std::array<std::array<u32, 16>, 4> Macro64Lut = {{
+    {{
+        0x09080100, 0x49484140,
+        0x0b0a0302, 0x4a4b4342,
+        0x19181110, 0x59585150,
+        0x1b1a1312, 0x5a5b5352,
+        0x89888180, 0xc9c8c1c0,
+        0x8b8a8382, 0xcacbc3c2,
+        0x99989190, 0xd9d8d1d0,
+        0x9b9a9392, 0xdbdad3d2,
+    }},
+    {{
+        0x0d0c0504, 0x4d4c4544,
+        0x0f0e0706, 0x4f4e4746,
+        0x1d1c1514, 0x5d5c5554,
+        0x1f1e1716, 0x5f5e5756,
+        0x8d8c8584, 0xcdccc5c4,
+        0x8f8e8786, 0xcfcec7c6,
+        0x9d9c9594, 0xdddcd5d4,
+        0x9f9e9796, 0xdfded7d6,
+    }},
+    {{
+        0x29282120, 0x69686160,
+        0x2b2a2322, 0x6b6a6362,
+        0x39383130, 0x79787170,
+        0x3b3a3332, 0x7b7a7372,
+        0xa9a8a1a0, 0xe9e8e1e0,
+        0xabaaa3a2, 0xebeae3e2,
+        0xb9b8b1b0, 0xf9f8f1f0,
+        0xbbbab3b2, 0xfbfaf3f2,
+    }},
+    {{
+        0x2d2c2524, 0x6d6c6564,
+        0x2f2e2726, 0x6f6e6766,
+        0x3d3c3534, 0x7d7c7574,
+        0x3f3e3736, 0x7f7e7776,
+        0xadaca5a4, 0xedece5e4,
+        0xafaea7a6, 0xefeee7e6,
+        0xbdbcb5b4, 0xfdfcf5f4,
+        0xbfbeb7b6, 0xfffef7f6,
+    }},
+}};
+
+constexpr std::array<u32, 16> DisplayMicro64Lut = {
+    0x05040100, 0x0d0c0908,
+    0x07060302, 0x0f0e0b0a,
+    0x15141110, 0x1d1c1918,
+    0x17161312, 0x1f1e1b1a,
+    0x25242120, 0x2d2c2928,
+    0x27262322, 0x2f2e2b2a,
+    0x35343130, 0x3d3c3938,
+    0x37363332, 0x3f3e3b3a,
+};
+// clang-format on
+
+/// Element order of the tiles handled by one detiler, indexed by slice % thickness and then by
+/// x + y * 8 within the tile.
+struct TileShape {
+    u32 bytes_per_element;
+    u32 thickness;
+    bool is_morton;
+    bool contiguous_pairs; ///< Texels 2n and 2n + 1 of a row are adjacent in the tile.
+    std::array<std::array<u8, 64>, 4> lut;
+};
+
+constexpr std::array<u8, 64> UnpackLut(const std::array<u32, 16>& packed) {
+    std::array<u8, 64> lut{};
+    for (u32 i = 0; i < lut.size(); ++i) {
+        lut[i] = static_cast<u8>(packed[i / 4] >> (8 * (i % 4)));
+    }
+    return lut;
+}
+
+/// Non-displayable thin micro tiles interleave the coordinate bits as x0 y0 x1 y1 x2 y2.
+constexpr std::array<u8, 64> MortonLut() {
+    std::array<u8, 64> lut{};
+    for (u32 y = 0; y < MicroTileDim; ++y) {
+        for (u32 x = 0; x < MicroTileDim; ++x) {
+            u32 index = 0;
+            for (u32 bit = 0; bit < 3; ++bit) {
+                index |= ((x >> bit) & 1) << (2 * bit);
+                index |= ((y >> bit) & 1) << (2 * bit + 1);
+            }
+            lut[x + y * MicroTileDim] = static_cast<u8>(index);
+        }
+    }
+    return lut;
+}
+
+constexpr TileShape MakeShape(u32 bytes_per_element, u32 thickness,
+                              const std::array<std::array<u8, 64>, 4>& lut, bool is_morton) {
+    bool contiguous_pairs = true;
+    for (u32 z = 0; z < thickness; ++z) {
+        for (u32 i = 0; i < 64; i += 2) {
+            contiguous_pairs &= lut[z][i + 1] == lut[z][i] + 1;
+        }
+    }
+    return {bytes_per_element, thickness, is_morton, contiguous_pairs, lut};
+}
+
+constexpr TileShape MakeMicroShape(u32 bytes_per_element) {
+    return MakeShape(bytes_per_element, 1, {MortonLut()}, true);
+}
+
+constexpr TileShape MakeThickShape(u32 bytes_per_element,
+                                   const std::array<std::array<u32, 16>, 4>& packed) {
+    return MakeShape(bytes_per_element, 4,
+                     {UnpackLut(packed[0]), UnpackLut(packed[1]), UnpackLut(packed[2]),
+                      UnpackLut(packed[3])},
+                     false);
+}
+
+constexpr std::array<TileShape, DetilerType::Max> TileShapes = {
+    MakeMicroShape(1),
+    MakeMicroShape(2),
+    MakeMicroShape(4),
+    MakeMicroShape(8),
+    MakeMicroShape(16),
+    MakeThickShape(1, Macro8Lut),
+    MakeThickShape(4, Macro32Lut),
+    MakeThickShape(8, Macro64Lut),
+    MakeShape(8, 1, {UnpackLut(DisplayMicro64Lut)}, false),
+};
+
+#ifdef ARCH_X86_64
+/// Converts eight rows of 32bpp micro tiles. A tile stores 2x2 texel quads, so two quads side
+/// by side hold four texels of two rows, which a 64-bit unpack puts back in place.
+template <bool ToTiled>
+void CopyMicro32Rows(const u8* src, u8* dst, u64 tiled, u64 linear, u32 tiles_per_row,
+                     u64 row_size) {
+    const auto load = [src](u64 offset) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+    };
+    const auto store = [dst](u64 offset, __m128i value) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + offset), value);
+    };
+    for (u32 tx = 0; tx < tiles_per_row; ++tx, tiled += 256, linear += 32) {
+        for (u32 quad_row = 0; quad_row < 4; ++quad_row) {
+            // y1 and y2 select the quads at tile offsets 32 and 128, x2 the ones at offset 64.
+            const u32 y = (quad_row & 1) * 2 + (quad_row >> 1) * 4;
+            for (u32 half = 0; half < 2; ++half) {
+                const u64 quads = tiled + (quad_row & 1) * 32 + (quad_row >> 1) * 128 + half * 64;
+                const u64 row0 = linear + y * row_size + half * 16;
+                const u64 row1 = row0 + row_size;
+                if constexpr (ToTiled) {
+                    const __m128i r0 = load(row0);
+                    const __m128i r1 = load(row1);
+                    store(quads, _mm_unpacklo_epi64(r0, r1));
+                    store(quads + 16, _mm_unpackhi_epi64(r0, r1));
+                } else {
+                    const __m128i q0 = load(quads);
+                    const __m128i q1 = load(quads + 16);
+                    store(row0, _mm_unpacklo_epi64(q0, q1));
+                    store(row1, _mm_unpackhi_epi64(q0, q1));
+                }
+            }
+        }
+    }
+}
+#endif
+
+template <u32 Bpe, bool ToTiled>
+void CopyMip(const TileShape& shape, const TiledMipLayout& mip, const u8* src, u8* dst) {
+    const auto copy = [src, dst]<u32 Size>(u64 tiled, u64 linear) {
+        if constexpr (ToTiled) {
+            std::memcpy(dst + tiled, src + linear, Size);
+        } else {
+            std::memcpy(dst + linear, src + tiled, Size);
+        }
+    };
+
+    const u32 tiles_per_row = mip.pitch / MicroTileDim;
+    const u64 tiles_per_slice = tiles_per_row * Common::DivCeil(mip.height, MicroTileDim);
+    const u64 tile_size = MicroTileDim * MicroTileDim * shape.thickness * Bpe;
+    const u64 row_size = u64(mip.pitch) * Bpe;
+    for (u32 z = 0; z < mip.num_slices; ++z) {
+        const auto& lut = shape.lut[z % shape.thickness];
+        const u64 tiled_slice = mip.offset + (z / shape.thickness) * tiles_per_slice * tile_size;
+        const u64 linear_slice = mip.offset + z * row_size * mip.height;
+        u32 y = 0;
+#ifdef ARCH_X86_64
+        if constexpr (Bpe == 4) {
+            if (shape.is_morton) {
+                for (; y + MicroTileDim <= mip.height; y += MicroTileDim) {
+                    const u64 tiled = tiled_slice + (y / MicroTileDim) * tiles_per_row * tile_size;
+                    CopyMicro32Rows<ToTiled>(src, dst, tiled, linear_slice + y * row_size,
+                                             tiles_per_row, row_size);
+                }
+            }
+        }
+#endif
+        for (; y < mip.height; ++y) {
+            const u8* row_lut = &lut[(y % MicroTileDim) * MicroTileDim];
+            u64 tiled = tiled_slice + (y / MicroTileDim) * tiles_per_row * tile_size;
+            u64 linear = linear_slice + y * row_size;
+            for (u32 tx = 0; tx < tiles_per_row; ++tx, tiled += tile_size) {
+                for (u32 x = 0; x < MicroTileDim; x += 2, linear += 2 * Bpe) {
+                    if (shape.contiguous_pairs) {
+                        copy.template operator()<2 * Bpe>(tiled + row_lut[x] * Bpe, linear);
+                    } else {
+                        copy.template operator()<Bpe>(tiled + row_lut[x] * Bpe, linear);
+                        copy.template operator()<Bpe>(tiled + row_lut[x + 1] * Bpe, linear + Bpe);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <bool ToTiled>
+void CopyMip(DetilerType type, const TiledMipLayout& mip, std::span<const u8> src,
+             std::span<u8> dst) {
+    const TileShape& shape = TileShapes[type];
+    ASSERT_MSG(mip.pitch % MicroTileDim == 0, "Unaligned tiled pitch {}", mip.pitch);
+    const u64 bpe = shape.bytes_per_element;
+    const u64 tiled_size = u64(mip.pitch) * Common::AlignUp(mip.height, MicroTileDim) * bpe *
+                           Common::AlignUp(mip.num_slices, shape.thickness);
+    const u64 linear_size = u64(mip.pitch) * mip.height * mip.num_slices * bpe;
+    ASSERT(mip.offset + (ToTiled ? linear_size : tiled_size) <= src.size());
+    ASSERT(mip.offset + (ToTiled ? tiled_size : linear_size) <= dst.size());
+
+    switch (shape.bytes_per_element) {
+    case 1:
+        return CopyMip<1, ToTiled>(shape, mip, src.data(), dst.data());
+    case 2:
+        return CopyMip<2, ToTiled>(shape, mip, src.data(), dst.data());
+    case 4:
+        return CopyMip<4, ToTiled>(shape, mip, src.data(), dst.data());
+    case 8:
+        return CopyMip<8, ToTiled>(shape, mip, src.data(), dst.data());
+    case 16:
+        return CopyMip<16, ToTiled>(shape, mip, src.data(), dst.data());
+    default:
+        UNREACHABLE();
+    }
+}
+
+TiledMipLayout GetMipLayout(const ImageInfo& info, DetilerType type, u32 level) {
+    const auto& mip = info.mips_layout[level];
+    const u32 block_dim = info.props.is_block ? 4 : 1;
+    const u32 pitch = mip.pitch / block_dim;
+    const u32 height = mip.height / block_dim;
+    const u64 slice_size = u64(pitch) * Common::AlignUp(height, MicroTileDim) *
+                           TileShapes[type].bytes_per_element;
+    return {
+        .pitch = pitch,
+        .height = height,
+        .num_slices = static_cast<u32>(mip.size / slice_size),
+        .offset = mip.offset,
+    };
+}
+
+} // Anonymous namespace
+
+std::optional<DetilerType> GetDetilerType(const ImageInfo& info) {
+    const auto bpp = info.num_bits * (info.props.is_block ? 16 : 1);
+    switch (info.tiling_mode) {
+    case AmdGpu::TilingMode::Texture_MicroTiled:
+        switch (bpp) {
+        case 8:
+            return DetilerType::Micro8;
+        case 16:
+            return DetilerType::Micro16;
+        case 32:
+            return DetilerType::Micro32;
+        case 64:
+            return DetilerType::Micro64;
+        case 128:
+            return DetilerType::Micro128;
+        default:
+            return std::nullopt;
+        }
+    case AmdGpu::TilingMode::Texture_Volume:
+        switch (bpp) {
+        case 8:
+            return DetilerType::Macro8;
+        case 32:
+            return DetilerType::Macro32;
+        case 64:
+            return DetilerType::Macro64;
+        default:
+            return std::nullopt;
+        }
+    case AmdGpu::TilingMode::Display_MicroTiled:
+        switch (bpp) {
+        case 64:
+            return DetilerType::Display_Micro64;
+        default:
+            return std::nullopt;
+        }
+    default:
+        return std::nullopt;
+    }
+}
+
+void DetileMip(DetilerType type, const TiledMipLayout& mip, std::span<const u8> tiled,
+               std::span<u8> linear) {
+    CopyMip<false>(type, mip, tiled, linear);
+}
+
+void TileMip(DetilerType type, const TiledMipLayout& mip, std::span<const u8> linear,
+             std::span<u8> tiled) {
+    CopyMip<true>(type, mip, linear, tiled);
+}
+
+bool DetileImage(const ImageInfo& info, std::span<const u8> tiled, std::span<u8> linear) {
+    const auto type = GetDetilerType(info);
+    if (!type) {
+        return false;
+    }
+    for (u32 m = 0; m < info.resources.levels; ++m) {
+        DetileMip(*type, GetMipLayout(info, *type, m), tiled, linear);
+    }
+    return true;
+}
+
+bool TileImage(const ImageInfo& info, std::span<const u8> linear, std::span<u8> tiled) {
+    const auto type = GetDetilerType(info);
+    if (!type) {
+        return false;
+    }
+    for (u32 m = 0; m < info.resources.levels; ++m) {
+        TileMip(*type, GetMipLayout(info, *type, m), linear, tiled);
+    }
+    return true;
+}
+
+} // namespace VideoCore
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <optional>
+#include <span>
+
+#include "common/types.h"
+
+namespace VideoCore {
+
+struct ImageInfo;
+
+enum DetilerType : u32 {
+    Micro8,
+    Micro16,
+    Micro32,
+    Micro64,
+    Micro128,
+
+    Macro8,
+    Macro32,
+    Macro64,
+
+    Display_Micro64,
+
+    Max
+};
+
+/// Returns the detiler handling the tiling mode and element size of the image, if any.
+std::optional<DetilerType> GetDetilerType(const ImageInfo& info);
+
+/// Layout of one mip level, in elements (texels, or blocks for compressed formats). The linear
+/// side is the layout the texture cache copies images from and to: rows of pitch elements and
+/// slices of height rows, starting at the same byte offset as the tiled mip.
+struct TiledMipLayout {
+    u32 pitch;
+    u32 height;
+    u32 num_slices;
+    u32 offset;
+};
+
+/// CPU counterparts of the detiler shaders. DetileMip produces the layout the shaders write,
+/// TileMip is its exact inverse. Padding in the tiled layout is left untouched.
+void DetileMip(DetilerType type, const TiledMipLayout& mip, std::span<const u8> tiled,
+               std::span<u8> linear);
+void TileMip(DetilerType type, const TiledMipLayout& mip, std::span<const u8> linear,
+             std::span<u8> tiled);
+
+/// Converts every mip of the image, returns false if the image has no CPU tiler.
+bool DetileImage(const ImageInfo& info, std::span<const u8> tiled, std::span<u8> linear);
+bool TileImage(const ImageInfo& info, std::span<const u8> linear, std::span<u8> tiled);
+
+} // namespace VideoCore